@@ -0,0 +1,144 @@
+import struct
+import sys
+
+# Wire layouts of src/monitor/monServiceMessage.h, all little endian and packed
+DATA_MESSAGE_GENERIC = struct.Struct("<BBBHHI")
+MON_ONE_MESSAGE = struct.Struct("<HIIHHII")
+MON_DELTA_MESSAGE = struct.Struct("<HBHHIIHHIBB")
+ROUTING_ENTRY = struct.Struct("<HbH")
+MON_COMPACT_METRICS = struct.Struct("<HHHHHB")
+
+MONCOUNT_MONONEMESSAGE = 0xFFFF
+MONCOUNT_MONDELTAMESSAGE = 0xFFFE
+
+# Must be the same as MON_SRTT_UNIT, MON_COMPACT_WAIT_UNIT and MON_COMPACT_HEAP_UNIT in src/config.h
+MON_SRTT_UNIT = 10
+MON_COMPACT_WAIT_UNIT = 100
+MON_COMPACT_HEAP_UNIT = 256
+
+# Size of a routing entry before the fixed width encoding (uint32_t, int8_t and unsigned long)
+LEGACY_ROUTING_ENTRY_SIZE = 9
+
+
+def decodeRoutingEntries(data, offset, count):
+    entries = []
+    for _ in range(count):
+        neighbor, rxSNR, srtt = ROUTING_ENTRY.unpack_from(data, offset)
+        entries.append(
+            {"neighbor": neighbor, "RxSNR": rxSNR, "SRTT": srtt * MON_SRTT_UNIT}
+        )
+        offset += ROUTING_ENTRY.size
+    return entries, offset
+
+
+def decodeHeader(data):
+    (
+        appPortDst,
+        appPortSrc,
+        messageId,
+        addrSrc,
+        addrDst,
+        messageSize,
+    ) = DATA_MESSAGE_GENERIC.unpack_from(data, 0)
+
+    return {
+        "appPortDst": appPortDst,
+        "appPortSrc": appPortSrc,
+        "messageId": messageId,
+        "addrSrc": addrSrc,
+        "addrDst": addrDst,
+        "messageSize": messageSize,
+    }
+
+
+def decodeMonOneMessage(data):
+    message = decodeHeader(data)
+    (
+        message["RTcount"],
+        message["uptime"],
+        message["time"],
+        message["TxQ"],
+        message["RxQ"],
+        message["airtimeLeft"],
+        count,
+    ) = MON_ONE_MESSAGE.unpack_from(data, DATA_MESSAGE_GENERIC.size)
+
+    message["number_of_neighbors"] = count
+    message["rt"], _ = decodeRoutingEntries(
+        data, DATA_MESSAGE_GENERIC.size + MON_ONE_MESSAGE.size, count
+    )
+    return message
+
+
+def decodeMonDeltaMessage(data):
+    message = decodeHeader(data)
+    (
+        message["RTcount"],
+        message["monCommand"],
+        message["seq"],
+        message["baseSeq"],
+        message["uptime"],
+        message["time"],
+        message["TxQ"],
+        message["RxQ"],
+        message["airtimeLeft"],
+        updated,
+        removed,
+    ) = MON_DELTA_MESSAGE.unpack_from(data, DATA_MESSAGE_GENERIC.size)
+
+    offset = DATA_MESSAGE_GENERIC.size + MON_DELTA_MESSAGE.size
+    message["updated"], offset = decodeRoutingEntries(data, offset, updated)
+    message["removed"] = list(struct.unpack_from("<%dH" % removed, data, offset))
+    offset += removed * 2
+
+    # The compact metrics are only in the reports of the newer nodes
+    if len(data) >= offset + MON_COMPACT_METRICS.size:
+        (
+            window,
+            waitP95,
+            waitMax,
+            freeHeapMin,
+            maxAllocHeapMin,
+            txQueueMax,
+        ) = MON_COMPACT_METRICS.unpack_from(data, offset)
+        message["metrics"] = {
+            "window": window * 1000,
+            "rxDrainWaitP95": waitP95 * MON_COMPACT_WAIT_UNIT,
+            "rxDrainWaitMax": waitMax * MON_COMPACT_WAIT_UNIT,
+            "freeHeapMin": freeHeapMin * MON_COMPACT_HEAP_UNIT,
+            "maxAllocHeapMin": maxAllocHeapMin * MON_COMPACT_HEAP_UNIT,
+            "txQueueMax": txQueueMax,
+        }
+    return message
+
+
+def decodeMonMessage(data):
+    """Decode a Mon message from its bytes, starting at the DataMessageGeneric header"""
+    (rtCount,) = struct.unpack_from("<H", data, DATA_MESSAGE_GENERIC.size)
+
+    if rtCount == MONCOUNT_MONONEMESSAGE:
+        return decodeMonOneMessage(data)
+    if rtCount == MONCOUNT_MONDELTAMESSAGE:
+        return decodeMonDeltaMessage(data)
+
+    raise ValueError("Not a monOneMessage or monDeltaMessage, RTcount %d" % rtCount)
+
+
+def bytesPerNeighbor():
+    """Bytes of a routing entry in the current and the previous encoding"""
+    return ROUTING_ENTRY.size, LEGACY_ROUTING_ENTRY_SIZE
+
+
+if __name__ == "__main__":
+    # Decode hex dumps, one message per line
+    for line in sys.stdin:
+        line = line.strip()
+        if line:
+            print(decodeMonMessage(bytes.fromhex(line)))
+
+    current, legacy = bytesPerNeighbor()
+    print(
+        "Bytes per neighbor: %d, %d before (%.0f%% less)"
+        % (current, legacy, 100.0 * (legacy - current) / legacy),
+        file=sys.stderr,
+    )
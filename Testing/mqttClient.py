@@ -58,7 +58,10 @@ class MQTT:
         # Parse the message.payload to json
         try:
             message_payload = json.loads(message.payload)
-            self.packetService.processPacket(message_payload)
+            reply = self.packetService.processPacket(message_payload)
+            if reply is not None:
+                gateway = reply.pop("gateway")
+                self.client.publish(f"from-server/{gateway}", json.dumps(reply), 2)
 
             # Add the new data
             json_data.append(
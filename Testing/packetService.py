@@ -1,4 +1,5 @@
 import status
+import simStateDecoder
 import os
 import json
 from datetime import datetime
@@ -16,9 +17,14 @@ class PacketService:
         self.file = file
         self.monitorFileName = os.path.join(file, "stateMonitors.json")
         self.dataFileName = os.path.join(file, "messages.json")
+        self.flowFileName = os.path.join(file, "flowReports.json")
         self.status = status.Status(file, numberOfPorts)
         self.shared_state_change = shared_state_change
         self.shared_state = shared_state
+        # Chunks of the state log already saved, by (addrSrc, run, seq)
+        self.stateChunks = set()
+        # Records saved per (addrSrc, run)
+        self.stateRecords = {}
 
     def savePacket(self, fileName, packet):
         json_data = self.createAndOpenFile(fileName)
@@ -37,6 +43,48 @@ class PacketService:
     def saveMonitor(self, packet):
         self.savePacket(self.monitorFileName, packet)
 
+    def saveMonitors(self, packets):
+        json_data = self.createAndOpenFile(self.monitorFileName)
+
+        date = datetime.now().strftime("%d/%m/%Y %H:%M:%S")
+        json_data.extend({"payload": packet, "date": date} for packet in packets)
+
+        with open(self.monitorFileName, "w") as file:
+            file.write(json.dumps(json_data, indent=4))
+
+    def saveStateChunk(self, data):
+        """Save the records of a chunk of the state log once and return the ack the node waits
+        for, a retransmitted chunk is only acknowledged again. The ack goes to the topic of the
+        gateway in "gateway"."""
+        header, messages = simStateDecoder.decodeMessage(data)
+
+        addrSrc = data["addrSrc"]
+        key = (addrSrc, header["run"], header["seq"])
+
+        if key not in self.stateChunks:
+            self.stateChunks.add(key)
+            self.saveMonitors(messages)
+
+            run = (addrSrc, header["run"])
+            self.stateRecords[run] = self.stateRecords.get(run, 0) + header["count"]
+            if self.stateRecords[run] == header["total"]:
+                print(f"Device {addrSrc} uploaded {header['total']} states")
+
+        # The chunk is relayed by the gateway in addrDst, or sent by the gateway itself
+        gateway = data["addrDst"] if data["addrDst"] != 0 else addrSrc
+
+        return {
+            "gateway": gateway,
+            "data": {
+                "appPortDst": 12,
+                "appPortSrc": 12,
+                "addrDst": addrSrc,
+                "simCommand": 9,
+                "run": header["run"],
+                "seq": header["seq"],
+            }
+        }
+
     def saveData(self, packet):
         self.savePacket(self.dataFileName, packet)
 
@@ -56,6 +104,7 @@ class PacketService:
         return json_data
 
     def processPacket(self, packet):
+        """Process a message of a node, returns the reply for the node or None"""
         # Check if "appPortSrc" key exists in the JSON data
         if "data" in packet and "simCommand" in packet["data"]:
             simCommand = packet["data"]["simCommand"]
@@ -99,9 +148,19 @@ class PacketService:
 
             elif simCommand == 3:
                 self.saveData(packet["data"])
+
+            elif simCommand == 10:
+                # Flow summaries measured by a gateway
+                self.savePacket(self.flowFileName, packet["data"])
+
+            elif simCommand == 8:
+                # Chunk of the state log
+                return self.saveStateChunk(packet["data"])
         elif "data" in packet:
             self.saveData(packet["data"])
 
+        return None
+
     def SetStatusAndCheckAll(
         self,
         packet,
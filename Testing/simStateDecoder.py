@@ -0,0 +1,138 @@
+import base64
+import json
+import struct
+import sys
+
+# Layout of SimStateChunkHeader in src/simulator/simStateChunk.h
+HEADER_FORMAT = "<BBHIIBH"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+CHUNK_VERSION = 1
+
+STATE_FIELDS = 18
+DELTA_FIELDS = (0, 8, 9)
+
+# simCommand of the per record messages the decoder reproduces
+STATE_MESSAGE_COMMAND = 2
+
+
+def readVarint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, offset
+
+
+def decodeChunk(encoded):
+    """Decode the base64 chunk of a StateChunk message.
+
+    Returns the header as a dict and the records as lists of fields, in the order of
+    SimStateChunk::getFields.
+    """
+    data = base64.b64decode(encoded)
+
+    version, run, seq, first, total, count, legacyMessageSize = struct.unpack_from(
+        HEADER_FORMAT, data
+    )
+    if version != CHUNK_VERSION:
+        raise ValueError(f"Unknown state chunk version {version}")
+
+    header = {
+        "run": run,
+        "seq": seq,
+        "first": first,
+        "total": total,
+        "count": count,
+        "legacyMessageSize": legacyMessageSize,
+    }
+
+    records = []
+    previous = [0] * STATE_FIELDS
+    offset = HEADER_SIZE
+
+    for _ in range(count):
+        mask, offset = readVarint(data, offset)
+        fields = list(previous)
+
+        for i in range(STATE_FIELDS):
+            if not mask & (1 << i):
+                continue
+
+            value, offset = readVarint(data, offset)
+            if i in DELTA_FIELDS:
+                delta = (value >> 1) ^ -(value & 1)
+                value = (previous[i] + delta) & 0xFFFFFFFF
+
+            fields[i] = value
+
+        records.append(fields)
+        previous = fields
+
+    return header, records
+
+
+def toStateMessage(addrSrc, legacyMessageSize, fields):
+    """The JSON the node sent for a record before the binary upload"""
+    return {
+        "messageId": fields[0] & 0xFF,
+        "addrSrc": addrSrc,
+        "addrDst": 0,
+        "messageSize": legacyMessageSize,
+        "simCommand": STATE_MESSAGE_COMMAND,
+        "state": {
+            "Id": fields[0],
+            "Type": fields[1],
+            "QR": fields[2],
+            "QS": fields[3],
+            "QRU": fields[4],
+            "QWRP": fields[5],
+            "QWSP": fields[6],
+            "RT": fields[7],
+            "SSS": fields[8],
+            "FMA": fields[9],
+            "packetHeader": {
+                "Type": fields[10],
+                "Id": fields[11],
+                "Size": fields[12],
+                "Src": fields[13],
+                "Dst": fields[14],
+                "Via": fields[15],
+                "SeqId": fields[16],
+                "Num": fields[17],
+            },
+        },
+    }
+
+
+def decodeMessage(data):
+    """Decode the data of a StateChunk message into the header and the per record messages"""
+    header, records = decodeChunk(data["chunk"])
+
+    messages = [
+        toStateMessage(data["addrSrc"], header["legacyMessageSize"], fields)
+        for fields in records
+    ]
+
+    return header, messages
+
+
+if __name__ == "__main__":
+    # Decode the StateChunk messages of a data.json written by mqttClient.py
+    if len(sys.argv) != 2:
+        print("Usage: python simStateDecoder.py <data.json>")
+        sys.exit(1)
+
+    with open(sys.argv[1], "r") as file:
+        entries = json.load(file)
+
+    states = []
+    for entry in entries:
+        data = entry["payload"].get("data", {})
+        if data.get("simCommand") == 8:
+            states.extend(decodeMessage(data)[1])
+
+    print(json.dumps(states, indent=4))
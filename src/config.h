@@ -121,15 +121,88 @@
 #define MQTT_STILL_CONNECTED_INTERVAL 300000  // In milliseconds, 0 to disable
 
 // Sensors Configuration
-#define STORED_SENSOR_DATA 10
+#define STORED_SENSOR_DATA 10  // Readings per sensor in the statistics of the metadata
+#define SENSOR_COUNT 4          // Sensors of the SensorService
 //- Temperature Configuration
 #define SOIL_SENSOR_PIN 12
-#define SENSOR_SENDING_EVERY 60000  // ms
+#define SENSOR_SENDING_EVERY 60000  // ms, reporting window of the aggregated sensor reports
+//- Sampling of each sensor, the samples are aggregated until the next report
+#define PH_SENSOR_SAMPLE_EVERY 30000           // ms
+#define AIR_SENSOR_SAMPLE_EVERY 10000          // ms
+#define SOIL_SENSOR_SAMPLE_EVERY 5000          // ms
+#define WATER_LEVEL_SENSOR_SAMPLE_EVERY 10000  // ms
+//- Conversions, started together and polled without blocking until ready or timed out
+#define SENSOR_POLL_INTERVAL 10             // ms between the checks of a conversion past its time
+#define PH_SENSOR_CONVERSION 1000           // ms, EZO read command
+#define WATER_LEVEL_SENSOR_CONVERSION 600   // ms, VL53L1X ranging with a 500 ms timing budget
+#define PH_SENSOR_TIMEOUT 2000              // ms until a conversion is recorded as missing
+#define AIR_SENSOR_TIMEOUT 100
+#define SOIL_SENSOR_TIMEOUT 1000
+#define WATER_LEVEL_SENSOR_TIMEOUT 1200
+//- Report by exception, a measurement is only reported when its window mean leaves the deadband
+//- around the last reported value, max(absolute, relative * |last|), or after SENSOR_HEARTBEAT
+#define SENSOR_HEARTBEAT 3600000          // ms without reporting a measurement, 0 to report all
+#define PH_SENSOR_DEADBAND 0.02           // Relative deadbands of the sensors
+#define AIR_SENSOR_DEADBAND 0.02
+#define SOIL_SENSOR_DEADBAND 0.02
+#define WATER_LEVEL_SENSOR_DEADBAND 0.02
+#define SOIL_TEMPERATURE_DEADBAND 0.2     // Absolute deadbands of the measurements, C
+#define SOIL_PH_DEADBAND 0.05             // pH
+#define HUMIDITY_DEADBAND 2               // %
+#define TEMPERATURE_DEADBAND 0.3          // C
+#define SOIL_MOISTURE_DEADBAND 1          // %
+#define SOIL_CONDUCTIVITY_DEADBAND 10     // us/cm
+#define WATER_LEVEL_DEADBAND 5            // mm
+//- Compact reports, see sensor/generic/compactMeasurement.h. The gateways expand them to the JSON
+//- of the full reports, comment to send the full reports to gateways with older firmware
+#define SENSOR_COMPACT_REPORTS
+#define SENSOR_POSITION_MOVED 10          // m, the position is sent when it moved more
+#define SENSOR_POSITION_CACHE 32          // Nodes whose last position the gateway keeps
+//- History of the window means in SPIFFS, for the backfill of the server
+#define SENSOR_HISTORY_FILE "/history.bin"
+#define SENSOR_HISTORY_OLD_FILE "/history.old"
+#define SENSOR_HISTORY_MAX_SIZE 262144     // Bytes of both files, the oldest half is deleted
+#define SENSOR_HISTORY_BLOCK 96            // Bytes of compressed points per block and frame
+#define SENSOR_HISTORY_FRAME_INTERVAL 5000 // ms between the frames of a backfill
 //- Metadata Configuration
 #define METADATA_UPDATE_DELAY 300000  // ms
 
 // MQTT_MON configuration
-#define MON_SENDING_EVERY 30000  // ms
+#define MON_SENDING_EVERY 30000           // ms, initial report interval
+#define MON_MIN_INTERVAL 10000            // ms, shortest report interval
+#define MON_MAX_INTERVAL 300000           // ms, longest report interval
+#define MON_TOPOLOGY_CHECK_INTERVAL 5000  // ms between checks of the routing table
+#define MON_CHURN_HIGH 3                  // Changes in an interval that halve it
+#define MON_QUIET_REPORTS 3               // Reports without changes that double the interval
+#define MON_QUEUE_GROWTH 4                // Send queue growth counted as a change
+#define MON_DELTA_ENABLED 1               // Send the neighbor changes instead of full tables
+#define MON_KEYFRAME_EVERY 10             // Reports between full keyframes
+#define MON_DELTA_SNR_THRESHOLD 3         // dB of SNR change that reports a neighbor
+#define MON_DELTA_SRTT_THRESHOLD 500      // ms of SRTT change that reports a neighbor
+#define MON_DELTA_SRTT_PERCENT 25         // % of SRTT change that reports a neighbor, if larger
+#define MON_METRICS_INTERVAL 600000       // ms between full metrics summaries
+#define MON_TASKS_INTERVAL 3600000        // ms between task and queue snapshots
+#define MON_COMPACT_WAIT_UNIT 100         // us per unit of the drain wait in the Mon reports
+#define MON_COMPACT_HEAP_UNIT 256         // Bytes per unit of the heap in the Mon reports
+#define METRICS_SAMPLE_INTERVAL 1000      // ms between samples of the queues and the heap
+#define METRICS_HEAP_BUCKET 16384         // Bytes per linear bucket of the heap histograms
+#define MON_SRTT_UNIT 10                  // ms per unit of the SRTT in the Mon reports
+
+// Heap configuration, the call site accounting needs a build with HEAP_PROFILE
+#ifdef HEAP_PROFILE
+#define HEAP_REPORT_INTERVAL 60000  // ms
+#else
+#define HEAP_REPORT_INTERVAL 200000  // ms
+#endif
+#define HEAP_PROFILE_SITES 64   // Allocation call sites tracked
+#define HEAP_PROFILE_LIVE 1024  // Live allocations tracked
+#define HEAP_PROFILE_TOP 5      // Call sites in each list of the report
+
+// Message trace configuration, see MessageTraceRecorder
+#define MESSAGE_TRACE_FILE "/trace.bin"
+#define MESSAGE_TRACE_BUFFER_SIZE 4096  // Bytes collected before appending them to the file
+#define MESSAGE_TRACE_MAX_MESSAGE 1024  // Bytes of a message kept, the rest is truncated
+#define MESSAGE_TRACE_MAX_SIZE 262144   // Bytes of the trace file
 
 
 // Battery configuration
@@ -305,7 +378,58 @@
 #endif
 
 
+// Duty cycle configuration
+#define DUTY_CYCLE_ENABLED 1
+#define DUTY_CYCLE_WINDOW 3600000  // ms, ETSI EN 300 220 observation period
+#define DUTY_CYCLE_BUCKETS 60      // Sliding window resolution (window / buckets)
+#define DUTY_CYCLE_RESERVE 20      // % of the budget kept for high priority and mesh control frames
+#define DUTY_CYCLE_DEFERRED_QUEUE_SIZE 10  // Deferred messages per priority
+#define LORAMESH_MAX_PACKET_SIZE 222       // LoRaMesher MAXPACKETSIZE, bytes of a frame
+#define LORAMESH_PACKET_OVERHEAD 12        // LoRaMesher header bytes added to every frame
+#define LORAMESH_MAX_FRAME_PAYLOAD (LORAMESH_MAX_PACKET_SIZE - LORAMESH_PACKET_OVERHEAD)
+
+// Piggyback configuration, Mon and Metadata messages wait to be attached to other frames
+#define PIGGYBACK_ENABLED 1
+#define PIGGYBACK_DEADLINE 20000  // ms waiting for a carrier before sending alone
+#define PIGGYBACK_MAX_PENDING 4   // Messages waiting for a carrier
+
+// Carry forward configuration, gateway-bound messages are kept while there is no gateway
+#define CARRY_FORWARD_MAX_MESSAGES 32       // Messages kept without a gateway
+#define CARRY_FORWARD_MAX_BYTES 4096        // Bytes of the messages kept without a gateway
+#define CARRY_FORWARD_POLICY 1              // When full, drop 0 the oldest, 1 the lowest priority
+#define CARRY_FORWARD_BATCH 4               // Messages flushed per batch once a gateway is known
+#define CARRY_FORWARD_BATCH_INTERVAL 10000  // ms between batches
+#define CARRY_FORWARD_POLL_INTERVAL 5000    // ms between checks for a gateway
+
+// Receive configuration
+#define RECEIVE_BATCH_SIZE 8  // Packets processed before yielding to other tasks
+
+// Transfer configuration
+#define TRANSFER_CHUNK_SIZE 80             // Bytes per chunk, a chunk must fit in one LoRa frame
+#define TRANSFER_WINDOW 8                  // Chunks in flight without ACK (max 32)
+#define TRANSFER_ACK_EVERY (TRANSFER_WINDOW / 2)  // Chunks received before sending an ACK
+#define TRANSFER_MAX_SIZE 16384            // Largest message in bytes
+#define TRANSFER_MAX_INCOMING 2
+#define TRANSFER_MAX_OUTGOING 4
+#define TRANSFER_MAX_QUEUED 3              // LoRaMesher send queue size that pauses the chunks
+#define TRANSFER_ACK_TIMEOUT 30000         // ms without ACK before probing the receiver
+#define TRANSFER_MAX_PROBES 3              // Unanswered probes before the transfer is interrupted
+#define TRANSFER_RESUME_INTERVAL 120000    // ms between resume attempts of an interrupted transfer
+#define TRANSFER_EXPIRE_TIMEOUT 3600000    // ms without progress before a transfer is dropped
+#define TRANSFER_TICK 1000                 // ms between checks of the outgoing transfers
+
+// Time synchronization configuration
+#define TIME_SYNC_NTP_SERVER "pool.ntp.org"
+#define TIME_SYNC_BEACON_INTERVAL 120000  // ms between beacons of a synchronized node
+#define TIME_SYNC_TIMEOUT (3 * TIME_SYNC_BEACON_INTERVAL)  // ms before accepting another source
+#define TIME_SYNC_HOLDOVER 3600000        // ms the time stays valid without beacons
+#define TIME_SYNC_MAX_STRATUM 8           // Hops from the gateway the time is propagated
+#define TIME_SYNC_STEP_THRESHOLD 2000     // ms of error that steps the clock instead of slewing
+#define TIME_SYNC_MAX_DRIFT 500           // ppm
+
+
 // Simulation Configuration
+// Defaults of the Sim run spec, /simSpec or a SetRunSpec message change them at runtime
 // The address of the device that will connect at the beginning of the simulation
 #define WIFI_ADDR_CONNECTED 20056
 
@@ -318,8 +442,14 @@
 // If defined, there only be one sender
 #define ONE_SENDER 35872
 
+#define SIM_MAX_SENDERS 8        // Senders in a run spec
+#define SIM_MAX_PACKET_SIZE 1000 // Largest Sim packet of a run spec
+
+// Default delivery mode when neither the producer nor the delivery policy choose one.
 // If defined 0 the packets will be sent unreliably
 #define SEND_RELIABLE 0
+#define RELIABLE_DELIVERY_TIMEOUT 300000  // ms until a pending reliable send is timed out
+#define DELIVERY_POLL_INTERVAL 1000       // ms between checks of the pending reliable sends
 
 // Simulator Delay Configuration (all times in milliseconds unless specified)
 #define SIM_NETWORK_PROPAGATION_MULTIPLIER 15
@@ -327,6 +457,16 @@
 #define SIM_POST_START_DELAY 30000
 #define SIM_UPLOAD_DELAY_CONNECTED 2000
 #define SIM_UPLOAD_DELAY_DISCONNECTED 40000
+#define SIM_UPLOAD_CHUNK_SIZE 512         // Bytes of the state log chunks, see SimStateChunk
+#define SIM_UPLOAD_ACK_TIMEOUT 10000      // ms waiting for the server to confirm a chunk
+#define SIM_UPLOAD_MAX_RETRIES 30         // Attempts per chunk before the upload is left
+#define SIM_STATE_RING_SIZE 256           // States kept in RAM before spilling to flash
+#define SIM_STATE_SPILL_MAX_SIZE 262144   // Bytes of the flash log of the states
+#define SIM_STATE_SPILL_FILE "/simStates.bin"
+#define SIM_STATE_DRAIN_INTERVAL 1000     // ms between moves of the captured states to the store
+#define SIM_FLOW_MAX 16                   // Sim flows measured by a gateway
+#define SIM_FLOW_REPORT_INTERVAL 60000    // ms between the flow reports of a gateway
+#define SIM_FLOW_REPORT_BATCH 5           // Flows per report message
 #define SIM_QUEUE_CONGESTION_DELAY 20000
 #define SIM_NON_SENDER_WAIT 600000
 #define SIM_POST_MQTT_DELAY 1000
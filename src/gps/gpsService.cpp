@@ -107,6 +107,10 @@ String GPSService::gpsResponse(messagePort port, DataMessage* message) {
 GPSMessage GPSService::getGPSMessage() {
     getGPSUpdatedWait();
 
+    return getLastGPSMessage();
+}
+
+GPSMessage GPSService::getLastGPSMessage() {
     GPSMessage gpsMessage;
 
     gpsMessage.latitude = gps.location.lat();
@@ -120,6 +124,18 @@ GPSMessage GPSService::getGPSMessage() {
     gpsMessage.month = gps.date.month();
     gpsMessage.year = gps.date.year();
 
+    // Without a GPS fix use the time synchronized from the gateways
+    struct tm utc;
+    if ((!gps.date.isValid() || gpsMessage.year < 2000) &&
+        TimeSyncService::getInstance().getUTCTime(&utc)) {
+        gpsMessage.second = utc.tm_sec;
+        gpsMessage.minute = utc.tm_min;
+        gpsMessage.hour = utc.tm_hour;
+        gpsMessage.day = utc.tm_mday;
+        gpsMessage.month = utc.tm_mon + 1;
+        gpsMessage.year = utc.tm_year + 1900;
+    }
+
     return gpsMessage;
 }
 
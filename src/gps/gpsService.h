@@ -21,6 +21,8 @@
 
 #include "time/timeHelper.h"
 
+#include "time/timeSyncService.h"
+
 #include "gpsCommandService.h"
 
 #include "display/displayService.h"
@@ -123,8 +125,18 @@ public:
 
     String gpsResponse(messagePort port, DataMessage* message);
 
+    /**
+     * @brief Wait for a valid position and get it
+     *
+     */
     GPSMessage getGPSMessage();
 
+    /**
+     * @brief Get the last position decoded by the GPS task, without waiting
+     *
+     */
+    GPSMessage getLastGPSMessage();
+
 private:
     GPSService() : MessageService(appPort::GPSApp, String("GPS")) {
         gpsCommandService = new GPSCommandService();
@@ -0,0 +1,340 @@
+#include "heapProfiler.h"
+
+#include <new>
+
+// Tombstone of the removed live allocations, keeps the probe sequences of the others
+#define HEAP_PROFILE_REMOVED ((void*)1)
+
+// Probes before giving up on a live allocation slot
+#define HEAP_PROFILE_MAX_PROBES 32
+
+// Return address of the function that called the allocator hook
+#define HEAP_PROFILE_CALLER ((uint32_t)(uintptr_t)__builtin_return_address(0))
+
+uint8_t HeapProfiler::getFragmentation() {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap == 0)
+        return 0;
+
+    return 100 - (uint64_t)ESP.getMaxAllocHeap() * 100 / freeHeap;
+}
+
+#ifdef HEAP_PROFILE
+
+struct HeapSite {
+    uint32_t address;  // Caller of the allocation, 0 for the free entries
+    uint8_t owner;     // appPort of the HeapOwner in scope, 0 without one
+    char task[10];     // Task of the first allocation, "isr" from an interrupt
+    uint32_t liveBytes;
+    uint32_t liveCount;
+    uint32_t allocations;
+    uint32_t reportedBytes;  // liveBytes at the previous report, to show the growth
+};
+
+struct LiveAllocation {
+    void* pointer;
+    uint32_t size;
+    uint8_t site;
+};
+
+static HeapSite sites[HEAP_PROFILE_SITES];
+static LiveAllocation live[HEAP_PROFILE_LIVE];
+
+// Allocations that did not fit in the tables, their bytes are not attributed
+static uint32_t untrackedAllocations = 0;
+
+// All the allocations seen, 0 if the linker wrappers are not in use
+static uint32_t totalAllocations = 0;
+
+static portMUX_TYPE heapProfilerLock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t getLiveSlot(void* pointer) {
+    return (uint32_t)(((uintptr_t)pointer >> 3) * 2654435761u) % HEAP_PROFILE_LIVE;
+}
+
+// appPort of the HeapOwner in scope of each task
+static thread_local uint8_t currentOwner = 0;
+
+HeapOwner::HeapOwner(uint8_t owner) {
+    previous = currentOwner;
+    currentOwner = owner;
+}
+
+HeapOwner::~HeapOwner() {
+    currentOwner = previous;
+}
+
+static int findSite(uint32_t caller, uint8_t owner) {
+    uint32_t slot = (caller ^ owner * 2654435761u) % HEAP_PROFILE_SITES;
+    for (uint8_t i = 0; i < HEAP_PROFILE_SITES; i++) {
+        HeapSite& site = sites[(slot + i) % HEAP_PROFILE_SITES];
+        if ((site.address == caller && site.owner == owner) || site.address == 0)
+            return (slot + i) % HEAP_PROFILE_SITES;
+    }
+
+    return -1;
+}
+
+static int findLive(void* pointer) {
+    uint32_t slot = getLiveSlot(pointer);
+    for (uint8_t i = 0; i < HEAP_PROFILE_MAX_PROBES; i++) {
+        LiveAllocation& allocation = live[(slot + i) % HEAP_PROFILE_LIVE];
+        if (allocation.pointer == pointer)
+            return (slot + i) % HEAP_PROFILE_LIVE;
+        if (allocation.pointer == nullptr)
+            return -1;
+    }
+
+    return -1;
+}
+
+static int findFreeLive(void* pointer) {
+    uint32_t slot = getLiveSlot(pointer);
+    for (uint8_t i = 0; i < HEAP_PROFILE_MAX_PROBES; i++) {
+        LiveAllocation& allocation = live[(slot + i) % HEAP_PROFILE_LIVE];
+        if (allocation.pointer == nullptr || allocation.pointer == HEAP_PROFILE_REMOVED)
+            return (slot + i) % HEAP_PROFILE_LIVE;
+    }
+
+    return -1;
+}
+
+void HeapProfiler::recordAllocation(void* pointer, size_t size, uint32_t caller) {
+    if (pointer == nullptr)
+        return;
+
+    // The constructors of the globals allocate before there is any task to name, or to hold the
+    // thread local owner
+    const char* task;
+    uint8_t owner = 0;
+    if (xPortInIsrContext())
+        task = "isr";
+    else if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED ||
+             xTaskGetCurrentTaskHandle() == NULL)
+        task = "boot";
+    else {
+        task = pcTaskGetName(NULL);
+        owner = currentOwner;
+    }
+
+    portENTER_CRITICAL_SAFE(&heapProfilerLock);
+
+    totalAllocations++;
+
+    int siteIndex = findSite(caller, owner);
+    int liveIndex = findFreeLive(pointer);
+
+    if (siteIndex < 0 || liveIndex < 0) {
+        untrackedAllocations++;
+        portEXIT_CRITICAL_SAFE(&heapProfilerLock);
+        return;
+    }
+
+    HeapSite& site = sites[siteIndex];
+    if (site.address == 0) {
+        site.address = caller;
+        site.owner = owner;
+        strncpy(site.task, task == nullptr ? "" : task, sizeof(site.task));
+    }
+    site.liveBytes += size;
+    site.liveCount++;
+    site.allocations++;
+
+    live[liveIndex] = {pointer, size, (uint8_t)siteIndex};
+
+    portEXIT_CRITICAL_SAFE(&heapProfilerLock);
+}
+
+void HeapProfiler::recordFree(void* pointer) {
+    if (pointer == nullptr)
+        return;
+
+    portENTER_CRITICAL_SAFE(&heapProfilerLock);
+
+    int liveIndex = findLive(pointer);
+    if (liveIndex >= 0) {
+        LiveAllocation& allocation = live[liveIndex];
+        HeapSite& site = sites[allocation.site];
+        site.liveBytes -= allocation.size;
+        site.liveCount--;
+        allocation.pointer = HEAP_PROFILE_REMOVED;
+    }
+
+    portEXIT_CRITICAL_SAFE(&heapProfilerLock);
+}
+
+/**
+ * @brief Insert a site in a list sorted by a key, keeping the first HEAP_PROFILE_TOP
+ *
+ */
+static void insertTop(HeapSite* top, int32_t* keys, uint8_t& size, HeapSite& site, int32_t key) {
+    if (size == HEAP_PROFILE_TOP && key <= keys[size - 1])
+        return;
+
+    uint8_t position = size < HEAP_PROFILE_TOP ? size++ : size - 1;
+    while (position > 0 && keys[position - 1] < key) {
+        top[position] = top[position - 1];
+        keys[position] = keys[position - 1];
+        position--;
+    }
+
+    top[position] = site;
+    keys[position] = key;
+}
+
+static String siteToString(HeapSite& site) {
+    char task[sizeof(site.task) + 1] = {};
+    memcpy(task, site.task, sizeof(site.task));
+
+    String owner = site.owner == 0 ? "" : ", appPort " + String(site.owner);
+
+    int32_t growth = (int32_t)(site.liveBytes - site.reportedBytes);
+    return "0x" + String(site.address, HEX) + " (" + String(task) + owner + "): " +
+           String(site.liveBytes) + " B in " + String(site.liveCount) + ", " +
+           (growth >= 0 ? "+" : "") + String(growth) + " B, " + String(site.allocations) +
+           " allocations\n";
+}
+
+#endif
+
+String HeapProfiler::getStatus(bool report) {
+    String status = "--- Heap ---\nFree " + String(ESP.getFreeHeap()) + " B, min free " +
+                    String(ESP.getMinFreeHeap()) + " B, largest block " +
+                    String(ESP.getMaxAllocHeap()) + " B, fragmentation " +
+                    String(getFragmentation()) + "%\n";
+
+#ifdef HEAP_PROFILE
+    HeapSite topLive[HEAP_PROFILE_TOP];
+    HeapSite topGrowth[HEAP_PROFILE_TOP];
+    int32_t liveKeys[HEAP_PROFILE_TOP];
+    int32_t growthKeys[HEAP_PROFILE_TOP];
+    uint8_t liveSize = 0;
+    uint8_t growthSize = 0;
+    uint32_t untracked;
+    uint32_t total;
+
+    portENTER_CRITICAL_SAFE(&heapProfilerLock);
+
+    for (uint8_t i = 0; i < HEAP_PROFILE_SITES; i++) {
+        HeapSite& site = sites[i];
+        if (site.address == 0)
+            continue;
+
+        insertTop(topLive, liveKeys, liveSize, site, site.liveBytes);
+
+        int32_t growth = (int32_t)(site.liveBytes - site.reportedBytes);
+        if (growth > 0)
+            insertTop(topGrowth, growthKeys, growthSize, site, growth);
+
+        if (report)
+            site.reportedBytes = site.liveBytes;
+    }
+
+    untracked = untrackedAllocations;
+    total = totalAllocations;
+
+    portEXIT_CRITICAL_SAFE(&heapProfilerLock);
+
+    status += "Top live:\n";
+    for (uint8_t i = 0; i < liveSize; i++) {
+        status += siteToString(topLive[i]);
+    }
+
+    status += "Top growth:\n";
+    for (uint8_t i = 0; i < growthSize; i++) {
+        status += siteToString(topGrowth[i]);
+    }
+
+    status += "Untracked allocations: " + String(untracked) + "\n";
+
+    if (total == 0)
+        status += "No allocation seen, the heap allocator is not linked through the wrappers\n";
+#endif
+
+    return status;
+}
+
+#ifdef HEAP_PROFILE
+
+// pvPortMalloc and vPortFree are macros of heap_caps_malloc_default and heap_caps_free in the
+// ESP-IDF FreeRTOS, and malloc, realloc and free of newlib call the same functions, so wrapping
+// them sees every allocation. The functions in heap_caps.c that call each other are not wrapped.
+extern "C" {
+void* __real_heap_caps_malloc_default(size_t size);
+void* __real_heap_caps_realloc_default(void* pointer, size_t size);
+void __real_heap_caps_free(void* pointer);
+
+void* __wrap_heap_caps_malloc_default(size_t size) {
+    void* pointer = __real_heap_caps_malloc_default(size);
+    HeapProfiler::recordAllocation(pointer, size, HEAP_PROFILE_CALLER);
+    return pointer;
+}
+
+void* __wrap_heap_caps_realloc_default(void* pointer, size_t size) {
+    void* resized = __real_heap_caps_realloc_default(pointer, size);
+
+    // A failed realloc keeps the original block
+    if (resized != nullptr || size == 0) {
+        HeapProfiler::recordFree(pointer);
+        HeapProfiler::recordAllocation(resized, size, HEAP_PROFILE_CALLER);
+    }
+    return resized;
+}
+
+void __wrap_heap_caps_free(void* pointer) {
+    HeapProfiler::recordFree(pointer);
+    __real_heap_caps_free(pointer);
+}
+}
+
+/**
+ * @brief Allocate for new without going through malloc, so the call site is the caller of new and
+ * not malloc
+ *
+ */
+static void* allocateNew(size_t size, uint32_t caller) {
+    void* pointer = __real_heap_caps_malloc_default(size);
+    HeapProfiler::recordAllocation(pointer, size, caller);
+    return pointer;
+}
+
+void* operator new(size_t size) {
+    void* pointer = allocateNew(size, HEAP_PROFILE_CALLER);
+    if (pointer == nullptr)
+        abort();
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    void* pointer = allocateNew(size, HEAP_PROFILE_CALLER);
+    if (pointer == nullptr)
+        abort();
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocateNew(size, HEAP_PROFILE_CALLER);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocateNew(size, HEAP_PROFILE_CALLER);
+}
+
+// free goes through the wrapper of heap_caps_free, which records it
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+#endif
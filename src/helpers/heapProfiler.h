@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+/**
+ * @brief Accounts the live heap by allocation call site. Only in the builds with HEAP_PROFILE (see
+ * the heap-profile environment in platformio.ini), they link the ESP-IDF heap_caps allocator
+ * through the wrappers of heapProfiler.cpp, which also replaces the global new and delete. The
+ * allocations made before the scheduler starts are attributed to the "boot" task.
+ *
+ * The call sites are return addresses, decode them with
+ * xtensa-esp32-elf-addr2line -pfiaC -e .pio/build/<env>/firmware.elf <address>
+ * For new and pvPortMalloc the address is the line that allocated. The C malloc, calloc and realloc
+ * reach the wrappers through newlib, so their address is always inside newlib and tells nothing,
+ * those sites are told apart by the task and by the HeapOwner, the appPort of the service whose
+ * message was being processed.
+ *
+ * The state is static, not a singleton, so the allocator hooks never run a lazy initialization that
+ * could allocate.
+ *
+ */
+class HeapProfiler {
+public:
+    static void recordAllocation(void* pointer, size_t size, uint32_t caller);
+
+    static void recordFree(void* pointer);
+
+    /**
+     * @brief Heap summary: free, minimum free, largest free block and fragmentation. With
+     * HEAP_PROFILE also the top call sites by live bytes and their growth since the previous
+     * report.
+     *
+     * @param report Start a new growth period
+     * @return String
+     */
+    static String getStatus(bool report = false);
+
+    /**
+     * @brief Percentage of the free heap that cannot be allocated in a single block
+     *
+     */
+    static uint8_t getFragmentation();
+};
+
+/**
+ * @brief Attributes the allocations of the current task to an appPort while in scope, the
+ * MessageManager sets it around the dispatch of each message to its service.
+ *
+ */
+class HeapOwner {
+public:
+#ifdef HEAP_PROFILE
+    explicit HeapOwner(uint8_t owner);
+
+    ~HeapOwner();
+
+private:
+    uint8_t previous;
+#else
+    explicit HeapOwner(uint8_t owner) {}
+#endif
+};
@@ -153,3 +153,14 @@ void Helper::printHex(uint8_t* data, int length, String title) {
     }
     Serial.println("]");
 }
+
+uint32_t Helper::crc32(const uint8_t* data, size_t length, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
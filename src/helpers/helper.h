@@ -19,4 +19,9 @@ public:
     static void hex2bin(const char* src, char* target);
     static int char2int(char src);
     static void printHex(uint8_t* data, int length, String title);
+
+    /**
+     * @brief CRC-32 (IEEE 802.3), pass the previous result as crc to continue a calculation
+     */
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
 };
\ No newline at end of file
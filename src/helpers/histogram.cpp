@@ -0,0 +1,98 @@
+#include "histogram.h"
+
+void Histogram::add(uint32_t value) {
+    buckets[getBucket(value, linearWidth)]++;
+    count++;
+    sum += value;
+
+    if (value < min)
+        min = value;
+    if (value > max)
+        max = value;
+}
+
+void Histogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    min = UINT32_MAX;
+    max = 0;
+    sum = 0;
+}
+
+void Histogram::load(const uint32_t* buckets, uint32_t min, uint32_t max, uint64_t sum) {
+    memcpy(this->buckets, buckets, sizeof(this->buckets));
+    count = 0;
+    for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        count += buckets[i];
+    }
+    this->min = min;
+    this->max = max;
+    this->sum = sum;
+}
+
+uint32_t Histogram::getPercentile(uint8_t percentile) {
+    if (count == 0)
+        return 0;
+
+    if (percentile >= 100)
+        return max;
+
+    uint32_t rank = (uint32_t)(((uint64_t)count * percentile + 99) / 100);
+    if (rank == 0)
+        rank = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (seen + buckets[i] < rank) {
+            seen += buckets[i];
+            continue;
+        }
+
+        uint32_t lower, upper;
+        if (linearWidth > 0) {
+            lower = i * linearWidth;
+            upper = (i + 1) * linearWidth - 1;
+        } else {
+            lower = i == 0 ? 0 : 1UL << (i - 1);
+            upper = (1UL << i) - 1;
+        }
+
+        if (i == HISTOGRAM_BUCKETS - 1)
+            upper = max;
+
+        // Clamp to the observed range, the first and last buckets can be very wide
+        if (lower < getMin())
+            lower = getMin();
+        if (upper > max)
+            upper = max;
+        if (upper < lower)
+            return lower;
+
+        return lower + (uint32_t)((uint64_t)(upper - lower) * (rank - seen - 1) /
+                                  (buckets[i] > 1 ? buckets[i] - 1 : 1));
+    }
+
+    return max;
+}
+
+String Histogram::toString(String name, String unit) {
+    return name + ": n " + String(count) + ", min " + String(getMin()) + ", mean " +
+           String(getMean()) + ", p50 " + String(getPercentile(50)) + ", p95 " +
+           String(getPercentile(95)) + ", p99 " + String(getPercentile(99)) + ", max " +
+           String(max) + " " + unit + "\n";
+}
+
+uint8_t Histogram::getBucket(uint32_t value, uint32_t linearWidth) {
+    if (linearWidth > 0) {
+        uint32_t bucket = value / linearWidth;
+        return bucket < HISTOGRAM_BUCKETS - 1 ? bucket : HISTOGRAM_BUCKETS - 1;
+    }
+
+    uint8_t bucket = 0;
+    while (value > 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
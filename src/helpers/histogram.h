@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define HISTOGRAM_BUCKETS 24
+
+/**
+ * @brief Fixed size histogram with power of two buckets. Bucket i counts the values in
+ * [2^(i-1), 2^i), the last bucket counts everything above. Adding a value is O(1) and does not
+ * allocate, so it can be used in the hot paths.
+ *
+ * The values of a narrow known range, like the free heap, can use linear buckets instead: bucket
+ * i counts [i * width, (i + 1) * width). A power of two bucket of the heap is as wide as the
+ * value, so its percentiles could be off by 2x.
+ *
+ */
+class Histogram {
+public:
+    void add(uint32_t value);
+
+    void reset();
+
+    /**
+     * @brief Use linear buckets of a width, 0 for the power of two buckets. Call it while empty.
+     *
+     */
+    void setLinear(uint32_t width) { linearWidth = width; }
+
+    uint32_t getCount() { return count; }
+
+    uint32_t getMin() { return count == 0 ? 0 : min; }
+
+    uint32_t getMax() { return max; }
+
+    uint32_t getMean() { return count == 0 ? 0 : (uint32_t)(sum / count); }
+
+    /**
+     * @brief Estimate a percentile, interpolating inside the bucket that contains it
+     *
+     * @param percentile 0 - 100
+     * @return uint32_t The estimated value
+     */
+    uint32_t getPercentile(uint8_t percentile);
+
+    /**
+     * @brief One line summary: count, min, mean, p50, p95, p99 and max
+     *
+     * @param name Name of the histogram
+     * @param unit Unit of the values
+     * @return String
+     */
+    String toString(String name, String unit);
+
+    /**
+     * @brief Replace the content with the buckets of another histogram
+     *
+     */
+    void load(const uint32_t* buckets, uint32_t min, uint32_t max, uint64_t sum);
+
+    static uint8_t getBucket(uint32_t value, uint32_t linearWidth = 0);
+
+private:
+    uint32_t buckets[HISTOGRAM_BUCKETS] = {};
+    uint32_t count = 0;
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    uint64_t sum = 0;
+    uint32_t linearWidth = 0;
+};
@@ -0,0 +1,161 @@
+#include "metrics.h"
+
+void AtomicHistogram::add(uint32_t value) {
+    buckets[Histogram::getBucket(value, linearWidth)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint32_t current = min.load(std::memory_order_relaxed);
+    while (value < current && !min.compare_exchange_weak(current, value)) {
+    }
+
+    current = max.load(std::memory_order_relaxed);
+    while (value > current && !max.compare_exchange_weak(current, value)) {
+    }
+}
+
+void AtomicHistogram::take(Histogram& histogram) {
+    uint32_t values[HISTOGRAM_BUCKETS];
+    for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        values[i] = buckets[i].exchange(0);
+    }
+
+    histogram.setLinear(linearWidth);
+    histogram.load(values, min.exchange(UINT32_MAX), max.exchange(0), sum.exchange(0));
+}
+
+void AtomicHistogram::peek(Histogram& histogram) {
+    uint32_t values[HISTOGRAM_BUCKETS];
+    for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        values[i] = buckets[i].load();
+    }
+
+    histogram.setLinear(linearWidth);
+    histogram.load(values, min.load(), max.load(), sum.load());
+}
+
+Metrics::Metrics() {
+    for (uint8_t i = 0; i < MetricCount; i++) {
+        if (isHeap((MetricId)i)) {
+            histograms[i].setLinear(METRICS_HEAP_BUCKET);
+            reportHistograms[i].setLinear(METRICS_HEAP_BUCKET);
+        }
+    }
+}
+
+const char* Metrics::getName(MetricId id) {
+    switch (id) {
+        case MetricTxQueue:
+            return "txQueue";
+        case MetricRxQueue:
+            return "rxQueue";
+        case MetricFreeHeap:
+            return "freeHeap";
+        case MetricNeighborSRTT:
+            return "neighborSRTT";
+        case MetricRxDrainWait:
+            return "rxDrainWait";
+        case MetricRxConvert:
+            return "rxConvert";
+        case MetricRxDispatch:
+            return "rxDispatch";
+        case MetricRxPackets:
+            return "rxPackets";
+        case MetricTxMessages:
+            return "txMessages";
+        case MetricMaxAllocHeap:
+            return "maxAllocHeap";
+        default:
+            return "unknown";
+    }
+}
+
+uint8_t Metrics::takeWindow(MetricSummary* summaries) {
+    uint8_t size = 0;
+    Histogram histogram;
+
+    for (uint8_t i = 0; i < MetricCount; i++) {
+        MetricId id = (MetricId)i;
+
+        if (isCounter(id)) {
+            summaries[size] = {i, counters[i].exchange(0), 0, 0, 0, 0};
+            size++;
+            continue;
+        }
+
+        histograms[i].take(histogram);
+        if (histogram.getCount() == 0)
+            continue;
+
+        summarize(id, histogram, summaries[size]);
+        size++;
+    }
+
+    windowStart = millis();
+
+    return size;
+}
+
+uint32_t Metrics::takeReportWindow(MetricSummary* summaries) {
+    Histogram histogram;
+
+    for (uint8_t i = 0; i < MetricCount; i++) {
+        MetricId id = (MetricId)i;
+        summaries[i] = {i, 0, 0, 0, 0, 0};
+
+        if (isCounter(id))
+            continue;
+
+        reportHistograms[i].take(histogram);
+        if (histogram.getCount() > 0)
+            summarize(id, histogram, summaries[i]);
+    }
+
+    uint32_t now = millis();
+    uint32_t window = now - reportWindowStart;
+    reportWindowStart = now;
+
+    return window;
+}
+
+void Metrics::peek(MetricId id, MetricSummary& summary) {
+    summary = {id, 0, 0, 0, 0, 0};
+    if (id >= MetricCount)
+        return;
+
+    if (isCounter(id)) {
+        summary.count = counters[id].load();
+        return;
+    }
+
+    Histogram histogram;
+    histograms[id].peek(histogram);
+    summarize(id, histogram, summary);
+}
+
+String Metrics::getStatus() {
+    String status = "--- Metrics, window of " + String((millis() - windowStart) / 1000) + " s ---\n";
+    Histogram histogram;
+
+    for (uint8_t i = 0; i < MetricCount; i++) {
+        MetricId id = (MetricId)i;
+
+        if (isCounter(id)) {
+            status += String(getName(id)) + ": " + String(counters[i].load()) + "\n";
+            continue;
+        }
+
+        histograms[i].peek(histogram);
+        status += histogram.toString(getName(id), "");
+    }
+
+    return status;
+}
+
+void Metrics::summarize(MetricId id, Histogram& histogram, MetricSummary& summary) {
+    summary.id = id;
+    summary.count = histogram.getCount();
+    summary.min = histogram.getMin();
+    summary.mean = histogram.getMean();
+    summary.p95 = histogram.getPercentile(95);
+    summary.max = histogram.getMax();
+}
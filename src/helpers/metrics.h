@@ -0,0 +1,165 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "config.h"
+
+#include "histogram.h"
+
+/**
+ * @brief Metrics known by every node, the ids are sent in the Mon reports so they must be the same
+ * in all the firmwares. Add new metrics before MetricCount and its name in Metrics::getName.
+ *
+ */
+enum MetricId : uint8_t {
+    MetricTxQueue = 0,       // Packets in the LoRaMesher send queue, sampled
+    MetricRxQueue = 1,       // Packets in the LoRaMesher received queue, sampled
+    MetricFreeHeap = 2,      // Free heap in bytes, sampled
+    MetricNeighborSRTT = 3,  // SRTT of the direct neighbors in ms, on every report
+    MetricRxDrainWait = 4,   // us from the wake-up of the receive task to the packet dequeue
+    MetricRxConvert = 5,     // us to convert a packet into a DataMessage
+    MetricRxDispatch = 6,    // us to dispatch a received message to its service
+    MetricRxPackets = 7,     // Counter of received packets
+    MetricTxMessages = 8,    // Counter of messages sent through the MessageManager
+    MetricMaxAllocHeap = 9,  // Largest free heap block in bytes, sampled
+    MetricCount
+};
+
+#pragma pack(1)
+
+/**
+ * @brief Aggregate of a metric during a window. Counters only use count.
+ *
+ */
+struct MetricSummary {
+    uint8_t id;
+    uint32_t count;
+    uint32_t min;
+    uint32_t mean;
+    uint32_t p95;
+    uint32_t max;
+};
+
+#pragma pack()
+
+/**
+ * @brief Histogram that can be updated from any task without locks. The values are kept in the
+ * same buckets as Histogram.
+ *
+ */
+class AtomicHistogram {
+public:
+    void add(uint32_t value);
+
+    /**
+     * @brief Use linear buckets of a width, see Histogram::setLinear. Call it while empty.
+     *
+     */
+    void setLinear(uint32_t width) { linearWidth = width; }
+
+    /**
+     * @brief Move the content into a Histogram and start a new window. A value added while the
+     * buckets are being moved can end up in either window.
+     *
+     */
+    void take(Histogram& histogram);
+
+    /**
+     * @brief Copy the content into a Histogram without resetting it
+     *
+     */
+    void peek(Histogram& histogram);
+
+private:
+    std::atomic<uint32_t> buckets[HISTOGRAM_BUCKETS] = {};
+    std::atomic<uint32_t> min{UINT32_MAX};
+    std::atomic<uint32_t> max{0};
+    std::atomic<uint32_t> sum{0};
+    uint32_t linearWidth = 0;
+};
+
+/**
+ * @brief Registry of the node metrics, aggregated per reporting window. Any task can record with
+ * Metrics::observe and Metrics::increment, they do not lock nor allocate.
+ *
+ * The distributions are aggregated in two windows: the one of the full summaries, closed by
+ * takeWindow, and the one of the compact metrics of every Mon report, closed by takeReportWindow.
+ *
+ */
+class Metrics {
+public:
+    static Metrics& getInstance() {
+        static Metrics instance;
+        return instance;
+    }
+
+    /**
+     * @brief Record a value of a distribution or a sampled gauge
+     *
+     */
+    static void observe(MetricId id, uint32_t value) {
+        if (id < MetricCount) {
+            getInstance().histograms[id].add(value);
+            getInstance().reportHistograms[id].add(value);
+        }
+    }
+
+    /**
+     * @brief Add to a counter
+     *
+     */
+    static void increment(MetricId id, uint32_t value = 1) {
+        if (id < MetricCount)
+            getInstance().counters[id].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static bool isCounter(MetricId id) { return id == MetricRxPackets || id == MetricTxMessages; }
+
+    static bool isHeap(MetricId id) { return id == MetricFreeHeap || id == MetricMaxAllocHeap; }
+
+    static const char* getName(MetricId id);
+
+    /**
+     * @brief Close the current window
+     *
+     * @param summaries Array of MetricCount summaries, only the metrics with values are written
+     * @return uint8_t Number of summaries written
+     */
+    uint8_t takeWindow(MetricSummary* summaries);
+
+    /**
+     * @brief Summary of a metric in the current window, without closing it
+     *
+     */
+    void peek(MetricId id, MetricSummary& summary);
+
+    uint32_t getWindowStart() { return windowStart; }
+
+    /**
+     * @brief Close the window of the compact metrics, which starts at the previous report
+     *
+     * @param summaries Array of MetricCount summaries, indexed by the metric id. The counters and
+     * the metrics without values are left at 0.
+     * @return uint32_t ms since the previous report
+     */
+    uint32_t takeReportWindow(MetricSummary* summaries);
+
+    /**
+     * @brief Current window, without closing it
+     *
+     */
+    String getStatus();
+
+private:
+    Metrics();
+
+    AtomicHistogram histograms[MetricCount];
+    AtomicHistogram reportHistograms[MetricCount];
+    std::atomic<uint32_t> counters[MetricCount] = {};
+    uint32_t windowStart = 0;
+    uint32_t reportWindowStart = 0;
+
+    static void summarize(MetricId id, Histogram& histogram, MetricSummary& summary);
+};
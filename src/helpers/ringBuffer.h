@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Fixed capacity ring buffer, the oldest element is overwritten when it is full. It does
+ * not allocate, the capacity is part of the type.
+ *
+ */
+template <typename T, size_t N>
+class RingBuffer {
+public:
+    /**
+     * @brief Add an element at the end
+     *
+     * @param evicted Set to the oldest element if it was overwritten, can be nullptr
+     * @return true If the buffer was full and the oldest element was overwritten
+     */
+    bool push(const T& value, T* evicted = nullptr) {
+        bool full = count == N;
+
+        if (full && evicted != nullptr)
+            *evicted = elements[head];
+
+        elements[head] = value;
+        head = (head + 1) % N;
+
+        if (!full)
+            count++;
+
+        return full;
+    }
+
+    /**
+     * @brief Element by age, 0 is the oldest
+     *
+     */
+    const T& operator[](size_t index) const { return elements[(head + N - count + index) % N]; }
+
+    /**
+     * @brief Newest element, only valid if the buffer is not empty
+     *
+     */
+    const T& last() const { return elements[(head + N - 1) % N]; }
+
+    size_t size() const { return count; }
+
+    static constexpr size_t capacity() { return N; }
+
+    bool isEmpty() const { return count == 0; }
+
+    bool isFull() const { return count == N; }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+private:
+    T elements[N] = {};
+    size_t head = 0;
+    size_t count = 0;
+};
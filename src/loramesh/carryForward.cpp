@@ -0,0 +1,154 @@
+#include "carryForward.h"
+
+static const char* CF_TAG = "CarryForward";
+
+bool CarryForward::add(DataMessage* message, SendPriority priority, DeliveryMode mode,
+                       DeliveryCallback callback) {
+    uint32_t size = message->getDataMessageSize();
+    if (size > CARRY_FORWARD_MAX_BYTES) {
+        rejected++;
+        return false;
+    }
+
+    std::vector<CarriedMessage> victims;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    while (carried.size() >= CARRY_FORWARD_MAX_MESSAGES ||
+           bytes + size > CARRY_FORWARD_MAX_BYTES) {
+        int victim = findVictim(priority);
+        if (victim < 0)
+            break;
+
+        victims.push_back(carried[victim]);
+        evict(victim);
+    }
+
+    bool fits = carried.size() < CARRY_FORWARD_MAX_MESSAGES &&
+                bytes + size <= CARRY_FORWARD_MAX_BYTES;
+
+    DataMessage* copy = fits ? (DataMessage*)pvPortMalloc(size) : nullptr;
+
+    if (copy != nullptr) {
+        memcpy(copy, message, size);
+        carried.push_back({copy, priority, mode, callback, millis()});
+        bytes += size;
+        kept++;
+    } else {
+        rejected++;
+    }
+
+    xSemaphoreGive(mutex);
+
+    // The senders of the evicted messages learn they will not be delivered
+    uint32_t now = millis();
+    for (CarriedMessage& victim : victims) {
+        ESP_LOGW(CF_TAG, "Message of appPort %d evicted", victim.message->appPortSrc);
+        if (victim.callback)
+            victim.callback(DeliveryResult::Dropped, now - victim.carriedAt);
+        vPortFree(victim.message);
+    }
+
+    return copy != nullptr;
+}
+
+int CarryForward::findVictim(SendPriority priority) {
+    if (carried.empty())
+        return -1;
+
+    if (CARRY_FORWARD_POLICY == CarryDropOldest)
+        return 0;
+
+    // The oldest of the lowest priority, if it is not above the new message
+    size_t victim = 0;
+    for (size_t i = 1; i < carried.size(); i++) {
+        if (carried[i].priority > carried[victim].priority)
+            victim = i;
+    }
+
+    return carried[victim].priority < priority ? -1 : (int)victim;
+}
+
+void CarryForward::evict(size_t index) {
+    bytes -= carried[index].message->getDataMessageSize();
+    carried.erase(carried.begin() + index);
+    evicted++;
+}
+
+bool CarryForward::take(CarriedMessage& message) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    uint32_t now = millis();
+
+    if (batchCount == 0 || now - batchStart >= CARRY_FORWARD_BATCH_INTERVAL) {
+        batchStart = now;
+        batchCount = 0;
+    }
+
+    if (carried.empty() || batchCount >= CARRY_FORWARD_BATCH) {
+        xSemaphoreGive(mutex);
+        return false;
+    }
+
+    // Higher priority first, then the oldest
+    size_t next = 0;
+    for (size_t i = 1; i < carried.size(); i++) {
+        if (carried[i].priority < carried[next].priority)
+            next = i;
+    }
+
+    message = carried[next];
+    bytes -= message.message->getDataMessageSize();
+    carried.erase(carried.begin() + next);
+
+    batchCount++;
+    flushed++;
+    maxDelay = std::max<uint32_t>(maxDelay, now - message.carriedAt);
+
+    xSemaphoreGive(mutex);
+
+    return true;
+}
+
+uint32_t CarryForward::getWaitTime(bool gateway) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    uint32_t waitTime = UINT32_MAX;
+
+    if (!carried.empty()) {
+        uint32_t elapsed = millis() - batchStart;
+
+        if (!gateway)
+            waitTime = CARRY_FORWARD_POLL_INTERVAL;
+        else if (batchCount < CARRY_FORWARD_BATCH || elapsed >= CARRY_FORWARD_BATCH_INTERVAL)
+            waitTime = 0;
+        else
+            waitTime = CARRY_FORWARD_BATCH_INTERVAL - elapsed;
+    }
+
+    xSemaphoreGive(mutex);
+
+    return waitTime;
+}
+
+bool CarryForward::isEmpty() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bool empty = carried.empty();
+    xSemaphoreGive(mutex);
+
+    return empty;
+}
+
+String CarryForward::getStatus() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    String status = "--- Carry forward ---\n";
+    status += "Waiting: " + String((uint32_t)carried.size()) + " (" + String(bytes) +
+              " bytes), kept: " + String(kept) + ", flushed: " + String(flushed) +
+              ", evicted: " + String(evicted) + ", rejected: " + String(rejected) + "\n";
+    status += "Longest wait for a gateway: " + String(maxDelay) + " ms\n";
+
+    xSemaphoreGive(mutex);
+
+    return status;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "config.h"
+
+#include "message/dataMessage.h"
+
+#include "delivery.h"
+
+#include "dutyCycle.h"
+
+enum CarryForwardPolicy : uint8_t {
+    CarryDropOldest = 0,
+    CarryDropLowestPriority = 1,
+};
+
+/**
+ * @brief Keeps the gateway-bound messages sent while the routing table has no gateway, up to
+ * CARRY_FORWARD_MAX_MESSAGES and CARRY_FORWARD_MAX_BYTES. When a gateway is known again they are
+ * flushed, higher priority and older first, CARRY_FORWARD_BATCH every
+ * CARRY_FORWARD_BATCH_INTERVAL so the backlog does not take all the airtime.
+ *
+ */
+class CarryForward {
+public:
+    CarryForward() { mutex = xSemaphoreCreateMutex(); }
+
+    struct CarriedMessage {
+        DataMessage* message;
+        SendPriority priority;
+        DeliveryMode mode;
+        DeliveryCallback callback;
+        uint32_t carriedAt;
+    };
+
+    /**
+     * @brief Keep a copy of the message, evicting others with CARRY_FORWARD_POLICY when full
+     *
+     * @return true If the message was kept
+     */
+    bool add(DataMessage* message, SendPriority priority, DeliveryMode mode,
+             DeliveryCallback callback);
+
+    /**
+     * @brief Take the next message to flush if the current batch has room
+     *
+     * @param carried Message to be sent and freed with vPortFree
+     * @return true If a message was taken
+     */
+    bool take(CarriedMessage& carried);
+
+    /**
+     * @brief Time until the next message can be flushed
+     *
+     * @param gateway The routing table has a gateway
+     * @return uint32_t ms, UINT32_MAX if there are no messages
+     */
+    uint32_t getWaitTime(bool gateway);
+
+    bool isEmpty();
+
+    String getStatus();
+
+private:
+    std::vector<CarriedMessage> carried;
+
+    SemaphoreHandle_t mutex = NULL;
+
+    uint32_t bytes = 0;
+
+    uint32_t batchStart = 0;
+    uint8_t batchCount = 0;
+
+    uint32_t kept = 0;
+    uint32_t flushed = 0;
+    uint32_t evicted = 0;
+    uint32_t rejected = 0;
+    uint32_t maxDelay = 0;
+
+    /**
+     * @brief Index of the message to evict for a new one of the priority, -1 to reject the new
+     * one
+     *
+     */
+    int findVictim(SendPriority priority);
+
+    void evict(size_t index);
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+enum DeliveryMode : uint8_t {
+    DefaultDelivery = 0,  // Use the policy table of the source appPort
+    Unreliable = 1,
+    Reliable = 2,
+};
+
+/**
+ * @brief How a send finished. LoRaMesher does not report if the destination acknowledged a
+ * reliable send, so there is no delivered result, a reliable send ends as Completed or TimedOut.
+ *
+ */
+enum DeliveryResult : uint8_t {
+    TimedOut = 1,
+    Dropped = 2,    // Evicted while waiting for a gateway
+    Completed = 3,  // LoRaMesher finished the send, acknowledged or out of retries
+};
+
+/**
+ * @brief Called when a reliable send finishes, with the time since the message was created. It is
+ * only an upper bound of the delivery time, a send completes with the last open connection.
+ *
+ */
+typedef std::function<void(DeliveryResult result, uint32_t latency)> DeliveryCallback;
+
+#define DELIVERY_MODE_COUNT 3
+
+#define DELIVERY_POLICY_SIZE 32
+
+class DeliveryStats {
+public:
+    uint32_t messages = 0;
+    uint32_t bytes = 0;
+    uint32_t airtime = 0;  // ms, including the ACK frames for reliable sends
+    uint32_t unknown = 0;  // Reliable sends finished without a per packet result
+    uint32_t timedOut = 0;
+    uint32_t latencySum = 0;  // ms from the send call to LoRaMesher, duty cycle wait included
+    uint32_t latencyMax = 0;
+
+    void addLatency(uint32_t latency) {
+        latencySum += latency;
+        if (latency > latencyMax)
+            latencyMax = latency;
+    }
+
+    uint32_t getMeanLatency() { return messages == 0 ? 0 : latencySum / messages; }
+};
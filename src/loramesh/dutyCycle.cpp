@@ -0,0 +1,200 @@
+#include "dutyCycle.h"
+
+static const char* DC_TAG = "DutyCycle";
+
+void DutyCycle::init(float frequency, float bandwidth, uint8_t spreadingFactor,
+                     uint8_t codingRate, uint16_t preambleLength) {
+    this->bandwidth = bandwidth;
+    this->spreadingFactor = spreadingFactor;
+    this->codingRate = codingRate;
+    this->preambleLength = preambleLength;
+
+    if (mutex == nullptr)
+        mutex = xSemaphoreCreateMutex();
+
+    current = nullptr;
+    for (uint8_t i = 0; i < SUB_BAND_COUNT; i++) {
+        if (frequency >= subBands[i].minFrequency && frequency <= subBands[i].maxFrequency) {
+            current = &subBands[i];
+            break;
+        }
+    }
+
+    if (current == nullptr) {
+        ESP_LOGW(DC_TAG, "Frequency %.2f MHz has no duty cycle limit", frequency);
+        return;
+    }
+
+    ESP_LOGI(DC_TAG, "Sub-band %.2f - %.2f MHz, duty cycle %d.%02d%%, budget %d ms",
+             current->minFrequency, current->maxFrequency, current->dutyCycle / 100,
+             current->dutyCycle % 100, getBudget(current, HighPriority));
+}
+
+uint32_t DutyCycle::getTimeOnAir(uint32_t payloadSize, float bandwidth, uint8_t spreadingFactor,
+                                 uint8_t codingRate, uint16_t preambleLength) {
+    // Symbol time in microseconds
+    float symbolTime = (float)(1UL << spreadingFactor) * 1000.0 / bandwidth;
+
+    // Low data rate optimization is mandatory when the symbol time exceeds 16 ms
+    int32_t lowDataRate = symbolTime > 16000 ? 1 : 0;
+
+    // Explicit header and CRC enabled, as LoRaMesher configures the radio
+    int32_t numerator = 8 * (int32_t)payloadSize - 4 * spreadingFactor + 28 + 16;
+    int32_t denominator = 4 * (spreadingFactor - 2 * lowDataRate);
+
+    int32_t payloadSymbols = 8;
+    if (numerator > 0)
+        payloadSymbols += ((numerator + denominator - 1) / denominator) * codingRate;
+
+    float preambleTime = (preambleLength + 4.25) * symbolTime;
+
+    return (uint32_t)(preambleTime + payloadSymbols * symbolTime);
+}
+
+uint32_t DutyCycle::getAirtime(uint32_t payloadSize) {
+    uint32_t frames = (payloadSize + LORAMESH_MAX_FRAME_PAYLOAD - 1) / LORAMESH_MAX_FRAME_PAYLOAD;
+    if (frames == 0)
+        frames = 1;
+
+    uint32_t lastFrameSize = payloadSize - (frames - 1) * LORAMESH_MAX_FRAME_PAYLOAD;
+
+    uint32_t airtime =
+        (frames - 1) * getTimeOnAir(LORAMESH_MAX_FRAME_PAYLOAD + LORAMESH_PACKET_OVERHEAD,
+                                    bandwidth, spreadingFactor, codingRate, preambleLength) +
+        getTimeOnAir(lastFrameSize + LORAMESH_PACKET_OVERHEAD, bandwidth, spreadingFactor,
+                     codingRate, preambleLength);
+
+    return (airtime + 999) / 1000;
+}
+
+bool DutyCycle::tryConsume(uint32_t airtime, SendPriority priority) {
+    if (current == nullptr || DUTY_CYCLE_ENABLED == 0)
+        return true;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    advance(current);
+
+    bool fits = getUsedAirtime(current) + airtime <= getBudget(current, priority);
+    if (fits)
+        current->buckets[current->lastBucket % DUTY_CYCLE_BUCKETS] += airtime;
+
+    xSemaphoreGive(mutex);
+
+    return fits;
+}
+
+uint32_t DutyCycle::getWaitTime(uint32_t airtime, SendPriority priority) {
+    if (current == nullptr || DUTY_CYCLE_ENABLED == 0)
+        return 0;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    advance(current);
+
+    uint32_t used = getUsedAirtime(current);
+    uint32_t budget = getBudget(current, priority);
+    uint32_t waitTime = 0;
+
+    if (airtime > budget) {
+        waitTime = UINT32_MAX;
+    } else if (used + airtime > budget) {
+        // Walk from the oldest bucket until enough airtime expires from the window
+        uint32_t nowBucket = current->lastBucket;
+        uint32_t firstBucket =
+            nowBucket >= DUTY_CYCLE_BUCKETS - 1 ? nowBucket - DUTY_CYCLE_BUCKETS + 1 : 0;
+        uint32_t freed = 0;
+
+        for (uint32_t bucket = firstBucket; bucket <= nowBucket; bucket++) {
+            freed += current->buckets[bucket % DUTY_CYCLE_BUCKETS];
+            if (used - freed + airtime <= budget) {
+                waitTime = (bucket + DUTY_CYCLE_BUCKETS) * BUCKET_DURATION - millis();
+                break;
+            }
+        }
+    }
+
+    xSemaphoreGive(mutex);
+
+    return waitTime;
+}
+
+uint32_t DutyCycle::getRemainingAirtime() {
+    if (current == nullptr)
+        return UINT32_MAX;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    advance(current);
+
+    uint32_t used = getUsedAirtime(current);
+    uint32_t budget = getBudget(current, HighPriority);
+
+    xSemaphoreGive(mutex);
+
+    return used < budget ? budget - used : 0;
+}
+
+String DutyCycle::getStatus() {
+    if (current == nullptr)
+        return "No duty cycle limit for this frequency\n";
+
+    String status = "";
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    for (uint8_t i = 0; i < SUB_BAND_COUNT; i++) {
+        SubBand* subBand = &subBands[i];
+        advance(subBand);
+
+        uint32_t used = getUsedAirtime(subBand);
+        if (subBand != current && used == 0)
+            continue;
+
+        uint32_t budget = getBudget(subBand, HighPriority);
+
+        status += String(subBand->minFrequency, 2) + " - " + String(subBand->maxFrequency, 2) +
+                  " MHz (" + String(subBand->dutyCycle / 100.0, 2) + "%): used " + String(used) +
+                  " ms, remaining " + String(used < budget ? budget - used : 0) + " ms of " +
+                  String(budget) + " ms" + (subBand == current ? " (active)" : "") + "\n";
+    }
+
+    xSemaphoreGive(mutex);
+
+    return status;
+}
+
+void DutyCycle::advance(SubBand* subBand) {
+    uint32_t nowBucket = millis() / BUCKET_DURATION;
+    uint32_t elapsed = nowBucket - subBand->lastBucket;
+
+    if (elapsed == 0)
+        return;
+
+    if (elapsed >= DUTY_CYCLE_BUCKETS) {
+        memset(subBand->buckets, 0, sizeof(subBand->buckets));
+    } else {
+        for (uint32_t bucket = subBand->lastBucket + 1; bucket <= nowBucket; bucket++) {
+            subBand->buckets[bucket % DUTY_CYCLE_BUCKETS] = 0;
+        }
+    }
+
+    subBand->lastBucket = nowBucket;
+}
+
+uint32_t DutyCycle::getUsedAirtime(SubBand* subBand) {
+    uint32_t used = 0;
+    for (uint8_t i = 0; i < DUTY_CYCLE_BUCKETS; i++) {
+        used += subBand->buckets[i];
+    }
+    return used;
+}
+
+uint32_t DutyCycle::getBudget(SubBand* subBand, SendPriority priority) {
+    uint32_t budget = DUTY_CYCLE_WINDOW / 10000 * subBand->dutyCycle;
+
+    if (priority == HighPriority)
+        return budget;
+
+    return budget / 100 * (100 - DUTY_CYCLE_RESERVE);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+enum SendPriority : uint8_t {
+    HighPriority = 0,
+    NormalPriority = 1,
+    LowPriority = 2,
+};
+
+#define SEND_PRIORITY_COUNT 3
+
+/**
+ * @brief Tracks the time on air used by this node in a sliding window for each regulatory
+ * sub-band and decides if a new frame fits in the remaining budget.
+ *
+ */
+class DutyCycle {
+public:
+    /**
+     * @brief Set the radio parameters used to compute the time on air of every frame
+     *
+     * @param frequency Frequency in MHz
+     * @param bandwidth Bandwidth in kHz
+     * @param spreadingFactor Spreading factor (7 - 12)
+     * @param codingRate Coding rate denominator (5 - 8)
+     * @param preambleLength Preamble length in symbols
+     */
+    void init(float frequency, float bandwidth, uint8_t spreadingFactor, uint8_t codingRate,
+              uint16_t preambleLength);
+
+    /**
+     * @brief Time on air of a single LoRa frame, following the Semtech SX127x datasheet
+     *
+     * @param payloadSize Size of the PHY payload in bytes
+     * @return uint32_t Time on air in microseconds
+     */
+    static uint32_t getTimeOnAir(uint32_t payloadSize, float bandwidth, uint8_t spreadingFactor,
+                                 uint8_t codingRate, uint16_t preambleLength);
+
+    /**
+     * @brief Time on air needed to send an application payload, including the LoRaMesher header
+     * and the frames needed when the payload is split
+     *
+     * @param payloadSize Application payload size in bytes
+     * @return uint32_t Time on air in milliseconds
+     */
+    uint32_t getAirtime(uint32_t payloadSize);
+
+    /**
+     * @brief Consume the airtime if it fits in the budget of the current sub-band
+     *
+     * @param airtime Airtime in milliseconds
+     * @param priority High priority frames can use the reserved part of the budget
+     * @return true If the airtime has been consumed
+     * @return false If the frame must wait
+     */
+    bool tryConsume(uint32_t airtime, SendPriority priority);
+
+    /**
+     * @brief Milliseconds until the given airtime fits in the budget
+     *
+     * @param airtime Airtime in milliseconds
+     * @param priority Priority of the frame
+     * @return uint32_t 0 if it fits now
+     */
+    uint32_t getWaitTime(uint32_t airtime, SendPriority priority);
+
+    /**
+     * @brief Remaining airtime in the current window of the sub-band in use
+     *
+     * @return uint32_t Milliseconds
+     */
+    uint32_t getRemainingAirtime();
+
+    String getStatus();
+
+private:
+    struct SubBand {
+        float minFrequency;
+        float maxFrequency;
+        uint16_t dutyCycle;  // In hundredths of percent
+        uint32_t lastBucket;
+        uint32_t buckets[DUTY_CYCLE_BUCKETS];
+    };
+
+    static const uint8_t SUB_BAND_COUNT = 6;
+
+    // EU868 sub-bands from ETSI EN 300 220 / ERC REC 70-03
+    SubBand subBands[SUB_BAND_COUNT] = {
+        {863.0, 865.0, 10, 0, {}},   {865.0, 868.0, 100, 0, {}},   {868.0, 868.6, 100, 0, {}},
+        {868.7, 869.2, 10, 0, {}},   {869.4, 869.65, 1000, 0, {}}, {869.7, 870.0, 100, 0, {}},
+    };
+
+    SubBand* current = nullptr;
+
+    float bandwidth = 125.0;
+    uint8_t spreadingFactor = 7;
+    uint8_t codingRate = 7;
+    uint16_t preambleLength = 8;
+
+    SemaphoreHandle_t mutex = nullptr;
+
+    static const uint32_t BUCKET_DURATION = DUTY_CYCLE_WINDOW / DUTY_CYCLE_BUCKETS;
+
+    void advance(SubBand* subBand);
+
+    uint32_t getUsedAirtime(SubBand* subBand);
+
+    uint32_t getBudget(SubBand* subBand, SendPriority priority);
+};
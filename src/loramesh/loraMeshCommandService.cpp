@@ -11,4 +11,44 @@ LoRaMeshCommandService::LoRaMeshCommandService() {
     addCommand(Command(
         "/getRT", "Get the routing table of the device", LoRaMeshMessageType::getRoutingTable, 1,
         [this](String args) { return LoRaMeshService::getInstance().getRoutingTable(); }));
+
+    addCommand(Command(
+        "/airtime", "Get the duty cycle airtime used and remaining", LoRaMeshMessageType::getAirtime,
+        1, [this](String args) { return LoRaMeshService::getInstance().getAirtimeStatus(); }));
+
+    addCommand(Command("/delivery",
+                       "Set the delivery mode of an appPort (0 default, 1 unreliable, 2 reliable). "
+                       "Usage: /delivery <appPort> <mode>",
+                       LoRaMeshMessageType::setDelivery, 1, [this](String args) {
+                           int separator = args.indexOf(" ");
+                           if (separator <= 0)
+                               return String("Usage: /delivery <appPort> <mode>");
+
+                           uint8_t port = args.substring(0, separator).toInt();
+                           uint8_t mode = args.substring(separator + 1).toInt();
+                           return LoRaMeshService::getInstance().setDeliveryPolicy(
+                               port, (DeliveryMode)mode);
+                       }));
+
+    addCommand(Command("/deliveryStats", "Get the delivery policy and the per mode statistics",
+                       LoRaMeshMessageType::getDelivery, 1, [this](String args) {
+                           return LoRaMeshService::getInstance().getDeliveryStatus();
+                       }));
+
+    addCommand(Command("/rxStats",
+                       "Get the receive batches and per stage timings. Use /rxStats reset to clear",
+                       LoRaMeshMessageType::getReceiveStats, 1, [this](String args) {
+                           return LoRaMeshService::getInstance().getReceiveStatus(args == "reset");
+                       }));
+
+    addCommand(Command("/piggyback", "Get the messages attached to other frames to the gateway",
+                       LoRaMeshMessageType::getPiggyback, 1, [this](String args) {
+                           return LoRaMeshService::getInstance().getPiggybackStatus();
+                       }));
+
+    addCommand(Command("/carryForward",
+                       "Get the messages kept while there is no gateway and the ones flushed",
+                       LoRaMeshMessageType::getCarryForward, 1, [this](String args) {
+                           return LoRaMeshService::getInstance().getCarryForwardStatus();
+                       }));
 }
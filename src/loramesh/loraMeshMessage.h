@@ -11,6 +11,12 @@
 enum LoRaMeshMessageType : uint8_t {
     sendMessage = 1,
     getRoutingTable = 2,
+    getAirtime = 3,
+    setDelivery = 4,
+    getDelivery = 5,
+    getReceiveStats = 6,
+    getPiggyback = 7,
+    getCarryForward = 8,
 };
 
 class LoRaMeshMessage {
@@ -38,6 +38,11 @@ void LoRaMeshService::initLoraMesherService() {
     // Initialize LoRaMesher
     radio.begin(config);
 
+    // Initialize the airtime accounting with the radio configuration
+    dutyCycle.init(config.freq, config.bw, config.sf, config.cr, config.preambleLength);
+
+    createDeferredSendTask();
+
     // Create the receive task and add it to the LoRaMesher
     createReceiveMessages();
 
@@ -49,29 +54,116 @@ void LoRaMeshService::initLoraMesherService() {
 }
 
 void LoRaMeshService::loopReceivedPackets() {
-    // Iterate through all the packets inside the Received User Packets FiFo
+    // LoRaMesher does not timestamp the enqueue, so the drain wait only measures the time a packet
+    // waits behind the ones drained before it since the task woke up
+    uint32_t wakeUp = micros();
+
+    // Drain the Received User Packets FiFo in bounded batches
     while (radio.getReceivedQueueSize() > 0) {
-        ESP_LOGV(LMS_TAG, "LoRaPacket received");
-        ESP_LOGV(LMS_TAG, "Queue receiveUserData size: %d", radio.getReceivedQueueSize());
-        ESP_LOGV(LMS_TAG, "Heap size receive: %d", ESP.getFreeHeap());
+        ReceiveTiming timings[RECEIVE_BATCH_SIZE];
+        uint8_t batchSize = 0;
+
+        while (batchSize < RECEIVE_BATCH_SIZE && radio.getReceivedQueueSize() > 0) {
+            ReceiveTiming& timing = timings[batchSize++];
+            uint32_t start = micros();
+            timing.drainWait = start - wakeUp;
+
+            // Get the first element inside the Received User Packets FiFo
+            AppPacket<LoRaMeshMessage>* packet = radio.getNextAppPacket<LoRaMeshMessage>();
+
+            // Create a DataMessage from the received packet, in the reused buffer
+            DataMessage* message = createDataMessage(packet);
+            DataMessage* piggybacked = message ? piggyback.split(message) : nullptr;
+            uint32_t converted = micros();
+            timing.convert = converted - start;
+
+            // Process the packet
+            if (message)
+                MessageManager::getInstance().processReceivedMessage(LoRaMeshPort, message);
+            else
+                receiveErrors++;
+
+            if (piggybacked) {
+                MessageManager::getInstance().processReceivedMessage(LoRaMeshPort, piggybacked);
+                vPortFree(piggybacked);
+            }
+
+            uint32_t dispatched = micros();
+            timing.dispatch = dispatched - converted;
+
+            // Delete the packet when used. It is very important to call this function to release
+            // the memory of the packet.
+            radio.deletePacket(packet);
+            timing.free = micros() - dispatched;
+        }
+
+        recordReceiveBatch(timings, batchSize);
+
+        ESP_LOGV(LMS_TAG, "Received batch of %d packets, %d left", batchSize,
+                 radio.getReceivedQueueSize());
+
+        // Let the other tasks run between batches, taskYIELD() would only run the ones of the same
+        // priority
+        vTaskDelay(1);
+    }
+}
+
+void LoRaMeshService::recordReceiveBatch(ReceiveTiming* timings, uint8_t size) {
+    if (size == 0)
+        return;
+
+    xSemaphoreTake(receiveStatsMutex, portMAX_DELAY);
 
-        // Get the first element inside the Received User Packets FiFo
-        AppPacket<LoRaMeshMessage>* packet = radio.getNextAppPacket<LoRaMeshMessage>();
+    for (uint8_t i = 0; i < size; i++) {
+        drainWaitHistogram.add(timings[i].drainWait);
+        convertHistogram.add(timings[i].convert);
+        dispatchHistogram.add(timings[i].dispatch);
+        freeHistogram.add(timings[i].free);
+    }
 
-        // Create a DataMessage from the received packet
-        DataMessage* message = createDataMessage(packet);
+    receivedBatches++;
+    if (size > maxBatchSize)
+        maxBatchSize = size;
 
-        // Process the packet
-        MessageManager::getInstance().processReceivedMessage(LoRaMeshPort, message);
+    xSemaphoreGive(receiveStatsMutex);
 
-        // Delete the message
-        vPortFree(message);
+    for (uint8_t i = 0; i < size; i++) {
+        Metrics::observe(MetricRxDrainWait, timings[i].drainWait);
+        Metrics::observe(MetricRxConvert, timings[i].convert);
+        Metrics::observe(MetricRxDispatch, timings[i].dispatch);
+    }
+    Metrics::increment(MetricRxPackets, size);
+}
 
-        // Delete the packet when used. It is very important to call this function to release the
-        // memory of the packet.
-        radio.deletePacket(packet);
-        ESP_LOGV(LMS_TAG, "Heap size receive2: %d", ESP.getFreeHeap());
+String LoRaMeshService::getReceiveStatus(bool reset) {
+    if (receiveStatsMutex == NULL)
+        return "LoRa not initialized\n";
+
+    String status = "--- Receive ---\n";
+
+    xSemaphoreTake(receiveStatsMutex, portMAX_DELAY);
+
+    status += "Packets: " + String(drainWaitHistogram.getCount()) +
+              ", batches: " + String(receivedBatches) + ", max batch: " + String(maxBatchSize) +
+              ", errors: " + String(receiveErrors) + "\n";
+    status += drainWaitHistogram.toString("Drain wait", "us");
+    status += convertHistogram.toString("Convert", "us");
+    status += dispatchHistogram.toString("Dispatch", "us");
+    status += freeHistogram.toString("Free", "us");
+
+    if (reset) {
+        drainWaitHistogram.reset();
+        convertHistogram.reset();
+        dispatchHistogram.reset();
+        freeHistogram.reset();
+        receivedBatches = 0;
+        maxBatchSize = 0;
+        receiveErrors = 0;
     }
+
+    xSemaphoreGive(receiveStatsMutex);
+
+    return status;
 }
 
 /**
@@ -95,6 +187,8 @@ void processReceivedPackets(void*) {
  *
  */
 void LoRaMeshService::createReceiveMessages() {
+    receiveStatsMutex = xSemaphoreCreateMutex();
+
     int res = xTaskCreate(processReceivedPackets, "Receive App Task", 5000, (void*)1, 2,
                           &receiveLoRaMessage_Handle);
     if (res != pdPASS) {
@@ -102,6 +196,11 @@ void LoRaMeshService::createReceiveMessages() {
     }
 
     radio.setReceiveAppDataTaskHandle(receiveLoRaMessage_Handle);
+
+    TaskMonitor::getInstance().registerQueue(
+        "LoRaRx", []() -> size_t { return LoraMesher::getInstance().getReceivedQueueSize(); });
+    TaskMonitor::getInstance().registerQueue(
+        "LoRaTx", []() -> size_t { return LoraMesher::getInstance().getSendQueueSize(); });
 }
 
 LoRaMeshMessage* LoRaMeshService::createLoRaMeshMessage(DataMessage* message) {
@@ -123,7 +222,14 @@ DataMessage* LoRaMeshService::createDataMessage(AppPacket<LoRaMeshMessage>* appP
         appPacket->payloadSize + sizeof(DataMessage) - sizeof(LoRaMeshMessage);
     uint32_t messageSize = dataMessageSize - sizeof(DataMessage);
 
-    DataMessage* dataMessage = (DataMessage*)pvPortMalloc(dataMessageSize);
+    // The message is only used while it is dispatched, reuse the same buffer for every packet
+    if (dataMessageSize > receiveBufferSize) {
+        vPortFree(receiveBuffer);
+        receiveBuffer = (DataMessage*)pvPortMalloc(dataMessageSize);
+        receiveBufferSize = receiveBuffer ? dataMessageSize : 0;
+    }
+
+    DataMessage* dataMessage = receiveBuffer;
 
     if (dataMessage) {
         LoRaMeshMessage* message = appPacket->payload;
@@ -138,6 +244,8 @@ DataMessage* LoRaMeshService::createDataMessage(AppPacket<LoRaMeshMessage>* appP
         dataMessage->messageSize = messageSize;
 
         memcpy(dataMessage->message, message->dataMessage, messageSize);
+    } else {
+        ESP_LOGE(LMS_TAG, "Not enough memory to receive a packet of %d bytes", dataMessageSize);
     }
 
     return dataMessage;
@@ -170,45 +278,394 @@ String LoRaMeshService::getRoutingTable() {
     // Release routing table list usage.
     routingTableList->releaseInUse();
 
+    // The copy is owned by the caller
     routingTableList->Clear();
+    delete routingTableList;
 
     return routingTable;
 }
 
-void LoRaMeshService::send(DataMessage* message) {
+void LoRaMeshService::send(DataMessage* message, DeliveryMode mode, DeliveryCallback callback) {
+    SendPriority priority = getSendPriority(message);
+    uint32_t airtime = dutyCycle.getAirtime(sizeof(LoRaMeshMessage) + message->messageSize);
+
+    mode = getDeliveryMode(message, mode);
+
+    // Messages already waiting for airtime with the same or higher priority go first
+    if (hasDeferredMessages(priority) || !dutyCycle.tryConsume(airtime, priority)) {
+        // A time beacon carries the time it was created, the next one is better than a late one
+        if (message->appPortSrc == appPort::TimeSyncApp) {
+            ESP_LOGW(LMS_TAG, "No airtime for the time beacon, dropped");
+            droppedMessages++;
+            return;
+        }
+
+        deferMessage(message, priority, mode, callback);
+        return;
+    }
+
+    sendNow(message, mode, callback, millis());
+}
+
+void LoRaMeshService::sendNow(DataMessage* message, DeliveryMode mode, DeliveryCallback callback,
+                              uint32_t createdAt) {
     ESP_LOGV(LMS_TAG, "Heap size send: %d", ESP.getFreeHeap());
 
     LoRaMeshMessage* loraMeshMessage = createLoRaMeshMessage(message);
+    uint32_t payloadSize = sizeof(LoRaMeshMessage) + message->messageSize;
 
-#if SEND_RELIABLE == 0
-    radio.createPacketAndSend(message->addrDst, (uint8_t*)loraMeshMessage,
-                              sizeof(LoRaMeshMessage) + message->messageSize);
-#else
-    radio.sendReliablePacket(message->addrDst, (uint8_t*)loraMeshMessage,
-                             sizeof(LoRaMeshMessage) + message->messageSize);
-#endif
+    uint32_t airtime = dutyCycle.getAirtime(payloadSize);
+
+    if (mode == DeliveryMode::Reliable) {
+        // Every frame of a reliable send is answered with an ACK
+        uint32_t frames =
+            (payloadSize + LORAMESH_MAX_FRAME_PAYLOAD - 1) / LORAMESH_MAX_FRAME_PAYLOAD;
+        airtime += frames * dutyCycle.getAirtime(0);
+    }
+
+    // The stats are also updated by the deferred send task
+    xSemaphoreTake(deliveryMutex, portMAX_DELAY);
+
+    DeliveryStats& stats = deliveryStats[mode];
+    stats.messages++;
+    stats.bytes += payloadSize;
+    stats.airtime += airtime;
+
+    // Both modes measure the same span, the time until the packet is handed to LoRaMesher
+    stats.addLatency(millis() - createdAt);
+
+    if (mode == DeliveryMode::Reliable)
+        pendingDeliveries.push_back({callback, createdAt, millis()});
+
+    xSemaphoreGive(deliveryMutex);
+
+    if (mode == DeliveryMode::Reliable) {
+        radio.sendReliablePacket(message->addrDst, (uint8_t*)loraMeshMessage, payloadSize);
+
+        // Start polling the completion of the send
+        xTaskNotifyGive(deferredSend_Handle);
+    } else {
+        radio.createPacketAndSend(message->addrDst, (uint8_t*)loraMeshMessage, payloadSize);
+    }
 
     vPortFree(loraMeshMessage);
     ESP_LOGV(LMS_TAG, "Heap size send 2: %d", ESP.getFreeHeap());
 }
 
-bool LoRaMeshService::sendClosestGateway(DataMessage* message) {
+DeliveryMode LoRaMeshService::getDeliveryMode(DataMessage* message, DeliveryMode mode) {
+    // LoRaMesher can only send reliable packets to a single destination
+    if (message->addrDst == BROADCAST_ADDR)
+        return DeliveryMode::Unreliable;
+
+    if (mode != DeliveryMode::DefaultDelivery)
+        return mode;
+
+    if (message->appPortSrc < DELIVERY_POLICY_SIZE &&
+        deliveryPolicy[message->appPortSrc] != DeliveryMode::DefaultDelivery)
+        return deliveryPolicy[message->appPortSrc];
+
+    return SEND_RELIABLE == 0 ? DeliveryMode::Unreliable : DeliveryMode::Reliable;
+}
+
+SendPriority LoRaMeshService::getSendPriority(DataMessage* message) {
+    switch (message->appPortSrc) {
+        case appPort::CommandApp:
+        case appPort::LoRaMesherApp:
+        case appPort::LedApp:
+        case appPort::DisplayApp:
+        case appPort::TimeSyncApp:
+            return SendPriority::HighPriority;
+        case appPort::MonApp:
+        case appPort::MetadataApp:
+        case appPort::HistoryApp:
+            return SendPriority::LowPriority;
+        default:
+            return SendPriority::NormalPriority;
+    }
+}
+
+bool LoRaMeshService::hasDeferredMessages(SendPriority priority) {
+    for (uint8_t i = 0; i <= priority; i++) {
+        if (deferredQueue[i] != NULL && uxQueueMessagesWaiting(deferredQueue[i]) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+void LoRaMeshService::deferMessage(DataMessage* message, SendPriority priority, DeliveryMode mode,
+                                   DeliveryCallback callback) {
+    uint32_t airtime = dutyCycle.getAirtime(sizeof(LoRaMeshMessage) + message->messageSize);
+
+    if (deferredQueue[priority] == NULL ||
+        dutyCycle.getWaitTime(airtime, priority) == UINT32_MAX) {
+        ESP_LOGE(LMS_TAG, "Message of %d ms airtime does not fit in the duty cycle", airtime);
+        droppedMessages++;
+        return;
+    }
+
+    DataMessage* copy = (DataMessage*)pvPortMalloc(message->getDataMessageSize());
+    if (copy == nullptr) {
+        ESP_LOGE(LMS_TAG, "Not enough memory to defer the message");
+        droppedMessages++;
+        return;
+    }
+
+    memcpy(copy, message, message->getDataMessageSize());
+
+    PendingSend* pending = new PendingSend{copy, mode, callback, millis()};
+
+    if (xQueueSend(deferredQueue[priority], &pending, 0) != pdPASS) {
+        ESP_LOGW(LMS_TAG, "Deferred queue %d full, message dropped", priority);
+        vPortFree(copy);
+        delete pending;
+        droppedMessages++;
+        return;
+    }
+
+    deferredMessages++;
+    ESP_LOGI(LMS_TAG, "Message deferred by the duty cycle, priority %d", priority);
+
+    xTaskNotifyGive(deferredSend_Handle);
+}
+
+/**
+ * @brief Send the deferred messages when the duty cycle allows it, higher priorities first, and
+ * track the completion of the reliable sends
+ *
+ */
+void LoRaMeshService::deferredSendLoop(void*) {
+    LoRaMeshService& service = LoRaMeshService::getInstance();
+    TickType_t waitTime = portMAX_DELAY;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, waitTime);
+        waitTime = portMAX_DELAY;
+
+        for (uint8_t priority = 0; priority < SEND_PRIORITY_COUNT; priority++) {
+            PendingSend* pending;
+
+            while (xQueuePeek(service.deferredQueue[priority], &pending, 0) == pdTRUE) {
+                uint32_t airtime = service.dutyCycle.getAirtime(sizeof(LoRaMeshMessage) +
+                                                                pending->message->messageSize);
+
+                if (!service.dutyCycle.tryConsume(airtime, (SendPriority)priority)) {
+                    waitTime = service.dutyCycle.getWaitTime(airtime, (SendPriority)priority) /
+                                   portTICK_PERIOD_MS +
+                               1;
+                    break;
+                }
+
+                xQueueReceive(service.deferredQueue[priority], &pending, 0);
+                service.sendNow(pending->message, pending->mode, pending->callback,
+                                pending->createdAt);
+                vPortFree(pending->message);
+                delete pending;
+            }
+
+            // Lower priorities have a smaller budget, they need to wait too
+            if (waitTime != portMAX_DELAY)
+                break;
+        }
+
+        if (service.checkPendingDeliveries()) {
+            TickType_t pollTime = DELIVERY_POLL_INTERVAL / portTICK_PERIOD_MS;
+            if (pollTime < waitTime)
+                waitTime = pollTime;
+        }
+
+        // The piggyback messages without a carrier before their deadline are sent alone
+        DataMessage* expired;
+        while ((expired = service.piggyback.takeExpired()) != nullptr) {
+            service.send(expired, DeliveryMode::DefaultDelivery, nullptr);
+            vPortFree(expired);
+        }
+
+        uint32_t piggybackWait = service.piggyback.getWaitTime();
+        if (piggybackWait != UINT32_MAX && piggybackWait / portTICK_PERIOD_MS + 1 < waitTime)
+            waitTime = piggybackWait / portTICK_PERIOD_MS + 1;
+
+        // The messages carried while there was no gateway are flushed in batches
+        if (!service.carryForward.isEmpty()) {
+            bool gateway = service.hasGateway();
+
+            CarryForward::CarriedMessage carried;
+            while (gateway && service.carryForward.take(carried)) {
+                service.sendClosestGateway(carried.message, carried.mode, carried.callback);
+                vPortFree(carried.message);
+            }
+
+            uint32_t carryWait = service.carryForward.getWaitTime(gateway);
+            if (carryWait != UINT32_MAX && carryWait / portTICK_PERIOD_MS + 1 < waitTime)
+                waitTime = carryWait / portTICK_PERIOD_MS + 1;
+        }
+    }
+}
+
+/**
+ * @brief Complete the reliable sends. LoRaMesher does not report the result of each reliable
+ * send, it closes the connection after the last ACK or after exhausting the retries, so all the
+ * pending sends are Completed, with an unknown outcome, when there are no active sent connections
+ * left.
+ *
+ * @return true If there are reliable sends still pending
+ */
+bool LoRaMeshService::checkPendingDeliveries() {
+    std::vector<PendingDelivery> finished;
+    std::vector<DeliveryResult> results;
+
+    xSemaphoreTake(deliveryMutex, portMAX_DELAY);
+
+    bool activeConnections = radio.hasActiveSentConnections();
+    uint32_t now = millis();
+
+    for (auto it = pendingDeliveries.begin(); it != pendingDeliveries.end();) {
+        if (!activeConnections && now - it->sentAt >= DELIVERY_POLL_INTERVAL) {
+            finished.push_back(*it);
+            results.push_back(DeliveryResult::Completed);
+            it = pendingDeliveries.erase(it);
+        } else if (now - it->sentAt >= RELIABLE_DELIVERY_TIMEOUT) {
+            finished.push_back(*it);
+            results.push_back(DeliveryResult::TimedOut);
+            it = pendingDeliveries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    bool stillPending = !pendingDeliveries.empty();
+
+    DeliveryStats& stats = deliveryStats[DeliveryMode::Reliable];
+    for (DeliveryResult result : results) {
+        if (result == DeliveryResult::Completed)
+            stats.unknown++;
+        else
+            stats.timedOut++;
+    }
+
+    xSemaphoreGive(deliveryMutex);
+
+    for (size_t i = 0; i < finished.size(); i++) {
+        if (finished[i].callback)
+            finished[i].callback(results[i], now - finished[i].createdAt);
+    }
+
+    return stillPending;
+}
+
+void LoRaMeshService::createDeferredSendTask() {
+    for (uint8_t i = 0; i < SEND_PRIORITY_COUNT; i++) {
+        deferredQueue[i] = xQueueCreate(DUTY_CYCLE_DEFERRED_QUEUE_SIZE, sizeof(PendingSend*));
+    }
+
+    TaskMonitor::getInstance().registerQueue("DeferHigh", deferredQueue[HighPriority]);
+    TaskMonitor::getInstance().registerQueue("DeferNorm", deferredQueue[NormalPriority]);
+    TaskMonitor::getInstance().registerQueue("DeferLow", deferredQueue[LowPriority]);
+
+    int res = xTaskCreate(deferredSendLoop, "Deferred Send Task", 4096, (void*)1, 1,
+                          &deferredSend_Handle);
+    if (res != pdPASS) {
+        ESP_LOGE(LMS_TAG, "Deferred Send Task creation gave error: %d", res);
+    }
+}
+
+String LoRaMeshService::getAirtimeStatus() {
+    String status = "--- Airtime ---\n";
+
+    status += dutyCycle.getStatus();
+
+    status += "Deferred: " + String(deferredMessages) + ", dropped: " + String(droppedMessages) +
+              ", waiting:";
+    for (uint8_t i = 0; i < SEND_PRIORITY_COUNT; i++) {
+        status += " " + String(deferredQueue[i] != NULL ? uxQueueMessagesWaiting(deferredQueue[i])
+                                                        : 0);
+    }
+    status += "\n";
+
+    return status;
+}
+
+bool LoRaMeshService::sendClosestGateway(DataMessage* message, DeliveryMode mode,
+                                         DeliveryCallback callback) {
     RouteNode* gatewayNode = radio.getClosestGateway();
 
     if (!gatewayNode) {
+        // Kept until a gateway appears in the routing table
+        if (carryForward.add(message, getSendPriority(message), mode, callback)) {
+            ESP_LOGW(LMS_TAG, "No gateway found, message carried forward");
+            xTaskNotifyGive(deferredSend_Handle);
+            return true;
+        }
+
         ESP_LOGE(LMS_TAG, "No gateway found");
         return false;
     }
 
     message->addrDst = gatewayNode->networkNode.address;
 
+    // Low priority messages wait for another frame to the gateway
+    if (mode != DeliveryMode::Reliable && !callback && Piggyback::canWait(message) &&
+        piggyback.add(message)) {
+        ESP_LOGV(LMS_TAG, "Message waiting for a carrier to gateway %X", message->addrDst);
+        xTaskNotifyGive(deferredSend_Handle);
+        return true;
+    }
+
     ESP_LOGI(LMS_TAG, "Sending message to gateway %X", message->addrDst);
 
-    send(message);
+    DataMessage* combined = piggyback.attach(message);
+    if (combined) {
+        send(combined, mode, callback);
+        vPortFree(combined);
+        return true;
+    }
+
+    send(message, mode, callback);
 
     return true;
 }
 
+String LoRaMeshService::setDeliveryPolicy(uint8_t port, DeliveryMode mode) {
+    if (port >= DELIVERY_POLICY_SIZE || mode >= DELIVERY_MODE_COUNT)
+        return "Invalid appPort or delivery mode";
+
+    deliveryPolicy[port] = mode;
+
+    return "Delivery policy of appPort " + String(port) + " set to " + String(mode);
+}
+
+String LoRaMeshService::getDeliveryStatus() {
+    static const char* modeNames[DELIVERY_MODE_COUNT] = {"Default", "Unreliable", "Reliable"};
+
+    String status = "--- Delivery ---\nPolicy (appPort: mode):";
+    for (uint8_t port = 0; port < DELIVERY_POLICY_SIZE; port++) {
+        if (deliveryPolicy[port] != DeliveryMode::DefaultDelivery)
+            status += " " + String(port) + ": " + modeNames[deliveryPolicy[port]];
+    }
+    status += "\nDefault: " + String(SEND_RELIABLE == 0 ? "Unreliable" : "Reliable") + "\n";
+
+    for (uint8_t mode = DeliveryMode::Unreliable; mode < DELIVERY_MODE_COUNT; mode++) {
+        xSemaphoreTake(deliveryMutex, portMAX_DELAY);
+        DeliveryStats stats = deliveryStats[mode];
+        xSemaphoreGive(deliveryMutex);
+
+        status += String(modeNames[mode]) + ": " + String(stats.messages) + " messages, " +
+                  String(stats.bytes) + " B, " + String(stats.airtime) + " ms airtime";
+        if (stats.messages > 0)
+            status += ", send latency " + String(stats.getMeanLatency()) + " ms mean / " +
+                      String(stats.latencyMax) + " ms max";
+        if (mode == DeliveryMode::Reliable)
+            status += ", " + String(stats.unknown) + " finished without a result, " +
+                      String(stats.timedOut) + " timed out";
+        status += "\n";
+    }
+
+    status += "The send latency is the wait until LoRaMesher sends the packet. LoRaMesher does not "
+              "report the ACKs, a finished reliable send may not have been delivered\n";
+
+    return status;
+}
+
 bool LoRaMeshService::hasActiveConnections() {
     return radio.hasActiveConnections();
 }
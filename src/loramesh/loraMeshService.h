@@ -14,6 +14,22 @@
 
 #include "loraMeshCommandService.h"
 
+#include "dutyCycle.h"
+
+#include "piggyback.h"
+
+#include "carryForward.h"
+
+#include "delivery.h"
+
+#include "helpers/histogram.h"
+
+#include "helpers/metrics.h"
+
+#include "monitor/taskMonitor.h"
+
+#include <vector>
+
 
 class LoRaMeshService : public MessageService {
 public:
@@ -40,9 +56,18 @@ public:
 
     String getRoutingTable();
 
-    void send(DataMessage* message);
+    /**
+     * @brief Send a message through the mesh
+     *
+     * @param message Message to send, it is copied if the send is deferred
+     * @param mode Delivery mode, DefaultDelivery uses the policy of the source appPort
+     * @param callback Called when a reliable send finishes
+     */
+    void send(DataMessage* message, DeliveryMode mode = DefaultDelivery,
+              DeliveryCallback callback = nullptr);
 
-    bool sendClosestGateway(DataMessage* message);
+    bool sendClosestGateway(DataMessage* message, DeliveryMode mode = DefaultDelivery,
+                            DeliveryCallback callback = nullptr);
 
     static inline void setGateway() { LoraMesher::getInstance().addGatewayRole(); }
 
@@ -72,14 +97,118 @@ public:
 
     void updateRoutingTable();
 
+    /**
+     * @brief Remaining airtime of the duty cycle window in the sub-band in use
+     *
+     * @return uint32_t Milliseconds
+     */
+    uint32_t getRemainingAirtime() { return dutyCycle.getRemainingAirtime(); }
+
+    String getAirtimeStatus();
+
+    /**
+     * @brief Time on air of a payload with the current radio configuration
+     *
+     * @param payloadSize Payload size in bytes
+     * @return uint32_t Milliseconds
+     */
+    uint32_t getAirtime(uint32_t payloadSize) { return dutyCycle.getAirtime(payloadSize); }
+
+    /**
+     * @brief Set the delivery mode used by default for the messages of an appPort
+     *
+     */
+    String setDeliveryPolicy(uint8_t port, DeliveryMode mode);
+
+    String getDeliveryStatus();
+
+    /**
+     * @brief Get the receive statistics: batches and the per packet time spent waiting in the
+     * queue, converting, dispatching and freeing, in microseconds
+     *
+     * @param reset Reset the statistics after reading them
+     * @return String
+     */
+    String getReceiveStatus(bool reset = false);
+
+    String getPiggybackStatus() { return piggyback.getStatus(); }
+
+    String getCarryForwardStatus() { return carryForward.getStatus(); }
+
 private:
     LoraMesher& radio = LoraMesher::getInstance();
 
     TaskHandle_t receiveLoRaMessage_Handle = NULL;
 
+    DutyCycle dutyCycle;
+
+    Piggyback piggyback;
+
+    CarryForward carryForward;
+
+    struct PendingSend {
+        DataMessage* message;
+        DeliveryMode mode;
+        DeliveryCallback callback;
+        uint32_t createdAt;
+    };
+
+    struct PendingDelivery {
+        DeliveryCallback callback;
+        uint32_t createdAt;
+        uint32_t sentAt;
+    };
+
+    xQueueHandle deferredQueue[SEND_PRIORITY_COUNT] = {};
+
+    TaskHandle_t deferredSend_Handle = NULL;
+
+    uint32_t deferredMessages = 0;
+
+    uint32_t droppedMessages = 0;
+
+    DeliveryMode deliveryPolicy[DELIVERY_POLICY_SIZE] = {};
+
+    DeliveryStats deliveryStats[DELIVERY_MODE_COUNT];
+
+    std::vector<PendingDelivery> pendingDeliveries;
+
+    SemaphoreHandle_t deliveryMutex = NULL;
+
+    void createDeferredSendTask();
+
+    static void deferredSendLoop(void*);
+
+    SendPriority getSendPriority(DataMessage* message);
+
+    DeliveryMode getDeliveryMode(DataMessage* message, DeliveryMode mode);
+
+    bool hasDeferredMessages(SendPriority priority);
+
+    void deferMessage(DataMessage* message, SendPriority priority, DeliveryMode mode,
+                      DeliveryCallback callback);
+
+    void sendNow(DataMessage* message, DeliveryMode mode, DeliveryCallback callback,
+                 uint32_t createdAt);
+
+    bool checkPendingDeliveries();
+
     LoRaMeshService() : MessageService(appPort::LoRaMesherApp, String("LoRaMesherApp")) {
         loraMesherCommandService = new LoRaMeshCommandService();
         commandService = loraMesherCommandService;
+        deliveryMutex = xSemaphoreCreateMutex();
+
+        // Periodic telemetry does not need ACKs, commands and controls do
+        deliveryPolicy[appPort::MonApp] = DeliveryMode::Unreliable;
+        deliveryPolicy[appPort::SensorApp] = DeliveryMode::Unreliable;
+        deliveryPolicy[appPort::MetadataApp] = DeliveryMode::Unreliable;
+        deliveryPolicy[appPort::CommandApp] = DeliveryMode::Reliable;
+        deliveryPolicy[appPort::LedApp] = DeliveryMode::Reliable;
+        deliveryPolicy[appPort::DisplayApp] = DeliveryMode::Reliable;
+        // The transfers acknowledge the chunks themselves
+        deliveryPolicy[appPort::TransferApp] = DeliveryMode::Unreliable;
+        // SimApp stays at the default, SEND_RELIABLE, that the experiment payloads are measured
+        // with. Sim sends its control and status messages with an explicit mode instead
     };
 
     void createReceiveMessages();
@@ -87,4 +216,31 @@ private:
     LoRaMeshMessage* createLoRaMeshMessage(DataMessage* message);
 
     DataMessage* createDataMessage(AppPacket<LoRaMeshMessage>* message);
+
+    // Buffer reused by every received packet, it only grows
+    DataMessage* receiveBuffer = nullptr;
+
+    uint32_t receiveBufferSize = 0;
+
+    struct ReceiveTiming {
+        uint32_t drainWait;
+        uint32_t convert;
+        uint32_t dispatch;
+        uint32_t free;
+    };
+
+    Histogram drainWaitHistogram;
+    Histogram convertHistogram;
+    Histogram dispatchHistogram;
+    Histogram freeHistogram;
+
+    uint32_t receivedBatches = 0;
+
+    uint32_t maxBatchSize = 0;
+
+    uint32_t receiveErrors = 0;
+
+    SemaphoreHandle_t receiveStatsMutex = NULL;
+
+    void recordReceiveBatch(ReceiveTiming* timings, uint8_t size);
 };
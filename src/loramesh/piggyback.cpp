@@ -0,0 +1,168 @@
+#include "piggyback.h"
+
+#include "loraMeshMessage.h"
+
+static const char* PB_TAG = "Piggyback";
+
+// Bytes added to the carrier: the header and the size byte
+#define PIGGYBACK_OVERHEAD (sizeof(PiggybackHeader) + 1)
+
+bool Piggyback::canWait(DataMessage* message) {
+    if (PIGGYBACK_ENABLED == 0)
+        return false;
+
+    if (message->appPortSrc != appPort::MonApp && message->appPortSrc != appPort::MetadataApp)
+        return false;
+
+    // Only the messages that leave room for a carrier in a single frame
+    return sizeof(LoRaMeshMessage) + message->messageSize + PIGGYBACK_OVERHEAD <
+           LORAMESH_MAX_FRAME_PAYLOAD;
+}
+
+bool Piggyback::add(DataMessage* message) {
+    DataMessage* copy = (DataMessage*)pvPortMalloc(message->getDataMessageSize());
+    if (copy == nullptr)
+        return false;
+
+    memcpy(copy, message, message->getDataMessageSize());
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (pending.size() >= PIGGYBACK_MAX_PENDING) {
+        xSemaphoreGive(mutex);
+        vPortFree(copy);
+        dropped++;
+        return false;
+    }
+
+    pending.push_back({copy, millis()});
+
+    xSemaphoreGive(mutex);
+
+    return true;
+}
+
+DataMessage* Piggyback::attach(DataMessage* carrier) {
+    if (carrier->appPortDst & PIGGYBACK_FLAG)
+        return nullptr;
+
+    uint32_t carrierSize = sizeof(LoRaMeshMessage) + carrier->messageSize;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        DataMessage* message = it->message;
+
+        // Only to the same gateway and inside a single frame
+        if (message->addrDst != carrier->addrDst ||
+            carrierSize + message->messageSize + PIGGYBACK_OVERHEAD > LORAMESH_MAX_FRAME_PAYLOAD)
+            continue;
+
+        uint32_t messageSize = carrier->messageSize + message->messageSize + PIGGYBACK_OVERHEAD;
+        DataMessage* combined = (DataMessage*)pvPortMalloc(sizeof(DataMessage) + messageSize);
+        if (combined == nullptr)
+            break;
+
+        memcpy(combined, carrier, carrier->getDataMessageSize());
+        combined->appPortDst = (appPort)(carrier->appPortDst | PIGGYBACK_FLAG);
+        combined->messageSize = messageSize;
+
+        uint8_t* trailer = combined->message + carrier->messageSize;
+        PiggybackHeader header = {message->appPortDst, message->appPortSrc, message->messageId};
+        memcpy(trailer, &header, sizeof(PiggybackHeader));
+        memcpy(trailer + sizeof(PiggybackHeader), message->message, message->messageSize);
+        trailer[sizeof(PiggybackHeader) + message->messageSize] = message->messageSize;
+
+        vPortFree(message);
+        pending.erase(it);
+        attached++;
+
+        xSemaphoreGive(mutex);
+
+        return combined;
+    }
+
+    xSemaphoreGive(mutex);
+
+    return nullptr;
+}
+
+DataMessage* Piggyback::takeExpired() {
+    DataMessage* message = nullptr;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (!pending.empty() && millis() - pending.front().queuedAt >= PIGGYBACK_DEADLINE) {
+        message = pending.front().message;
+        pending.erase(pending.begin());
+        standalone++;
+    }
+
+    xSemaphoreGive(mutex);
+
+    return message;
+}
+
+uint32_t Piggyback::getWaitTime() {
+    uint32_t waitTime = UINT32_MAX;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (!pending.empty()) {
+        uint32_t waited = millis() - pending.front().queuedAt;
+        waitTime = waited >= PIGGYBACK_DEADLINE ? 0 : PIGGYBACK_DEADLINE - waited;
+    }
+
+    xSemaphoreGive(mutex);
+
+    return waitTime;
+}
+
+DataMessage* Piggyback::split(DataMessage* message) {
+    if (!(message->appPortDst & PIGGYBACK_FLAG))
+        return nullptr;
+
+    message->appPortDst = (appPort)(message->appPortDst & ~PIGGYBACK_FLAG);
+
+    if (message->messageSize < PIGGYBACK_OVERHEAD)
+        return nullptr;
+
+    uint8_t size = message->message[message->messageSize - 1];
+    if (message->messageSize < PIGGYBACK_OVERHEAD + size) {
+        ESP_LOGW(PB_TAG, "Malformed piggyback from %X", message->addrSrc);
+        return nullptr;
+    }
+
+    uint32_t carrierSize = message->messageSize - PIGGYBACK_OVERHEAD - size;
+    uint8_t* trailer = message->message + carrierSize;
+
+    DataMessage* piggybacked = (DataMessage*)pvPortMalloc(sizeof(DataMessage) + size);
+    if (piggybacked == nullptr)
+        return nullptr;
+
+    PiggybackHeader header;
+    memcpy(&header, trailer, sizeof(PiggybackHeader));
+
+    piggybacked->appPortDst = header.appPortDst;
+    piggybacked->appPortSrc = header.appPortSrc;
+    piggybacked->messageId = header.messageId;
+    piggybacked->addrSrc = message->addrSrc;
+    piggybacked->addrDst = message->addrDst;
+    piggybacked->messageSize = size;
+    memcpy(piggybacked->message, trailer + sizeof(PiggybackHeader), size);
+
+    message->messageSize = carrierSize;
+    received++;
+
+    return piggybacked;
+}
+
+String Piggyback::getStatus() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    size_t waiting = pending.size();
+    xSemaphoreGive(mutex);
+
+    return "--- Piggyback ---\nAttached: " + String(attached) + ", sent alone: " +
+           String(standalone) + ", dropped: " + String(dropped) + ", waiting: " + String(waiting) +
+           ", received: " + String(received) + "\n";
+}
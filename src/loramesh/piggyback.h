@@ -0,0 +1,101 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "config.h"
+
+#include "message/dataMessage.h"
+
+// Set in the appPortDst of a frame that carries a piggybacked message after its own payload
+#define PIGGYBACK_FLAG 0x80
+
+#pragma pack(1)
+
+/**
+ * @brief Header of the piggybacked message. It is written after the payload of the carrier and
+ * followed by the piggybacked payload and one byte with the size of that payload.
+ *
+ */
+class PiggybackHeader {
+public:
+    appPort appPortDst;
+    appPort appPortSrc;
+    uint8_t messageId;
+};
+
+#pragma pack()
+
+/**
+ * @brief Holds the low priority gateway-bound messages (Mon, Metadata) until another frame to the
+ * gateway has room to carry them. The messages that do not find a carrier before
+ * PIGGYBACK_DEADLINE are sent on their own.
+ *
+ */
+class Piggyback {
+public:
+    Piggyback() { mutex = xSemaphoreCreateMutex(); }
+
+    /**
+     * @brief The message can wait for a carrier
+     *
+     */
+    static bool canWait(DataMessage* message);
+
+    /**
+     * @brief Keep a copy of the message until a carrier is sent
+     *
+     * @return true If there was room to keep it
+     */
+    bool add(DataMessage* message);
+
+    /**
+     * @brief Attach the oldest pending message that fits to a carrier
+     *
+     * @param carrier Gateway-bound message
+     * @return DataMessage* New message with the carrier and the piggybacked message, to be freed
+     * with vPortFree. nullptr if nothing fits.
+     */
+    DataMessage* attach(DataMessage* carrier);
+
+    /**
+     * @brief Take a message that has waited more than PIGGYBACK_DEADLINE
+     *
+     * @return DataMessage* Message to be sent and freed with vPortFree, nullptr if none
+     */
+    DataMessage* takeExpired();
+
+    /**
+     * @brief Time until the oldest pending message expires
+     *
+     * @return uint32_t ms, UINT32_MAX if there are no pending messages
+     */
+    uint32_t getWaitTime();
+
+    /**
+     * @brief Remove the piggybacked message from a received frame
+     *
+     * @param message Received frame, the flag and the trailer are removed in place
+     * @return DataMessage* The piggybacked message, to be freed with vPortFree. nullptr if the
+     * frame did not carry one or it is malformed.
+     */
+    DataMessage* split(DataMessage* message);
+
+    String getStatus();
+
+private:
+    struct PendingPiggyback {
+        DataMessage* message;
+        uint32_t queuedAt;
+    };
+
+    std::vector<PendingPiggyback> pending;
+
+    SemaphoreHandle_t mutex = NULL;
+
+    uint32_t attached = 0;
+    uint32_t standalone = 0;
+    uint32_t dropped = 0;
+    uint32_t received = 0;
+};
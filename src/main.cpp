@@ -10,6 +10,9 @@
 // Manager
 #include "message/messageManager.h"
 
+// Heap
+#include "helpers/heapProfiler.h"
+
 // LoRaMesh
 #include "loramesh/loraMeshService.h"
 
@@ -98,9 +101,14 @@ void initMetadata() {
 
 #pragma region Sensors
 
+#include "sensor/history/sensorHistory.h"
+
 SensorService& sensorService = SensorService::getInstance();
 
+SensorHistory& sensorHistory = SensorHistory::getInstance();
+
 void initSensors() {
+    sensorHistory.init();
     sensorService.init();
 }
 
@@ -141,6 +149,30 @@ void initMQTT() {
 #pragma endregion
 
 
+#pragma region Transfer
+#include "transfer/transferService.h"
+
+TransferService& transferService = TransferService::getInstance();
+
+void initTransfer() {
+    transferService.init();
+}
+
+#pragma endregion
+
+
+#pragma region TimeSync
+#include "time/timeSyncService.h"
+
+TimeSyncService& timeSyncService = TimeSyncService::getInstance();
+
+void initTimeSync() {
+    timeSyncService.init();
+}
+
+#pragma endregion
+
+
 #pragma region GPS
 
 #include "gps/gpsService.h"
@@ -200,6 +232,9 @@ void initManager() {
     manager.addMessageService(&sensorService);
     ESP_LOGV(TAG, "Sensors service added to manager");
 
+    manager.addMessageService(&sensorHistory);
+    ESP_LOGV(TAG, "Sensor history service added to manager");
+
     manager.addMessageService(&simulator);
     ESP_LOGV(TAG, "Simulator service added to manager");
 
@@ -209,6 +244,12 @@ void initManager() {
     manager.addMessageService(&displayService);
     ESP_LOGV(TAG, "Display service added to manager");
 
+    manager.addMessageService(&transferService);
+    ESP_LOGV(TAG, "Transfer service added to manager");
+
+    manager.addMessageService(&timeSyncService);
+    ESP_LOGV(TAG, "TimeSync service added to manager");
+
     Serial.println(manager.getAvailableCommands());
 }
 
@@ -279,6 +320,14 @@ void setup() {
     initLoRaMesher();
     ESP_LOGV(TAG, "Heap after initLoRaMesher: %d", ESP.getFreeHeap());
 
+#ifdef LORA_ENABLED
+    // Initialize Transfer
+    initTransfer();
+
+    // Initialize Time Sync
+    initTimeSync();
+#endif
+
 #ifdef BLUETOOTH_ENABLED
     // Initialize Bluetooth
     initBluetooth();
@@ -327,10 +376,9 @@ void setup() {
 }
 
 void loop() {
-    vTaskDelay(200000 / portTICK_PERIOD_MS);
+    vTaskDelay(HEAP_REPORT_INTERVAL / portTICK_PERIOD_MS);
 
-    Serial.printf("FREE HEAP: %d\n", ESP.getFreeHeap());
-    Serial.printf("Min, Max: %d, %d\n", ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+    Serial.print(HeapProfiler::getStatus(true));
 
 #ifdef BATTERY_ENABLED
     if (battery.getVoltagePercentage() < 20) {
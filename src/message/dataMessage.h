@@ -34,6 +34,9 @@ enum appPort : uint8_t {
     MetadataApp = 15,
     MonApp = 16,
     DisplayApp = 17,
+    TransferApp = 18,
+    TimeSyncApp = 19,
+    HistoryApp = 20,
 };
 
 class DataMessageGeneric {
@@ -1,5 +1,7 @@
 #include "messageManager.h"
 
+#include "helpers/heapProfiler.h"
+
 static const char* MANAGER_TAG = "MANAGER";
 
 void MessageManager::init() {}
@@ -127,30 +129,51 @@ String MessageManager::printDataMessageHeader(String title, DataMessage* message
 }
 
 void MessageManager::processReceivedMessage(messagePort port, DataMessage* message) {
+    MessageTraceRecorder::getInstance().record(TraceReceived, port, message);
+
     printDataMessageHeader("Received", message);
 
     // TODO: Add a list to track the messages already received to avoid loops and duplicates
 
-    if (message->addrDst != 0 &&
-        message->addrDst != LoRaMeshService::getInstance().getLocalAddress()) {
+    // Broadcasts from the mesh are also for this node, the ones from the server go to the mesh
+    bool forMe = message->addrDst == 0 ||
+                 message->addrDst == LoRaMeshService::getInstance().getLocalAddress() ||
+                 (port == LoRaMeshPort && message->addrDst == BROADCAST_ADDR);
+
+    if (!forMe) {
         ESP_LOGI(MANAGER_TAG, "Message not for me");
         if (port == MqttPort) {
-            sendMessage(LoRaMeshPort, message);
+            // Downlink from the server carries commands and control, do not lose it silently
+            sendMessage(LoRaMeshPort, message, DeliveryMode::Reliable);
         }
         return;
     }
 
+    if (port == LoRaMeshPort && message->appPortDst == MQTTApp) {
+        for (auto service : services) {
+            if (service->serviceId == message->appPortSrc) {
+                HeapOwner owner(service->serviceId);
+                service->processGatewayMessage(message);
+            }
+        }
+    }
+
     for (auto service : services) {
         if (service->serviceId == message->appPortDst) {
+            HeapOwner owner(service->serviceId);
             service->processReceivedMessage(port, message);
         }
     }
 }
 
-void MessageManager::sendMessage(messagePort port, DataMessage* message) {
+void MessageManager::sendMessage(messagePort port, DataMessage* message, DeliveryMode mode,
+                                 DeliveryCallback callback) {
+    Metrics::increment(MetricTxMessages);
+    MessageTraceRecorder::getInstance().record(TraceSent, port, message, mode);
+
     switch (port) {
         case LoRaMeshPort:
-            sendMessageLoRaMesher(message);
+            sendMessageLoRaMesher(message, mode, callback);
             break;
         case BluetoothPort:
             sendMessageBluetooth(message);
@@ -159,7 +182,7 @@ void MessageManager::sendMessage(messagePort port, DataMessage* message) {
             sendMessageWiFi(message);
             break;
         case MqttPort:
-            sendMessageMqtt(message);
+            sendMessageMqtt(message, mode, callback);
             break;
         case InternalPort:
             processReceivedMessage(InternalPort, message);
@@ -169,12 +192,14 @@ void MessageManager::sendMessage(messagePort port, DataMessage* message) {
     }
 }
 
-void MessageManager::sendMessageLoRaMesher(DataMessage* message) {
+void MessageManager::sendMessageLoRaMesher(DataMessage* message, DeliveryMode mode,
+                                           DeliveryCallback callback) {
     LoRaMeshService& mesher = LoRaMeshService::getInstance();
-    mesher.send(message);
+    mesher.send(message, mode, callback);
 }
 
-void MessageManager::sendMessageMqtt(DataMessage* message) {
+void MessageManager::sendMessageMqtt(DataMessage* message, DeliveryMode mode,
+                                     DeliveryCallback callback) {
     MqttService& mqtt = MqttService::getInstance();
     if (mqtt.isInitialized() && mqtt.writeToMqtt(message)) {
         ESP_LOGI(MANAGER_TAG, "Message sent to MQTT");
@@ -182,7 +207,7 @@ void MessageManager::sendMessageMqtt(DataMessage* message) {
     }
 
     LoRaMeshService& mesher = LoRaMeshService::getInstance();
-    mesher.sendClosestGateway(message);
+    mesher.sendClosestGateway(message, mode, callback);
 }
 
 void MessageManager::sendMessageWiFi(DataMessage* message) {
@@ -8,12 +8,22 @@
 
 #include "messageService.h"
 
+#include "loramesh/delivery.h"
+
+#include "helpers/metrics.h"
+
+#include "messageTraceRecorder.h"
+
 #include "loramesh/loraMeshService.h"
 
 #include "mqtt/mqttService.h"
 
 #include "wifi/wifiServerService.h"
 
+#ifdef HOST_NODES
+#include "hostNodes.h"
+#endif
+
 class MessageManager {
 public:
     /**
@@ -21,8 +31,13 @@ public:
      *
      */
     static MessageManager& getInstance() {
+#ifdef HOST_NODES
+        // tools/meshsim runs a MessageManager per virtual node
+        return HostNodes::instance<MessageManager>();
+#else
         static MessageManager instance;
         return instance;
+#endif
     }
 
     xQueueHandle xProcessQueue;
@@ -35,7 +50,9 @@ public:
 
     void processReceivedMessage(messagePort port, DataMessage* message);
 
-    void sendMessage(messagePort port, DataMessage* message);
+    void sendMessage(messagePort port, DataMessage* message,
+                     DeliveryMode mode = DeliveryMode::DefaultDelivery,
+                     DeliveryCallback callback = nullptr);
 
     String getAvailableCommands();
 
@@ -52,6 +69,10 @@ public:
     String printDataMessageHeader(String title, DataMessage* message);
 
 private:
+#ifdef HOST_NODES
+    friend class HostNodes;
+#endif
+
     MessageManager(){};
 
     std::vector<MessageService*> services;
@@ -61,10 +82,12 @@ private:
     TaskHandle_t receiveMessageManager_TaskHandle = NULL;
 
     // TODO: Fix that to a specific sender
-    static void sendMessageLoRaMesher(DataMessage* message);
+    static void sendMessageLoRaMesher(DataMessage* message, DeliveryMode mode,
+                                      DeliveryCallback callback);
 
     static void sendMessageBluetooth(DataMessage* message) {};
 
     static void sendMessageWiFi(DataMessage* message);
-    static void sendMessageMqtt(DataMessage* message);
+    static void sendMessageMqtt(DataMessage* message, DeliveryMode mode,
+                                DeliveryCallback callback);
 };
\ No newline at end of file
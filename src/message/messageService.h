@@ -20,6 +20,13 @@ public:
                  serviceName.c_str());
     };
 
+    /**
+     * @brief Called at a gateway for the messages of this service received from the mesh and
+     * forwarded to the server, before they are forwarded
+     *
+     */
+    virtual void processGatewayMessage(DataMessage* message) {}
+
     virtual String getJSON(DataMessage* message) {
         ESP_LOGE(MS_TAG, "getJSON not implemented for service %s", serviceName.c_str());
         return "";
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+// Format of the message traces of MessageTraceRecorder, also read by tools/tracereplay on the host,
+// so this header only depends on the standard types.
+//
+// A trace is a MessageTraceHeader followed by records. Each record is a MessageTraceRecord
+// followed by the first size bytes of the DataMessage, as it was in memory.
+
+#define MESSAGE_TRACE_MAGIC 0x5254434C  // "LCTR"
+#define MESSAGE_TRACE_VERSION 1
+
+// Lines of the dump of the trace in the serial log, the base64 of the trace is between them
+#define MESSAGE_TRACE_DUMP_BEGIN "--- MESSAGE TRACE BEGIN ---"
+#define MESSAGE_TRACE_DUMP_END "--- MESSAGE TRACE END ---"
+
+enum MessageTraceEvent : uint8_t {
+    TraceReceived = 0,  // MessageManager::processReceivedMessage
+    TraceSent = 1,      // MessageManager::sendMessage
+};
+
+#pragma pack(1)
+
+class MessageTraceHeader {
+public:
+    uint32_t magic;
+    uint8_t version;
+    uint16_t localAddress;
+    uint32_t startMillis;  // millis() of the node when the recording started
+};
+
+class MessageTraceRecord {
+public:
+    uint32_t delta;     // us since the previous record, or since the start for the first one
+    uint8_t event;      // MessageTraceEvent
+    uint8_t port;       // messagePort
+    uint8_t mode;       // DeliveryMode of the sent messages
+    uint16_t size;      // Bytes of the message that follow the record
+    uint32_t fullSize;  // Bytes of the message, larger than size if it was truncated
+};
+
+#pragma pack()
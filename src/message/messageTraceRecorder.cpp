@@ -0,0 +1,182 @@
+#include "messageTraceRecorder.h"
+
+#include "mbedtls/base64.h"
+
+#include "LoraMesher.h"
+
+static const char* TRACE_TAG = "MessageTrace";
+
+// Bytes of the trace per base64 line of the dump
+#define MESSAGE_TRACE_DUMP_LINE 57
+
+String MessageTraceRecorder::start() {
+    if (recording)
+        return "Already recording\n";
+
+    stop();
+
+    if (!SPIFFS.begin(true))
+        return "SPIFFS not available\n";
+
+    buffer = (uint8_t*)pvPortMalloc(MESSAGE_TRACE_BUFFER_SIZE);
+    if (buffer == nullptr)
+        return "Not enough memory for the trace buffer\n";
+
+    File file = SPIFFS.open(MESSAGE_TRACE_FILE, FILE_WRITE);
+    if (!file) {
+        vPortFree(buffer);
+        buffer = nullptr;
+        return "Could not create " + String(MESSAGE_TRACE_FILE) + "\n";
+    }
+
+    MessageTraceHeader header;
+    header.magic = MESSAGE_TRACE_MAGIC;
+    header.version = MESSAGE_TRACE_VERSION;
+    header.localAddress = LoraMesher::getInstance().getLocalAddress();
+    header.startMillis = millis();
+    file.write((uint8_t*)&header, sizeof(MessageTraceHeader));
+    file.close();
+
+    buffered = 0;
+    fileSize = sizeof(MessageTraceHeader);
+    records = 0;
+    truncated = 0;
+    dropped = 0;
+    lastMicros = micros();
+    recording = true;
+
+    ESP_LOGI(TRACE_TAG, "Recording the message trace");
+
+    return "Recording the message trace\n";
+}
+
+String MessageTraceRecorder::stop() {
+    // A full trace stops the recording but keeps the buffer until here
+    if (buffer == nullptr)
+        return "Not recording\n";
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (recording) {
+        recording = false;
+        flush();
+    }
+
+    vPortFree(buffer);
+    buffer = nullptr;
+
+    xSemaphoreGive(mutex);
+
+    return getStatus();
+}
+
+void MessageTraceRecorder::append(MessageTraceEvent event, uint8_t port, DataMessage* message,
+                                  uint8_t mode) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    // Stopped while waiting for the mutex
+    if (!recording) {
+        xSemaphoreGive(mutex);
+        return;
+    }
+
+    MessageTraceRecord record;
+    record.fullSize = message->getDataMessageSize();
+    record.size = std::min<uint32_t>(record.fullSize, MESSAGE_TRACE_MAX_MESSAGE);
+    record.event = event;
+    record.port = port;
+    record.mode = mode;
+
+    size_t recordSize = sizeof(MessageTraceRecord) + record.size;
+
+    if ((buffered + recordSize > MESSAGE_TRACE_BUFFER_SIZE && !flush()) ||
+        fileSize + buffered + recordSize > MESSAGE_TRACE_MAX_SIZE) {
+        dropped++;
+        xSemaphoreGive(mutex);
+        return;
+    }
+
+    uint32_t now = micros();
+    record.delta = now - lastMicros;
+    lastMicros = now;
+
+    memcpy(buffer + buffered, &record, sizeof(MessageTraceRecord));
+    memcpy(buffer + buffered + sizeof(MessageTraceRecord), message, record.size);
+    buffered += recordSize;
+
+    records++;
+    if (record.size < record.fullSize)
+        truncated++;
+
+    xSemaphoreGive(mutex);
+}
+
+bool MessageTraceRecorder::flush() {
+    if (buffered == 0)
+        return true;
+
+    File file = SPIFFS.open(MESSAGE_TRACE_FILE, FILE_APPEND);
+    if (!file) {
+        ESP_LOGE(TRACE_TAG, "Could not open the trace");
+        return false;
+    }
+
+    size_t written = file.write(buffer, buffered);
+    file.close();
+
+    fileSize += written;
+
+    // A partial record would corrupt the rest of the trace
+    if (written != buffered) {
+        ESP_LOGE(TRACE_TAG, "Trace full, recording stopped");
+        recording = false;
+        return false;
+    }
+
+    buffered = 0;
+
+    return true;
+}
+
+String MessageTraceRecorder::getStatus() {
+    String status = "--- Message trace ---\n";
+
+    status += recording ? "Recording\n" : "Stopped\n";
+    status += "Records " + String(records) + ", truncated " + String(truncated) + ", dropped " +
+              String(dropped) + ", " + String(fileSize + buffered) + " bytes\n";
+
+    return status;
+}
+
+String MessageTraceRecorder::dump() {
+    if (recording)
+        return "Stop the recording first\n";
+
+    File file = SPIFFS.open(MESSAGE_TRACE_FILE, FILE_READ);
+    if (!file)
+        return "No trace\n";
+
+    Serial.println(MESSAGE_TRACE_DUMP_BEGIN);
+
+    uint8_t data[MESSAGE_TRACE_DUMP_LINE];
+    unsigned char line[((MESSAGE_TRACE_DUMP_LINE + 2) / 3) * 4 + 1];
+    size_t read;
+    size_t total = 0;
+
+    while ((read = file.read(data, MESSAGE_TRACE_DUMP_LINE)) > 0) {
+        size_t length = 0;
+        mbedtls_base64_encode(line, sizeof(line), &length, data, read);
+        line[length] = '\0';
+        Serial.println((const char*)line);
+        total += read;
+
+        // Let the other tasks run during long dumps
+        vTaskDelay(1 / portTICK_PERIOD_MS);
+    }
+
+    file.close();
+
+    Serial.println(MESSAGE_TRACE_DUMP_END);
+
+    return "Dumped " + String(total) + " bytes\n";
+}
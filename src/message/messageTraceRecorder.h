@@ -0,0 +1,83 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "SPIFFS.h"
+
+#include "dataMessage.h"
+
+#include "messageTrace.h"
+
+#include "config.h"
+
+/**
+ * @brief Records the messages that go through the MessageManager into a binary trace in SPIFFS,
+ * see messageTrace.h. tools/tracereplay replays the traces on the host.
+ *
+ * The records are collected in a buffer of MESSAGE_TRACE_BUFFER_SIZE bytes, allocated only while
+ * recording, and appended to the file when it is full, in the task of the message. When the file
+ * reaches MESSAGE_TRACE_MAX_SIZE the next records are dropped.
+ *
+ */
+class MessageTraceRecorder {
+public:
+    static MessageTraceRecorder& getInstance() {
+        static MessageTraceRecorder instance;
+        return instance;
+    }
+
+    /**
+     * @brief Start a new trace, the previous one is deleted
+     *
+     */
+    String start();
+
+    String stop();
+
+    /**
+     * @brief Record a message if a trace is being recorded
+     *
+     * @param mode DeliveryMode of the sent messages
+     */
+    void record(MessageTraceEvent event, uint8_t port, DataMessage* message, uint8_t mode = 0) {
+        if (recording)
+            append(event, port, message, mode);
+    }
+
+    String getStatus();
+
+    /**
+     * @brief Print the trace as base64 lines in the serial output, between MESSAGE_TRACE_DUMP_BEGIN
+     * and MESSAGE_TRACE_DUMP_END. tools/tracereplay reads the log directly.
+     *
+     */
+    String dump();
+
+private:
+    MessageTraceRecorder() { mutex = xSemaphoreCreateMutex(); };
+
+    SemaphoreHandle_t mutex = NULL;
+
+    volatile bool recording = false;
+
+    uint8_t* buffer = nullptr;
+
+    size_t buffered = 0;
+
+    uint32_t lastMicros = 0;
+
+    uint32_t fileSize = 0;
+
+    uint32_t records = 0;
+    uint32_t truncated = 0;
+    uint32_t dropped = 0;
+
+    void append(MessageTraceEvent event, uint8_t port, DataMessage* message, uint8_t mode);
+
+    /**
+     * @brief Append the buffer to the file
+     *
+     * @return true If the buffer is empty again
+     */
+    bool flush();
+};
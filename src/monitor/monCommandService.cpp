@@ -1,5 +1,7 @@
 #include "monCommandService.h"
 #include "monService.h"
+#include "helpers/heapProfiler.h"
+#include "message/messageTraceRecorder.h"
 
 monCommandService::monCommandService() {
     // addCommand(Command("/ledOn", "Set the Led On specifying the source in hex (like the
@@ -13,4 +15,41 @@ monCommandService::monCommandService() {
     //     [this](String args) {
     //     return String(Led::getInstance().ledOff(strtol(args.c_str(), NULL, 16)));
     // }));
+
+    addCommand(Command("/monStats", "Get the Mon keyframe and delta report statistics",
+                       MonCommand::GetMonStats, 1,
+                       [this](String args) { return MonService::getInstance().getStats(); }));
+
+    addCommand(Command("/metrics", "Get the metrics of the current report window",
+                       MonCommand::GetMetrics, 1,
+                       [this](String args) { return Metrics::getInstance().getStatus(); }));
+
+    addCommand(Command("/tasks", "Get the CPU use, free stack and core of the tasks and the queues",
+                       MonCommand::GetTasks, 1,
+                       [this](String args) { return TaskMonitor::getInstance().getStatus(); }));
+
+    addCommand(Command("/heap",
+                       "Get the heap fragmentation and, in heap profile builds, the allocation "
+                       "call sites with more live bytes",
+                       MonCommand::GetHeap, 1,
+                       [this](String args) { return HeapProfiler::getStatus(); }));
+
+    addCommand(Command("/traceStart",
+                       "Start recording the messages of the MessageManager into a new trace",
+                       MonCommand::TraceStart, 1,
+                       [this](String args) {
+                           return MessageTraceRecorder::getInstance().start();
+                       }));
+
+    addCommand(Command("/traceStop", "Stop recording the message trace", MonCommand::TraceStop, 1,
+                       [this](String args) { return MessageTraceRecorder::getInstance().stop(); }));
+
+    addCommand(Command("/trace", "Get the state of the message trace", MonCommand::GetTrace, 1,
+                       [this](String args) {
+                           return MessageTraceRecorder::getInstance().getStatus();
+                       }));
+
+    addCommand(Command("/traceDump", "Print the message trace in base64 for tools/tracereplay",
+                       MonCommand::DumpTrace, 1,
+                       [this](String args) { return MessageTraceRecorder::getInstance().dump(); }));
 }
@@ -3,6 +3,7 @@
 #include "loramesh/loraMeshService.h"
 #include "LoraMesher.h"
 #include "monServiceMessage.h"
+#include <algorithm>
 
 #if defined(MON_MQTT_ONE_MESSAGE)
 static const char* MON_TAG = "MonOMService";
@@ -12,14 +13,42 @@ static const char* MON_TAG = "MonService";
 
 void MonService::init() {
     ESP_LOGI(MON_TAG, "Initializing mqtt_mon");
+#if defined(MON_MQTT_ONE_MESSAGE)
+    reportMutex = xSemaphoreCreateMutex();
+#endif
     createSendingTask();
 }
 
 String MonService::getJSON(DataMessage* message) {
     monMessage* bm = (monMessage*)message;
+    if (bm->RTcount == MONCOUNT_MONTASKSMESSAGE) {
+        // Can have more entries than the other Mon messages
+        ESP_LOGI(MON_TAG, "getJSON: monTasksMessage->serialize");
+        DynamicJsonDocument tasksDoc(4096);
+        JsonObject tasksData = tasksDoc.createNestedObject("RT");
+        ((monTasksMessage*)message)->serialize(tasksData);
+
+        String json;
+        serializeJson(tasksDoc, json);
+
+        return json;
+    }
+
     StaticJsonDocument<2000> doc;
     JsonObject data = doc.createNestedObject("RT");
-    if ((bm->RTcount == MONCOUNT_MONONEMESSAGE) || (bm->messageSize != 17)) {
+    if (bm->RTcount == MONCOUNT_MONMETRICSMESSAGE) {
+        ESP_LOGI(MON_TAG, "getJSON: monMetricsMessage->serialize");
+        monMetricsMessage* mon = (monMetricsMessage*)message;
+        mon->serialize(data);
+    } else if (bm->RTcount == MONCOUNT_MONCOMPACTMETRICSMESSAGE) {
+        ESP_LOGI(MON_TAG, "getJSON: monCompactMetricsMessage->serialize");
+        monCompactMetricsMessage* mon = (monCompactMetricsMessage*)message;
+        mon->serialize(data);
+    } else if (bm->RTcount == MONCOUNT_MONDELTAMESSAGE) {
+        ESP_LOGI(MON_TAG, "getJSON: monDeltaMessage->serialize");
+        monDeltaMessage* mon = (monDeltaMessage*)message;
+        mon->serialize(data);
+    } else if ((bm->RTcount == MONCOUNT_MONONEMESSAGE) || (bm->messageSize != 17)) {
         ESP_LOGI(MON_TAG, "getJSON: monOneMessage->serialize");
         monOneMessage* mon = (monOneMessage*)message;
         mon->serialize(data);
@@ -54,6 +83,30 @@ DataMessage* MonService::getDataMessage(JsonObject data) {
 
 void MonService::processReceivedMessage(messagePort port, DataMessage* message) {
     ESP_LOGI(MON_TAG, "Received mon data");
+#if defined(MON_MQTT_ONE_MESSAGE)
+    monDeltaMessage* deltaMessage = (monDeltaMessage*)message;
+    if (reportMutex == NULL ||
+        message->messageSize < sizeof(monDeltaMessage) - sizeof(DataMessageGeneric) ||
+        deltaMessage->RTcount != MONCOUNT_MONDELTAMESSAGE)
+        return;
+
+    switch (deltaMessage->monCommand) {
+        case MonCommand::MonKeyframe:
+        case MonCommand::MonDelta:
+            if (message->messageSize < sizeof(monDeltaMessage) - sizeof(DataMessageGeneric) +
+                                           deltaMessage->updated * sizeof(routing_entry) +
+                                           deltaMessage->removed * sizeof(uint16_t))
+                return;
+            processReport(deltaMessage);
+            break;
+        case MonCommand::MonAck:
+        case MonCommand::MonNack:
+            processReportAck(deltaMessage);
+            break;
+        default:
+            break;
+    }
+#endif
 }
 
 void MonService::createSendingTask() {
@@ -86,8 +139,12 @@ monOneMessage* MonService::createMONPayloadMessage(int number_of_neighbors) {
     MONMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
     MONMessage->RTcount = MONCOUNT_MONONEMESSAGE;
     MONMessage->uptime = millis();
+    MONMessage->time = TimeSyncService::getInstance().isSynced()
+                           ? TimeSyncService::getInstance().getEpoch()
+                           : 0;
     MONMessage->TxQ = LoraMesher::getInstance().getSendQueueSize();
     MONMessage->RxQ = LoraMesher::getInstance().getReceivedQueueSize();
+    MONMessage->airtimeLeft = LoRaMeshService::getInstance().getRemainingAirtime();
     MONMessage->number_of_neighbors = number_of_neighbors;
     MONMessage->appPortDst = appPort::MQTTApp;
     MONMessage->appPortSrc = appPort::MonApp;
@@ -97,6 +154,525 @@ monOneMessage* MonService::createMONPayloadMessage(int number_of_neighbors) {
     return MONMessage;
 }
 
+void MonService::sendReport(std::vector<routing_entry>& neighbors) {
+    // A gateway publishes its own table directly, it does not use LoRa
+    if (MON_DELTA_ENABLED == 0 || WiFiServerService::getInstance().isConnected()) {
+        monOneMessage* MONMessage = createMONPayloadMessage(neighbors.size());
+        memcpy(MONMessage->rt, neighbors.data(), neighbors.size() * sizeof(routing_entry));
+        ESP_LOGV(MON_TAG, "sending monOneMessage");
+        // Send the message
+        MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)MONMessage);
+        // Delete the message
+        vPortFree(MONMessage);
+
+        // Without LoRa the compact metrics do not need to ride in the report
+        if (WiFiServerService::getInstance().isConnected()) {
+            MonCompactMetrics metrics = takeCompactMetrics();
+            publishCompactMetrics(LoraMesher::getInstance().getLocalAddress(), millis(), metrics);
+        }
+        return;
+    }
+
+    sendDeltaReport(neighbors);
+}
+
+void MonService::sendDeltaReport(std::vector<routing_entry>& neighbors) {
+    if (reportMutex == NULL)
+        return;
+
+    xSemaphoreTake(reportMutex, portMAX_DELAY);
+
+    bool keyframe =
+        forceKeyframe || !hasAcked || reportsSinceKeyframe + 1 >= MON_KEYFRAME_EVERY;
+
+    std::vector<routing_entry> updated;
+    std::vector<uint16_t> removed;
+
+    if (!keyframe) {
+        for (auto& current : neighbors) {
+            auto previous = std::find_if(
+                ackedTable.begin(), ackedTable.end(),
+                [&current](routing_entry& entry) { return entry.neighbor == current.neighbor; });
+            if (previous == ackedTable.end() || hasChanged(*previous, current))
+                updated.push_back(current);
+        }
+
+        for (auto& previous : ackedTable) {
+            auto current = std::find_if(
+                neighbors.begin(), neighbors.end(),
+                [&previous](routing_entry& entry) { return entry.neighbor == previous.neighbor; });
+            if (current == neighbors.end())
+                removed.push_back(previous.neighbor);
+        }
+
+        // A keyframe is not larger than a delta with most of the table
+        if (updated.size() * sizeof(routing_entry) + removed.size() * sizeof(uint16_t) >=
+            neighbors.size() * sizeof(routing_entry))
+            keyframe = true;
+    }
+
+    if (keyframe) {
+        updated = neighbors;
+        removed.clear();
+    }
+
+    if (updated.size() > UINT8_MAX)
+        updated.resize(UINT8_MAX);
+    if (removed.size() > UINT8_MAX)
+        removed.resize(UINT8_MAX);
+
+    uint32_t messageSize = sizeof(monDeltaMessage) + updated.size() * sizeof(routing_entry) +
+                           removed.size() * sizeof(uint16_t) + sizeof(MonCompactMetrics);
+    monDeltaMessage* message = (monDeltaMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr) {
+        xSemaphoreGive(reportMutex);
+        ESP_LOGE(MON_TAG, "Not enough memory for the Mon report");
+        return;
+    }
+
+    reportSeq++;
+
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+    message->RTcount = MONCOUNT_MONDELTAMESSAGE;
+    message->monCommand = keyframe ? MonCommand::MonKeyframe : MonCommand::MonDelta;
+    message->seq = reportSeq;
+    message->baseSeq = keyframe ? 0 : ackedSeq;
+    message->uptime = millis();
+    message->time =
+        TimeSyncService::getInstance().isSynced() ? TimeSyncService::getInstance().getEpoch() : 0;
+    message->TxQ = LoraMesher::getInstance().getSendQueueSize();
+    message->RxQ = LoraMesher::getInstance().getReceivedQueueSize();
+    message->airtimeLeft = LoRaMeshService::getInstance().getRemainingAirtime();
+    message->updated = updated.size();
+    message->removed = removed.size();
+    memcpy(message->getUpdated(), updated.data(), updated.size() * sizeof(routing_entry));
+    for (uint8_t i = 0; i < removed.size(); i++) {
+        message->setRemoved(i, removed[i]);
+    }
+    MonCompactMetrics metrics = takeCompactMetrics();
+    message->setCompactMetrics(metrics);
+    message->appPortDst = appPort::MonApp;
+    message->appPortSrc = appPort::MonApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = 0;
+    message->messageId = monMessageId;
+
+    // The table the gateway will have once it applies this report
+    if (keyframe) {
+        pendingTable = updated;
+    } else {
+        pendingTable = ackedTable;
+        applyDelta(pendingTable, updated.data(), updated.size(), message);
+    }
+    pendingSeq = reportSeq;
+    hasPending = true;
+
+    if (keyframe) {
+        keyframesSent++;
+        reportsSinceKeyframe = 0;
+        forceKeyframe = false;
+    } else {
+        deltasSent++;
+        reportsSinceKeyframe++;
+        uint32_t fullSize = sizeof(monOneMessage) + neighbors.size() * sizeof(routing_entry);
+        if (fullSize > messageSize)
+            bytesSaved += fullSize - messageSize;
+    }
+
+    xSemaphoreGive(reportMutex);
+
+    ESP_LOGV(MON_TAG, "sending Mon %s %d: %d updated, %d removed",
+             keyframe ? "keyframe" : "delta", message->seq, message->updated, message->removed);
+
+    if (!LoRaMeshService::getInstance().sendClosestGateway((DataMessage*)message))
+        ESP_LOGW(MON_TAG, "No gateway for the Mon report");
+
+    vPortFree(message);
+}
+
+bool MonService::hasChanged(routing_entry& previous, routing_entry& current) {
+    if (abs(current.RxSNR - previous.RxSNR) >= MON_DELTA_SNR_THRESHOLD)
+        return true;
+
+    uint32_t currentSRTT = current.getSRTT();
+    uint32_t previousSRTT = previous.getSRTT();
+    uint32_t difference = currentSRTT > previousSRTT ? currentSRTT - previousSRTT
+                                                     : previousSRTT - currentSRTT;
+    uint32_t threshold = previousSRTT * MON_DELTA_SRTT_PERCENT / 100;
+    if (threshold < MON_DELTA_SRTT_THRESHOLD)
+        threshold = MON_DELTA_SRTT_THRESHOLD;
+
+    return difference >= threshold;
+}
+
+void MonService::applyDelta(std::vector<routing_entry>& table, routing_entry* updated,
+                            uint8_t updatedCount, monDeltaMessage* message) {
+    for (uint8_t i = 0; i < message->removed; i++) {
+        uint16_t address = message->getRemoved(i);
+        table.erase(std::remove_if(
+                        table.begin(), table.end(),
+                        [address](routing_entry& entry) { return entry.neighbor == address; }),
+                    table.end());
+    }
+
+    for (uint8_t i = 0; i < updatedCount; i++) {
+        auto entry = std::find_if(table.begin(), table.end(), [&](routing_entry& entry) {
+            return entry.neighbor == updated[i].neighbor;
+        });
+        if (entry == table.end())
+            table.push_back(updated[i]);
+        else
+            *entry = updated[i];
+    }
+}
+
+void MonService::processReport(monDeltaMessage* message) {
+    uint16_t src = message->addrSrc;
+
+    xSemaphoreTake(reportMutex, portMAX_DELAY);
+
+    NodeTable& node = nodeTables[src];
+    std::vector<routing_entry> table;
+
+    if (message->monCommand == MonCommand::MonKeyframe) {
+        // Start from an empty table
+    } else if (node.valid && message->baseSeq == node.seq) {
+        table = node.table;
+    } else if (node.hasPrevious && message->baseSeq == node.previousSeq) {
+        table = node.previous;
+    } else {
+        nacksSent++;
+        xSemaphoreGive(reportMutex);
+        ESP_LOGW(MON_TAG, "Mon delta %d from %X on unknown base %d", message->seq, src,
+                 message->baseSeq);
+        sendReportAck(src, message->seq, MonCommand::MonNack);
+        return;
+    }
+
+    applyDelta(table, message->getUpdated(), message->updated, message);
+
+    node.previous = node.table;
+    node.previousSeq = node.seq;
+    node.hasPrevious = node.valid;
+    node.table = table;
+    node.seq = message->seq;
+    node.valid = true;
+    reportsApplied++;
+
+    xSemaphoreGive(reportMutex);
+
+    sendReportAck(src, message->seq, MonCommand::MonAck);
+
+    publishTable(message, table);
+
+    if (message->hasCompactMetrics()) {
+        MonCompactMetrics metrics = message->getCompactMetrics();
+        publishCompactMetrics(src, message->uptime, metrics);
+    }
+}
+
+void MonService::processReportAck(monDeltaMessage* message) {
+    xSemaphoreTake(reportMutex, portMAX_DELAY);
+
+    if (hasPending && message->seq == pendingSeq) {
+        if (message->monCommand == MonCommand::MonAck) {
+            acksReceived++;
+            ackedTable = pendingTable;
+            ackedSeq = pendingSeq;
+            hasAcked = true;
+        } else {
+            nacksReceived++;
+            forceKeyframe = true;
+        }
+        hasPending = false;
+    }
+
+    xSemaphoreGive(reportMutex);
+}
+
+void MonService::sendReportAck(uint16_t dst, uint16_t seq, MonCommand command) {
+    monDeltaMessage* message = (monDeltaMessage*)pvPortMalloc(sizeof(monDeltaMessage));
+    if (message == nullptr)
+        return;
+
+    memset(message, 0, sizeof(monDeltaMessage));
+    message->messageSize = sizeof(monDeltaMessage) - sizeof(DataMessageGeneric);
+    message->RTcount = MONCOUNT_MONDELTAMESSAGE;
+    message->monCommand = command;
+    message->seq = seq;
+    message->appPortDst = appPort::MonApp;
+    message->appPortSrc = appPort::MonApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = dst;
+
+    MessageManager::getInstance().sendMessage(messagePort::LoRaMeshPort, (DataMessage*)message);
+
+    vPortFree(message);
+}
+
+void MonService::publishTable(monDeltaMessage* message, std::vector<routing_entry>& table) {
+    monOneMessage* MONMessage = createMONPayloadMessage(table.size());
+    memcpy(MONMessage->rt, table.data(), table.size() * sizeof(routing_entry));
+
+    // Keep the values of the node, downstream the message is the same as a full report
+    MONMessage->uptime = message->uptime;
+    MONMessage->time = message->time;
+    MONMessage->TxQ = message->TxQ;
+    MONMessage->RxQ = message->RxQ;
+    MONMessage->airtimeLeft = message->airtimeLeft;
+    MONMessage->addrSrc = message->addrSrc;
+    MONMessage->messageId = message->messageId;
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)MONMessage);
+
+    vPortFree(MONMessage);
+}
+
+void MonService::publishCompactMetrics(uint16_t src, uint32_t uptime,
+                                       MonCompactMetrics& metrics) {
+    monCompactMetricsMessage* message =
+        (monCompactMetricsMessage*)pvPortMalloc(sizeof(monCompactMetricsMessage));
+    if (message == nullptr)
+        return;
+
+    message->messageSize = sizeof(monCompactMetricsMessage) - sizeof(DataMessageGeneric);
+    message->RTcount = MONCOUNT_MONCOMPACTMETRICSMESSAGE;
+    message->uptime = uptime;
+    message->metrics = metrics;
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::MonApp;
+    message->addrSrc = src;
+    message->addrDst = 0;
+    message->messageId = monMessageId;
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+
+    vPortFree(message);
+}
+
+MonCompactMetrics MonService::takeCompactMetrics() {
+    MetricSummary summaries[MetricCount];
+    uint32_t window = Metrics::getInstance().takeReportWindow(summaries);
+    MetricSummary& drainWait = summaries[MetricRxDrainWait];
+    MetricSummary& txQueue = summaries[MetricTxQueue];
+
+    MonCompactMetrics compact;
+    compact.window = MonCompactMetrics::quantize(window, 1000);
+    compact.rxDrainWaitP95 = MonCompactMetrics::quantize(drainWait.p95, MON_COMPACT_WAIT_UNIT);
+    compact.rxDrainWaitMax = MonCompactMetrics::quantize(drainWait.max, MON_COMPACT_WAIT_UNIT);
+    compact.freeHeapMin =
+        MonCompactMetrics::quantize(summaries[MetricFreeHeap].min, MON_COMPACT_HEAP_UNIT);
+    compact.maxAllocHeapMin =
+        MonCompactMetrics::quantize(summaries[MetricMaxAllocHeap].min, MON_COMPACT_HEAP_UNIT);
+    compact.txQueueMax = txQueue.max > UINT8_MAX ? UINT8_MAX : txQueue.max;
+
+    return compact;
+}
+
+void MonService::sampleMetrics() {
+    Metrics::observe(MetricTxQueue, LoraMesher::getInstance().getSendQueueSize());
+    Metrics::observe(MetricRxQueue, LoraMesher::getInstance().getReceivedQueueSize());
+    Metrics::observe(MetricFreeHeap, esp_get_free_heap_size());
+    Metrics::observe(MetricMaxAllocHeap, ESP.getMaxAllocHeap());
+    TaskMonitor::getInstance().sampleQueues();
+}
+
+void MonService::waitNextReport() {
+    uint32_t reportedAt = millis();
+    adaptInterval();
+
+    size_t startQueue = LoraMesher::getInstance().getSendQueueSize();
+    uint32_t lastTopologyCheck = reportedAt;
+
+    // A significant event seen before the minimum interval is reported once it has passed
+    bool topologyChanged = false;
+
+    // Sample the gauges during the report window so the spikes between reports are visible
+    while (millis() - reportedAt < reportInterval) {
+        sampleMetrics();
+
+        if (millis() - lastTopologyCheck >= MON_TOPOLOGY_CHECK_INTERVAL) {
+            lastTopologyCheck = millis();
+
+            size_t queue = LoraMesher::getInstance().getSendQueueSize();
+            if (queue >= startQueue + MON_QUEUE_GROWTH) {
+                churn++;
+                startQueue = queue;
+            }
+
+            if (checkTopology())
+                topologyChanged = true;
+        }
+
+        // Significant events are reported now, but not more often than the minimum interval
+        if (topologyChanged && millis() - reportedAt >= MON_MIN_INTERVAL) {
+            immediateReports++;
+            reportInterval = MON_MIN_INTERVAL;
+            quietReports = 0;
+            return;
+        }
+
+        uint32_t elapsed = millis() - reportedAt;
+        uint32_t remaining = elapsed < reportInterval ? reportInterval - elapsed : 0;
+        vTaskDelay((remaining < METRICS_SAMPLE_INTERVAL ? remaining : METRICS_SAMPLE_INTERVAL) /
+                   portTICK_PERIOD_MS);
+    }
+}
+
+void MonService::adaptInterval() {
+    // Hysteresis: shorten as soon as the topology is busy, lengthen only after some quiet reports
+    if (churn >= MON_CHURN_HIGH) {
+        reportInterval = std::max<uint32_t>(MON_MIN_INTERVAL, reportInterval / 2);
+        quietReports = 0;
+    } else if (churn == 0) {
+        if (++quietReports >= MON_QUIET_REPORTS) {
+            reportInterval = std::min<uint32_t>(MON_MAX_INTERVAL, reportInterval * 2);
+            quietReports = 0;
+        }
+    } else {
+        quietReports = 0;
+    }
+
+    ESP_LOGD(MON_TAG, "Churn %d, next report in %d ms", churn, reportInterval);
+
+    churn = 0;
+}
+
+bool MonService::checkTopology() {
+    std::vector<uint16_t> neighbors;
+    size_t routes = 0;
+
+    LM_LinkedList<RouteNode>* routingTableList = LoraMesher::getInstance().routingTableListCopy();
+    routingTableList->setInUse();
+    if (routingTableList->moveToStart()) {
+        do {
+            RouteNode* rtn = routingTableList->getCurrent();
+            if (rtn->networkNode.address == rtn->via)
+                neighbors.push_back(rtn->networkNode.address);
+            routes++;
+        } while (routingTableList->next());
+    }
+    routingTableList->releaseInUse();
+    routingTableList->Clear();
+    delete routingTableList;
+
+    bool gateway = LoRaMeshService::getInstance().hasGateway();
+    std::sort(neighbors.begin(), neighbors.end());
+
+    bool significant = false;
+
+    if (hadGateway && !gateway) {
+        ESP_LOGI(MON_TAG, "Gateway lost");
+        significant = true;
+    }
+
+    for (uint16_t neighbor : knownNeighbors) {
+        if (!std::binary_search(neighbors.begin(), neighbors.end(), neighbor)) {
+            ESP_LOGI(MON_TAG, "Neighbor %X lost", neighbor);
+            significant = true;
+        }
+    }
+
+    // Any other change of the routes or the neighbors only shortens the interval
+    if (neighbors != knownNeighbors || routes != knownRoutes || gateway != hadGateway)
+        churn++;
+
+    knownNeighbors = neighbors;
+    knownRoutes = routes;
+    hadGateway = gateway;
+
+    return significant;
+}
+
+void MonService::sendMetrics() {
+    MetricSummary summaries[MetricCount];
+    uint32_t window = millis() - Metrics::getInstance().getWindowStart();
+    uint8_t metricsCount = Metrics::getInstance().takeWindow(summaries);
+
+    uint32_t messageSize = sizeof(monMetricsMessage) + metricsCount * sizeof(MetricSummary);
+    monMetricsMessage* message = (monMetricsMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr) {
+        ESP_LOGE(MON_TAG, "Not enough memory for the metrics");
+        return;
+    }
+
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+    message->RTcount = MONCOUNT_MONMETRICSMESSAGE;
+    message->uptime = millis();
+    message->window = window;
+    message->metricsCount = metricsCount;
+    memcpy(message->metrics, summaries, metricsCount * sizeof(MetricSummary));
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::MonApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = 0;
+    message->messageId = monMessageId;
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+
+    vPortFree(message);
+}
+
+void MonService::sendTasks() {
+    std::vector<TaskSnapshot> tasks;
+    std::vector<QueueSnapshot> queues;
+    TaskMonitor::getInstance().getTasks(tasks);
+    TaskMonitor::getInstance().getQueues(queues);
+
+    if (tasks.size() > UINT8_MAX)
+        tasks.resize(UINT8_MAX);
+    if (queues.size() > UINT8_MAX)
+        queues.resize(UINT8_MAX);
+
+    uint32_t messageSize = sizeof(monTasksMessage) + tasks.size() * sizeof(TaskSnapshot) +
+                           queues.size() * sizeof(QueueSnapshot);
+    monTasksMessage* message = (monTasksMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr) {
+        ESP_LOGE(MON_TAG, "Not enough memory for the task snapshot");
+        return;
+    }
+
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+    message->RTcount = MONCOUNT_MONTASKSMESSAGE;
+    message->uptime = millis();
+    message->freeHeap = esp_get_free_heap_size();
+    message->minFreeHeap = esp_get_minimum_free_heap_size();
+    message->taskCount = tasks.size();
+    message->queueCount = queues.size();
+    memcpy(message->getTasks(), tasks.data(), tasks.size() * sizeof(TaskSnapshot));
+    memcpy(message->getQueues(), queues.data(), queues.size() * sizeof(QueueSnapshot));
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::MonApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = 0;
+    message->messageId = monMessageId;
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+
+    vPortFree(message);
+}
+
+String MonService::getStats() {
+    if (reportMutex == NULL)
+        return "Mon not initialized";
+
+    xSemaphoreTake(reportMutex, portMAX_DELAY);
+
+    String stats = "--- Mon reports ---\nSent: " + String(keyframesSent) + " keyframes, " +
+                   String(deltasSent) + " deltas, " + String(bytesSaved) + " B saved, " +
+                   String(acksReceived) + " ACKs, " + String(nacksReceived) + " NACKs\n";
+    stats += "Acked table: seq " + String(ackedSeq) + ", " + String(ackedTable.size()) +
+             " neighbors" + (hasPending ? ", waiting ACK of " + String(pendingSeq) : "") + "\n";
+    stats += "Gateway: " + String(reportsApplied) + " reports applied, " + String(nacksSent) +
+             " NACKs, " + String(nodeTables.size()) + " nodes\n";
+    stats += "Interval: " + String(reportInterval / 1000) + " s, churn " + String(churn) +
+             ", immediate reports " + String(immediateReports) + "\n";
+
+    xSemaphoreGive(reportMutex);
+
+    return stats;
+}
+
 void MonService::sendingLoopOneMessage(void* parameter) {
     MonService& monService = MonService::getInstance();
     UBaseType_t uxHighWaterMark;
@@ -126,31 +702,38 @@ void MonService::sendingLoopOneMessage(void* parameter) {
                     };
                 } while (routingTableList->next());
                 if (monMessagecount > 0) {
+                    std::vector<routing_entry> neighbors;
+                    neighbors.reserve(monMessagecount);
                     routingTableList->moveToStart();
-                    monOneMessage* MONMessage =
-                        getInstance().createMONPayloadMessage(monMessagecount);
-                    int i = 0;
                     do {
                         RouteNode* rtn = routingTableList->getCurrent();
                         if (rtn->networkNode.address == rtn->via) {
-                            MONMessage->rt[i++] = {rtn->networkNode.address, rtn->receivedSNR,
-                                                   rtn->SRTT};
+                            neighbors.push_back(
+                                {rtn->networkNode.address, rtn->receivedSNR,
+                                 routing_entry::quantizeSRTT(rtn->SRTT)});
+                            Metrics::observe(MetricNeighborSRTT, rtn->SRTT);
                         }
                     } while (routingTableList->next());
-                    ESP_LOGV(MON_TAG, "sending monOneMessage");
-                    // Send the message
-                    MessageManager::getInstance().sendMessage(messagePort::MqttPort,
-                                                              (DataMessage*)MONMessage);
-                    // Delete the message
-                    vPortFree(MONMessage);
+                    routingTableList->releaseInUse();
+                    monService.sendReport(neighbors);
                 } else {
+                    routingTableList->releaseInUse();
                     ESP_LOGD(MON_TAG, "sendingLoopOneMessage: no neighbors?");
                 }
             } else {
                 ESP_LOGD(MON_TAG, "No routes");
             }
+            // The full summaries take several frames, the reports only carry the compact ones
+            if (millis() - monService.metricsSentAt >= MON_METRICS_INTERVAL) {
+                monService.metricsSentAt = millis();
+                monService.sendMetrics();
+            }
+            if (millis() - monService.tasksSentAt >= MON_TASKS_INTERVAL) {
+                monService.tasksSentAt = millis();
+                monService.sendTasks();
+            }
             // end send MON
-            vTaskDelay(MON_SENDING_EVERY / portTICK_PERIOD_MS);
+            monService.waitNextReport();
             // Print the free heap memory
             ESP_LOGD(MON_TAG, "Free heap: %d", esp_get_free_heap_size());
         }
@@ -159,6 +742,10 @@ void MonService::sendingLoopOneMessage(void* parameter) {
 
 #else
 
+String MonService::getStats() {
+    return "Mon delta reports need MON_MQTT_ONE_MESSAGE";
+}
+
 void MonService::sendingLoop(void* parameter) {
     MonService& monService = MonService::getInstance();
     UBaseType_t uxHighWaterMark;
@@ -7,6 +7,9 @@
 #include "message/messageService.h"
 #include "monCommandService.h"
 #include "monServiceMessage.h"
+#include "time/timeSyncService.h"
+#include <map>
+#include <vector>
 
 #define MON_MQTT_ONE_MESSAGE
 
@@ -25,6 +28,7 @@ public:
     String getJSON(DataMessage* message);
     DataMessage* getDataMessage(JsonObject data);
     void processReceivedMessage(messagePort port, DataMessage* message);
+    String getStats();
 
 private:
     MonService() : MessageService(MonApp, "Mon") { commandService = monCommandService_; };
@@ -32,6 +36,67 @@ private:
 #if defined(MON_MQTT_ONE_MESSAGE)
     static void sendingLoopOneMessage(void*);
     monOneMessage* createMONPayloadMessage(int number_of_neighbors);
+    void sendReport(std::vector<routing_entry>& neighbors);
+    void sendDeltaReport(std::vector<routing_entry>& neighbors);
+    void processReport(monDeltaMessage* message);
+    void processReportAck(monDeltaMessage* message);
+    void sendReportAck(uint16_t dst, uint16_t seq, MonCommand command);
+    void publishTable(monDeltaMessage* message, std::vector<routing_entry>& table);
+    void sampleMetrics();
+    MonCompactMetrics takeCompactMetrics();
+    void publishCompactMetrics(uint16_t src, uint32_t uptime, MonCompactMetrics& metrics);
+    void waitNextReport();
+    void adaptInterval();
+    bool checkTopology();
+    void sendMetrics();
+    void sendTasks();
+    static bool hasChanged(routing_entry& previous, routing_entry& current);
+    static void applyDelta(std::vector<routing_entry>& table, routing_entry* updated,
+                           uint8_t updatedCount, monDeltaMessage* message);
+
+    // Node side, the table the gateway has and the report waiting for its ACK
+    std::vector<routing_entry> ackedTable;
+    std::vector<routing_entry> pendingTable;
+    uint16_t reportSeq = 0;
+    uint16_t ackedSeq = 0;
+    uint16_t pendingSeq = 0;
+    bool hasAcked = false;
+    bool hasPending = false;
+    bool forceKeyframe = true;
+    uint16_t reportsSinceKeyframe = 0;
+
+    // Gateway side, the last two tables of every node, the node may not have seen the last ACK
+    struct NodeTable {
+        uint16_t seq = 0;
+        uint16_t previousSeq = 0;
+        bool valid = false;
+        bool hasPrevious = false;
+        std::vector<routing_entry> table;
+        std::vector<routing_entry> previous;
+    };
+    std::map<uint16_t, NodeTable> nodeTables;
+
+    SemaphoreHandle_t reportMutex = NULL;
+
+    uint32_t keyframesSent = 0;
+    uint32_t deltasSent = 0;
+    uint32_t bytesSaved = 0;
+    uint32_t acksReceived = 0;
+    uint32_t nacksReceived = 0;
+    uint32_t reportsApplied = 0;
+    uint32_t nacksSent = 0;
+
+    uint32_t metricsSentAt = 0;
+    uint32_t tasksSentAt = 0;
+
+    // Adaptive report interval, changes of the topology and the queues since the last report
+    uint32_t reportInterval = MON_SENDING_EVERY;
+    uint16_t churn = 0;
+    uint16_t quietReports = 0;
+    uint32_t immediateReports = 0;
+    std::vector<uint16_t> knownNeighbors;
+    size_t knownRoutes = 0;
+    bool hadGateway = false;
 #else
     static void sendingLoop(void*);
     void createAndSendMessage(uint16_t mcount, RouteNode*);
@@ -3,7 +3,32 @@
 #include <Arduino.h>
 #include "message/dataMessage.h"
 
+#include "config.h"
+
+#include "helpers/metrics.h"
+
+#include "taskMonitor.h"
+
 #define MONCOUNT_MONONEMESSAGE UINT16_MAX
+#define MONCOUNT_MONDELTAMESSAGE (UINT16_MAX - 1)
+#define MONCOUNT_MONMETRICSMESSAGE (UINT16_MAX - 2)
+#define MONCOUNT_MONTASKSMESSAGE (UINT16_MAX - 3)
+#define MONCOUNT_MONCOMPACTMETRICSMESSAGE (UINT16_MAX - 4)
+
+enum MonCommand : uint8_t {
+    MonKeyframe = 0,  // Full neighbor table
+    MonDelta = 1,     // Changes against the table of baseSeq
+    MonAck = 2,       // The gateway has applied the report seq
+    MonNack = 3,      // The gateway does not have the base table, a keyframe is needed
+    GetMonStats = 4,
+    GetMetrics = 5,
+    GetTasks = 6,
+    GetHeap = 7,
+    TraceStart = 8,
+    TraceStop = 9,
+    GetTrace = 10,
+    DumpTrace = 11,
+};
 
 #pragma pack(1)
 class monMessage : public DataMessageGeneric {
@@ -15,8 +40,8 @@ public:
     uint8_t metric = 0;
     int8_t receivedSNR = 0;
     int8_t sentSNR = 0;
-    unsigned long SRTT = 0;
-    unsigned long RTTVAR = 0;
+    uint32_t SRTT = 0;
+    uint32_t RTTVAR = 0;
     void serialize(JsonObject& doc) {
         // Call the base class serialize function
         ((DataMessageGeneric*)(this))->serialize(doc);
@@ -45,19 +70,62 @@ public:
     }
 };
 
+/**
+ * @brief Neighbor of a Mon report. The wire format has fixed width fields so it is the same on the
+ * nodes and on the host tools, and the SRTT is quantized to MON_SRTT_UNIT ms.
+ *
+ */
 struct routing_entry {
-    uint32_t neighbor;
+    uint16_t neighbor;
     int8_t RxSNR;
-    unsigned long SRTT;
+    uint16_t SRTT;  // In MON_SRTT_UNIT ms, saturated to UINT16_MAX
+
+    static uint16_t quantizeSRTT(uint32_t srtt) {
+        uint32_t units = (srtt + MON_SRTT_UNIT / 2) / MON_SRTT_UNIT;
+        return units > UINT16_MAX ? UINT16_MAX : units;
+    }
+
+    uint32_t getSRTT() { return (uint32_t)SRTT * MON_SRTT_UNIT; }
+};
+
+/**
+ * @brief Few metrics aggregated since the previous report that ride in every delta report,
+ * quantized so they add 11 bytes to the frame. The full summaries are sent every
+ * MON_METRICS_INTERVAL.
+ *
+ */
+struct MonCompactMetrics {
+    uint16_t window;           // s since the previous report
+    uint16_t rxDrainWaitP95;   // In MON_COMPACT_WAIT_UNIT us, saturated to UINT16_MAX
+    uint16_t rxDrainWaitMax;   // In MON_COMPACT_WAIT_UNIT us, saturated to UINT16_MAX
+    uint16_t freeHeapMin;      // In MON_COMPACT_HEAP_UNIT bytes
+    uint16_t maxAllocHeapMin;  // In MON_COMPACT_HEAP_UNIT bytes
+    uint8_t txQueueMax;
+
+    static uint16_t quantize(uint32_t value, uint32_t unit) {
+        uint32_t units = value / unit;
+        return units > UINT16_MAX ? UINT16_MAX : units;
+    }
+
+    void serialize(JsonObject& doc) {
+        doc["window"] = (uint32_t)window * 1000;
+        doc["rxDrainWaitP95"] = (uint32_t)rxDrainWaitP95 * MON_COMPACT_WAIT_UNIT;
+        doc["rxDrainWaitMax"] = (uint32_t)rxDrainWaitMax * MON_COMPACT_WAIT_UNIT;
+        doc["freeHeapMin"] = (uint32_t)freeHeapMin * MON_COMPACT_HEAP_UNIT;
+        doc["maxAllocHeapMin"] = (uint32_t)maxAllocHeapMin * MON_COMPACT_HEAP_UNIT;
+        doc["txQueueMax"] = txQueueMax;
+    }
 };
 
 class monOneMessage : public DataMessageGeneric {
     // see LoRaMesher/src/entities/routingTable/RouteNode.h
 public:
     uint16_t RTcount = MONCOUNT_MONONEMESSAGE;  // for backward compatibility
-    unsigned long uptime;
+    uint32_t uptime;
+    uint32_t time;  // Synchronized epoch seconds, 0 if the time is not synchronized
     uint16_t TxQ;
     uint16_t RxQ;
+    uint32_t airtimeLeft;  // Remaining duty cycle airtime in ms
     uint32_t number_of_neighbors;
     routing_entry rt[];
     void operator delete(void* ptr) {
@@ -70,14 +138,16 @@ public:
         // Add the derived class data to the JSON object
         doc["RTcount"] = MONCOUNT_MONONEMESSAGE;
         doc["uptime"] = uptime;
+        doc["time"] = time;
         doc["TxQ"] = TxQ;
         doc["RxQ"] = RxQ;
+        doc["airtimeLeft"] = airtimeLeft;
         doc["number_of_neighbors"] = number_of_neighbors;
         JsonArray rtArray = doc.createNestedArray("rt");
         for (int i = 0; i < number_of_neighbors; i++) {
             rtArray[i]["neighbor"] = rt[i].neighbor;
             rtArray[i]["RxSNR"] = rt[i].RxSNR;
-            rtArray[i]["SRTT"] = rt[i].SRTT;
+            rtArray[i]["SRTT"] = rt[i].getSRTT();
         }
     }
     void deserialize(JsonObject& doc) {
@@ -86,15 +156,216 @@ public:
         // Add the derived class data to the JSON object
         RTcount = doc["RTcount"];
         uptime = doc["uptime"];
+        time = doc["time"];
         TxQ = doc["TxQ"];
         RxQ = doc["RxQ"];
+        airtimeLeft = doc["airtimeLeft"];
         number_of_neighbors = doc["number_of_neighbors"];
         for (int i = 0; i < number_of_neighbors; i++) {
             rt[i].neighbor = doc["rt"][i]["neighbor"];
             rt[i].RxSNR = doc["rt"][i]["RxSNR"];
-            rt[i].SRTT = doc["rt"][i]["SRTT"];
+            rt[i].SRTT = routing_entry::quantizeSRTT(doc["rt"][i]["SRTT"]);
+        }
+    }
+};
+
+/**
+ * @brief Neighbor table report sent to the gateway, which rebuilds the full table and publishes it
+ * as a monOneMessage. The payload has the updated entries followed by the removed addresses.
+ *
+ */
+class monDeltaMessage : public DataMessageGeneric {
+public:
+    uint16_t RTcount = MONCOUNT_MONDELTAMESSAGE;  // Same position as in the other Mon messages
+    MonCommand monCommand;
+    uint16_t seq;
+    uint16_t baseSeq;
+    uint32_t uptime;
+    uint32_t time;
+    uint16_t TxQ;
+    uint16_t RxQ;
+    uint32_t airtimeLeft;
+    uint8_t updated;
+    uint8_t removed;
+    uint8_t payload[];
+
+    routing_entry* getUpdated() { return (routing_entry*)payload; }
+
+    // The removed addresses can be unaligned, copy them byte by byte
+    uint16_t getRemoved(uint8_t index) {
+        uint16_t address;
+        memcpy(&address, payload + updated * sizeof(routing_entry) + index * sizeof(uint16_t),
+               sizeof(uint16_t));
+        return address;
+    }
+
+    void setRemoved(uint8_t index, uint16_t address) {
+        memcpy(payload + updated * sizeof(routing_entry) + index * sizeof(uint16_t), &address,
+               sizeof(uint16_t));
+    }
+
+    uint32_t getEntriesSize() {
+        return updated * sizeof(routing_entry) + removed * sizeof(uint16_t);
+    }
+
+    // The compact metrics follow the removed addresses, the reports of older nodes do not have them
+    bool hasCompactMetrics() {
+        return messageSize >= sizeof(monDeltaMessage) - sizeof(DataMessageGeneric) +
+                                  getEntriesSize() + sizeof(MonCompactMetrics);
+    }
+
+    MonCompactMetrics getCompactMetrics() {
+        MonCompactMetrics metrics;
+        memcpy(&metrics, payload + getEntriesSize(), sizeof(MonCompactMetrics));
+        return metrics;
+    }
+
+    void setCompactMetrics(MonCompactMetrics& metrics) {
+        memcpy(payload + getEntriesSize(), &metrics, sizeof(MonCompactMetrics));
+    }
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*)(this))->serialize(doc);
+        // Add the derived class data to the JSON object
+        doc["RTcount"] = MONCOUNT_MONDELTAMESSAGE;
+        doc["monCommand"] = monCommand;
+        doc["seq"] = seq;
+        doc["baseSeq"] = baseSeq;
+        doc["uptime"] = uptime;
+        doc["time"] = time;
+        doc["TxQ"] = TxQ;
+        doc["RxQ"] = RxQ;
+        doc["airtimeLeft"] = airtimeLeft;
+        JsonArray updatedArray = doc.createNestedArray("updated");
+        for (int i = 0; i < updated; i++) {
+            updatedArray[i]["neighbor"] = getUpdated()[i].neighbor;
+            updatedArray[i]["RxSNR"] = getUpdated()[i].RxSNR;
+            updatedArray[i]["SRTT"] = getUpdated()[i].getSRTT();
+        }
+        JsonArray removedArray = doc.createNestedArray("removed");
+        for (int i = 0; i < removed; i++) {
+            removedArray.add(getRemoved(i));
+        }
+    }
+};
+
+/**
+ * @brief Metrics aggregated during the last report window, see helpers/metrics.h
+ *
+ */
+class monMetricsMessage : public DataMessageGeneric {
+public:
+    uint16_t RTcount = MONCOUNT_MONMETRICSMESSAGE;  // Same position as in the other Mon messages
+    uint32_t uptime;
+    uint32_t window;  // ms since the previous window
+    uint8_t metricsCount;
+    MetricSummary metrics[];
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*)(this))->serialize(doc);
+        // Add the derived class data to the JSON object
+        doc["RTcount"] = MONCOUNT_MONMETRICSMESSAGE;
+        doc["uptime"] = uptime;
+        doc["window"] = window;
+        JsonObject metricsObject = doc.createNestedObject("metrics");
+        for (int i = 0; i < metricsCount; i++) {
+            JsonObject metric = metricsObject.createNestedObject(
+                Metrics::getName((MetricId)metrics[i].id));
+            metric["n"] = metrics[i].count;
+            if (Metrics::isCounter((MetricId)metrics[i].id))
+                continue;
+            metric["min"] = metrics[i].min;
+            metric["mean"] = metrics[i].mean;
+            metric["p95"] = metrics[i].p95;
+            metric["max"] = metrics[i].max;
+        }
+    }
+};
+
+/**
+ * @brief Compact metrics of a delta report, published by the gateway for the node
+ *
+ */
+class monCompactMetricsMessage : public DataMessageGeneric {
+public:
+    uint16_t RTcount = MONCOUNT_MONCOMPACTMETRICSMESSAGE;  // Same position as in the others
+    uint32_t uptime;
+    MonCompactMetrics metrics;
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*)(this))->serialize(doc);
+        // Add the derived class data to the JSON object
+        doc["RTcount"] = MONCOUNT_MONCOMPACTMETRICSMESSAGE;
+        doc["uptime"] = uptime;
+        JsonObject metricsObject = doc.createNestedObject("metrics");
+        metrics.serialize(metricsObject);
+    }
+};
+
+/**
+ * @brief Snapshot of the tasks and the queues of a node, see monitor/taskMonitor.h. The payload has
+ * the tasks followed by the queues.
+ *
+ */
+class monTasksMessage : public DataMessageGeneric {
+public:
+    uint16_t RTcount = MONCOUNT_MONTASKSMESSAGE;  // Same position as in the other Mon messages
+    uint32_t uptime;
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;
+    uint8_t taskCount;
+    uint8_t queueCount;
+    uint8_t payload[];
+
+    TaskSnapshot* getTasks() { return (TaskSnapshot*)payload; }
+
+    QueueSnapshot* getQueues() {
+        return (QueueSnapshot*)(payload + taskCount * sizeof(TaskSnapshot));
+    }
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*)(this))->serialize(doc);
+        // Add the derived class data to the JSON object
+        doc["RTcount"] = MONCOUNT_MONTASKSMESSAGE;
+        doc["uptime"] = uptime;
+        doc["freeHeap"] = freeHeap;
+        doc["minFreeHeap"] = minFreeHeap;
+        char name[TASK_MONITOR_NAME_LENGTH + 1] = {};
+        JsonArray tasksArray = doc.createNestedArray("tasks");
+        for (int i = 0; i < taskCount; i++) {
+            memcpy(name, getTasks()[i].name, TASK_MONITOR_NAME_LENGTH);
+            JsonObject task = tasksArray.createNestedObject();
+            task["name"] = name;
+            task["cpu"] = getTasks()[i].cpu;
+            task["stackFree"] = getTasks()[i].stackFree;
+            if (getTasks()[i].core != UINT8_MAX)
+                task["core"] = getTasks()[i].core;
+        }
+        JsonArray queuesArray = doc.createNestedArray("queues");
+        for (int i = 0; i < queueCount; i++) {
+            memcpy(name, getQueues()[i].name, TASK_MONITOR_NAME_LENGTH);
+            JsonObject queue = queuesArray.createNestedObject();
+            queue["name"] = name;
+            queue["depth"] = getQueues()[i].depth;
+            queue["highWater"] = getQueues()[i].highWater;
+            queue["capacity"] = getQueues()[i].capacity;
         }
     }
 };
 
 #pragma pack()
+
+// The host decoder in Testing/monitoringAnalysis/monMessageDecoder.py follows these layouts
+static_assert(sizeof(routing_entry) == 5, "routing_entry wire format changed");
+static_assert(sizeof(monOneMessage) == sizeof(DataMessageGeneric) + 22,
+              "monOneMessage wire format changed");
+static_assert(sizeof(MetricSummary) == 21, "MetricSummary wire format changed");
+static_assert(sizeof(MonCompactMetrics) == 11, "MonCompactMetrics wire format changed");
+static_assert(sizeof(TaskSnapshot) == 14, "TaskSnapshot wire format changed");
+static_assert(sizeof(QueueSnapshot) == 16, "QueueSnapshot wire format changed");
+static_assert(sizeof(monDeltaMessage) == sizeof(DataMessageGeneric) + 25,
+              "monDeltaMessage wire format changed");
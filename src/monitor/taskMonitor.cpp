@@ -0,0 +1,165 @@
+#include "taskMonitor.h"
+
+#include <algorithm>
+
+static const char* TM_TAG = "TaskMonitor";
+
+// The names are not null terminated when they use all the TASK_MONITOR_NAME_LENGTH characters
+static String getName(const char* name) {
+    char terminated[TASK_MONITOR_NAME_LENGTH + 1];
+    memcpy(terminated, name, TASK_MONITOR_NAME_LENGTH);
+    terminated[TASK_MONITOR_NAME_LENGTH] = '\0';
+    return String(terminated);
+}
+
+void TaskMonitor::registerQueue(const char* name, QueueHandle_t queue) {
+    if (queue == NULL)
+        return;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    watchedQueues.push_back({name, queue, nullptr, 0});
+    xSemaphoreGive(mutex);
+}
+
+void TaskMonitor::registerQueue(const char* name, size_t (*getDepth)()) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    watchedQueues.push_back({name, NULL, getDepth, 0});
+    xSemaphoreGive(mutex);
+}
+
+void TaskMonitor::sampleQueues() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    for (auto& watched : watchedQueues) {
+        uint16_t depth = getDepth(watched);
+        if (depth > watched.highWater)
+            watched.highWater = depth;
+    }
+
+    xSemaphoreGive(mutex);
+}
+
+bool TaskMonitor::getTasks(std::vector<TaskSnapshot>& tasks) {
+#if configUSE_TRACE_FACILITY == 1
+    UBaseType_t taskCount = uxTaskGetNumberOfTasks();
+
+    // Room for the tasks created while the array is filled
+    TaskStatus_t* status = (TaskStatus_t*)pvPortMalloc((taskCount + 2) * sizeof(TaskStatus_t));
+    if (status == nullptr) {
+        ESP_LOGE(TM_TAG, "Not enough memory for the task snapshot");
+        return false;
+    }
+
+    uint32_t totalRunTime = 0;
+    taskCount = uxTaskGetSystemState(status, taskCount + 2, &totalRunTime);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    // The run time counts for all the cores
+    uint32_t elapsed = (totalRunTime - previousTotalRunTime) * portNUM_PROCESSORS;
+    std::map<TaskHandle_t, uint32_t> runTime;
+
+    tasks.clear();
+    tasks.reserve(taskCount);
+
+    for (UBaseType_t i = 0; i < taskCount; i++) {
+        TaskSnapshot snapshot;
+        strncpy(snapshot.name, status[i].pcTaskName, TASK_MONITOR_NAME_LENGTH);
+        snapshot.stackFree = status[i].usStackHighWaterMark > UINT16_MAX
+                                 ? UINT16_MAX
+                                 : status[i].usStackHighWaterMark;
+        snapshot.cpu = 0;
+        snapshot.core = UINT8_MAX;
+
+#if configGENERATE_RUN_TIME_STATS == 1
+        runTime[status[i].xHandle] = status[i].ulRunTimeCounter;
+
+        auto previous = previousRunTime.find(status[i].xHandle);
+        uint32_t taskElapsed = status[i].ulRunTimeCounter;
+        if (previous != previousRunTime.end())
+            taskElapsed -= previous->second;
+
+        if (elapsed > 0)
+            snapshot.cpu = std::min<uint64_t>(100, (uint64_t)taskElapsed * 100 / elapsed);
+#endif
+
+#if configTASKLIST_INCLUDE_COREID == 1
+        if (status[i].xCoreID >= 0 && status[i].xCoreID < portNUM_PROCESSORS)
+            snapshot.core = status[i].xCoreID;
+#endif
+
+        tasks.push_back(snapshot);
+    }
+
+    previousRunTime = runTime;
+    previousTotalRunTime = totalRunTime;
+
+    xSemaphoreGive(mutex);
+
+    vPortFree(status);
+
+    std::sort(tasks.begin(), tasks.end(), [](const TaskSnapshot& a, const TaskSnapshot& b) {
+        return strncmp(a.name, b.name, TASK_MONITOR_NAME_LENGTH) < 0;
+    });
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TaskMonitor::getQueues(std::vector<QueueSnapshot>& queues) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    queues.clear();
+    queues.reserve(watchedQueues.size());
+
+    for (auto& watched : watchedQueues) {
+        QueueSnapshot snapshot;
+        strncpy(snapshot.name, watched.name, TASK_MONITOR_NAME_LENGTH);
+        snapshot.depth = getDepth(watched);
+        if (snapshot.depth > watched.highWater)
+            watched.highWater = snapshot.depth;
+        snapshot.highWater = watched.highWater;
+        snapshot.capacity = 0;
+        if (watched.queue != NULL)
+            snapshot.capacity = snapshot.depth + uxQueueSpacesAvailable(watched.queue);
+
+        queues.push_back(snapshot);
+    }
+
+    xSemaphoreGive(mutex);
+}
+
+String TaskMonitor::getStatus() {
+    String status = "--- Tasks ---\n";
+
+    std::vector<TaskSnapshot> tasks;
+    if (getTasks(tasks)) {
+        for (auto& task : tasks) {
+            status += getName(task.name) + ": cpu " + String(task.cpu) + "%, free stack " +
+                      String(task.stackFree) + " B, core " +
+                      (task.core == UINT8_MAX ? String("any") : String(task.core)) + "\n";
+        }
+    } else {
+        status += "Needs CONFIG_FREERTOS_USE_TRACE_FACILITY\n";
+    }
+
+    status += "--- Queues ---\n";
+
+    std::vector<QueueSnapshot> queues;
+    getQueues(queues);
+    for (auto& queue : queues) {
+        status += getName(queue.name) + ": " + String(queue.depth) + "/" +
+                  (queue.capacity == 0 ? String("?") : String(queue.capacity)) + ", max " +
+                  String(queue.highWater) + "\n";
+    }
+
+    return status;
+}
+
+uint16_t TaskMonitor::getDepth(WatchedQueue& watched) {
+    size_t depth = watched.queue != NULL ? uxQueueMessagesWaiting(watched.queue)
+                                         : watched.getDepth();
+    return depth > UINT16_MAX ? UINT16_MAX : depth;
+}
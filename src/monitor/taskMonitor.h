@@ -0,0 +1,104 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <map>
+#include <vector>
+
+#include "config.h"
+
+#define TASK_MONITOR_NAME_LENGTH 10
+
+#pragma pack(1)
+
+/**
+ * @brief Compact snapshot of a task, sent in the Mon uplink
+ *
+ */
+struct TaskSnapshot {
+    char name[TASK_MONITOR_NAME_LENGTH];  // Truncated, not null terminated when full
+    uint8_t cpu;                          // % of the CPU time since the previous snapshot
+    uint16_t stackFree;                   // Minimum free stack since the task started, in bytes
+    uint8_t core;                         // Core affinity, UINT8_MAX if not pinned
+};
+
+/**
+ * @brief Compact snapshot of a queue, sent in the Mon uplink
+ *
+ */
+struct QueueSnapshot {
+    char name[TASK_MONITOR_NAME_LENGTH];
+    uint16_t depth;
+    uint16_t highWater;  // Maximum depth seen since boot
+    uint16_t capacity;   // 0 if unknown
+};
+
+#pragma pack()
+
+/**
+ * @brief Snapshots the CPU use, free stack and core of every FreeRTOS task, and tracks the high
+ * water mark of the registered queues. The CPU use needs the FreeRTOS run time stats, see
+ * CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS in the sdkconfig files.
+ *
+ */
+class TaskMonitor {
+public:
+    static TaskMonitor& getInstance() {
+        static TaskMonitor instance;
+        return instance;
+    }
+
+    /**
+     * @brief Track the depth of a FreeRTOS queue
+     *
+     * @param name Name of the queue, must be a literal
+     * @param queue Queue handle
+     */
+    void registerQueue(const char* name, QueueHandle_t queue);
+
+    /**
+     * @brief Track the depth of a queue that is not a FreeRTOS queue, like the LoRaMesher queues
+     *
+     * @param name Name of the queue, must be a literal
+     * @param getDepth Function that returns the current depth
+     */
+    void registerQueue(const char* name, size_t (*getDepth)());
+
+    /**
+     * @brief Sample the depth of the registered queues and update their high water marks
+     *
+     */
+    void sampleQueues();
+
+    /**
+     * @brief Snapshot all the tasks
+     *
+     * @param tasks Snapshots, sorted by name
+     * @return true If the snapshot could be taken
+     */
+    bool getTasks(std::vector<TaskSnapshot>& tasks);
+
+    void getQueues(std::vector<QueueSnapshot>& queues);
+
+    String getStatus();
+
+private:
+    TaskMonitor() { mutex = xSemaphoreCreateMutex(); }
+
+    struct WatchedQueue {
+        const char* name;
+        QueueHandle_t queue;
+        size_t (*getDepth)();
+        uint16_t highWater;
+    };
+
+    std::vector<WatchedQueue> watchedQueues;
+
+    // Run time counters of the previous snapshot, to get the CPU use between snapshots
+    std::map<TaskHandle_t, uint32_t> previousRunTime;
+    uint32_t previousTotalRunTime = 0;
+
+    SemaphoreHandle_t mutex = NULL;
+
+    static uint16_t getDepth(WatchedQueue& watched);
+};
@@ -12,6 +12,7 @@ void MqttService::initMqtt(String lclName) {
     mqtt_service_init(lclName.c_str());
 
     receiveQueue = xQueueCreate(10, sizeof(MQTTQueueMessageV2*));
+    TaskMonitor::getInstance().registerQueue("MqttRx", receiveQueue);
 
     createMqttTask();
 
@@ -10,6 +10,8 @@
 
 #include "message/messageManager.h"
 
+#include "monitor/taskMonitor.h"
+
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+#include "config.h"
+
+#include "gps/gpsMessage.h"
+
+#include "sensorMeasurement.h"
+
+#include "measurementAggregate.h"
+
+/**
+ * @brief Compact encoding of the sensor reports. Little endian, version 1:
+ *
+ *   uint8  version
+ *   uint8  flags            CompactPosition when the position follows
+ *   uint32 timestamp        UTC seconds since 1970, 0 if unknown
+ *   uint16 window           s
+ *   [int32 latitude, int32 longitude  1e-7 degrees
+ *    int16 altitude                   m
+ *    uint8 satellites]
+ *   uint8  present          Bit per MeasurementType with samples in the window
+ *   uint8  single           Bit per present measurement with a single sample
+ *   Per present measurement, in MeasurementType order, fixed point with getMeasurementScale:
+ *   int16  mean             The value when single
+ *   [int16 min, int16 max, int16 last
+ *    uint16 count]
+ *
+ * Absent measurements take no bytes. A stationary node only sends its position when it moved, the
+ * gateway keeps the last position of each node to expand the reports to the JSON of
+ * SensorReportMessage. Any change of the layout needs a new version.
+ *
+ */
+#define COMPACT_MEASUREMENT_VERSION 1
+
+static_assert(MeasurementCount <= 8, "The presence bitmaps of the compact reports use one byte");
+
+enum CompactMeasurementFlags : uint8_t {
+    CompactPosition = 0x01,
+};
+
+/**
+ * @brief Bounds checked little endian writes and reads of the compact encoding
+ *
+ */
+class CompactBuffer {
+public:
+    CompactBuffer(uint8_t* data, size_t size) : data(data), size(size) {}
+
+    template <typename T>
+    void write(T value) {
+        if (position + sizeof(T) > size) {
+            overflow = true;
+            return;
+        }
+
+        for (size_t i = 0; i < sizeof(T); i++)
+            data[position++] = (uint8_t)((typename std::make_unsigned<T>::type)value >> (8 * i));
+    }
+
+    template <typename T>
+    T read() {
+        if (position + sizeof(T) > size) {
+            overflow = true;
+            return 0;
+        }
+
+        typename std::make_unsigned<T>::type value = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+            value |= (typename std::make_unsigned<T>::type)data[position++] << (8 * i);
+
+        return (T)value;
+    }
+
+    size_t getPosition() { return position; }
+
+    bool hasOverflow() { return overflow; }
+
+private:
+    uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    bool overflow = false;
+};
+
+/**
+ * @brief Last positions of the nodes, used by the gateway for the reports without position
+ *
+ */
+class CompactPositionCache {
+public:
+    static CompactPositionCache& getInstance() {
+        static CompactPositionCache instance;
+        return instance;
+    }
+
+    void update(uint16_t address, const GPSMessage& gps) {
+        Entry* entry = find(address);
+        if (entry == nullptr) {
+            entry = &entries[next];
+            next = (next + 1) % SENSOR_POSITION_CACHE;
+        }
+
+        entry->address = address;
+        entry->valid = true;
+        entry->latitude = gps.latitude;
+        entry->longitude = gps.longitude;
+        entry->altitude = gps.altitude;
+        entry->satellites = gps.satellites;
+    }
+
+    /**
+     * @brief Copy the last position of the node into gps
+     *
+     * @return true If the position is known
+     */
+    bool get(uint16_t address, GPSMessage& gps) {
+        Entry* entry = find(address);
+        if (entry == nullptr)
+            return false;
+
+        gps.latitude = entry->latitude;
+        gps.longitude = entry->longitude;
+        gps.altitude = entry->altitude;
+        gps.satellites = entry->satellites;
+
+        return true;
+    }
+
+private:
+    CompactPositionCache() {}
+
+    struct Entry {
+        uint16_t address;
+        bool valid = false;
+        double latitude;
+        double longitude;
+        double altitude;
+        uint8_t satellites;
+    };
+
+    Entry entries[SENSOR_POSITION_CACHE];
+
+    // Replaced when a new node does not fit
+    uint8_t next = 0;
+
+    Entry* find(uint16_t address) {
+        for (Entry& entry : entries) {
+            if (entry.valid && entry.address == address)
+                return &entry;
+        }
+
+        return nullptr;
+    }
+};
+
+class CompactMeasurement {
+public:
+    /**
+     * @brief Largest encoding of a report with count aggregates
+     *
+     */
+    static size_t getMaxSize(uint8_t count) { return 8 + 11 + 2 + count * 10; }
+
+    /**
+     * @brief Encode a report
+     *
+     * @param position Position to include, nullptr if it did not move
+     * @param window Duration of the window in ms
+     * @return size_t Bytes written, 0 if they did not fit in maxSize
+     */
+    static size_t encode(uint8_t* buffer, size_t maxSize, uint32_t timestamp, uint32_t window,
+                         const GPSMessage* position, const MeasurementAggregate* aggregates,
+                         uint8_t count) {
+        CompactBuffer out(buffer, maxSize);
+
+        out.write<uint8_t>(COMPACT_MEASUREMENT_VERSION);
+        out.write<uint8_t>(position != nullptr ? CompactPosition : 0);
+        out.write<uint32_t>(timestamp);
+        out.write<uint16_t>(std::min<uint32_t>(window / 1000, UINT16_MAX));
+
+        if (position != nullptr) {
+            out.write<int32_t>(lround(position->latitude * 1e7));
+            out.write<int32_t>(lround(position->longitude * 1e7));
+            out.write<int16_t>(toFixed(position->altitude, 1));
+            out.write<uint8_t>(position->satellites);
+        }
+
+        // Aggregate of each present measurement
+        const MeasurementAggregate* byType[MeasurementCount] = {};
+        uint8_t present = 0;
+        uint8_t single = 0;
+
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t type = aggregates[i].type;
+            if (type >= MeasurementCount || byType[type] != nullptr)
+                continue;
+
+            byType[type] = &aggregates[i];
+            present |= 1 << type;
+            if (aggregates[i].count == 1)
+                single |= 1 << type;
+        }
+
+        out.write<uint8_t>(present);
+        out.write<uint8_t>(single);
+
+        for (uint8_t type = 0; type < MeasurementCount; type++) {
+            const MeasurementAggregate* aggregate = byType[type];
+            if (aggregate == nullptr)
+                continue;
+
+            float scale = getMeasurementScale((MeasurementType)type);
+
+            out.write<int16_t>(toFixed(aggregate->mean, scale));
+
+            if (single & (1 << type))
+                continue;
+
+            out.write<int16_t>(toFixed(aggregate->min, scale));
+            out.write<int16_t>(toFixed(aggregate->max, scale));
+            out.write<int16_t>(toFixed(aggregate->last, scale));
+            out.write<uint16_t>(aggregate->count);
+        }
+
+        return out.hasOverflow() ? 0 : out.getPosition();
+    }
+
+    /**
+     * @brief Expand an encoded report of the node addrSrc into the data of the JSON of
+     * SensorReportMessage
+     *
+     * @return true If the report could be decoded
+     */
+    static bool expand(uint8_t* payload, size_t size, uint16_t addrSrc, JsonObject& data) {
+        CompactBuffer in(payload, size);
+
+        uint8_t version = in.read<uint8_t>();
+        if (version != COMPACT_MEASUREMENT_VERSION) {
+            data["error"] = "Unknown compact report version " + String(version);
+            return false;
+        }
+
+        uint8_t flags = in.read<uint8_t>();
+        uint32_t timestamp = in.read<uint32_t>();
+        uint16_t window = in.read<uint16_t>();
+
+        GPSMessage gps = {};
+        fromEpoch(timestamp, gps);
+
+        CompactPositionCache& positions = CompactPositionCache::getInstance();
+
+        if (flags & CompactPosition) {
+            gps.latitude = in.read<int32_t>() / 1e7;
+            gps.longitude = in.read<int32_t>() / 1e7;
+            gps.altitude = in.read<int16_t>();
+            gps.satellites = in.read<uint8_t>();
+
+            if (!in.hasOverflow())
+                positions.update(addrSrc, gps);
+        } else {
+            positions.get(addrSrc, gps);
+        }
+
+        uint8_t present = in.read<uint8_t>();
+        uint8_t single = in.read<uint8_t>();
+
+        if (in.hasOverflow()) {
+            data["error"] = "Truncated compact report";
+            return false;
+        }
+
+        gps.serialize(data);
+
+        data["message_type"] = "measurement";
+        data["window"] = (uint32_t)window * 1000;
+
+        JsonArray measurements = data.createNestedArray("message");
+
+        for (uint8_t type = 0; type < MeasurementCount; type++) {
+            if (!(present & (1 << type)))
+                continue;
+
+            float scale = getMeasurementScale((MeasurementType)type);
+
+            MeasurementAggregate aggregate;
+            aggregate.type = type;
+            aggregate.mean = in.read<int16_t>() / scale;
+
+            if (single & (1 << type)) {
+                aggregate.min = aggregate.max = aggregate.last = aggregate.mean;
+                aggregate.count = 1;
+            } else {
+                aggregate.min = in.read<int16_t>() / scale;
+                aggregate.max = in.read<int16_t>() / scale;
+                aggregate.last = in.read<int16_t>() / scale;
+                aggregate.count = in.read<uint16_t>();
+            }
+
+            if (in.hasOverflow()) {
+                data["error"] = "Truncated compact report";
+                return false;
+            }
+
+            JsonObject measurement = measurements.createNestedObject();
+            aggregate.serialize(measurement);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief UTC seconds since 1970 of the date and time of the GPS message, 0 if unknown
+     *
+     */
+    static uint32_t toEpoch(const GPSMessage& gps) {
+        if (gps.year < 2000 || gps.month == 0 || gps.day == 0)
+            return 0;
+
+        // Days from civil, with the year starting in March
+        int32_t year = gps.year - (gps.month <= 2);
+        int32_t era = year / 400;
+        uint32_t yearOfEra = year - era * 400;
+        uint32_t dayOfYear = (153 * (gps.month + (gps.month > 2 ? -3 : 9)) + 2) / 5 + gps.day - 1;
+        uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        int32_t days = era * 146097 + (int32_t)dayOfEra - 719468;
+
+        return (uint32_t)days * 86400 + gps.hour * 3600 + gps.minute * 60 + gps.second;
+    }
+
+    /**
+     * @brief Date and time of the GPS message from UTC seconds since 1970, left at 0 if unknown
+     *
+     */
+    static void fromEpoch(uint32_t epoch, GPSMessage& gps) {
+        if (epoch == 0)
+            return;
+
+        uint32_t seconds = epoch % 86400;
+        gps.hour = seconds / 3600;
+        gps.minute = seconds / 60 % 60;
+        gps.second = seconds % 60;
+
+        // Civil from days
+        int32_t days = epoch / 86400 + 719468;
+        int32_t era = days / 146097;
+        uint32_t dayOfEra = days - era * 146097;
+        uint32_t yearOfEra =
+            (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        uint32_t monthIndex = (5 * dayOfYear + 2) / 153;
+
+        gps.day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        gps.month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        gps.year = yearOfEra + era * 400 + (gps.month <= 2);
+    }
+
+private:
+    static int16_t toFixed(double value, float scale) {
+        double fixed = round(value * scale);
+        return (int16_t)std::max<double>(INT16_MIN, std::min<double>(INT16_MAX, fixed));
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+#include "sensorMeasurement.h"
+
+#pragma pack(1)
+
+/**
+ * @brief Aggregate of the samples of a measurement during a reporting window
+ *
+ */
+class MeasurementAggregate {
+public:
+    uint8_t type;  // MeasurementType
+    uint16_t count;
+    float min;
+    float max;
+    float mean;
+    float last;
+
+    void serialize(JsonObject& doc) {
+        doc["measurement"] = mean;
+        doc["type"] = getMeasurementName((MeasurementType)type);
+        doc["min"] = min;
+        doc["max"] = max;
+        doc["last"] = last;
+        doc["count"] = count;
+    }
+};
+
+#pragma pack()
+
+/**
+ * @brief Accumulates the samples of a measurement until the end of the reporting window
+ *
+ */
+class WindowAggregator {
+public:
+    void add(float value) {
+        if (count == 0 || value < min)
+            min = value;
+        if (count == 0 || value > max)
+            max = value;
+
+        sum += value;
+        last = value;
+
+        if (count < UINT16_MAX)
+            count++;
+    }
+
+    uint16_t getCount() { return count; }
+
+    /**
+     * @brief Write the aggregate of the window and start a new one
+     *
+     */
+    void take(MeasurementType type, MeasurementAggregate& aggregate) {
+        aggregate.type = type;
+        aggregate.count = count;
+        aggregate.min = min;
+        aggregate.max = max;
+        aggregate.mean = count == 0 ? 0 : sum / count;
+        aggregate.last = last;
+
+        count = 0;
+        sum = 0;
+    }
+
+private:
+    uint16_t count = 0;
+    float min = 0;
+    float max = 0;
+    double sum = 0;
+    float last = 0;
+};
@@ -1,92 +1,355 @@
-// #pragma once
+#pragma once
 
-// #include <Arduino.h>
+#include <Arduino.h>
 
-// #include "config.h"
+#include "config.h"
 
-// #include "message/messageManager.h"
+#include "helpers/ringBuffer.h"
 
-// #include "message/messageService.h"
 
-// #include "gps/gpsService.h"
+#include "sensor/metadata/metadataSensorMessage.h"
 
-// #include "sensor/metadata/metadata.h"
+#include "sensorMeasurement.h"
 
+#include "measurementAggregate.h"
 
-// template <typename T>
-// class Sensor: public MessageService {
-// protected:
-//     uint32_t readEveryMs = 0;
+#include "sensor/history/sensorHistory.h"
 
-//     T previousValues[STORED_SENSOR_DATA];
+/**
+ * @brief Sensor as seen by the SensorService, independent of the type of its readings. Each
+ * sensor is sampled on its own schedule, the samples are aggregated until the next report.
+ *
+ * A sample is a conversion polled without blocking: poll() starts it when it is due, and records
+ * the reading once the device has it, or a missing reading after the timeout of the sensor. The
+ * SensorService polls every sensor from the same task, so their conversions overlap.
+ *
+ */
+class SensorBase {
+public:
+    SensorBase(String name, uint32_t sampleEvery, float deadband, uint32_t timeout)
+        : name(name), sampleEvery(sampleEvery), deadband(deadband), timeout(timeout) {}
 
-//     uint8_t previousValuesIndex = 0;
+    virtual ~SensorBase() {}
 
-//     uint16_t readValues = 0;
+    virtual void init() = 0;
 
-//     uint8_t sensorMessageId = 0;
+    /**
+     * @brief Advance the acquisition of the sensor
+     *
+     * @return uint32_t ms until the sensor has to be polled again
+     */
+    uint32_t poll(uint32_t now) {
+        if (!converting) {
+            if ((int32_t)(now - nextSample) < 0)
+                return nextSample - now;
 
-// public:
-//     Sensor(uint8_t id, String name, uint32_t readEveryMs): MessageService(id, name) {
-//         this->readEveryMs = readEveryMs;
+            // Keep the schedule unless the sampling fell behind
+            nextSample += sampleEvery;
+            if ((int32_t)(now - nextSample) >= 0)
+                nextSample = now + sampleEvery;
 
-//         resetPreviousValues();
-//     };
+            conversionStart = now;
+            readyAt = now + startConversion();
+            converting = true;
+        }
 
-//     virtual T readValue() = 0;
-//     virtual T readValueWait(uint8_t retries) = 0;
+        uint32_t elapsed = now - conversionStart;
 
-//     float getVariance() {
-//         float mean = 0;
-//         uint8_t size = readValues > STORED_SENSOR_DATA ? STORED_SENSOR_DATA : readValues;
+        if (isConversionReady(now)) {
+            finishConversion(false);
+        } else if (elapsed >= timeout) {
+            finishConversion(true);
+            timeouts++;
+        } else {
+            // Until the expected end of the conversion, then every SENSOR_POLL_INTERVAL
+            int32_t untilReady = (int32_t)(readyAt - now);
+            uint32_t wait = untilReady > 0 ? untilReady : SENSOR_POLL_INTERVAL;
+            return std::min<uint32_t>(wait, timeout - elapsed);
+        }
 
-//         if (size == 0)
-//             return 0;
+        converting = false;
+        lastConversionTime = elapsed;
+        maxConversionTime = std::max<uint32_t>(maxConversionTime, elapsed);
 
-//         for (int i = 0; i < size; i++) {
-//             mean += previousValues[i];
-//         }
-//         mean /= size;
+        int32_t untilSample = (int32_t)(nextSample - now);
+        return untilSample > 0 ? untilSample : 0;
+    }
 
-//         float variance = 0;
-//         for (int i = 0; i < size; i++) {
-//             variance += pow(previousValues[i] - mean, 2);
-//         }
-//         variance /= size;
+    /**
+     * @brief Sample from now on, at the next poll. A conversion in progress is abandoned.
+     *
+     */
+    void resetSchedule(uint32_t now) {
+        nextSample = now;
+        converting = false;
+    }
 
-//         return variance;
-//     };
+    bool isConverting() { return converting; }
 
-//     float getStandardDeviation() {
-//         float variance = getVariance();
+    uint32_t getSampleEvery() { return sampleEvery; }
 
-//         if (variance == 0)
-//             return 0;
+    /**
+     * @brief Write the aggregates of the measurements to report and start a new window. A
+     * measurement is reported when it has samples and its mean left the deadband around the last
+     * reported value, or SENSOR_HEARTBEAT elapsed since it was reported. The means of all the
+     * measurements with samples are stored in the SensorHistory.
+     *
+     * @param aggregates Array of maxCount aggregates
+     * @return uint8_t Number of aggregates written
+     */
+    virtual uint8_t takeWindow(MeasurementAggregate* aggregates, uint8_t maxCount,
+                               uint32_t now) = 0;
 
-//         float standardDeviation = sqrt(variance);
+    /**
+     * @brief Number of measurements in each reading
+     *
+     */
+    virtual uint8_t getValueCount() = 0;
 
-//         return standardDeviation;
-//     };
+    /**
+     * @brief Fill the metadata of a measurement with the statistics of the last readings
+     *
+     * @param index Measurement of the reading, 0 to getValueCount() - 1
+     */
+    virtual void getMetadata(uint8_t index, MetadataSensorMessage& metadata) = 0;
 
-//     MetadataSensorMessage* getMetadataMessage() {
-//         metadataMessage->type = serviceId;
-//         metadataMessage->variance = getVariance();
-//         metadataMessage->stDev = getStandardDeviation();
-//         metadataMessage->sampleSize = readValues > STORED_SENSOR_DATA ? STORED_SENSOR_DATA :
-//         readValues; metadataMessage->sendTimeInterval = readEveryMs; metadataMessage->calibration
-//         = 0; metadataMessage->missingValues = 0;
+    virtual String getStatsString() = 0;
 
-//         return metadataMessage;
-//     };
+    String getName() { return name; }
 
-// protected:
-//     void resetPreviousValues() {
-//         for (int i = 0; i < STORED_SENSOR_DATA; i++) {
-//             previousValues[i] = 0;
-//         }
-//     };
+protected:
+    String name;
 
+    uint32_t sampleEvery;
 
-//     MetadataSensorMessage* metadataMessage = new MetadataSensorMessage();
+    uint32_t nextSample = 0;
 
-// };
\ No newline at end of file
+    // Relative deadband of the measurements
+    float deadband;
+
+    // ms from the start of a conversion until it is recorded as missing
+    uint32_t timeout;
+
+    bool converting = false;
+
+    // millis() when the conversion started and when it is expected to be ready
+    uint32_t conversionStart = 0;
+    uint32_t readyAt = 0;
+
+    uint32_t timeouts = 0;
+
+    uint32_t lastConversionTime = 0;
+    uint32_t maxConversionTime = 0;
+
+    /**
+     * @brief Start a conversion of the device, without waiting for it
+     *
+     * @return uint32_t ms the conversion takes, 0 if the reading is available right away
+     */
+    virtual uint32_t startConversion() { return 0; }
+
+    /**
+     * @brief Whether the result of the conversion can be read. By default when the time returned
+     * by startConversion elapsed, devices with a ready flag check it instead.
+     *
+     */
+    virtual bool isConversionReady(uint32_t now) { return (int32_t)(now - readyAt) >= 0; }
+
+    /**
+     * @brief Record the result of the conversion, or a missing reading if it timed out
+     *
+     */
+    virtual void finishConversion(bool timedOut) = 0;
+};
+
+/**
+ * @brief Sensor with readings of type T. It keeps the last STORED_SENSOR_DATA readings, for the
+ * mean and variance of each measurement over them, and the aggregate of each measurement in the
+ * reporting window.
+ *
+ * T lists its measurements at compile time:
+ *   static const uint8_t ValueCount;
+ *   float getValue(uint8_t index) const;
+ *   static MeasurementType getType(uint8_t index);
+ *   static T missing();  // Reading with every value missing
+ * The values equal to SENSOR_MISSING_VALUE are counted as missing and left out of the statistics.
+ *
+ */
+template <typename T>
+class Sensor : public SensorBase {
+public:
+    Sensor(String name, uint32_t sampleEvery, float deadband, uint32_t timeout)
+        : SensorBase(name, sampleEvery, deadband, timeout) {
+        mutex = xSemaphoreCreateMutex();
+    }
+
+    uint8_t getValueCount() override { return T::ValueCount; }
+
+    uint8_t takeWindow(MeasurementAggregate* aggregates, uint8_t maxCount,
+                       uint32_t now) override {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < T::ValueCount; i++) {
+            if (window[i].getCount() == 0)
+                continue;
+
+            MeasurementAggregate aggregate;
+            window[i].take(T::getType(i), aggregate);
+
+            SensorHistory::getInstance().append(T::getType(i), aggregate.mean);
+
+            if (!isException(i, aggregate.mean, now)) {
+                suppressed[i] += aggregate.count;
+                continue;
+            }
+
+            if (count < maxCount) {
+                aggregates[count++] = aggregate;
+                lastReported[i] = aggregate.mean;
+                lastReportTime[i] = now;
+                reported[i] = true;
+            }
+        }
+
+        xSemaphoreGive(mutex);
+
+        return count;
+    }
+
+    void getMetadata(uint8_t index, MetadataSensorMessage& metadata) override {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+
+        double mean, variance;
+
+        metadata.type = T::getType(index);
+        metadata.sampleSize = getStats(index, mean, variance);
+        metadata.sendTimeInterval = SENSOR_SENDING_EVERY;
+        metadata.calibration = 0;
+        metadata.stDev = sqrt(variance);
+        metadata.variance = variance;
+        metadata.missingValues = missing[index];
+        metadata.suppressedValues = suppressed[index];
+
+        xSemaphoreGive(mutex);
+    }
+
+    String getStatsString() override {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+
+        String status = name + ", " + String((uint32_t)history.size()) + " readings, conversion " +
+                        String(lastConversionTime) + " ms (max " + String(maxConversionTime) +
+                        "), timeouts " + String(timeouts) + "\n";
+
+        for (uint8_t i = 0; i < T::ValueCount; i++) {
+            double mean, variance;
+            getStats(i, mean, variance);
+            status += String(getMeasurementName(T::getType(i))) + ": mean " + String(mean) +
+                      ", stdev " + String(sqrt(variance)) + ", missing " +
+                      String(missing[i]) + ", suppressed " + String(suppressed[i]) + "\n";
+        }
+
+        xSemaphoreGive(mutex);
+
+        return status;
+    }
+
+protected:
+    /**
+     * @brief Read the result of the conversion from the device
+     *
+     */
+    virtual T readSensor() = 0;
+
+    void finishConversion(bool timedOut) override {
+        record(timedOut ? T::missing() : readSensor());
+    }
+
+private:
+    // The metadata and the commands read the statistics from other tasks
+    SemaphoreHandle_t mutex = NULL;
+
+    RingBuffer<T, STORED_SENSOR_DATA> history;
+
+    uint8_t missing[T::ValueCount] = {};
+
+    WindowAggregator window[T::ValueCount];
+
+    // Last reported mean of each measurement, for the deadbands
+    float lastReported[T::ValueCount] = {};
+    uint32_t lastReportTime[T::ValueCount] = {};
+    bool reported[T::ValueCount] = {};
+
+    uint32_t suppressed[T::ValueCount] = {};
+
+    /**
+     * @brief Mean and population variance of a measurement over the stored readings. They are
+     * recomputed when read: the window is small and a reading is recorded far more often than the
+     * metadata is sent, so updating them on every reading would cost more.
+     *
+     * @return uint32_t Number of readings of the measurement that are not missing
+     */
+    uint32_t getStats(uint8_t index, double& mean, double& variance) {
+        uint32_t count = 0;
+        mean = 0;
+        variance = 0;
+
+        for (size_t i = 0; i < history.size(); i++) {
+            float value = history[i].getValue(index);
+            if (value == SENSOR_MISSING_VALUE)
+                continue;
+
+            count++;
+            mean += value;
+        }
+
+        if (count == 0)
+            return 0;
+
+        mean /= count;
+
+        for (size_t i = 0; i < history.size(); i++) {
+            float value = history[i].getValue(index);
+            if (value != SENSOR_MISSING_VALUE)
+                variance += (value - mean) * (value - mean);
+        }
+
+        variance /= count;
+
+        return count;
+    }
+
+    bool isException(uint8_t index, float value, uint32_t now) {
+        if (!reported[index] || SENSOR_HEARTBEAT == 0 ||
+            now - lastReportTime[index] >= SENSOR_HEARTBEAT)
+            return true;
+
+        float band = std::max<float>(getMeasurementDeadband(T::getType(index)),
+                                     deadband * fabs(lastReported[index]));
+
+        return fabs(value - lastReported[index]) > band;
+    }
+
+    void record(const T& reading) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+
+        T evicted;
+
+        if (history.push(reading, &evicted)) {
+            for (uint8_t i = 0; i < T::ValueCount; i++) {
+                if (evicted.getValue(i) == SENSOR_MISSING_VALUE)
+                    missing[i]--;
+            }
+        }
+
+        for (uint8_t i = 0; i < T::ValueCount; i++) {
+            float value = reading.getValue(i);
+            if (value == SENSOR_MISSING_VALUE)
+                missing[i]++;
+            else
+                window[i].add(value);
+        }
+
+        xSemaphoreGive(mutex);
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+// Value of the readings that could not be measured
+#define SENSOR_MISSING_VALUE -1
+
+/**
+ * @brief Measurements of the sensors, the ids are sent in the metadata so they must be the same in
+ * all the firmwares. Add new measurements before MeasurementCount and their name in
+ * getMeasurementName.
+ *
+ */
+enum MeasurementType : uint8_t {
+    MeasurementSoilTemperature = 0,
+    MeasurementSoilPH = 1,
+    MeasurementHumidity = 2,
+    MeasurementTemperature = 3,
+    MeasurementSoilTemperatureLowRes = 4,
+    MeasurementSoilMoisture = 5,
+    MeasurementSoilConductivity = 6,
+    MeasurementWaterLevel = 7,
+    MeasurementCount
+};
+
+/**
+ * @brief Type of the measurement in the JSON of the server
+ *
+ */
+inline const char* getMeasurementName(MeasurementType type) {
+    switch (type) {
+        case MeasurementSoilTemperature:
+            return "Soil_Temperature";
+        case MeasurementSoilPH:
+            return "Soil_PH";
+        case MeasurementHumidity:
+            return "humidity";
+        case MeasurementTemperature:
+            return "temperature";
+        case MeasurementSoilTemperatureLowRes:
+            return "Soil_Temperature_Low_Res";
+        case MeasurementSoilMoisture:
+            return "Soil_Moisture";
+        case MeasurementSoilConductivity:
+            return "Soil_Conductivity";
+        case MeasurementWaterLevel:
+            return "Water_Level";
+        default:
+            return "Unknown";
+    }
+}
+
+/**
+ * @brief Absolute deadband of the measurement, in its unit
+ *
+ */
+inline float getMeasurementDeadband(MeasurementType type) {
+    switch (type) {
+        case MeasurementSoilTemperature:
+        case MeasurementSoilTemperatureLowRes:
+            return SOIL_TEMPERATURE_DEADBAND;
+        case MeasurementSoilPH:
+            return SOIL_PH_DEADBAND;
+        case MeasurementHumidity:
+            return HUMIDITY_DEADBAND;
+        case MeasurementTemperature:
+            return TEMPERATURE_DEADBAND;
+        case MeasurementSoilMoisture:
+            return SOIL_MOISTURE_DEADBAND;
+        case MeasurementSoilConductivity:
+            return SOIL_CONDUCTIVITY_DEADBAND;
+        case MeasurementWaterLevel:
+            return WATER_LEVEL_DEADBAND;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Factor of the fixed point values of the measurement in the compact reports, chosen to
+ * fit its range in an int16
+ *
+ */
+inline float getMeasurementScale(MeasurementType type) {
+    switch (type) {
+        case MeasurementSoilConductivity:
+        case MeasurementWaterLevel:
+            return 1;
+        default:
+            return 100;
+    }
+}
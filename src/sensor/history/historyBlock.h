@@ -0,0 +1,319 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#pragma pack(1)
+
+/**
+ * @brief Header of a compressed block of points of one measurement, stored in front of its data
+ * in the history files and sent in the backfill frames
+ *
+ */
+class HistoryBlockHeader {
+public:
+    uint8_t type;  // MeasurementType
+    uint8_t count;
+    uint8_t size;  // Bytes of data
+    uint32_t firstTime;
+    uint32_t lastTime;
+};
+
+#pragma pack()
+
+/**
+ * @brief Bit stream over a byte buffer, most significant bit first
+ *
+ */
+class HistoryBitStream {
+public:
+    HistoryBitStream(uint8_t* data, uint16_t size) : data(data), size(size) {}
+
+    void write(uint32_t value, uint8_t bits) {
+        for (int8_t i = bits - 1; i >= 0; i--) {
+            uint8_t mask = 0x80 >> (position % 8);
+            if (value & ((uint32_t)1 << i))
+                data[position / 8] |= mask;
+            else
+                data[position / 8] &= ~mask;
+            position++;
+        }
+    }
+
+    /**
+     * @brief Read bits, false when the data ends before
+     *
+     */
+    bool read(uint32_t& value, uint8_t bits) {
+        if (position + bits > size * 8)
+            return false;
+
+        value = 0;
+        for (uint8_t i = 0; i < bits; i++) {
+            value = (value << 1) | ((data[position / 8] >> (7 - position % 8)) & 1);
+            position++;
+        }
+
+        return true;
+    }
+
+    uint16_t getPosition() { return position; }
+
+    void setPosition(uint16_t bit) { position = bit; }
+
+private:
+    uint8_t* data;
+    uint16_t size;
+    uint16_t position = 0;
+};
+
+/**
+ * @brief Compresses the points of a measurement as in Gorilla: the timestamps with the delta of
+ * their deltas, a regular interval takes 1 bit, and the values XOR the previous one, an unchanged
+ * value takes 1 bit and a close one only its meaningful bits.
+ *
+ */
+class HistoryBlockEncoder {
+public:
+    HistoryBlockHeader header = {};
+
+    uint8_t data[SENSOR_HISTORY_BLOCK] = {};
+
+    void reset(uint8_t type) {
+        header = {};
+        header.type = type;
+        stream.setPosition(0);
+    }
+
+    bool isEmpty() { return header.count == 0; }
+
+    /**
+     * @brief Add a point
+     *
+     * @param time UTC seconds
+     * @return false If the point does not fit in the block or goes back in time, the block has to
+     * be closed and reset before adding it
+     */
+    bool append(uint32_t time, float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        if (header.count == 0) {
+            header.firstTime = time;
+            header.lastTime = time;
+            header.count = 1;
+            stream.write(bits, 32);
+            previousDelta = 0;
+            previousValue = bits;
+            previousLeading = NoWindow;
+            updateSize();
+            return true;
+        }
+
+        if (header.count == UINT8_MAX || time < header.lastTime ||
+            stream.getPosition() + MaxPointBits > SENSOR_HISTORY_BLOCK * 8)
+            return false;
+
+        int64_t delta = (int64_t)time - header.lastTime;
+        writeDeltaOfDelta(delta - previousDelta);
+        previousDelta = delta;
+
+        writeValue(bits ^ previousValue);
+        previousValue = bits;
+
+        header.lastTime = time;
+        header.count++;
+        updateSize();
+
+        return true;
+    }
+
+private:
+    // Timestamp 4 + 32 bits, value 2 + 5 + 5 + 32 bits
+    static const uint8_t MaxPointBits = 80;
+
+    static const uint8_t NoWindow = 0xFF;
+
+    HistoryBitStream stream = HistoryBitStream(data, SENSOR_HISTORY_BLOCK);
+
+    int64_t previousDelta = 0;
+    uint32_t previousValue = 0;
+
+    // Meaningful bits of the previous XOR
+    uint8_t previousLeading = NoWindow;
+    uint8_t previousTrailing = 0;
+
+    void updateSize() { header.size = (stream.getPosition() + 7) / 8; }
+
+    void writeDeltaOfDelta(int64_t deltaOfDelta) {
+        if (deltaOfDelta == 0) {
+            stream.write(0, 1);
+        } else if (deltaOfDelta >= -64 && deltaOfDelta <= 63) {
+            stream.write(0b10, 2);
+            stream.write((uint32_t)deltaOfDelta, 7);
+        } else if (deltaOfDelta >= -256 && deltaOfDelta <= 255) {
+            stream.write(0b110, 3);
+            stream.write((uint32_t)deltaOfDelta, 9);
+        } else if (deltaOfDelta >= -2048 && deltaOfDelta <= 2047) {
+            stream.write(0b1110, 4);
+            stream.write((uint32_t)deltaOfDelta, 12);
+        } else {
+            stream.write(0b1111, 4);
+            stream.write((uint32_t)deltaOfDelta, 32);
+        }
+    }
+
+    void writeValue(uint32_t xorValue) {
+        if (xorValue == 0) {
+            stream.write(0, 1);
+            return;
+        }
+
+        stream.write(1, 1);
+
+        uint8_t leading = std::min<uint8_t>(__builtin_clz(xorValue), 31);
+        uint8_t trailing = __builtin_ctz(xorValue);
+
+        // Inside the window of the previous value
+        if (previousLeading != NoWindow && leading >= previousLeading &&
+            trailing >= previousTrailing) {
+            stream.write(0, 1);
+            stream.write(xorValue >> previousTrailing, 32 - previousLeading - previousTrailing);
+            return;
+        }
+
+        uint8_t meaningful = 32 - leading - trailing;
+
+        stream.write(1, 1);
+        stream.write(leading, 5);
+        stream.write(meaningful - 1, 5);
+        stream.write(xorValue >> trailing, meaningful);
+
+        previousLeading = leading;
+        previousTrailing = trailing;
+    }
+};
+
+class HistoryBlockDecoder {
+public:
+    HistoryBlockDecoder(const HistoryBlockHeader& header, uint8_t* data)
+        : header(header), stream(data, header.size) {}
+
+    /**
+     * @brief Next point of the block
+     *
+     * @return false At the end of the block or if the data is corrupt
+     */
+    bool next(uint32_t& time, float& value) {
+        if (read >= header.count)
+            return false;
+
+        uint32_t bits;
+
+        if (read == 0) {
+            if (!stream.read(bits, 32))
+                return false;
+
+            time = header.firstTime;
+        } else {
+            int64_t deltaOfDelta;
+            if (!readDeltaOfDelta(deltaOfDelta) || !readValue(bits))
+                return false;
+
+            previousDelta += deltaOfDelta;
+            time = previousTime + previousDelta;
+        }
+
+        previousTime = time;
+        previousValue = bits;
+        read++;
+
+        memcpy(&value, &bits, sizeof(value));
+
+        return true;
+    }
+
+private:
+    HistoryBlockHeader header;
+
+    HistoryBitStream stream;
+
+    uint8_t read = 0;
+
+    uint32_t previousTime = 0;
+    int64_t previousDelta = 0;
+    uint32_t previousValue = 0;
+
+    uint8_t previousLeading = 0;
+    uint8_t previousTrailing = 0;
+
+    static int64_t signExtend(uint32_t value, uint8_t bits) {
+        if (bits < 32 && (value & ((uint32_t)1 << (bits - 1))))
+            return (int64_t)value - ((int64_t)1 << bits);
+
+        return bits == 32 ? (int64_t)(int32_t)value : (int64_t)value;
+    }
+
+    bool readDeltaOfDelta(int64_t& deltaOfDelta) {
+        uint32_t bit;
+        uint8_t prefix = 0;
+
+        // Up to four 1 bits select the size
+        while (prefix < 4) {
+            if (!stream.read(bit, 1))
+                return false;
+            if (bit == 0)
+                break;
+            prefix++;
+        }
+
+        static const uint8_t sizes[] = {0, 7, 9, 12, 32};
+
+        if (prefix == 0) {
+            deltaOfDelta = 0;
+            return true;
+        }
+
+        uint32_t value;
+        if (!stream.read(value, sizes[prefix]))
+            return false;
+
+        deltaOfDelta = signExtend(value, sizes[prefix]);
+        return true;
+    }
+
+    bool readValue(uint32_t& bits) {
+        uint32_t control;
+        if (!stream.read(control, 1))
+            return false;
+
+        if (control == 0) {
+            bits = previousValue;
+            return true;
+        }
+
+        if (!stream.read(control, 1))
+            return false;
+
+        if (control == 1) {
+            uint32_t leading, meaningful;
+            if (!stream.read(leading, 5) || !stream.read(meaningful, 5))
+                return false;
+
+            previousLeading = leading;
+            previousTrailing = 32 - leading - (meaningful + 1);
+            if (leading + meaningful + 1 > 32)
+                return false;
+        }
+
+        uint8_t meaningfulBits = 32 - previousLeading - previousTrailing;
+
+        uint32_t xorValue;
+        if (!stream.read(xorValue, meaningfulBits))
+            return false;
+
+        bits = previousValue ^ (xorValue << previousTrailing);
+        return true;
+    }
+};
@@ -0,0 +1,367 @@
+#include "sensorHistory.h"
+
+#include "time/timeSyncService.h"
+
+#include "LoraMesher.h"
+
+static const char* HISTORY_TAG = "SensorHistory";
+
+void SensorHistory::init() {
+    for (uint8_t type = 0; type < MeasurementCount; type++)
+        encoders[type].reset(type);
+
+    available = SPIFFS.begin(true);
+    if (!available) {
+        ESP_LOGE(HISTORY_TAG, "SPIFFS not available, the sensor history is disabled");
+        return;
+    }
+
+    File file = SPIFFS.open(SENSOR_HISTORY_FILE, FILE_READ);
+    if (file) {
+        fileSize = file.size();
+        file.close();
+    }
+
+    createBackfillTask();
+
+    ESP_LOGI(HISTORY_TAG, "Sensor history initialized, %d bytes", fileSize);
+}
+
+void SensorHistory::append(MeasurementType type, float value) {
+    if (!available || type >= MeasurementCount)
+        return;
+
+    // Without the time the points could not be queried
+    uint32_t time = TimeSyncService::getInstance().getEpoch();
+    if (time == 0) {
+        untimed++;
+        return;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    HistoryBlockEncoder& encoder = encoders[type];
+    if (!encoder.append(time, value)) {
+        writeBlock(encoder);
+        encoder.append(time, value);
+    }
+
+    points++;
+
+    xSemaphoreGive(mutex);
+}
+
+void SensorHistory::writeBlock(HistoryBlockEncoder& encoder) {
+    if (encoder.isEmpty())
+        return;
+
+    uint32_t recordSize = sizeof(HistoryBlockHeader) + encoder.header.size;
+
+    if (fileSize + recordSize > SENSOR_HISTORY_MAX_SIZE / 2)
+        rotate();
+
+    File file = SPIFFS.open(SENSOR_HISTORY_FILE, FILE_APPEND);
+    if (!file) {
+        ESP_LOGE(HISTORY_TAG, "Could not open the history");
+    } else {
+        size_t written = file.write((uint8_t*)&encoder.header, sizeof(HistoryBlockHeader));
+        written += file.write(encoder.data, encoder.header.size);
+        file.close();
+
+        fileSize += written;
+        blocks++;
+
+        // A partial block would corrupt the rest of the file
+        if (written != recordSize) {
+            ESP_LOGE(HISTORY_TAG, "History full, starting a new file");
+            rotate();
+        }
+    }
+
+    encoder.reset(encoder.header.type);
+}
+
+void SensorHistory::rotate() {
+    SPIFFS.remove(SENSOR_HISTORY_OLD_FILE);
+    SPIFFS.rename(SENSOR_HISTORY_FILE, SENSOR_HISTORY_OLD_FILE);
+
+    fileSize = 0;
+    rotations++;
+
+    ESP_LOGI(HISTORY_TAG, "Oldest sensor history deleted");
+}
+
+void SensorHistory::closeBlocks() {
+    for (HistoryBlockEncoder& encoder : encoders)
+        writeBlock(encoder);
+}
+
+String SensorHistory::getStatus() {
+    if (!available)
+        return "Sensor history not available\n";
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    uint32_t oldSize = 0;
+    File file = SPIFFS.open(SENSOR_HISTORY_OLD_FILE, FILE_READ);
+    if (file) {
+        oldSize = file.size();
+        file.close();
+    }
+
+    String status = "--- Sensor history ---\n";
+    status += "Points " + String(points) + ", blocks " + String(blocks) + ", without time " +
+              String(untimed) + "\n";
+    status += "Stored " + String(fileSize + oldSize) + " of " + String(SENSOR_HISTORY_MAX_SIZE) +
+              " bytes, rotations " + String(rotations) + "\n";
+
+    if (backfill.active)
+        status += "Backfill in progress, " + String(backfill.frames) + " frames sent\n";
+
+    xSemaphoreGive(mutex);
+
+    return status;
+}
+
+String SensorHistory::sendQuery(uint16_t dst, uint32_t from, uint32_t to, uint8_t types) {
+    uint32_t messageSize = sizeof(SensorHistoryMessage) + sizeof(HistoryQueryMessage);
+
+    SensorHistoryMessage* message = (SensorHistoryMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr)
+        return "Not enough memory for the query\n";
+
+    message->historyCommand = HistoryCommand::HistoryQuery;
+
+    HistoryQueryMessage* query = (HistoryQueryMessage*)message->payload;
+    query->from = from;
+    query->to = to;
+    query->types = types;
+
+    message->appPortDst = appPort::HistoryApp;
+    message->appPortSrc = appPort::HistoryApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = dst;
+    message->messageId = 0;
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+    if (dst == message->addrSrc)
+        MessageManager::getInstance().sendMessage(messagePort::InternalPort, (DataMessage*)message);
+    else
+        MessageManager::getInstance().sendMessage(messagePort::LoRaMeshPort, (DataMessage*)message);
+
+    vPortFree(message);
+
+    return "History query sent to " + String(dst, HEX) + "\n";
+}
+
+String SensorHistory::getJSON(DataMessage* message) {
+    SensorHistoryMessage* historyMessage = (SensorHistoryMessage*)message;
+
+    DynamicJsonDocument doc(4096);
+
+    JsonObject data = doc.createNestedObject("data");
+
+    historyMessage->serialize(data);
+
+    String json;
+    serializeJson(doc, json);
+
+    return json;
+}
+
+DataMessage* SensorHistory::getDataMessage(JsonObject data) {
+    if ((HistoryCommand)data["historyCommand"] != HistoryCommand::HistoryQuery) {
+        ESP_LOGE(HISTORY_TAG, "Unknown history command: %d", data["historyCommand"].as<uint8_t>());
+        return nullptr;
+    }
+
+    uint32_t messageSize = sizeof(SensorHistoryMessage) + sizeof(HistoryQueryMessage);
+
+    SensorHistoryMessage* message = (SensorHistoryMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr)
+        return nullptr;
+
+    ((DataMessageGeneric*)message)->deserialize(data);
+
+    message->historyCommand = HistoryCommand::HistoryQuery;
+
+    HistoryQueryMessage* query = (HistoryQueryMessage*)message->payload;
+    query->from = data["from"];
+    query->to = data["to"];
+    query->types = data["types"];
+
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+    return (DataMessage*)message;
+}
+
+void SensorHistory::processReceivedMessage(messagePort port, DataMessage* message) {
+    SensorHistoryMessage* historyMessage = (SensorHistoryMessage*)message;
+
+    switch (historyMessage->historyCommand) {
+        case HistoryCommand::HistoryQuery:
+            startBackfill((HistoryQueryMessage*)historyMessage->payload);
+            break;
+        default:
+            break;
+    }
+}
+
+void SensorHistory::startBackfill(HistoryQueryMessage* query) {
+    if (!available) {
+        ESP_LOGW(HISTORY_TAG, "History query without history");
+        return;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    if (backfill.active)
+        ESP_LOGW(HISTORY_TAG, "History query replaces the backfill in progress");
+
+    closeBlocks();
+
+    backfill.query = *query;
+    backfill.file = 0;
+    backfill.offset = 0;
+    backfill.rotations = rotations;
+    backfill.frames = 0;
+    backfill.active = true;
+
+    xSemaphoreGive(mutex);
+
+    ESP_LOGI(HISTORY_TAG, "Backfill from %u to %u", query->from, query->to);
+
+    xTaskNotifyGive(backfill_TaskHandle);
+}
+
+void SensorHistory::createBackfillTask() {
+    BaseType_t res = xTaskCreate(backfillLoop, "Backfill Task", 4096, NULL, 1,
+                                 &backfill_TaskHandle);
+
+    if (res != pdPASS)
+        ESP_LOGE(HISTORY_TAG, "Backfill task creation failed");
+}
+
+void SensorHistory::backfillLoop(void*) {
+    SensorHistory& history = SensorHistory::getInstance();
+
+    while (true) {
+        if (!history.backfill.active) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        SensorHistoryMessage* message = history.nextFrame();
+        if (message == nullptr) {
+            history.sendEnd();
+            continue;
+        }
+
+        MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+        vPortFree(message);
+
+        // Leave the airtime to the current traffic
+        ulTaskNotifyTake(pdTRUE, SENSOR_HISTORY_FRAME_INTERVAL / portTICK_PERIOD_MS);
+    }
+}
+
+SensorHistoryMessage* SensorHistory::nextFrame() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    // The current file became the old one since the last frame
+    if (backfill.rotations != rotations) {
+        if (backfill.file == 1 && rotations - backfill.rotations == 1) {
+            backfill.file = 0;
+        } else {
+            backfill.file = 0;
+            backfill.offset = 0;
+        }
+        backfill.rotations = rotations;
+    }
+
+    HistoryQueryMessage& query = backfill.query;
+    SensorHistoryMessage* message = nullptr;
+
+    while (message == nullptr && backfill.file < 2) {
+        File file = SPIFFS.open(backfill.file == 0 ? SENSOR_HISTORY_OLD_FILE : SENSOR_HISTORY_FILE,
+                                FILE_READ);
+
+        if (file && file.seek(backfill.offset)) {
+            HistoryBlockHeader header;
+
+            while (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) {
+                if (header.size > SENSOR_HISTORY_BLOCK || header.type >= MeasurementCount) {
+                    ESP_LOGE(HISTORY_TAG, "Corrupt history block at %u", backfill.offset);
+                    break;
+                }
+
+                backfill.offset += sizeof(header) + header.size;
+
+                bool selected = query.types == 0 || (query.types & (1 << header.type));
+                if (!selected || header.lastTime < query.from || header.firstTime > query.to) {
+                    file.seek(backfill.offset);
+                    continue;
+                }
+
+                uint32_t payloadSize = sizeof(HistoryFrameMessage) + header.size;
+                message = (SensorHistoryMessage*)pvPortMalloc(sizeof(SensorHistoryMessage) +
+                                                              payloadSize);
+                if (message == nullptr) {
+                    ESP_LOGE(HISTORY_TAG, "Not enough memory for the history frame");
+                    break;
+                }
+
+                HistoryFrameMessage* frame = (HistoryFrameMessage*)message->payload;
+                frame->frame = backfill.frames++;
+                frame->header = header;
+                file.read(frame->data, header.size);
+
+                message->historyCommand = HistoryCommand::HistoryFrame;
+                setHeader(message, payloadSize);
+                break;
+            }
+        }
+
+        if (file)
+            file.close();
+
+        if (message == nullptr) {
+            backfill.file++;
+            backfill.offset = 0;
+        }
+    }
+
+    xSemaphoreGive(mutex);
+
+    return message;
+}
+
+void SensorHistory::sendEnd() {
+    uint32_t payloadSize = sizeof(HistoryEndMessage);
+
+    SensorHistoryMessage* message =
+        (SensorHistoryMessage*)pvPortMalloc(sizeof(SensorHistoryMessage) + payloadSize);
+
+    backfill.active = false;
+
+    if (message == nullptr)
+        return;
+
+    message->historyCommand = HistoryCommand::HistoryEnd;
+    ((HistoryEndMessage*)message->payload)->frames = backfill.frames;
+    setHeader(message, payloadSize);
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+    vPortFree(message);
+
+    ESP_LOGI(HISTORY_TAG, "Backfill finished, %d frames", backfill.frames);
+}
+
+void SensorHistory::setHeader(SensorHistoryMessage* message, uint32_t payloadSize) {
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::HistoryApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = 0;
+    message->messageId = backfill.frames;
+    message->messageSize = sizeof(SensorHistoryMessage) - sizeof(DataMessageGeneric) + payloadSize;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "SPIFFS.h"
+
+#include "config.h"
+
+#include "message/messageService.h"
+
+#include "message/messageManager.h"
+
+#include "sensor/generic/sensorMeasurement.h"
+
+#include "historyBlock.h"
+
+#include "sensorHistoryMessage.h"
+
+#include "sensorHistoryCommandService.h"
+
+static_assert(MeasurementCount <= 8, "The history queries select the measurements with one byte");
+
+/**
+ * @brief Time series of the window means of the measurements, kept in SPIFFS to backfill the
+ * server after the node was out of reach of a gateway.
+ *
+ * Each measurement fills a compressed block in RAM, see HistoryBlockEncoder, that is appended to
+ * SENSOR_HISTORY_FILE when full. When the file reaches half of SENSOR_HISTORY_MAX_SIZE it becomes
+ * SENSOR_HISTORY_OLD_FILE, replacing the oldest half. The points need the synchronized time.
+ *
+ * A HistoryQuery streams the blocks that overlap the range, one per frame every
+ * SENSOR_HISTORY_FRAME_INTERVAL, to the gateway, which expands them into JSON.
+ *
+ */
+class SensorHistory : public MessageService {
+public:
+    static SensorHistory& getInstance() {
+        static SensorHistory instance;
+        return instance;
+    }
+
+    ~SensorHistory() {
+        if (sensorHistoryCommandService != nullptr) {
+            delete sensorHistoryCommandService;
+        }
+    }
+
+    SensorHistoryCommandService* sensorHistoryCommandService = nullptr;
+
+    void init();
+
+    /**
+     * @brief Store a point of a measurement at the current time
+     *
+     */
+    void append(MeasurementType type, float value);
+
+    String getStatus();
+
+    /**
+     * @brief Request the points of a node between two UTC times, the frames go to the server
+     *
+     * @param types Bit per MeasurementType, 0 for all
+     */
+    String sendQuery(uint16_t dst, uint32_t from, uint32_t to, uint8_t types);
+
+    String getJSON(DataMessage* message);
+
+    DataMessage* getDataMessage(JsonObject data);
+
+    void processReceivedMessage(messagePort port, DataMessage* message);
+
+private:
+    SensorHistory() : MessageService(HistoryApp, "History") {
+        sensorHistoryCommandService = new SensorHistoryCommandService();
+        commandService = sensorHistoryCommandService;
+        mutex = xSemaphoreCreateMutex();
+    };
+
+    SemaphoreHandle_t mutex = NULL;
+
+    bool available = false;
+
+    HistoryBlockEncoder encoders[MeasurementCount];
+
+    uint32_t fileSize = 0;
+
+    // Increased when the current file becomes the old one
+    uint32_t rotations = 0;
+
+    uint32_t points = 0;
+    uint32_t blocks = 0;
+    uint32_t untimed = 0;
+
+    struct Backfill {
+        bool active = false;
+        HistoryQueryMessage query;
+        uint8_t file;  // 0 the old file, 1 the current one
+        uint32_t offset;
+        uint32_t rotations;
+        uint16_t frames;
+    };
+
+    Backfill backfill;
+
+    TaskHandle_t backfill_TaskHandle = NULL;
+
+    void createBackfillTask();
+
+    static void backfillLoop(void*);
+
+    void startBackfill(HistoryQueryMessage* query);
+
+    /**
+     * @brief Read the next block of the backfill into a frame message
+     *
+     * @return SensorHistoryMessage* The message to send, nullptr at the end of the history
+     */
+    SensorHistoryMessage* nextFrame();
+
+    void sendEnd();
+
+    /**
+     * @brief Append a block to the current file, rotating the files when it is full
+     *
+     */
+    void writeBlock(HistoryBlockEncoder& encoder);
+
+    void rotate();
+
+    /**
+     * @brief Write the blocks in RAM, so that a backfill includes their points
+     *
+     */
+    void closeBlocks();
+
+    void setHeader(SensorHistoryMessage* message, uint32_t payloadSize);
+};
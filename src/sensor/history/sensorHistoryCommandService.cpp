@@ -0,0 +1,22 @@
+#include "sensorHistoryCommandService.h"
+#include "sensorHistory.h"
+
+SensorHistoryCommandService::SensorHistoryCommandService() {
+    addCommand(Command("/history", "Get the size and the statistics of the sensor history",
+                       HistoryCommand::GetHistoryStats, 1, [this](String args) {
+                           return SensorHistory::getInstance().getStatus();
+                       }));
+
+    addCommand(Command("/historyQuery",
+                       "Request the sensor history of a node for the server. Usage: /historyQuery "
+                       "<dst in hex> <from> <to> <types bitmap, all if empty>, times in UTC "
+                       "seconds",
+                       HistoryCommand::SendHistoryQuery, 1, [this](String args) {
+                           unsigned int dst = 0, types = 0;
+                           unsigned long from = 0, to = 0;
+                           if (sscanf(args.c_str(), "%x %lu %lu %u", &dst, &from, &to, &types) < 3)
+                               return String("Usage: /historyQuery <dst> <from> <to> [types]");
+
+                           return SensorHistory::getInstance().sendQuery(dst, from, to, types);
+                       }));
+}
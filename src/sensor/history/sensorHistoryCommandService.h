@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Arduino.h"
+
+#include "commands/commandService.h"
+
+
+class SensorHistoryCommandService : public CommandService {
+public:
+    SensorHistoryCommandService();
+};
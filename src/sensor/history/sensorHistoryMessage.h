@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/dataMessage.h"
+
+#include "sensor/generic/sensorMeasurement.h"
+
+#include "historyBlock.h"
+
+#pragma pack(1)
+
+enum HistoryCommand : uint8_t {
+    HistoryQuery = 0,
+    HistoryFrame = 1,
+    HistoryEnd = 2,
+    GetHistoryStats = 3,
+    SendHistoryQuery = 4,
+};
+
+/**
+ * @brief Request of the stored points between two UTC times
+ *
+ */
+class HistoryQueryMessage {
+public:
+    uint32_t from;
+    uint32_t to;
+    uint8_t types;  // Bit per MeasurementType, 0 for all
+};
+
+/**
+ * @brief A stored block, sent as it is in the flash
+ *
+ */
+class HistoryFrameMessage {
+public:
+    uint16_t frame;
+    HistoryBlockHeader header;
+    uint8_t data[];
+};
+
+class HistoryEndMessage {
+public:
+    uint16_t frames;
+};
+
+class SensorHistoryMessage : public DataMessageGeneric {
+public:
+    HistoryCommand historyCommand;
+    uint8_t payload[];
+
+    void serialize(JsonObject& doc) {
+        ((DataMessageGeneric*)(this))->serialize(doc);
+
+        doc["historyCommand"] = historyCommand;
+
+        switch (historyCommand) {
+            case HistoryCommand::HistoryQuery: {
+                HistoryQueryMessage* query = (HistoryQueryMessage*)payload;
+                doc["from"] = query->from;
+                doc["to"] = query->to;
+                doc["types"] = query->types;
+                break;
+            }
+            case HistoryCommand::HistoryFrame: {
+                HistoryFrameMessage* frame = (HistoryFrameMessage*)payload;
+                doc["message_type"] = "history";
+                doc["frame"] = frame->frame;
+                doc["type"] = getMeasurementName((MeasurementType)frame->header.type);
+
+                // [timestamp, measurement] of each point
+                JsonArray points = doc.createNestedArray("message");
+
+                HistoryBlockDecoder decoder(frame->header, frame->data);
+                uint32_t time;
+                float value;
+                while (decoder.next(time, value)) {
+                    JsonArray point = points.createNestedArray();
+                    point.add(time);
+                    point.add(value);
+                }
+                break;
+            }
+            case HistoryCommand::HistoryEnd: {
+                HistoryEndMessage* end = (HistoryEndMessage*)payload;
+                doc["frames"] = end->frames;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+};
+
+#pragma pack()
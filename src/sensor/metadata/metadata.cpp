@@ -1,5 +1,7 @@
 #include "metadata.h"
 
+#include "sensor/sensorService.h"
+
 static const char* METADATA_TAG = "MetadataService";
 
 void Metadata::initMetadata() {
@@ -68,11 +70,17 @@ void Metadata::metadataLoop(void* pvParameters) {
 void Metadata::createAndSendMetadata() {
     ESP_LOGV(METADATA_TAG, "Sending metadata message %d", metadataId++);
 
-    // uint8_t metadataSize = 1; //TODO: This should be dynamic with an array of sensors
-    // uint16_t metadataSensorSize = metadataSize * sizeof(MetadataSensorMessage);
-    uint16_t messageWithHeaderSize = sizeof(MetadataMessage);  // + metadataSensorSize;
+    SensorService& sensorService = SensorService::getInstance();
+
+    uint8_t metadataSize = sensorService.getMeasurementCount();
+    uint16_t metadataSensorSize = metadataSize * sizeof(MetadataSensorMessage);
+    uint16_t messageWithHeaderSize = sizeof(MetadataMessage) + metadataSensorSize;
 
-    MetadataMessage* message = new MetadataMessage();
+    MetadataMessage* message = (MetadataMessage*)pvPortMalloc(messageWithHeaderSize);
+    if (message == nullptr) {
+        ESP_LOGE(METADATA_TAG, "Not enough memory for the metadata message");
+        return;
+    }
 
     message->appPortDst = appPort::MQTTApp;
     message->appPortSrc = appPort::MetadataApp;
@@ -85,17 +93,11 @@ void Metadata::createAndSendMetadata() {
     message->metadataSendTimeInterval = METADATA_UPDATE_DELAY;
     message->batteryPercentage = Battery::getInstance().getVoltagePercentage();
 
-    // message->metadataSize = metadataSize;
-
-    // TODO: This should be a vector of sensors
-    //  Temperature& temperature = Temperature::getInstance();
-
-    // MetadataSensorMessage* tempMetadata = temperature.getMetadataMessage();
-    // memcpy(message->sensorMetadata, tempMetadata, sizeof(MetadataSensorMessage));
+    message->metadataSize = sensorService.getMetadata(message->sensorMetadata, metadataSize);
 
     MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
 
-    delete (message);
+    vPortFree(message);
 }
 
 void Metadata::getJSONDataObject(JsonObject& doc, MetadataMessage* metadataMessage) {
@@ -16,8 +16,8 @@ public:
     GPSMessage gps;
     int metadataSendTimeInterval;
     float batteryPercentage;
-    // uint8_t metadataSize;
-    // MetadataSensorMessage sensorMetadata[];
+    uint8_t metadataSize;
+    MetadataSensorMessage sensorMetadata[];
 
     void serialize(JsonObject& doc) {
         // Call the base class serialize function
@@ -34,16 +34,13 @@ public:
         // Add the battery percentage to the JSON object
         doc["battery_percentage"] = batteryPercentage;
 
-        doc.createNestedArray("message");
+        JsonArray sensorsArray = doc.createNestedArray("message");
 
-        // JsonArray sensorsArray = doc.createNestedArray("message");
-
-        // for (int i = 0; i < metadataSize; i++) {
-        //     JsonObject sensorObject = sensorsArray.createNestedObject();
-        //     sensorMetadata[i].serialize(sensorObject);
-        //     // TODO: Add the sensor id to the metadata message
-        //     sensorObject["id"] = i;
-        // }
+        for (int i = 0; i < metadataSize; i++) {
+            JsonObject sensorObject = sensorsArray.createNestedObject();
+            sensorMetadata[i].serialize(sensorObject);
+            sensorObject["id"] = i;
+        }
     }
 };
 
@@ -4,27 +4,31 @@
 
 #include <ArduinoJson.h>
 
+#include "sensor/generic/sensorMeasurement.h"
+
 #pragma pack(1)
 class MetadataSensorMessage {
 public:
-    uint8_t type;
+    uint8_t type;  // MeasurementType
     uint8_t sampleSize;
     uint32_t sendTimeInterval;
     uint32_t calibration;
     float stDev;
     float variance;
     uint8_t missingValues;
+    uint32_t suppressedValues;  // Samples not reported because they stayed in the deadband
 
     MetadataSensorMessage() {}
 
     void serialize(JsonObject& doc) {
-        doc["type"] = type;
+        doc["type"] = getMeasurementName((MeasurementType)type);
         doc["sample_size"] = sampleSize;
         doc["send_time_interval"] = sendTimeInterval;
         doc["calibration"] = calibration;
         doc["standard_deviation"] = stDev;
         doc["variance"] = variance;
         doc["missing_values"] = missingValues;
+        doc["suppressed_values"] = suppressedValues;
     }
 };
 
@@ -1,4 +1,11 @@
 #include "sensorCommandService.h"
 #include "sensorService.h"
 
-SensorCommandService::SensorCommandService() {}
\ No newline at end of file
+SensorCommandService::SensorCommandService() {
+    addCommand(Command("/sensors",
+                       "Get the mean, standard deviation and missing values of the sensors",
+                       SensorCommand::GetSensors, 1,
+                       [this](String args) {
+                           return SensorService::getInstance().getStatsString();
+                       }));
+}
\ No newline at end of file
@@ -7,10 +7,8 @@ void SensorService::init() {
 #if !defined(NO_SENSOR_DATA)
     ESP_LOGI(SENSOR_TAG, "Initializing sensors");
 
-    phSensor->init();
-    sht4xAirSensor->init();
-    soilSensor->init();
-    waterLevelSensor->init();
+    for (SensorBase* sensor : sensors)
+        sensor->init();
 
     ESP_LOGI(SENSOR_TAG, "Sensors initialized");
 
@@ -45,6 +43,9 @@ DataMessage* SensorService::getDataMessage(JsonObject data) {
         case SensorCommand::Calibrate:
             return getCalibrateMessage(data);
             break;
+
+        default:
+            break;
     }
 
     ESP_LOGE(SENSOR_TAG, "Unknown sensor command: %d", data["sensorCommand"].as<uint8_t>());
@@ -107,6 +108,37 @@ void SensorService::sensorsOff() {
     running = false;
 }
 
+uint8_t SensorService::getMeasurementCount() {
+    uint8_t count = 0;
+
+    for (SensorBase* sensor : sensors)
+        count += sensor->getValueCount();
+
+    return count;
+}
+
+uint8_t SensorService::getMetadata(MetadataSensorMessage* metadata, uint8_t maxCount) {
+    uint8_t count = 0;
+
+    for (SensorBase* sensor : sensors) {
+        for (uint8_t i = 0; i < sensor->getValueCount() && count < maxCount; i++)
+            sensor->getMetadata(i, metadata[count++]);
+    }
+
+    return count;
+}
+
+String SensorService::getStatsString() {
+    String status = "--- Sensors, last " + String(STORED_SENSOR_DATA) + " readings ---\n";
+    status += "Reports sent " + String(sentReports) + ", suppressed " +
+              String(suppressedReports) + "\n";
+
+    for (SensorBase* sensor : sensors)
+        status += sensor->getStatsString();
+
+    return status;
+}
+
 void SensorService::createSendingTask() {
     BaseType_t res = xTaskCreatePinnedToCore(sendingLoop,   /* Function to implement the task */
                                              "SendingTask", /* Name of the task */
@@ -134,35 +166,82 @@ void SensorService::sendingLoop(void* parameter) {
         if (!sensorService.running) {
             // Wait until a notification to start the task
             ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            // Start a new window, sampling every sensor now
+            uint32_t now = millis();
+            sensorService.windowStart = now;
+            for (SensorBase* sensor : sensorService.sensors)
+                sensor->resetSchedule(now);
         } else {
             uxHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
             ESP_LOGD(SENSOR_TAG, "Stack space unused after entering the task: %d", uxHighWaterMark);
 
-            sensorService.createAndSendMessage();
+            uint32_t now = millis();
+
+            uint32_t wait = sensorService.pollSensors(now);
 
-            vTaskDelay(SENSOR_SENDING_EVERY / portTICK_PERIOD_MS);
+            if (now - sensorService.windowStart >= SENSOR_SENDING_EVERY) {
+                sensorService.createAndSendMessage();
+                sensorService.windowStart = now;
 
-            // Print the free heap memory
-            ESP_LOGD(SENSOR_TAG, "Free heap: %d", esp_get_free_heap_size());
+                // Print the free heap memory
+                ESP_LOGD(SENSOR_TAG, "Free heap: %d", esp_get_free_heap_size());
+            }
+
+            // Until the next sensor to poll or the end of the window
+            int32_t windowLeft = (int32_t)(sensorService.windowStart + SENSOR_SENDING_EVERY -
+                                           millis());
+            wait = std::min<uint32_t>(wait, windowLeft > 0 ? windowLeft : 0);
+            vTaskDelay(std::max<uint32_t>(wait / portTICK_PERIOD_MS, 1));
         }
     }
 }
 
+uint32_t SensorService::pollSensors(uint32_t now) {
+    uint32_t wait = UINT32_MAX;
+
+    for (SensorBase* sensor : sensors)
+        wait = std::min<uint32_t>(wait, sensor->poll(now));
+
+    return wait;
+}
+
 void SensorService::createAndSendMessage() {
-    ESP_LOGV(SENSOR_TAG, "Sending sensor data %d", sensorMessageId++);
+    uint8_t maxAggregates = getMeasurementCount();
+    uint32_t maxSize = sizeof(SensorReportMessage) + maxAggregates * sizeof(MeasurementAggregate);
+
+    SensorReportMessage* message = (SensorReportMessage*)pvPortMalloc(maxSize);
+    if (message == nullptr) {
+        ESP_LOGE(SENSOR_TAG, "Not enough memory for the sensor report");
+        return;
+    }
+
+    uint32_t now = millis();
 
-    MeasurementMessage* message = new MeasurementMessage();
+    // Aggregates of the sensors, only the measurements that changed or reached the heartbeat
+    uint8_t count = 0;
+    for (SensorBase* sensor : sensors)
+        count += sensor->takeWindow(message->aggregates + count, maxAggregates - count, now);
 
-    message->sensorCommand = SensorCommand::Data;
+    if (count == 0) {
+        ESP_LOGV(SENSOR_TAG, "No measurement to report");
+        suppressedReports++;
+        vPortFree(message);
+        return;
+    }
 
-    // Get GPS data
-    message->gps = GPSService::getInstance().getGPSMessage();
+    ESP_LOGV(SENSOR_TAG, "Sending sensor report %d", sensorMessageId++);
 
-    // Get sensor data
-    message->phSensorMessage = phSensor->read();
-    message->sht4xAirSensorMessage = sht4xAirSensor->read();
-    message->soilSensorMessage = soilSensor->read();
-    message->waterLevelSensorMessage = waterLevelSensor->read();
+    // Last position of the GPS task, waiting for a fix would keep the node awake for seconds
+    GPSMessage gps = GPSService::getInstance().getLastGPSMessage();
+
+#if defined(SENSOR_COMPACT_REPORTS)
+    sendCompactReport(message->aggregates, count, now - windowStart, gps, now);
+#else
+    message->sensorCommand = SensorCommand::Report;
+    message->aggregateCount = count;
+    message->window = now - windowStart;
+    message->gps = gps;
 
     message->appPortDst = appPort::MQTTApp;
     message->appPortSrc = appPort::SensorApp;
@@ -170,11 +249,66 @@ void SensorService::createAndSendMessage() {
     message->addrDst = 0;
     message->messageId = sensorMessageId;
 
-    message->messageSize = sizeof(MeasurementMessage) - sizeof(DataMessageGeneric);
+    message->messageSize = sizeof(SensorReportMessage) - sizeof(DataMessageGeneric) +
+                           count * sizeof(MeasurementAggregate);
 
     // Send the message
     MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+    sentReports++;
+#endif
 
     // Delete the message
-    delete message;
+    vPortFree(message);
+}
+
+void SensorService::sendCompactReport(MeasurementAggregate* aggregates, uint8_t count,
+                                      uint32_t window, GPSMessage& gps, uint32_t now) {
+    size_t maxPayload = CompactMeasurement::getMaxSize(count);
+
+    SensorCompactReportMessage* message =
+        (SensorCompactReportMessage*)pvPortMalloc(sizeof(SensorCompactReportMessage) + maxPayload);
+    if (message == nullptr) {
+        ESP_LOGE(SENSOR_TAG, "Not enough memory for the compact sensor report");
+        return;
+    }
+
+    bool sendPosition = hasMoved(gps, now);
+
+    size_t payloadSize = CompactMeasurement::encode(
+        message->payload, maxPayload, CompactMeasurement::toEpoch(gps), window,
+        sendPosition ? &gps : nullptr, aggregates, count);
+
+    message->sensorCommand = SensorCommand::CompactReport;
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::SensorApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = 0;
+    message->messageId = sensorMessageId;
+    message->messageSize = sizeof(SensorCommand) + payloadSize;
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)message);
+    sentReports++;
+
+    if (sendPosition) {
+        lastPosition = gps;
+        lastPositionTime = now;
+        positionSent = true;
+    }
+
+    vPortFree(message);
+}
+
+bool SensorService::hasMoved(GPSMessage& gps, uint32_t now) {
+    // Without a fix there is no position to send
+    if (gps.latitude == 0 && gps.longitude == 0)
+        return false;
+
+    // Sent again with the heartbeat, for the gateways that restarted
+    if (!positionSent || SENSOR_HEARTBEAT == 0 || now - lastPositionTime >= SENSOR_HEARTBEAT)
+        return true;
+
+    double distance = GPSService::getInstance().distanceBetween(
+        lastPosition.latitude, lastPosition.longitude, gps.latitude, gps.longitude);
+
+    return distance > SENSOR_POSITION_MOVED;
 }
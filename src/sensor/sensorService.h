@@ -54,6 +54,22 @@ public:
 
     void sensorsOff();
 
+    /**
+     * @brief Number of measurements of all the sensors
+     *
+     */
+    uint8_t getMeasurementCount();
+
+    /**
+     * @brief Fill the metadata of every measurement of the sensors
+     *
+     * @param metadata Array of maxCount metadata
+     * @return uint8_t Number of metadata written
+     */
+    uint8_t getMetadata(MetadataSensorMessage* metadata, uint8_t maxCount);
+
+    String getStatsString();
+
     SensorCommandService* sensorCommandService = nullptr;
 
 private:
@@ -67,6 +83,8 @@ private:
     SoilHTSensor* soilSensor = new SoilHTSensor();
     WaterLevelSensor* waterLevelSensor = new WaterLevelSensor();
 
+    SensorBase* sensors[SENSOR_COUNT] = {phSensor, sht4xAirSensor, soilSensor, waterLevelSensor};
+
     void createSendingTask();
 
     static void sendingLoop(void*);
@@ -79,8 +97,48 @@ private:
 
     size_t sensorMessageId = 0;
 
+    // millis() when the current reporting window started
+    uint32_t windowStart = 0;
+
+    uint32_t sentReports = 0;
+
+    // Windows without any measurement out of its deadband
+    uint32_t suppressedReports = 0;
+
+    /**
+     * @brief Start the conversions that are due and record the ones that finished
+     *
+     * @return uint32_t ms until a sensor has to be polled again
+     */
+    uint32_t pollSensors(uint32_t now);
+
+    // Last position sent in a compact report
+    GPSMessage lastPosition;
+    uint32_t lastPositionTime = 0;
+    bool positionSent = false;
+
+    /**
+     * @brief Send the aggregates of the window and start a new one
+     *
+     */
     void createAndSendMessage();
 
+    /**
+     * @brief Send the aggregates in a SensorCompactReportMessage, with the position only when it
+     * moved
+     *
+     * @param window Duration of the window in ms
+     */
+    void sendCompactReport(MeasurementAggregate* aggregates, uint8_t count, uint32_t window,
+                           GPSMessage& gps, uint32_t now);
+
+    /**
+     * @brief Whether the position has to be sent, it moved more than SENSOR_POSITION_MOVED or
+     * SENSOR_HEARTBEAT elapsed since it was sent
+     *
+     */
+    bool hasMoved(GPSMessage& gps, uint32_t now);
+
     DataMessage* getMeasurementMessage(JsonObject data);
 
     DataMessage* getCalibrateMessage(JsonObject data);
@@ -14,11 +14,18 @@
 
 #include "types/WaterLevel/WaterLevelSensorMessage.h"
 
+#include "generic/measurementAggregate.h"
+
+#include "generic/compactMeasurement.h"
+
 #pragma pack(1)
 
 enum SensorCommand : uint8_t {
     Data = 0,
     Calibrate = 1,
+    GetSensors = 2,
+    Report = 3,
+    CompactReport = 4,
 };
 
 
@@ -76,6 +83,63 @@ public:
     }
 };
 
+/**
+ * @brief Aggregates of the samples of the sensors during a reporting window. Only the
+ * measurements with samples are sent.
+ *
+ */
+class SensorReportMessage : public DataMessageGeneric {
+public:
+    SensorCommand sensorCommand;
+
+    GPSMessage gps;
+
+    uint32_t window;  // ms
+
+    uint8_t aggregateCount;
+
+    MeasurementAggregate aggregates[];
+
+    void serialize(JsonObject& doc) {
+        JsonObject dataObj = doc.createNestedObject("data");
+
+        ((DataMessageGeneric*)(this))->serialize(dataObj);
+
+        gps.serialize(dataObj);
+
+        dataObj["message_type"] = "measurement";
+        dataObj["window"] = window;
+
+        JsonArray measurements = dataObj.createNestedArray("message");
+
+        for (uint8_t i = 0; i < aggregateCount; i++) {
+            JsonObject measurement = measurements.createNestedObject();
+            aggregates[i].serialize(measurement);
+        }
+    }
+};
+
+/**
+ * @brief SensorReportMessage in the encoding of CompactMeasurement
+ *
+ */
+class SensorCompactReportMessage : public DataMessageGeneric {
+public:
+    SensorCommand sensorCommand;
+
+    uint8_t payload[];
+
+    uint32_t getPayloadSize() { return messageSize - sizeof(SensorCommand); }
+
+    void serialize(JsonObject& doc) {
+        JsonObject dataObj = doc.createNestedObject("data");
+
+        ((DataMessageGeneric*)(this))->serialize(dataObj);
+
+        CompactMeasurement::expand(payload, getPayloadSize(), addrSrc, dataObj);
+    }
+};
+
 class SensorCommandMessage : public DataMessageGeneric {
 public:
     SensorCommand sensorCommand;
@@ -86,11 +150,19 @@ public:
             case SensorCommand::Data:
                 ((MeasurementMessage*)(this))->serialize(doc);
                 break;
+            case SensorCommand::Report:
+                ((SensorReportMessage*)(this))->serialize(doc);
+                break;
+            case SensorCommand::CompactReport:
+                ((SensorCompactReportMessage*)(this))->serialize(doc);
+                break;
             case SensorCommand::Calibrate:
                 // Call the base class serialize function
                 ((DataMessageGeneric*)(this))->serialize(doc);
                 doc["sensorCommand"] = sensorCommand;
                 break;
+            default:
+                break;
         }
     }
 
@@ -102,6 +174,8 @@ public:
                 // Call the base class deserialize function
                 ((DataMessageGeneric*)(this))->deserialize(doc);
                 break;
+            default:
+                break;
         }
 
         // Add the derived class data to the JSON object
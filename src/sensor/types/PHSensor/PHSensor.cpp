@@ -11,7 +11,18 @@ void PHSensor::init() {
     // initialized = true;
 }
 
-PHSensorMessage PHSensor::read() {
+uint32_t PHSensor::startConversion() {
+    if (!initialized)
+        return 0;
+
+    // Both circuits convert at the same time
+    // PH.send_read_cmd();
+    // RTD.send_read_cmd();
+
+    return PH_SENSOR_CONVERSION;
+}
+
+PHSensorMessage PHSensor::readSensor() {
     return PHSensorMessage(-1, -1);
 
     // if (!initialized) {
@@ -19,11 +30,6 @@ PHSensorMessage PHSensor::read() {
     //     return PHSensorMessage(-1, -1);
     // }
 
-    // PH.send_read_cmd();
-    // RTD.send_read_cmd();
-
-    // vTaskDelay(1000 / portTICK_PERIOD_MS);
-
     // float ph = receive_reading(PH);
 
     // float rtd = receive_reading(RTD);
@@ -9,13 +9,20 @@
 // <Ezo_i2c.h> // Link: https://github.com/Atlas-Scientific/Ezo_I2c_lib) #pragma
 // pop_macro("NO_DATA")
 
+#include "sensor/generic/sensor.h"
+
 #include "PHSensorMessage.h"
 
-class PHSensor {
+class PHSensor : public Sensor<PHSensorMessage> {
 public:
-    void init();
+    PHSensor() : Sensor("PH", PH_SENSOR_SAMPLE_EVERY, PH_SENSOR_DEADBAND, PH_SENSOR_TIMEOUT) {}
+
+    void init() override;
+
+protected:
+    uint32_t startConversion() override;
 
-    PHSensorMessage read();
+    PHSensorMessage readSensor() override;
 
 private:
     // Ezo_board RTD = Ezo_board(102, "RTD");  //Temperature, create a PH circuit object, who's
@@ -4,6 +4,8 @@
 
 #include <ArduinoJson.h>
 
+#include "sensor/generic/sensorMeasurement.h"
+
 #pragma pack(1)
 class PHSensorMessage {
 public:
@@ -14,6 +16,34 @@ public:
 
     PHSensorMessage(float temperature, float ph) : temperature(temperature), ph(ph) {}
 
+    static const uint8_t ValueCount = 2;
+
+    float getValue(uint8_t index) const {
+        switch (index) {
+            case 0:
+                return temperature;
+            case 1:
+                return ph;
+            default:
+                return SENSOR_MISSING_VALUE;
+        }
+    }
+
+    static MeasurementType getType(uint8_t index) {
+        switch (index) {
+            case 0:
+                return MeasurementSoilTemperature;
+            case 1:
+                return MeasurementSoilPH;
+            default:
+                return MeasurementCount;
+        }
+    }
+
+    static PHSensorMessage missing() {
+        return PHSensorMessage(SENSOR_MISSING_VALUE, SENSOR_MISSING_VALUE);
+    }
+
     void serialize(JsonArray& doc) {
         JsonObject tempObj = doc.createNestedObject();
         tempObj["measurement"] = temperature;
@@ -27,7 +27,7 @@ void SHT4xAirSensor::init() {
     // initialized = true;
 }
 
-SHT4xAirSensorMessage SHT4xAirSensor::read() {
+SHT4xAirSensorMessage SHT4xAirSensor::readSensor() {
     return SHT4xAirSensorMessage(-1, -1);
 
     // if (!initialized) {
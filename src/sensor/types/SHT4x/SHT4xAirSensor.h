@@ -2,15 +2,21 @@
 
 #include <Arduino.h>
 
+#include "sensor/generic/sensor.h"
+
 #include "SHT4xAirSensorMessage.h"
 
 // #include <SensirionI2CSht4x.h>
 
-class SHT4xAirSensor {
+class SHT4xAirSensor : public Sensor<SHT4xAirSensorMessage> {
 public:
-    void init();
+    SHT4xAirSensor()
+        : Sensor("SHT4x air", AIR_SENSOR_SAMPLE_EVERY, AIR_SENSOR_DEADBAND, AIR_SENSOR_TIMEOUT) {}
+
+    void init() override;
 
-    SHT4xAirSensorMessage read();
+protected:
+    SHT4xAirSensorMessage readSensor() override;
 
 private:
     // SensirionI2CSht4x sht4x;
@@ -4,6 +4,8 @@
 
 #include <ArduinoJson.h>
 
+#include "sensor/generic/sensorMeasurement.h"
+
 #pragma pack(1)
 class SHT4xAirSensorMessage {
 public:
@@ -15,6 +17,34 @@ public:
     SHT4xAirSensorMessage(float temperature, float humidity)
         : temperature(temperature), humidity(humidity) {}
 
+    static const uint8_t ValueCount = 2;
+
+    float getValue(uint8_t index) const {
+        switch (index) {
+            case 0:
+                return temperature;
+            case 1:
+                return humidity;
+            default:
+                return SENSOR_MISSING_VALUE;
+        }
+    }
+
+    static MeasurementType getType(uint8_t index) {
+        switch (index) {
+            case 0:
+                return MeasurementTemperature;
+            case 1:
+                return MeasurementHumidity;
+            default:
+                return MeasurementCount;
+        }
+    }
+
+    static SHT4xAirSensorMessage missing() {
+        return SHT4xAirSensorMessage(SENSOR_MISSING_VALUE, SENSOR_MISSING_VALUE);
+    }
+
     void serialize(JsonArray& doc) {
         JsonObject humObj = doc.createNestedObject();
         humObj["measurement"] = humidity;
@@ -9,7 +9,31 @@ void SoilHTSensor::init() {
     initialized = true;
 }
 
-SoilSensorMessage SoilHTSensor::read() {
+uint32_t SoilHTSensor::startConversion() {
+    notFound = false;
+
+    return 0;
+
+    // //Send RESET
+    // if (!ds.reset()) {
+    //     notFound = true;
+    //     return 0;
+    // }
+
+    // ds.skip();//Send ROM Command-Skip ROM
+    // ds.write(0x44);//Send Function command- convert T
+
+    // return 0;
+}
+
+bool SoilHTSensor::isConversionReady(uint32_t now) {
+    return true;
+
+    // // The sensor keeps the bus low until the conversion completes
+    // return notFound || ds.read_bit() != 0;
+}
+
+SoilSensorMessage SoilHTSensor::readSensor() {
     return SoilSensorMessage(-1, -1, -1);
 
     // if (!initialized) {
@@ -23,21 +47,11 @@ SoilSensorMessage SoilHTSensor::read() {
 
     // byte scratchpad[9];
 
-    // //Send RESET
-    // if (!ds.reset()) {
+    // if (notFound) {
     //     ESP_LOGE(SOIL_SENSOR_TAG, "No sensor found");
     //     return SoilSensorMessage(-1, -1, -1);
     // }
 
-    // ds.skip();//Send ROM Command-Skip ROM
-    // ds.write(0x44);//Send Function command- convert T
-
-    // ESP_LOGV(SOIL_SENSOR_TAG, "Waiting for conversion to complete");
-    // while (ds.read_bit() == 0) {
-    //     vTaskDelay(10 / portTICK_PERIOD_MS);
-    // }
-    // ESP_LOGV(SOIL_SENSOR_TAG, "Conversion complete");
-
     // ds.reset();//Send RESET
     // ds.skip();//Send ROM Command-Skip ROM
     // ds.write(0xBE);//Send Function command- Read Scratchpad
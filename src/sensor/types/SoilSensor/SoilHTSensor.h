@@ -6,20 +6,33 @@
 
 #include "config.h"
 
+#include "sensor/generic/sensor.h"
+
 #include "SoilSensorMessage.h"
 
 // PIN 12:
 // https://github.com/INFWIN/mt05s-demo/blob/main/sourcecode/MT05S_ArduinoIDE_DOIT_ESP32_DevKit_V1/MT05S_ArduinoIDE_ESP32_DoIt_DevKit_V1.ino
 
 
-class SoilHTSensor {
+class SoilHTSensor : public Sensor<SoilSensorMessage> {
 public:
-    void init();
+    SoilHTSensor()
+        : Sensor("Soil", SOIL_SENSOR_SAMPLE_EVERY, SOIL_SENSOR_DEADBAND, SOIL_SENSOR_TIMEOUT) {}
+
+    void init() override;
+
+protected:
+    uint32_t startConversion() override;
 
-    SoilSensorMessage read();
+    bool isConversionReady(uint32_t now) override;
+
+    SoilSensorMessage readSensor() override;
 
 private:
     OneWire ds = OneWire(SOIL_SENSOR_PIN);
 
     bool initialized = false;
+
+    // The sensor did not answer the reset of the conversion
+    bool notFound = false;
 };
@@ -4,6 +4,8 @@
 
 #include <ArduinoJson.h>
 
+#include "sensor/generic/sensorMeasurement.h"
+
 #pragma pack(1)
 class SoilSensorMessage {
 public:
@@ -16,6 +18,38 @@ public:
     SoilSensorMessage(int16_t temperature, int16_t moisture, int16_t conductivity)
         : temperature(temperature), moisture(moisture), conductivity(conductivity) {}
 
+    static const uint8_t ValueCount = 3;
+
+    float getValue(uint8_t index) const {
+        switch (index) {
+            case 0:
+                return temperature;
+            case 1:
+                return moisture;
+            case 2:
+                return conductivity;
+            default:
+                return SENSOR_MISSING_VALUE;
+        }
+    }
+
+    static MeasurementType getType(uint8_t index) {
+        switch (index) {
+            case 0:
+                return MeasurementSoilTemperatureLowRes;
+            case 1:
+                return MeasurementSoilMoisture;
+            case 2:
+                return MeasurementSoilConductivity;
+            default:
+                return MeasurementCount;
+        }
+    }
+
+    static SoilSensorMessage missing() {
+        return SoilSensorMessage(SENSOR_MISSING_VALUE, SENSOR_MISSING_VALUE, SENSOR_MISSING_VALUE);
+    }
+
     void serialize(JsonArray& doc) {
         JsonObject tempObj = doc.createNestedObject();
         tempObj["measurement"] = temperature;
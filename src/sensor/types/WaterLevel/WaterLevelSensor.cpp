@@ -50,7 +50,16 @@ void WaterLevelSensor::init() {
     // vl53.stopRanging();
 }
 
-WaterLevelSensorMessage WaterLevelSensor::read() {
+uint32_t WaterLevelSensor::startConversion() {
+    if (!initialized)
+        return 0;
+
+    // vl53.startRanging();
+
+    return WATER_LEVEL_SENSOR_CONVERSION;
+}
+
+WaterLevelSensorMessage WaterLevelSensor::readSensor() {
     return WaterLevelSensorMessage(-1);
 
     // if (!initialized) {
@@ -58,10 +67,6 @@ WaterLevelSensorMessage WaterLevelSensor::read() {
     //     return WaterLevelSensorMessage(-1);
     // }
 
-    // vl53.startRanging();
-
-    // vTaskDelay(600 / portTICK_PERIOD_MS);
-
     // float distance = -1;
     // if (vl53.dataReady()) {
     //     // new measurement for the taking!
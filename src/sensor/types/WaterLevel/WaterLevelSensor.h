@@ -4,13 +4,22 @@
 
 // #include "Adafruit_VL53L1X.h"
 
+#include "sensor/generic/sensor.h"
+
 #include "WaterLevelSensorMessage.h"
 
-class WaterLevelSensor {
+class WaterLevelSensor : public Sensor<WaterLevelSensorMessage> {
 public:
-    void init();
+    WaterLevelSensor()
+        : Sensor("Water level", WATER_LEVEL_SENSOR_SAMPLE_EVERY, WATER_LEVEL_SENSOR_DEADBAND,
+                 WATER_LEVEL_SENSOR_TIMEOUT) {}
+
+    void init() override;
+
+protected:
+    uint32_t startConversion() override;
 
-    WaterLevelSensorMessage read();
+    WaterLevelSensorMessage readSensor() override;
 
 private:
     // Adafruit_VL53L1X vl53 = Adafruit_VL53L1X();
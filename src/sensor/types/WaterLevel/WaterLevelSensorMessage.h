@@ -4,6 +4,8 @@
 
 #include <ArduinoJson.h>
 
+#include "sensor/generic/sensorMeasurement.h"
+
 #pragma pack(1)
 class WaterLevelSensorMessage {
 public:
@@ -13,6 +15,16 @@ public:
 
     WaterLevelSensorMessage(float distance) : distance(distance) {}
 
+    static const uint8_t ValueCount = 1;
+
+    float getValue(uint8_t index) const { return distance; }
+
+    static MeasurementType getType(uint8_t index) { return MeasurementWaterLevel; }
+
+    static WaterLevelSensorMessage missing() {
+        return WaterLevelSensorMessage(SENSOR_MISSING_VALUE);
+    }
+
     void serialize(JsonArray& doc) {
         JsonObject distObj = doc.createNestedObject();
         distObj["measurement"] = distance;
@@ -1,14 +1,20 @@
 #include "sim.h"
 
+#include "mbedtls/base64.h"
+
 static const char* SIM_TAG = "Sim";
 
 void Sim::init() {
     service = new SimulatorService();
+    stateStore.init();
     createSimTask();
+    createBackgroundTask();
     start();
 }
 
 String Sim::start() {
+    stateStore.resetStats();
+
     if (LOG_MESHER == true) {
         if (service != nullptr) {
             service->startSimulation();
@@ -37,13 +43,63 @@ String Sim::getJSON(DataMessage* message) {
 
     simMessage->serialize(data);
 
+    if (simMessage->simCommand != SimCommand::StateChunk) {
+        String json;
+        serializeJson(doc, json);
+
+        return json;
+    }
+
+    // The binary chunk travels as base64
+    size_t chunkSize = simMessage->messageSize - (sizeof(SimMessage) - sizeof(DataMessageGeneric));
+    size_t encodedSize = 0;
+    mbedtls_base64_encode(NULL, 0, &encodedSize, simMessage->payload, chunkSize);
+
+    unsigned char* encoded = (unsigned char*)pvPortMalloc(encodedSize);
+    if (encoded == nullptr)
+        return "";
+
+    mbedtls_base64_encode(encoded, encodedSize, &encodedSize, simMessage->payload, chunkSize);
+    data["chunk"] = (const char*)encoded;
+
     String json;
     serializeJson(doc, json);
 
+    vPortFree(encoded);
+
     return json;
 }
 
 DataMessage* Sim::getDataMessage(JsonObject data) {
+    if (data["simCommand"] == SimCommand::UploadAck) {
+        uint32_t messageSize = sizeof(SimMessage) + sizeof(SimUploadAck);
+        SimMessage* simMessage = (SimMessage*)pvPortMalloc(messageSize);
+
+        simMessage->deserialize(data);
+        simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+        SimUploadAck ack = {data["run"], data["seq"]};
+        memcpy(simMessage->payload, &ack, sizeof(SimUploadAck));
+
+        return ((DataMessage*)simMessage);
+    }
+
+    if (data["simCommand"] == SimCommand::SetRunSpec) {
+        uint32_t messageSize = sizeof(SimMessage) + sizeof(SimRunSpec);
+        SimMessage* simMessage = (SimMessage*)pvPortMalloc(messageSize);
+
+        simMessage->deserialize(data);
+        simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+        // The fields not in the JSON keep the value of the current spec
+        SimRunSpec spec = getRunSpec();
+        JsonObject specData = data["spec"];
+        spec.deserialize(specData);
+        memcpy(simMessage->payload, &spec, sizeof(SimRunSpec));
+
+        return ((DataMessage*)simMessage);
+    }
+
     SimMessage* simMessage = new SimMessage();
 
     simMessage->deserialize(data);
@@ -63,6 +119,24 @@ void Sim::processReceivedMessage(messagePort port, DataMessage* message) {
         case SimCommand::StopSim:
             stop();
             break;
+        case SimCommand::SetRunSpec: {
+            if (simMessage->messageSize < sizeof(SimMessage) - sizeof(DataMessageGeneric) +
+                                              sizeof(SimRunSpec)) {
+                ESP_LOGW(SIM_TAG, "Run spec too short");
+                break;
+            }
+
+            SimRunSpec spec;
+            memcpy(&spec, simMessage->payload, sizeof(SimRunSpec));
+            ESP_LOGI(SIM_TAG, "%s", setRunSpec(spec).c_str());
+            break;
+        }
+        case SimCommand::UploadAck: {
+            SimUploadAck ack;
+            memcpy(&ack, simMessage->payload, sizeof(SimUploadAck));
+            processUploadAck(ack);
+            break;
+        }
         default:
             break;
     }
@@ -77,12 +151,138 @@ void Sim::createSimTask() {
                 &sim_TaskHandle); /* Task handle to keep track of created task */
 }
 
+void Sim::createBackgroundTask() {
+    xTaskCreate(backgroundLoop,          /* Task function. */
+                "SimBackgroundTask",     /* name of task. */
+                4096,                    /* Stack size of task */
+                (void*)1,                /* parameter of the task */
+                2,                       /* priority of the task */
+                &background_TaskHandle); /* Task handle to keep track of created task */
+}
+
+void Sim::backgroundLoop(void* pvParameters) {
+    Sim& sim = Sim::getInstance();
+
+    for (;;) {
+        vTaskDelay(SIM_STATE_DRAIN_INTERVAL / portTICK_PERIOD_MS);
+        sim.drainStates();
+
+        if (millis() - sim.lastFlowReport >= SIM_FLOW_REPORT_INTERVAL) {
+            sim.lastFlowReport = millis();
+            sim.sendFlowReports();
+        }
+    }
+}
+
+void Sim::drainStates() {
+    if (service == nullptr)
+        return;
+
+    LM_LinkedList<LM_State>* states = service->statesList;
+
+    states->setInUse();
+
+    while (states->getLength() > 0) {
+        LM_State* state = states->Pop();
+        if (state == nullptr)
+            break;
+
+        stateStore.capture(state);
+        delete state;
+    }
+
+    states->releaseInUse();
+}
+
+String Sim::getStatesStats() {
+    return stateStore.getStatsString();
+}
+
+void Sim::processGatewayMessage(DataMessage* message) {
+    SimMessage* simMessage = (SimMessage*)message;
+    if (simMessage->simCommand != SimCommand::Payload)
+        return;
+
+    uint64_t receivedAt =
+        TimeSyncService::getInstance().isSynced() ? TimeSyncService::getInstance().getTime() : 0;
+
+    SimPayloadMessage* payload = simMessage->getPayloadMessage();
+    if (payload == nullptr) {
+        flowMonitor.observe(simMessage->addrSrc, 0, 0, false, 0, 0);
+        return;
+    }
+
+    bool valid = payload->computeCrc() == payload->crc;
+
+    flowMonitor.observe(simMessage->addrSrc, payload->run, payload->seq, valid, payload->sentAt,
+                        receivedAt);
+}
+
+String Sim::getFlows() {
+    return flowMonitor.toString();
+}
+
+void Sim::sendFlowReports() {
+    SimFlowSummary summaries[SIM_FLOW_MAX];
+    uint8_t count = flowMonitor.takeSummaries(summaries);
+
+    // In batches that fit in the JSON document of getJSON
+    for (uint8_t first = 0; first < count; first += SIM_FLOW_REPORT_BATCH) {
+        uint8_t batch = std::min<uint8_t>(SIM_FLOW_REPORT_BATCH, count - first);
+
+        uint32_t messageSize =
+            sizeof(SimMessage) + sizeof(SimFlowReport) + batch * sizeof(SimFlowSummary);
+        SimMessage* simMessage = (SimMessage*)pvPortMalloc(messageSize);
+        if (simMessage == nullptr)
+            return;
+
+        simMessage->simCommand = SimCommand::FlowReport;
+        simMessage->appPortDst = appPort::MQTTApp;
+        simMessage->appPortSrc = appPort::SimApp;
+        simMessage->addrSrc = LoraMesher::getInstance().getLocalAddress();
+        simMessage->addrDst = 0;
+        simMessage->messageId = 0;
+        simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+        SimFlowReport* report = (SimFlowReport*)simMessage->payload;
+        report->count = batch;
+        memcpy(report->flows, &summaries[first], batch * sizeof(SimFlowSummary));
+
+        MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage,
+                                                  DeliveryMode::Reliable);
+
+        vPortFree(simMessage);
+    }
+}
+
 void Sim::simLoop(void* pvParameters) {
     ESP_LOGI(SIM_TAG, "Simulator started");
-    Sim sim = Sim::getInstance();
+    Sim& sim = Sim::getInstance();
+    bool firstRun = true;
 
     for (;;) {
-        sim.sendStartSimMessage();
+        // The states of a failed upload are sent with their own run before the next run stores
+        // new ones. If they still can not be uploaded they are dropped, the server sees the run
+        // incomplete from its total.
+        if (sim.uploadFirst < sim.uploadTotal && !sim.uploadStates()) {
+            ESP_LOGW(SIM_TAG, "Simulator dropping %d states of run %d not uploaded",
+                     sim.uploadTotal - sim.uploadFirst, sim.uploadRun);
+            sim.stateStore.remove(sim.stateStore.getLength());
+            sim.uploadFirst = sim.uploadTotal;
+        }
+
+        SimRunSpec spec = sim.getRunSpec();
+        uint16_t localAddress = LoraMesher::getInstance().getLocalAddress();
+
+        // The first run starts with init
+        if (!firstRun)
+            sim.start();
+        firstRun = false;
+        sim.run++;
+
+        ESP_LOGI(SIM_TAG, "Simulator run: %s", spec.toString().c_str());
+
+        sim.sendStartSimMessage(spec.wifiAddress);
 
         vTaskDelay(HELLO_PACKETS_DELAY * SIM_NETWORK_PROPAGATION_MULTIPLIER * 1000 /
                    portTICK_PERIOD_MS);  // Wait to propagate all the network status
@@ -90,28 +290,28 @@ void Sim::simLoop(void* pvParameters) {
         ESP_LOGI(SIM_TAG, "Heap size start sim: %d", ESP.getFreeHeap());
 
 
-#if ONE_SENDER != 0
-        if (LoraMesher::getInstance().getLocalAddress() == ONE_SENDER) {
-            while (LoraMesher::getInstance().getClosestGateway() == nullptr) {
+        if (spec.isSender(localAddress)) {
+            vTaskDelay(spec.getStartOffset(localAddress) / portTICK_PERIOD_MS);
+
+            // The chosen senders wait for a route, as ONE_SENDER did
+            while (spec.senderCount > 0 &&
+                   LoraMesher::getInstance().getClosestGateway() == nullptr) {
                 vTaskDelay(1000 / portTICK_PERIOD_MS);  // Wait 1 second
             }
-            sim.sendPacketsToServer(PACKET_COUNT, PACKET_SIZE, PACKET_DELAY);
+            sim.sendPacketsToServer(spec);
         } else {
             vTaskDelay(SIM_NON_SENDER_WAIT /
                        portTICK_PERIOD_MS);  // Wait to avoid other messages to propagate
-            vTaskDelay(PACKET_DELAY * PACKET_COUNT / portTICK_PERIOD_MS);
+            vTaskDelay(spec.getDuration() / portTICK_PERIOD_MS);
         }
-#else
-        sim.sendPacketsToServer(PACKET_COUNT, PACKET_SIZE, PACKET_DELAY);
-#endif
 
 
         ESP_LOGI(SIM_TAG, "Simulator stopped");
 
         while (LoRaMeshService::getInstance().hasActiveConnections()) {
             ESP_LOGI(SIM_TAG, "Simulator waiting for connections to be closed");
-            vTaskDelay(PACKET_DELAY * 1.5 /
-                       portTICK_PERIOD_MS);  // Wait PACKET_DELAY * 1.5 milliseconds
+            vTaskDelay(spec.interval * 1.5 /
+                       portTICK_PERIOD_MS);  // Wait 1.5 intervals
         }
 
         sim.stop();
@@ -134,7 +334,9 @@ void Sim::simLoop(void* pvParameters) {
 
         sim.sendAllData();
 
-        vTaskDelete(NULL);
+        // A sweep continues with the next spec
+        ESP_LOGI(SIM_TAG, "Simulator waiting for the next run spec");
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 }
 
@@ -143,77 +345,179 @@ void Sim::sendAllData() {
 
     SimMessage* simMessage = createSimMessage(SimCommand::EndedSimulation);
 
-    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage);
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage,
+                                              DeliveryMode::Reliable);
 
     delete simMessage;
 
-    service->statesList->setInUse();
+    // The records captured since the last drain
+    drainStates();
 
-    if (service->statesList->moveToStart()) {
-        ESP_LOGI(SIM_TAG, "Simulator sending data, n. %d", service->statesList->getLength());
-        do {
-            LM_State* state = service->statesList->Pop();
-            if (state == nullptr) {
-                continue;
-            }
+    ESP_LOGI(SIM_TAG, "%s", stateStore.getStatsString().c_str());
 
-            simMessage = createSimMessage(state);
+    beginUpload();
+    uploadStates();
 
-            MessageManager::getInstance().sendMessage(messagePort::MqttPort,
-                                                      (DataMessage*)simMessage);
-            delete state;
-            vPortFree(simMessage);
+    ESP_LOGI(SIM_TAG, "Simulator Finished sending data");
 
-            // If wifi connected wait configured delay, else wait longer to avoid flooding
-            if (WiFi.status() == WL_CONNECTED)
-                vTaskDelay(SIM_UPLOAD_DELAY_CONNECTED /
-                           portTICK_PERIOD_MS);  // Wait between uploads when connected
-            else
-                vTaskDelay(SIM_UPLOAD_DELAY_DISCONNECTED /
-                           portTICK_PERIOD_MS);  // Wait longer when disconnected to avoid flooding
+    uint32_t messageSize = sizeof(SimMessage) + sizeof(SimStateStoreStats);
+    simMessage = (SimMessage*)pvPortMalloc(messageSize);
+    if (simMessage == nullptr)
+        return;
 
-        } while (service->statesList->getLength() > 0);
-    }
+    simMessage->simCommand = SimCommand::EndedSimulationStatus;
+    simMessage->appPortDst = appPort::MQTTApp;
+    simMessage->appPortSrc = appPort::SimApp;
+    simMessage->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    simMessage->addrDst = 0;
+    simMessage->messageId = 0;
 
-    service->statesList->releaseInUse();
+    // The server knows how many records of the run were lost
+    simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
+    SimStateStoreStats stats = stateStore.getStats();
+    memcpy(simMessage->payload, &stats, sizeof(SimStateStoreStats));
 
-    ESP_LOGI(SIM_TAG, "Simulator Finished sending data");
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage,
+                                              DeliveryMode::Reliable);
 
-    simMessage = createSimMessage(SimCommand::EndedSimulationStatus);
+    vPortFree(simMessage);
+}
 
-    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage);
+void Sim::beginUpload() {
+    uploadRun = run;
+    uploadSeq = 0;
+    uploadFirst = 0;
+    uploadTotal = stateStore.getLength();
+}
 
-    delete simMessage;
+bool Sim::uploadStates() {
+    ESP_LOGI(SIM_TAG, "Simulator uploading states %d to %d of run %d", uploadFirst, uploadTotal,
+             uploadRun);
+
+    SimMessage* chunkMessage =
+        (SimMessage*)pvPortMalloc(sizeof(SimMessage) + SIM_UPLOAD_CHUNK_SIZE);
+    if (chunkMessage == nullptr)
+        return false;
+
+    chunkMessage->simCommand = SimCommand::StateChunk;
+    chunkMessage->appPortDst = appPort::MQTTApp;
+    chunkMessage->appPortSrc = appPort::SimApp;
+    chunkMessage->addrSrc = LoraMesher::getInstance().getLocalAddress();
+
+    ackedSeq = (int32_t)uploadSeq - 1;
+
+    bool uploaded = true;
+
+    while (uploadFirst < uploadTotal) {
+        SimStateChunk chunk(chunkMessage->payload, uploadRun, uploadSeq, uploadFirst,
+                            uploadTotal);
+
+        // The records stay in the store until the server confirms the chunk
+        LM_State state;
+        for (uint32_t index = 0; uploadFirst + index < uploadTotal; index++) {
+            if (!stateStore.get(index, &state) || !chunk.add(&state))
+                break;
+        }
+
+        if (chunk.getCount() == 0)
+            break;
+
+        chunkMessage->messageId = uploadSeq;
+        chunkMessage->messageSize =
+            sizeof(SimMessage) - sizeof(DataMessageGeneric) + chunk.getSize();
+
+        if (!sendChunk(chunkMessage, uploadSeq)) {
+            ESP_LOGW(SIM_TAG, "Simulator upload interrupted at state %d of %d", uploadFirst,
+                     uploadTotal);
+            uploaded = false;
+            break;
+        }
+
+        stateStore.remove(chunk.getCount());
+
+        uploadFirst += chunk.getCount();
+        uploadSeq++;
+    }
+
+    vPortFree(chunkMessage);
+
+    return uploaded;
 }
 
-SimMessage* Sim::createSimMessage(LM_State* state) {
-    uint32_t messageSize = sizeof(SimMessage) + sizeof(SimMessageState);
+bool Sim::sendChunk(SimMessage* chunkMessage, uint16_t seq) {
+    for (uint8_t attempt = 0; attempt < SIM_UPLOAD_MAX_RETRIES; attempt++) {
+        // Resume when the node has a way to the server again
+        if (!MqttService::getInstance().connect() &&
+            LoraMesher::getInstance().getClosestGateway() == nullptr) {
+            vTaskDelay(SIM_UPLOAD_DELAY_DISCONNECTED / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        // Forget the acks of the previous attempts
+        xSemaphoreTake(uploadAckSemaphore, 0);
 
-    SimMessage* simMessage = (SimMessage*)pvPortMalloc(messageSize);
+        // The server answers through the gateway in addrDst, set again when sent by LoRa
+        chunkMessage->addrDst = 0;
 
-    simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
-    simMessage->simCommand = SimCommand::Message;
+        // Acknowledged by the server with an UploadAck
+        MessageManager::getInstance().sendMessage(
+            messagePort::MqttPort, (DataMessage*)chunkMessage, DeliveryMode::Unreliable);
 
-    memcpy(simMessage->payload, state, sizeof(SimMessageState));
+        uint32_t sentAt = millis();
+        while (ackedSeq < seq) {
+            // Read the clock once, the wait never wraps around when the timeout just expired
+            uint32_t elapsed = millis() - sentAt;
+            uint32_t remaining =
+                elapsed < SIM_UPLOAD_ACK_TIMEOUT ? SIM_UPLOAD_ACK_TIMEOUT - elapsed : 0;
+            if (remaining == 0)
+                break;
 
-    simMessage->appPortDst = appPort::MQTTApp;
-    simMessage->appPortSrc = appPort::SimApp;
-    simMessage->addrSrc = LoraMesher::getInstance().getLocalAddress();
-    simMessage->addrDst = 0;
-    simMessage->messageId = state->id;
+            xSemaphoreTake(uploadAckSemaphore, remaining / portTICK_PERIOD_MS);
+        }
 
-    return simMessage;
+        if (ackedSeq >= seq)
+            return true;
+
+        ESP_LOGW(SIM_TAG, "Simulator chunk %d not confirmed, attempt %d", seq, attempt + 1);
+        vTaskDelay(SIM_UPLOAD_DELAY_CONNECTED / portTICK_PERIOD_MS);
+    }
+
+    return false;
 }
 
-void Sim::sendPacketsToServer(size_t packetCount, size_t packetSize, size_t delayMs) {
-    SimMessage* simPayloadMessage = createSimPayloadMessage(packetSize);
-    for (size_t i = 0; i < packetCount; i++) {
+void Sim::processUploadAck(SimUploadAck& ack) {
+    if (ack.run != uploadRun)
+        return;
+
+    if ((int32_t)ack.seq > ackedSeq)
+        ackedSeq = ack.seq;
+
+    xSemaphoreGive(uploadAckSemaphore);
+}
+
+void Sim::sendPacketsToServer(SimRunSpec& spec) {
+    SimMessage* simPayloadMessage = createSimPayloadMessage(spec.maxSize);
+    SimPayloadMessage* payload = (SimPayloadMessage*)simPayloadMessage->payload;
+
+    for (size_t i = 0; i < spec.packetCount; i++) {
+        uint16_t packetSize = spec.getPacketSize();
+        payload->packetSize = packetSize;
+        simPayloadMessage->messageSize = sizeof(SimMessage) + sizeof(SimPayloadMessage) +
+                                         packetSize - sizeof(DataMessageGeneric);
+
+        payload->run = run;
+        payload->seq = i;
+        payload->sentAt = TimeSyncService::getInstance().isSynced()
+                              ? TimeSyncService::getInstance().getTime()
+                              : 0;
+        payload->crc = payload->computeCrc();
+
         simPayloadMessage->messageId = i;
-        ESP_LOGI(SIM_TAG, "Simulator sending packet %d", i);
+        ESP_LOGI(SIM_TAG, "Simulator sending packet %d of %d bytes", i, packetSize);
         MessageManager::getInstance().sendMessage(messagePort::MqttPort,
                                                   (DataMessage*)simPayloadMessage);
 
-        vTaskDelay(delayMs / portTICK_PERIOD_MS);  // Wait delayMs milliseconds
+        vTaskDelay(spec.getNextDelay(i + 1) / portTICK_PERIOD_MS);
 
         // Wait until the previous packet has been sent
         while (LoRaMeshService::getInstance().queueWaitingSendPacketsLength() > 3) {
@@ -247,9 +551,6 @@ SimMessage* Sim::createSimPayloadMessage(size_t packetSize) {
     // Add 0, 1, 2, 3... packetSize to the payload
     for (size_t i = 0; i < packetSize; i++) {
         simPayloadMessage->payload[i] = i;
-        if (i % 100 == 0) {
-            vTaskDelay(1 / portTICK_PERIOD_MS);  // Wait 1 milliseconds
-        }
     }
 
     return simMessage;
@@ -270,7 +571,7 @@ SimMessage* Sim::createSimMessage(SimCommand command) {
     return simMessage;
 }
 
-void Sim::sendStartSimMessage() {
+void Sim::sendStartSimMessage(uint16_t wifiAddress) {
     WiFiServerService::getInstance().addSSID(WIFI_SSID);
     WiFiServerService::getInstance().addPassword(WIFI_PASSWORD);
 
@@ -287,21 +588,58 @@ void Sim::sendStartSimMessage() {
 
     SimMessage* simMessage = createSimMessage(SimCommand::StartingSimulation);
 
-    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage);
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage,
+                                              DeliveryMode::Reliable);
 
     delete simMessage;
 
     vTaskDelay(SIM_POST_START_DELAY / portTICK_PERIOD_MS);  // Wait after sending start message
 
-#if WIFI_ADDR_CONNECTED == 0
-    return;
-#endif
+    if (wifiAddress == 0)
+        return;
 
     // Delete WiFi and MQTT
-    if (LoraMesher::getInstance().getLocalAddress() == WIFI_ADDR_CONNECTED)
+    if (LoraMesher::getInstance().getLocalAddress() == wifiAddress)
         return;
 
     MqttService::getInstance().disconnect();
     WiFiServerService::getInstance().disconnectWiFi();
     WiFiServerService::getInstance().resetWiFiData();
 }
+
+String Sim::setRunSpec(SimRunSpec& spec) {
+    String error = spec.validate();
+    if (error.length() > 0)
+        return "Run spec not set: " + error;
+
+    xSemaphoreTake(runSpecMutex, portMAX_DELAY);
+    runSpec = spec;
+    xSemaphoreGive(runSpecMutex);
+
+    if (sim_TaskHandle != NULL)
+        xTaskNotifyGive(sim_TaskHandle);
+
+    return "Next run: " + spec.toString();
+}
+
+String Sim::setRunSpec(String args) {
+    SimRunSpec spec = getRunSpec();
+
+    args.trim();
+    if (args.length() == 0)
+        return spec.toString();
+
+    String error = spec.parse(args);
+    if (error.length() > 0)
+        return "Run spec not set: " + error;
+
+    return setRunSpec(spec);
+}
+
+SimRunSpec Sim::getRunSpec() {
+    xSemaphoreTake(runSpecMutex, portMAX_DELAY);
+    SimRunSpec spec = runSpec;
+    xSemaphoreGive(runSpecMutex);
+
+    return spec;
+}
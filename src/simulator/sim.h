@@ -14,6 +14,16 @@
 
 #include "simMessage.h"
 
+#include "simRunSpec.h"
+
+#include "simStateChunk.h"
+
+#include "simStateStore.h"
+
+#include "simFlowMonitor.h"
+
+#include "time/timeSyncService.h"
+
 #include "LoraMesher.h"
 
 #include "WiFi.h"
@@ -55,12 +65,53 @@ public:
 
     void processReceivedMessage(messagePort port, DataMessage* message);
 
-    void sendPacketsToServer(size_t packetCount, size_t packetSize, size_t delayMs);
+    /**
+     * @brief Measure the Sim packets relayed by this gateway
+     *
+     */
+    void processGatewayMessage(DataMessage* message);
+
+    /**
+     * @brief Send the Sim packets of a run to the server
+     *
+     */
+    void sendPacketsToServer(SimRunSpec& spec);
+
+    /**
+     * @brief Set the traffic of the next run. If the simulator is waiting between runs, the run
+     * starts, otherwise it starts when the current one finishes.
+     *
+     * @return String The spec or the error
+     */
+    String setRunSpec(SimRunSpec& spec);
+
+    /**
+     * @brief Change the fields of the run spec given as "key=value" arguments, see
+     * SimRunSpec::parse. Without arguments it only shows the current spec.
+     *
+     */
+    String setRunSpec(String args);
+
+    SimRunSpec getRunSpec();
+
+    /**
+     * @brief Records captured, spilled to flash and dropped in the current run
+     *
+     */
+    String getStatesStats();
+
+    /**
+     * @brief Flows measured by this gateway
+     *
+     */
+    String getFlows();
 
 private:
     Sim() : MessageService(SimApp, "Sim") {
         simCommandService = new SimCommandService();
         commandService = simCommandService;
+        runSpecMutex = xSemaphoreCreateMutex();
+        uploadAckSemaphore = xSemaphoreCreateBinary();
     };
 
     TaskHandle_t sim_TaskHandle = NULL;
@@ -69,15 +120,89 @@ private:
 
     static void simLoop(void*);
 
+    TaskHandle_t background_TaskHandle = NULL;
+
+    void createBackgroundTask();
+
+    /**
+     * @brief Drain the states and send the flow reports
+     *
+     */
+    static void backgroundLoop(void*);
+
+    /**
+     * @brief Move the records of the LoRaMesher list to the store, so the list does not grow
+     * during the run
+     *
+     */
+    void drainStates();
+
+    SimStateStore stateStore;
+
+    SimFlowMonitor flowMonitor;
+
+    uint32_t lastFlowReport = 0;
+
+    /**
+     * @brief Send the summaries of the flows with packets since the previous report
+     *
+     */
+    void sendFlowReports();
+
     bool running = false;
 
+    SimRunSpec runSpec = SimRunSpec::getDefault();
+
+    SemaphoreHandle_t runSpecMutex = NULL;
+
+    // Runs since boot, the uploads of different runs do not mix
+    uint8_t run = 0;
+
+    // Upload of the state log, the stored records belong to uploadRun. A failed upload is
+    // resumed with the same run and sequence numbers before the next run stores records.
+    uint8_t uploadRun = 0;
+    uint16_t uploadSeq = 0;
+    uint32_t uploadFirst = 0;  // Index in the run of the oldest stored record
+    uint32_t uploadTotal = 0;  // Records of the run
+
+    // Last chunk of the upload confirmed by the server, -1 none
+    volatile int32_t ackedSeq = -1;
+
+    SemaphoreHandle_t uploadAckSemaphore = NULL;
+
     void sendAllData();
 
-    SimMessage* createSimMessage(LM_State* state);
+    /**
+     * @brief Start the upload of the records of the current run
+     *
+     */
+    void beginUpload();
+
+    /**
+     * @brief Upload the state log in SimStateChunk chunks, one at a time, each one confirmed by
+     * the server before its records are freed. It resumes from the unconfirmed chunk after a
+     * disconnection, or when called again after a failed upload.
+     *
+     * @return true If every record has been confirmed
+     */
+    bool uploadStates();
+
+    /**
+     * @brief Send a chunk until the server confirms it or SIM_UPLOAD_MAX_RETRIES attempts
+     *
+     */
+    bool sendChunk(SimMessage* chunkMessage, uint16_t seq);
+
+    void processUploadAck(SimUploadAck& ack);
 
     SimMessage* createSimPayloadMessage(size_t packetSize);
 
     SimMessage* createSimMessage(SimCommand command);
 
-    void sendStartSimMessage();
+    /**
+     * @brief Announce the start of a run over MQTT
+     *
+     * @param wifiAddress Node that keeps the WiFi during the run, the others disconnect
+     */
+    void sendStartSimMessage(uint16_t wifiAddress);
 };
\ No newline at end of file
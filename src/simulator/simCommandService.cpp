@@ -11,4 +11,22 @@ SimCommandService::SimCommandService() {
     //     [this](String args) {
     //     return String(Sim::getInstance().stop());
     // }));
-}
\ No newline at end of file
+
+    addCommand(Command("/simSpec",
+                       "Show or set the traffic of the next Sim run: senders=<hex>,<hex>|all "
+                       "arrival=periodic|poisson|bursty count interval burst gap "
+                       "size=<n>|<min>-<max> offset stagger wifi=<hex>",
+                       SimCommand::SetRunSpec, 1,
+                       [this](String args) { return Sim::getInstance().setRunSpec(args); }));
+
+    addCommand(Command("/simStates",
+                       "Show the Sim states captured, spilled to flash and dropped in this run",
+                       SimCommand::EndedSimulationStatus, 1,
+                       [this](String args) { return Sim::getInstance().getStatesStats(); }));
+
+    addCommand(Command("/simFlows",
+                       "Show the loss, reordering, corruption and delay of the Sim flows relayed "
+                       "by this gateway",
+                       SimCommand::FlowReport, 1,
+                       [this](String args) { return Sim::getInstance().getFlows(); }));
+}
@@ -0,0 +1,195 @@
+#include "simFlowMonitor.h"
+
+void SimFlow::reset(uint16_t src, uint8_t run) {
+    *this = SimFlow();
+    this->src = src;
+    this->run = run;
+}
+
+uint32_t SimFlow::getLost() {
+    if (firstSeq < 0)
+        return 0;
+
+    uint32_t expected = highestSeq - firstSeq + 1;
+    return expected > received ? expected - received : 0;
+}
+
+void SimFlow::summarize(SimFlowSummary& summary) {
+    summary.src = src;
+    summary.run = run;
+    summary.received = received;
+    summary.firstSeq = firstSeq < 0 ? 0 : firstSeq;
+    summary.lost = getLost();
+    summary.reordered = reordered;
+    summary.duplicated = duplicated;
+    summary.corrupted = corrupted;
+    summary.unsynced = unsynced;
+    summary.delayCount = delay.getCount();
+    summary.delayMin = delay.getMin();
+    summary.delayMean = delay.getMean();
+    summary.delayP50 = delay.getPercentile(50);
+    summary.delayP95 = delay.getPercentile(95);
+    summary.delayMax = delay.getMax();
+    summary.flags = flags;
+}
+
+SimFlowMonitor::SimFlowMonitor() {
+    mutex = xSemaphoreCreateMutex();
+}
+
+void SimFlowMonitor::observe(uint16_t src, uint8_t run, uint32_t seq, bool valid,
+                             uint64_t sentAt, uint64_t receivedAt) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    SimFlow& flow = getFlow(src, run, valid);
+    flow.changed = true;
+    flow.lastSeen = millis();
+
+    if (!valid) {
+        flow.corrupted++;
+        xSemaphoreGive(mutex);
+        return;
+    }
+
+    uint32_t duplicated = flow.duplicated;
+    observeSeq(flow, seq);
+
+    // A clock error larger than the delay is counted as 0
+    if (flow.duplicated == duplicated) {
+        if (sentAt == 0 || receivedAt == 0)
+            flow.unsynced++;
+        else
+            flow.delay.add(receivedAt > sentAt ? receivedAt - sentAt : 0);
+    }
+
+    xSemaphoreGive(mutex);
+}
+
+uint8_t SimFlowMonitor::takeSummaries(SimFlowSummary* summaries) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < flowCount; i++) {
+        if (!flows[i].changed)
+            continue;
+
+        flows[i].summarize(summaries[count]);
+        summaries[count++].evictions = evictions;
+        flows[i].delay.reset();
+        flows[i].changed = false;
+    }
+
+    xSemaphoreGive(mutex);
+
+    return count;
+}
+
+String SimFlowMonitor::toString() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    String status = "--- Sim flows ---\n";
+    if (flowCount == 0)
+        status += "No flows\n";
+    if (evictions > 0)
+        status += "Evicted " + String(evictions) + " flows, more senders than " +
+                  String(SIM_FLOW_MAX) + "\n";
+
+    for (uint8_t i = 0; i < flowCount; i++) {
+        SimFlow& flow = flows[i];
+        status += String(flow.src, HEX) + " run " + String(flow.run) + " from " +
+                  String(flow.firstSeq) + (flow.flags & SimFlowRestarted ? " (restarted)" : "") +
+                  ": received " + String(flow.received) + ", lost " + String(flow.getLost()) +
+                  ", reordered " +
+                  String(flow.reordered) + ", duplicated " + String(flow.duplicated) +
+                  ", corrupted " + String(flow.corrupted) + ", unsynced " +
+                  String(flow.unsynced) + "\n";
+        status += flow.delay.toString("Delay", "ms");
+    }
+
+    xSemaphoreGive(mutex);
+
+    return status;
+}
+
+SimFlow& SimFlowMonitor::getFlow(uint16_t src, uint8_t run, bool newRun) {
+    for (uint8_t i = 0; i < flowCount; i++) {
+        if (flows[i].src != src)
+            continue;
+
+        // A new run of the sender starts the sequence numbers again
+        if (newRun && flows[i].run != run)
+            flows[i].reset(src, run);
+
+        return flows[i];
+    }
+
+    uint8_t index = flowCount;
+    if (flowCount < SIM_FLOW_MAX) {
+        flowCount++;
+    } else {
+        index = 0;
+        for (uint8_t i = 1; i < flowCount; i++) {
+            if (millis() - flows[i].lastSeen > millis() - flows[index].lastSeen)
+                index = i;
+        }
+
+        evictions++;
+        evicted[evictedNext] = getEvictedKey(flows[index].src, flows[index].run);
+        evictedNext = (evictedNext + 1) % SIM_FLOW_EVICTED_MAX;
+    }
+
+    bool restarted = wasEvicted(src, run);
+
+    flows[index].reset(src, run);
+    if (restarted)
+        flows[index].flags |= SimFlowRestarted;
+
+    return flows[index];
+}
+
+bool SimFlowMonitor::wasEvicted(uint16_t src, uint8_t run) {
+    uint32_t key = getEvictedKey(src, run);
+
+    for (uint8_t i = 0; i < SIM_FLOW_EVICTED_MAX; i++) {
+        if (evicted[i] == key)
+            return true;
+    }
+
+    return false;
+}
+
+void SimFlowMonitor::observeSeq(SimFlow& flow, uint32_t seq) {
+    int32_t highest = flow.highestSeq;
+
+    // The loss is counted from the first packet seen, a flow that starts late is flagged
+    if (flow.firstSeq < 0) {
+        flow.firstSeq = seq;
+        if (seq > 0)
+            flow.flags |= SimFlowLateStart;
+    } else if ((int32_t)seq < flow.firstSeq) {
+        flow.firstSeq = seq;
+        if (seq == 0)
+            flow.flags &= ~SimFlowLateStart;
+    }
+
+    if (highest < 0 || (int32_t)seq > highest) {
+        uint32_t shift = highest < 0 ? SIM_FLOW_WINDOW : seq - highest;
+        flow.window = shift >= SIM_FLOW_WINDOW ? 1 : (flow.window << shift) | 1;
+        flow.highestSeq = seq;
+        flow.received++;
+        return;
+    }
+
+    uint32_t behind = highest - seq;
+    if (behind < SIM_FLOW_WINDOW) {
+        if (flow.window & (1ULL << behind)) {
+            flow.duplicated++;
+            return;
+        }
+        flow.window |= 1ULL << behind;
+    }
+
+    // Older than the window it can not be told from a duplicate, it is counted as reordered
+    flow.reordered++;
+    flow.received++;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+#include "helpers/histogram.h"
+
+#include "config.h"
+
+// Sequence numbers behind the highest one that are checked for duplicates
+#define SIM_FLOW_WINDOW 64
+
+// Senders of the evicted flows remembered to flag them when they come back
+#define SIM_FLOW_EVICTED_MAX 16
+
+/**
+ * @brief Flags of a flow summary, the counters of these flows do not cover the whole run
+ *
+ */
+enum SimFlowFlags : uint8_t {
+    SimFlowLateStart = 1,  // The first packet seen was not the first one of the run
+    SimFlowRestarted = 2,  // The flow was evicted before and measured again from firstSeq
+};
+
+#pragma pack(1)
+
+/**
+ * @brief Summary of a flow, the Sim packets of a sender in a run. The counters are of the whole
+ * run from firstSeq, the delays of the last report window.
+ *
+ */
+class SimFlowSummary {
+public:
+    uint16_t src;
+    uint8_t run;
+    uint32_t received;    // Unique packets with a valid CRC
+    uint32_t firstSeq;    // Lowest sequence number received, the loss is counted from it
+    uint32_t lost;        // Sequence numbers from firstSeq to the highest one not received
+    uint32_t reordered;   // Received after a higher sequence number
+    uint32_t duplicated;
+    uint32_t corrupted;   // Invalid CRC or size
+    uint32_t unsynced;    // Without a one way delay, the sender or the gateway was not synced
+    uint32_t delayCount;  // One way delays in ms of the window
+    uint32_t delayMin;
+    uint32_t delayMean;
+    uint32_t delayP50;
+    uint32_t delayP95;
+    uint32_t delayMax;
+    uint8_t flags;        // SimFlowFlags
+    uint32_t evictions;   // Flows evicted by the gateway since boot, more senders than SIM_FLOW_MAX
+
+    void serialize(JsonObject& doc) {
+        doc["src"] = src;
+        doc["run"] = run;
+        doc["flags"] = flags;
+        doc["evictions"] = evictions;
+        doc["received"] = received;
+        doc["firstSeq"] = firstSeq;
+        doc["lost"] = lost;
+        doc["reordered"] = reordered;
+        doc["duplicated"] = duplicated;
+        doc["corrupted"] = corrupted;
+        doc["unsynced"] = unsynced;
+
+        JsonObject delay = doc.createNestedObject("delay");
+        delay["count"] = delayCount;
+        delay["min"] = delayMin;
+        delay["mean"] = delayMean;
+        delay["p50"] = delayP50;
+        delay["p95"] = delayP95;
+        delay["max"] = delayMax;
+    }
+};
+
+#pragma pack()
+
+/**
+ * @brief State of a flow at the gateway
+ *
+ */
+class SimFlow {
+public:
+    uint16_t src = 0;
+    uint8_t run = 0;
+    bool changed = false;
+    uint32_t lastSeen = 0;
+
+    int32_t firstSeq = -1;
+    int32_t highestSeq = -1;
+    uint64_t window = 0;  // Bit i is set if highestSeq - i has been received
+
+    uint8_t flags = 0;
+
+    uint32_t received = 0;
+    uint32_t reordered = 0;
+    uint32_t duplicated = 0;
+    uint32_t corrupted = 0;
+    uint32_t unsynced = 0;
+
+    Histogram delay;
+
+    void reset(uint16_t src, uint8_t run);
+
+    uint32_t getLost();
+
+    void summarize(SimFlowSummary& summary);
+};
+
+/**
+ * @brief Measures at the gateway the Sim flows that reach it: loss, reordering and duplicates
+ * from the sequence numbers, corruption from the CRC and the one way delay from the
+ * synchronized send time.
+ *
+ */
+class SimFlowMonitor {
+public:
+    SimFlowMonitor();
+
+    /**
+     * @brief Account a received Sim packet
+     *
+     * @param valid The size and the CRC of the packet are correct, otherwise only the
+     * corruption is counted
+     * @param sentAt Synchronized epoch ms of the sender, 0 if it was not synced
+     * @param receivedAt Synchronized epoch ms of the gateway, 0 if it is not synced
+     */
+    void observe(uint16_t src, uint8_t run, uint32_t seq, bool valid, uint64_t sentAt,
+                 uint64_t receivedAt);
+
+    /**
+     * @brief Write the summaries of the flows and start a new delay window
+     *
+     * @param summaries At least SIM_FLOW_MAX
+     * @return uint8_t Flows written, only the ones with packets since the previous call
+     */
+    uint8_t takeSummaries(SimFlowSummary* summaries);
+
+    String toString();
+
+private:
+    SemaphoreHandle_t mutex = NULL;
+
+    SimFlow flows[SIM_FLOW_MAX];
+
+    uint8_t flowCount = 0;
+
+    uint32_t evictions = 0;
+
+    // Ring of the sender and run of the last evicted flows, 0 is empty
+    uint32_t evicted[SIM_FLOW_EVICTED_MAX] = {};
+
+    uint8_t evictedNext = 0;
+
+    static uint32_t getEvictedKey(uint16_t src, uint8_t run) {
+        return 1 << 24 | (uint32_t)src << 8 | run;
+    }
+
+    bool wasEvicted(uint16_t src, uint8_t run);
+
+    /**
+     * @brief The flow of a sender, a new one replaces the least recently seen when full
+     *
+     * @param newRun A different run resets the flow, false for the corrupted packets
+     */
+    SimFlow& getFlow(uint16_t src, uint8_t run, bool newRun);
+
+    void observeSeq(SimFlow& flow, uint32_t seq);
+};
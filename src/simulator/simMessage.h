@@ -8,6 +8,12 @@
 
 #include "config.h"
 
+#include "simStateStore.h"
+
+#include "helpers/helper.h"
+
+#include "simFlowMonitor.h"
+
 #pragma pack(1)
 
 enum SimCommand : uint8_t {
@@ -18,6 +24,10 @@ enum SimCommand : uint8_t {
     StartingSimulation = 4,
     EndedSimulation = 5,  // StartedSimulationStatus
     EndedSimulationStatus = 6,
+    SetRunSpec = 7,  // The payload is a SimRunSpec
+    StateChunk = 8,  // The payload is a chunk of the state log, see SimStateChunk
+    UploadAck = 9,   // The payload is a SimUploadAck
+    FlowReport = 10, // The payload is a SimFlowReport
 };
 
 
@@ -56,14 +66,42 @@ public:
     }
 };
 
+/**
+ * @brief The server received a chunk of the state log
+ *
+ */
+class SimUploadAck {
+public:
+    uint8_t run;
+    uint16_t seq;
+};
+
+/**
+ * @brief Sim packet. The sequence number, the send time and the CRC let the gateway measure the
+ * flow, see SimFlowMonitor.
+ *
+ */
 class SimPayloadMessage {
 public:
     uint32_t packetSize;
+    uint8_t run;      // Sim run of the sender
+    uint32_t seq;     // Packet of the run, from 0
+    uint64_t sentAt;  // Synchronized epoch ms, 0 if the sender was not synced
+    uint32_t crc;     // CRC-32 of the fields above and the payload
 
     uint8_t payload[];
 
+    uint32_t computeCrc() {
+        uint32_t headerCrc = Helper::crc32((uint8_t*)this, (uint8_t*)&crc - (uint8_t*)this);
+        return Helper::crc32(payload, packetSize, headerCrc);
+    }
+
     void serializePayload(JsonObject& doc) {
         doc["packetSize"] = packetSize;
+        doc["run"] = run;
+        doc["seq"] = seq;
+        doc["sentAt"] = sentAt;
+        doc["crc"] = crc;
 
         if (UPLOAD_PAYLOAD == true) {
             JsonArray payloadArray = doc.createNestedArray("payload");
@@ -77,6 +115,25 @@ public:
     }
 };
 
+/**
+ * @brief Summaries of the flows measured by a gateway
+ *
+ */
+class SimFlowReport {
+public:
+    uint8_t count;
+    SimFlowSummary flows[];
+
+    void serializeFlows(JsonObject& doc) {
+        JsonArray array = doc.createNestedArray("flows");
+
+        for (uint8_t i = 0; i < count; i++) {
+            JsonObject flow = array.createNestedObject();
+            flows[i].serialize(flow);
+        }
+    }
+};
+
 class SimMessage : public DataMessageGeneric {
 public:
     SimCommand simCommand;
@@ -101,6 +158,20 @@ public:
                 payloadMessage->serializePayload(doc);
                 break;
             }
+            case ::SimCommand::FlowReport: {
+                SimFlowReport* report = (SimFlowReport*)this->payload;
+                report->serializeFlows(doc);
+                break;
+            }
+            case ::SimCommand::EndedSimulationStatus: {
+                if (messageSize < sizeof(SimMessage) - sizeof(DataMessageGeneric) +
+                                      sizeof(SimStateStoreStats))
+                    break;
+
+                SimStateStoreStats* stats = (SimStateStoreStats*)this->payload;
+                stats->serialize(doc);
+                break;
+            }
             default:
                 break;
         }
@@ -113,6 +184,23 @@ public:
         // Add the derived class data to the JSON object
         simCommand = (SimCommand)doc["simCommand"];
     }
+
+    /**
+     * @brief Payload of a Sim packet. The size is checked before reading the payload fields.
+     *
+     * @return SimPayloadMessage* nullptr if it is not a Sim packet or the sizes do not match
+     */
+    SimPayloadMessage* getPayloadMessage() {
+        uint32_t headerSize = sizeof(SimMessage) - sizeof(DataMessageGeneric);
+        SimPayloadMessage* payloadMessage = (SimPayloadMessage*)payload;
+
+        bool valid = simCommand == ::SimCommand::Payload &&
+                     messageSize >= headerSize + sizeof(SimPayloadMessage) &&
+                     messageSize - headerSize - sizeof(SimPayloadMessage) ==
+                         payloadMessage->packetSize;
+
+        return valid ? payloadMessage : nullptr;
+    }
 };
 
 #pragma pack()
\ No newline at end of file
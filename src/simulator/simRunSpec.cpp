@@ -0,0 +1,219 @@
+#include "simRunSpec.h"
+
+SimRunSpec SimRunSpec::getDefault() {
+    SimRunSpec spec;
+    memset(&spec, 0, sizeof(SimRunSpec));
+
+#if ONE_SENDER != 0
+    spec.senderCount = 1;
+    spec.senders[0] = ONE_SENDER;
+#endif
+
+    spec.arrival = PeriodicArrival;
+    spec.packetCount = PACKET_COUNT;
+    spec.interval = PACKET_DELAY;
+    spec.burstSize = 1;
+    spec.sizeDistribution = FixedSize;
+    spec.minSize = PACKET_SIZE;
+    spec.maxSize = PACKET_SIZE;
+    spec.wifiAddress = WIFI_ADDR_CONNECTED;
+
+    return spec;
+}
+
+String SimRunSpec::validate() {
+    if (senderCount > SIM_MAX_SENDERS)
+        return "At most " + String(SIM_MAX_SENDERS) + " senders";
+
+    if (packetCount == 0 || interval == 0)
+        return "The count and the interval must be positive";
+
+    if (arrival > BurstyArrival)
+        return "Unknown arrival";
+
+    if (burstSize == 0)
+        return "The burst must have at least one packet";
+
+    if (sizeDistribution == FixedSize)
+        maxSize = minSize;
+
+    if (sizeDistribution > UniformSize || minSize == 0 || minSize > maxSize ||
+        maxSize > SIM_MAX_PACKET_SIZE)
+        return "The size must be between 1 and " + String(SIM_MAX_PACKET_SIZE) + " bytes";
+
+    return "";
+}
+
+bool SimRunSpec::isSender(uint16_t address) {
+    if (senderCount == 0)
+        return true;
+
+    for (uint8_t i = 0; i < senderCount; i++) {
+        if (senders[i] == address)
+            return true;
+    }
+
+    return false;
+}
+
+uint32_t SimRunSpec::getStartOffset(uint16_t address) {
+    for (uint8_t i = 0; i < senderCount; i++) {
+        if (senders[i] == address)
+            return startOffset + i * startStagger;
+    }
+
+    return startOffset;
+}
+
+uint32_t SimRunSpec::getDuration() {
+    uint32_t traffic = packetCount * interval;
+
+    if (arrival == BurstyArrival) {
+        uint32_t bursts = (packetCount + burstSize - 1) / burstSize;
+        traffic = bursts * interval + (packetCount - bursts) * burstGap;
+    }
+
+    uint8_t lastPosition = senderCount > 0 ? senderCount - 1 : 0;
+
+    return startOffset + lastPosition * startStagger + traffic;
+}
+
+uint16_t SimRunSpec::getPacketSize() {
+    if (sizeDistribution == FixedSize || minSize >= maxSize)
+        return minSize;
+
+    return minSize + esp_random() % (maxSize - minSize + 1);
+}
+
+uint32_t SimRunSpec::getNextDelay(uint32_t sent) {
+    switch (arrival) {
+        case PoissonArrival: {
+            // Exponential gap, (0, 1] keeps the logarithm finite
+            double uniform = ((double)esp_random() + 1.0) / 4294967296.0;
+            return (uint32_t)(-log(uniform) * interval);
+        }
+        case BurstyArrival:
+            return sent % burstSize != 0 ? burstGap : interval;
+        default:
+            return interval;
+    }
+}
+
+void SimRunSpec::deserialize(JsonObject& doc) {
+    if (doc.containsKey("senders")) {
+        JsonArray array = doc["senders"];
+        senderCount = 0;
+        for (JsonVariant sender : array) {
+            if (senderCount == SIM_MAX_SENDERS) {
+                senderCount++;
+                break;
+            }
+            senders[senderCount++] = sender.as<uint16_t>();
+        }
+    }
+
+    arrival = (SimArrival)(doc["arrival"] | (uint8_t)arrival);
+    packetCount = doc["count"] | packetCount;
+    interval = doc["interval"] | interval;
+    burstSize = doc["burst"] | burstSize;
+    burstGap = doc["gap"] | burstGap;
+    sizeDistribution = (SimSizeDistribution)(doc["sizeDistribution"] | (uint8_t)sizeDistribution);
+    minSize = doc["minSize"] | minSize;
+    maxSize = doc["maxSize"] | maxSize;
+    startOffset = doc["offset"] | startOffset;
+    startStagger = doc["stagger"] | startStagger;
+    wifiAddress = doc["wifi"] | wifiAddress;
+}
+
+String SimRunSpec::parse(String args) {
+    args.trim();
+
+    while (args.length() > 0) {
+        int end = args.indexOf(' ');
+        String token = end < 0 ? args : args.substring(0, end);
+        args = end < 0 ? "" : args.substring(end + 1);
+        args.trim();
+
+        int separator = token.indexOf('=');
+        if (separator < 0)
+            return "Expected key=value: " + token;
+
+        String key = token.substring(0, separator);
+        String value = token.substring(separator + 1);
+        uint32_t number = strtoul(value.c_str(), NULL, 10);
+
+        if (key == "senders") {
+            senderCount = 0;
+            if (value == "all")
+                continue;
+
+            int start = 0;
+            while (start < (int)value.length()) {
+                int comma = value.indexOf(',', start);
+                if (comma < 0)
+                    comma = value.length();
+
+                if (senderCount == SIM_MAX_SENDERS)
+                    return "At most " + String(SIM_MAX_SENDERS) + " senders";
+
+                senders[senderCount++] = strtol(value.substring(start, comma).c_str(), NULL, 16);
+                start = comma + 1;
+            }
+        } else if (key == "arrival") {
+            if (value == "periodic")
+                arrival = PeriodicArrival;
+            else if (value == "poisson")
+                arrival = PoissonArrival;
+            else if (value == "bursty")
+                arrival = BurstyArrival;
+            else
+                return "Unknown arrival: " + value;
+        } else if (key == "count") {
+            packetCount = number;
+        } else if (key == "interval") {
+            interval = number;
+        } else if (key == "burst") {
+            burstSize = number;
+        } else if (key == "gap") {
+            burstGap = number;
+        } else if (key == "size") {
+            int dash = value.indexOf('-');
+            sizeDistribution = dash < 0 ? FixedSize : UniformSize;
+            minSize = number;
+            maxSize = dash < 0 ? number : value.substring(dash + 1).toInt();
+        } else if (key == "offset") {
+            startOffset = number;
+        } else if (key == "stagger") {
+            startStagger = number;
+        } else if (key == "wifi") {
+            wifiAddress = strtol(value.c_str(), NULL, 16);
+        } else {
+            return "Unknown key: " + key;
+        }
+    }
+
+    return "";
+}
+
+String SimRunSpec::toString() {
+    static const char* arrivals[] = {"periodic", "poisson", "bursty"};
+
+    String senderList = senderCount == 0 ? "all" : "";
+    for (uint8_t i = 0; i < senderCount; i++) {
+        senderList += (i > 0 ? "," : "") + String(senders[i], HEX);
+    }
+
+    String size = String(minSize);
+    if (sizeDistribution == UniformSize)
+        size += "-" + String(maxSize);
+
+    String spec = "senders=" + senderList +
+                  " arrival=" + String(arrival <= BurstyArrival ? arrivals[arrival] : "?") +
+                  " count=" + String(packetCount) + " interval=" + String(interval);
+
+    if (arrival == BurstyArrival)
+        spec += " burst=" + String(burstSize) + " gap=" + String(burstGap);
+
+    return spec + " size=" + size + " offset=" + String(startOffset) +
+           " stagger=" + String(startStagger) + " wifi=" + String(wifiAddress, HEX) + "\n";
+}
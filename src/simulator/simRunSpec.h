@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+#include "config.h"
+
+enum SimArrival : uint8_t {
+    PeriodicArrival = 0,
+    PoissonArrival = 1,
+    BurstyArrival = 2,
+};
+
+enum SimSizeDistribution : uint8_t {
+    FixedSize = 0,
+    UniformSize = 1,
+};
+
+#pragma pack(1)
+
+/**
+ * @brief Traffic of a Sim run: who sends, how many packets, when and how large. It replaces the
+ * ONE_SENDER, PACKET_COUNT, PACKET_SIZE, PACKET_DELAY and WIFI_ADDR_CONNECTED macros, which are
+ * only the defaults now, so a sweep changes it over MQTT or the commands without reflashing.
+ *
+ */
+class SimRunSpec {
+public:
+    uint8_t senderCount;  // 0, every node sends
+    uint16_t senders[SIM_MAX_SENDERS];
+    SimArrival arrival;
+    uint32_t packetCount;   // Per sender
+    uint32_t interval;      // ms, the period, the mean of the Poisson gaps or between bursts
+    uint8_t burstSize;      // Packets per burst
+    uint32_t burstGap;      // ms between the packets of a burst
+    SimSizeDistribution sizeDistribution;
+    uint16_t minSize;       // Bytes, the size of the fixed distribution
+    uint16_t maxSize;
+    uint32_t startOffset;   // ms after the network propagation wait
+    uint32_t startStagger;  // ms added per position in the senders list
+    uint16_t wifiAddress;   // Node that keeps the WiFi during the run, 0 none
+
+    /**
+     * @brief The spec of the compile-time macros
+     *
+     */
+    static SimRunSpec getDefault();
+
+    /**
+     * @brief Check the limits of the spec
+     *
+     * @return String Empty if it is valid, the error otherwise
+     */
+    String validate();
+
+    bool isSender(uint16_t address);
+
+    /**
+     * @brief ms the sender waits before the first packet
+     *
+     */
+    uint32_t getStartOffset(uint16_t address);
+
+    /**
+     * @brief Expected ms from the end of the propagation wait until the last sender finishes
+     *
+     */
+    uint32_t getDuration();
+
+    /**
+     * @brief Draw the size of the next packet
+     *
+     */
+    uint16_t getPacketSize();
+
+    /**
+     * @brief Draw the ms until the next packet
+     *
+     * @param sent Packets already sent, the bursts count them
+     */
+    uint32_t getNextDelay(uint32_t sent);
+
+    /**
+     * @brief Set the fields present in the JSON, the others keep their value
+     *
+     */
+    void deserialize(JsonObject& doc);
+
+    /**
+     * @brief Set the fields of a "key=value key=value" argument list
+     *
+     * Keys: senders=<hex>,<hex> (all for every node), arrival=periodic|poisson|bursty, count,
+     * interval, burst, gap, size=<n> or size=<min>-<max>, offset, stagger, wifi=<hex>
+     *
+     * @return String Empty if every key is known, the error otherwise
+     */
+    String parse(String args);
+
+    String toString();
+};
+
+#pragma pack()
@@ -0,0 +1,85 @@
+#include "simStateChunk.h"
+
+#include "simMessage.h"
+
+SimStateChunk::SimStateChunk(uint8_t* buffer, uint8_t run, uint16_t seq, uint32_t first,
+                             uint32_t total)
+    : buffer(buffer), size(sizeof(SimStateChunkHeader)) {
+    header.version = SIM_STATE_CHUNK_VERSION;
+    header.run = run;
+    header.seq = seq;
+    header.first = first;
+    header.total = total;
+    header.count = 0;
+    header.legacyMessageSize =
+        sizeof(SimMessage) + sizeof(SimMessageState) - sizeof(DataMessageGeneric);
+
+    memcpy(buffer, &header, sizeof(SimStateChunkHeader));
+}
+
+bool SimStateChunk::add(LM_State* state) {
+    if (header.count == UINT8_MAX || size + SIM_STATE_MAX_RECORD_SIZE > SIM_UPLOAD_CHUNK_SIZE)
+        return false;
+
+    uint32_t fields[SIM_STATE_FIELDS];
+    getFields(state, fields);
+
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < SIM_STATE_FIELDS; i++) {
+        if (fields[i] != previous[i])
+            mask |= 1UL << i;
+    }
+
+    size += writeVarint(buffer + size, mask);
+
+    for (uint8_t i = 0; i < SIM_STATE_FIELDS; i++) {
+        if (!(mask & (1UL << i)))
+            continue;
+
+        uint32_t value = fields[i];
+        if (isDelta(i)) {
+            int32_t delta = (int32_t)(fields[i] - previous[i]);
+            value = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        }
+
+        size += writeVarint(buffer + size, value);
+        previous[i] = fields[i];
+    }
+
+    header.count++;
+    memcpy(buffer, &header, sizeof(SimStateChunkHeader));
+
+    return true;
+}
+
+void SimStateChunk::getFields(LM_State* state, uint32_t* fields) {
+    fields[0] = state->id;
+    fields[1] = state->type;
+    fields[2] = state->receivedQueueSize;
+    fields[3] = state->sentQueueSize;
+    fields[4] = state->receivedUserQueueSize;
+    fields[5] = state->q_WRPSize;
+    fields[6] = state->q_WSPSize;
+    fields[7] = state->routingTableSize;
+    fields[8] = state->secondsSinceStart;
+    fields[9] = state->freeMemoryAllocation;
+    fields[10] = state->packetHeader.type;
+    fields[11] = state->packetHeader.id;
+    fields[12] = state->packetHeader.packetSize;
+    fields[13] = state->packetHeader.src;
+    fields[14] = state->packetHeader.dst;
+    fields[15] = state->packetHeader.via;
+    fields[16] = state->packetHeader.seq_id;
+    fields[17] = state->packetHeader.number;
+}
+
+size_t SimStateChunk::writeVarint(uint8_t* buffer, uint32_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        buffer[size++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[size++] = value;
+
+    return size;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "LoraMesher.h"
+
+#include "config.h"
+
+#define SIM_STATE_CHUNK_VERSION 1
+
+// Fields of a state record, in the order of the encoding
+#define SIM_STATE_FIELDS 18
+
+// Largest encoded record: the field mask and every field as a 5 byte varint
+#define SIM_STATE_MAX_RECORD_SIZE (3 + SIM_STATE_FIELDS * 5)
+
+#pragma pack(1)
+
+/**
+ * @brief Header of a chunk of the state log upload. It is followed by the encoded records.
+ *
+ */
+class SimStateChunkHeader {
+public:
+    uint8_t version;
+    uint8_t run;        // Sim run of the node, the server keys the chunks by node, run and seq
+    uint16_t seq;
+    uint32_t first;     // Index of the first record of the chunk in the run
+    uint32_t total;     // Records of the run, to check the upload is complete
+    uint8_t count;      // Records in this chunk
+    uint16_t legacyMessageSize;  // messageSize of the per record Sim messages, for the decoder
+};
+
+#pragma pack()
+
+/**
+ * @brief Compact encoding of the LM_State records. Each record is a varint mask of the fields
+ * that changed since the previous record followed by those fields as varints. The id, the
+ * seconds since start and the free memory are zigzag deltas. Every chunk starts from a zero
+ * record, so it decodes alone. Decoded by Testing/simStateDecoder.py.
+ *
+ */
+class SimStateChunk {
+public:
+    /**
+     * @brief Start a chunk
+     *
+     * @param buffer At least SIM_UPLOAD_CHUNK_SIZE bytes
+     */
+    SimStateChunk(uint8_t* buffer, uint8_t run, uint16_t seq, uint32_t first, uint32_t total);
+
+    /**
+     * @brief Append a record if it fits
+     *
+     * @return true If it has been added
+     */
+    bool add(LM_State* state);
+
+    uint8_t getCount() { return header.count; }
+
+    /**
+     * @brief Size of the chunk with the header
+     *
+     */
+    size_t getSize() { return size; }
+
+private:
+    uint8_t* buffer;
+
+    size_t size;
+
+    SimStateChunkHeader header;
+
+    uint32_t previous[SIM_STATE_FIELDS] = {};
+
+    static void getFields(LM_State* state, uint32_t* fields);
+
+    static bool isDelta(uint8_t field) { return field == 0 || field == 8 || field == 9; }
+
+    static size_t writeVarint(uint8_t* buffer, uint32_t value);
+};
@@ -0,0 +1,179 @@
+#include "simStateStore.h"
+
+static const char* SIM_STORE_TAG = "SimStore";
+
+bool SimStateStore::init() {
+    mutex = xSemaphoreCreateMutex();
+
+    ring = (LM_State*)pvPortMalloc(SIM_STATE_RING_SIZE * sizeof(LM_State));
+    if (ring == nullptr) {
+        ESP_LOGE(SIM_STORE_TAG, "Not enough memory for the state ring");
+        return false;
+    }
+    ringCapacity = SIM_STATE_RING_SIZE;
+
+    spillAvailable = SPIFFS.begin(true);
+    if (!spillAvailable) {
+        ESP_LOGW(SIM_STORE_TAG, "SPIFFS not available, the states are only kept in RAM");
+        return true;
+    }
+
+    // The log of a previous boot can not be uploaded, its run is unknown
+    if (SPIFFS.exists(SIM_STATE_SPILL_FILE))
+        SPIFFS.remove(SIM_STATE_SPILL_FILE);
+
+    return true;
+}
+
+void SimStateStore::capture(LM_State* state) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    stats.captured++;
+
+    if (ringCount == ringCapacity && !spill()) {
+        stats.dropped++;
+        xSemaphoreGive(mutex);
+        return;
+    }
+
+    memcpy(&ring[(ringHead + ringCount) % ringCapacity], state, sizeof(LM_State));
+    ringCount++;
+
+    xSemaphoreGive(mutex);
+}
+
+uint32_t SimStateStore::getLength() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    uint32_t length = spillWritten - spillRemoved + ringCount;
+    xSemaphoreGive(mutex);
+
+    return length;
+}
+
+bool SimStateStore::get(uint32_t index, LM_State* state) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    bool found = false;
+    uint32_t spilled = spillWritten - spillRemoved;
+
+    if (index < spilled) {
+        found = readSpilled(index, state);
+    } else if (index - spilled < ringCount) {
+        memcpy(state, &ring[(ringHead + index - spilled) % ringCapacity], sizeof(LM_State));
+        found = true;
+    }
+
+    xSemaphoreGive(mutex);
+
+    return found;
+}
+
+void SimStateStore::remove(uint32_t count) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    uint32_t fromSpill = std::min<uint32_t>(count, spillWritten - spillRemoved);
+    spillRemoved += fromSpill;
+    count -= fromSpill;
+
+    // Start a new log once the current one has been read
+    if (spillRemoved == spillWritten && (spillWritten > 0 || spillFull)) {
+        closeReader();
+        SPIFFS.remove(SIM_STATE_SPILL_FILE);
+        spillWritten = 0;
+        spillRemoved = 0;
+        spillFull = false;
+    }
+
+    uint32_t fromRing = std::min<uint32_t>(count, ringCount);
+    ringHead = (ringHead + fromRing) % ringCapacity;
+    ringCount -= fromRing;
+
+    xSemaphoreGive(mutex);
+}
+
+SimStateStoreStats SimStateStore::getStats() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    SimStateStoreStats current = stats;
+    xSemaphoreGive(mutex);
+
+    return current;
+}
+
+void SimStateStore::resetStats() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    stats = {};
+    xSemaphoreGive(mutex);
+}
+
+String SimStateStore::getStatsString() {
+    SimStateStoreStats current = getStats();
+
+    return "States captured " + String(current.captured) + ", spilled " +
+           String(current.spilled) + ", dropped " + String(current.dropped) + ", stored " +
+           String(getLength()) + "\n";
+}
+
+bool SimStateStore::spill() {
+    if (!spillAvailable || spillFull || ringCount == 0)
+        return false;
+
+    size_t ringSize = ringCount * sizeof(LM_State);
+    if ((spillWritten + ringCount) * sizeof(LM_State) > SIM_STATE_SPILL_MAX_SIZE)
+        return false;
+
+    closeReader();
+
+    File file = SPIFFS.open(SIM_STATE_SPILL_FILE, FILE_APPEND);
+    if (!file) {
+        ESP_LOGE(SIM_STORE_TAG, "Could not open the state log");
+        spillAvailable = false;
+        return false;
+    }
+
+    // The ring may wrap, the oldest records are written first
+    uint32_t firstPart = std::min<uint32_t>(ringCount, ringCapacity - ringHead);
+    size_t written = file.write((uint8_t*)&ring[ringHead], firstPart * sizeof(LM_State));
+    if (firstPart < ringCount)
+        written += file.write((uint8_t*)ring, (ringCount - firstPart) * sizeof(LM_State));
+
+    file.close();
+
+    uint32_t spilled = written / sizeof(LM_State);
+
+    // A partial record would shift the ones appended after it
+    if (written != ringSize) {
+        ESP_LOGE(SIM_STORE_TAG, "State log full after %d records", spillWritten + spilled);
+        spillFull = true;
+        if (written % sizeof(LM_State) != 0)
+            spilled = 0;
+    }
+
+    spillWritten += spilled;
+    stats.spilled += spilled;
+    ringHead = (ringHead + spilled) % ringCapacity;
+    ringCount -= spilled;
+
+    if (spilled > 0)
+        ESP_LOGI(SIM_STORE_TAG, "Spilled %d states to flash", spilled);
+
+    return ringCount < ringCapacity;
+}
+
+void SimStateStore::closeReader() {
+    if (spillReader)
+        spillReader.close();
+}
+
+bool SimStateStore::readSpilled(uint32_t index, LM_State* state) {
+    if (!spillReader) {
+        spillReader = SPIFFS.open(SIM_STATE_SPILL_FILE, FILE_READ);
+        if (!spillReader)
+            return false;
+    }
+
+    size_t offset = (spillRemoved + index) * sizeof(LM_State);
+    if (spillReader.position() != offset && !spillReader.seek(offset))
+        return false;
+
+    return spillReader.read((uint8_t*)state, sizeof(LM_State)) == sizeof(LM_State);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <ArduinoJson.h>
+
+#include "SPIFFS.h"
+
+#include "LoraMesher.h"
+
+#include "config.h"
+
+#pragma pack(1)
+
+/**
+ * @brief Fidelity of the state capture of a run
+ *
+ */
+class SimStateStoreStats {
+public:
+    uint32_t captured;  // Records given by LoRaMesher
+    uint32_t spilled;   // Records moved from the RAM ring to the flash log
+    uint32_t dropped;   // Records lost, the ring and the flash log were full
+
+    void serialize(JsonObject& doc) {
+        JsonObject data = doc.createNestedObject("states");
+
+        data["captured"] = captured;
+        data["spilled"] = spilled;
+        data["dropped"] = dropped;
+    }
+};
+
+#pragma pack()
+
+/**
+ * @brief Storage of the Sim state records with a constant memory use. The records are kept in a
+ * ring of SIM_STATE_RING_SIZE records allocated at init. When the ring is full it is appended to
+ * a log in SPIFFS of at most SIM_STATE_SPILL_MAX_SIZE bytes. When both are full the new records
+ * are dropped and counted.
+ *
+ * The records are read oldest first, the ones in flash before the ones in the ring, and they
+ * stay stored until removed, so the upload only frees them once confirmed.
+ *
+ */
+class SimStateStore {
+public:
+    /**
+     * @brief Allocate the ring and start a new flash log
+     *
+     * @return true If the ring has been allocated, without SPIFFS the records are only kept in RAM
+     */
+    bool init();
+
+    /**
+     * @brief Store a copy of the record
+     *
+     */
+    void capture(LM_State* state);
+
+    /**
+     * @brief Records stored
+     *
+     */
+    uint32_t getLength();
+
+    /**
+     * @brief Copy a record without removing it
+     *
+     * @param index 0 is the oldest record. Reading in order avoids seeking in the flash log.
+     * @return true If the record exists and could be read
+     */
+    bool get(uint32_t index, LM_State* state);
+
+    /**
+     * @brief Remove the oldest records
+     *
+     */
+    void remove(uint32_t count);
+
+    SimStateStoreStats getStats();
+
+    void resetStats();
+
+    String getStatsString();
+
+private:
+    SemaphoreHandle_t mutex = NULL;
+
+    LM_State* ring = nullptr;
+
+    uint32_t ringCapacity = 0;
+
+    // Index of the oldest record of the ring
+    uint32_t ringHead = 0;
+
+    uint32_t ringCount = 0;
+
+    // SPIFFS is mounted
+    bool spillAvailable = false;
+
+    // A write failed, no more appends until the log is read and removed
+    bool spillFull = false;
+
+    // Records appended to the flash log and already removed from its start
+    uint32_t spillWritten = 0;
+    uint32_t spillRemoved = 0;
+
+    File spillReader;
+
+    SimStateStoreStats stats = {};
+
+    /**
+     * @brief Append the ring to the flash log and empty it
+     *
+     * @return true If there is room in the ring again
+     */
+    bool spill();
+
+    void closeReader();
+
+    bool readSpilled(uint32_t index, LM_State* state);
+};
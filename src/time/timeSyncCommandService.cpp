@@ -0,0 +1,9 @@
+#include "timeSyncCommandService.h"
+#include "timeSyncService.h"
+
+TimeSyncCommandService::TimeSyncCommandService() {
+    addCommand(Command("/time", "Get the synchronized time, its source and the drift estimate",
+                       TimeSyncCommand::GetTimeStatus, 1, [this](String args) {
+                           return TimeSyncService::getInstance().getStatus();
+                       }));
+}
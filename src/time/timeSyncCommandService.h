@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Arduino.h"
+
+#include "commands/commandService.h"
+
+#include "timeSyncMessage.h"
+
+class TimeSyncCommandService : public CommandService {
+public:
+    TimeSyncCommandService();
+};
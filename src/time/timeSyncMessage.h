@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/dataMessage.h"
+
+#pragma pack(1)
+
+enum TimeSyncCommand : uint8_t {
+    TimeBeacon = 0,
+    GetTimeStatus = 1,
+};
+
+class TimeSyncMessage : public DataMessageGeneric {
+public:
+    TimeSyncCommand timeSyncCommand;
+    uint8_t stratum;  // 1 for a gateway synchronized with NTP, +1 for every hop
+    uint64_t time;    // Epoch milliseconds when the beacon was sent
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*)(this))->serialize(doc);
+
+        // Add the derived class data to the JSON object
+        doc["timeSyncCommand"] = timeSyncCommand;
+        doc["stratum"] = stratum;
+        doc["time"] = time;
+    }
+
+    void deserialize(JsonObject& doc) {
+        // Call the base class deserialize function
+        ((DataMessageGeneric*)(this))->deserialize(doc);
+
+        // Add the derived class data to the JSON object
+        timeSyncCommand = doc["timeSyncCommand"];
+        stratum = doc["stratum"];
+        time = doc["time"];
+    }
+};
+
+#pragma pack()
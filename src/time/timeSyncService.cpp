@@ -0,0 +1,281 @@
+#include "timeSyncService.h"
+
+static const char* TS_TAG = "TimeSyncService";
+
+// Fraction of the measured frequency error applied to the drift estimate on every beacon
+#define TIME_SYNC_DRIFT_GAIN 0.25
+
+// Epoch seconds before which the system time is not considered set by SNTP (2023-11-14)
+#define TIME_SYNC_MIN_EPOCH 1700000000
+
+void TimeSyncService::init() {
+    timeMutex = xSemaphoreCreateMutex();
+
+    createTimeSyncTask();
+}
+
+bool TimeSyncService::isSynced() {
+    return stratum != TIME_SYNC_UNSYNCED && millis() - lastSync < TIME_SYNC_HOLDOVER;
+}
+
+uint64_t TimeSyncService::getTime() {
+    if (timeMutex == NULL || stratum == TIME_SYNC_UNSYNCED)
+        return 0;
+
+    xSemaphoreTake(timeMutex, portMAX_DELAY);
+    uint64_t time = getTimeAt(millis());
+    xSemaphoreGive(timeMutex);
+
+    return time;
+}
+
+uint32_t TimeSyncService::getEpoch() {
+    return getTime() / 1000;
+}
+
+bool TimeSyncService::getUTCTime(struct tm* result) {
+    if (!isSynced())
+        return false;
+
+    time_t epoch = getEpoch();
+    gmtime_r(&epoch, result);
+
+    return true;
+}
+
+uint32_t TimeSyncService::getDelayUntil(uint64_t time) {
+    if (!isSynced())
+        return UINT32_MAX;
+
+    uint64_t now = getTime();
+    if (time <= now)
+        return 0;
+
+    // The local clock runs at (1 + drift) of the synchronized one
+    return (uint32_t)((time - now) / (1.0 - drift / 1000000.0));
+}
+
+String TimeSyncService::getStatus() {
+    String status = "--- Time ---\n";
+
+    struct tm utc;
+    if (getUTCTime(&utc)) {
+        char isoTime[21];
+        strftime(isoTime, sizeof(isoTime), "%Y-%m-%dT%H:%M:%SZ", &utc);
+        status += String(isoTime) + "\n";
+    } else {
+        status += "Not synchronized\n";
+    }
+
+    if (stratum != TIME_SYNC_UNSYNCED) {
+        status += "Stratum " + String(stratum) + " from " + String(parent, HEX) + ", last sync " +
+                  String((millis() - lastSync) / 1000) + " s ago, error " + String(lastError) +
+                  " ms, drift " + String(drift, 1) + " ppm\n";
+    }
+
+    status += "Beacons sent " + String(beaconsSent) + ", received " + String(beaconsReceived) +
+              ", steps " + String(steps) + "\n";
+
+    return status;
+}
+
+String TimeSyncService::getJSON(DataMessage* message) {
+    TimeSyncMessage* timeSyncMessage = (TimeSyncMessage*)message;
+
+    StaticJsonDocument<200> doc;
+
+    JsonObject data = doc.createNestedObject("data");
+
+    timeSyncMessage->serialize(data);
+
+    String json;
+    serializeJson(doc, json);
+
+    return json;
+}
+
+DataMessage* TimeSyncService::getDataMessage(JsonObject data) {
+    TimeSyncMessage* timeSyncMessage = new TimeSyncMessage();
+
+    timeSyncMessage->deserialize(data);
+
+    timeSyncMessage->messageSize = sizeof(TimeSyncMessage) - sizeof(DataMessageGeneric);
+
+    return ((DataMessage*)timeSyncMessage);
+}
+
+void TimeSyncService::processReceivedMessage(messagePort port, DataMessage* message) {
+    uint32_t receivedAt = millis();
+
+    TimeSyncMessage* timeSyncMessage = (TimeSyncMessage*)message;
+
+    if (timeMutex == NULL ||
+        message->messageSize < sizeof(TimeSyncMessage) - sizeof(DataMessageGeneric))
+        return;
+
+    switch (timeSyncMessage->timeSyncCommand) {
+        case TimeSyncCommand::TimeBeacon:
+            processBeacon(message->addrSrc, timeSyncMessage, receivedAt);
+            break;
+        default:
+            break;
+    }
+}
+
+void TimeSyncService::processBeacon(uint16_t src, TimeSyncMessage* message, uint32_t receivedAt) {
+    beaconsReceived++;
+
+    uint8_t candidateStratum = message->stratum + 1;
+    if (message->stratum == TIME_SYNC_UNSYNCED || candidateStratum > TIME_SYNC_MAX_STRATUM)
+        return;
+
+    xSemaphoreTake(timeMutex, portMAX_DELAY);
+
+    // Follow the current parent, a better stratum, or anyone when the current source is lost
+    bool accept = src == parent || candidateStratum < stratum || !isFresh(receivedAt);
+
+    // A gateway with NTP is its own source
+    if (stratum == 1 && parent == LoraMesher::getInstance().getLocalAddress() &&
+        isFresh(receivedAt))
+        accept = false;
+
+    if (!accept) {
+        xSemaphoreGive(timeMutex);
+        return;
+    }
+
+    // The beacon was stamped before being sent, add its time on air
+    uint64_t remoteTime = message->time + LoRaMeshService::getInstance().getAirtime(
+                                              sizeof(LoRaMeshMessage) + message->messageSize);
+
+    if (stratum == TIME_SYNC_UNSYNCED || src != parent) {
+        // New source, step to its time and keep the drift estimate of the local oscillator
+        lastError = 0;
+        referenceMillis = receivedAt;
+        referenceTime = remoteTime;
+        steps++;
+    } else {
+        int64_t error = (int64_t)(remoteTime - getTimeAt(receivedAt));
+        uint32_t elapsed = receivedAt - lastSync;
+        lastError = error;
+
+        if (error > TIME_SYNC_STEP_THRESHOLD || error < -TIME_SYNC_STEP_THRESHOLD) {
+            referenceMillis = receivedAt;
+            referenceTime = remoteTime;
+            steps++;
+        } else {
+            // Correct the frequency with a fraction of the error rate and the phase with half of
+            // the error, so a single delayed beacon does not move the clock too much
+            if (elapsed > 0)
+                drift -= TIME_SYNC_DRIFT_GAIN * (float)error * 1000000.0 / elapsed;
+            if (drift > TIME_SYNC_MAX_DRIFT)
+                drift = TIME_SYNC_MAX_DRIFT;
+            if (drift < -TIME_SYNC_MAX_DRIFT)
+                drift = -TIME_SYNC_MAX_DRIFT;
+
+            referenceTime = getTimeAt(receivedAt) + error / 2;
+            referenceMillis = receivedAt;
+        }
+    }
+
+    stratum = candidateStratum;
+    parent = src;
+    lastSync = receivedAt;
+
+    xSemaphoreGive(timeMutex);
+
+    ESP_LOGI(TS_TAG, "Time from %X stratum %d, error %d ms, drift %.1f ppm", src, stratum,
+             lastError, drift);
+}
+
+bool TimeSyncService::updateFromNtp() {
+    if (!WiFiServerService::getInstance().isConnected())
+        return false;
+
+    if (!ntpStarted) {
+        configTime(0, 0, TIME_SYNC_NTP_SERVER);
+        ntpStarted = true;
+        ESP_LOGI(TS_TAG, "SNTP started with %s", TIME_SYNC_NTP_SERVER);
+    }
+
+    struct timeval now;
+    gettimeofday(&now, NULL);
+
+    if (now.tv_sec < TIME_SYNC_MIN_EPOCH)
+        return false;
+
+    uint32_t localMillis = millis();
+
+    xSemaphoreTake(timeMutex, portMAX_DELAY);
+
+    // The system clock is disciplined by SNTP, take it as it is
+    referenceMillis = localMillis;
+    referenceTime = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+    drift = 0;
+    lastError = 0;
+    stratum = 1;
+    parent = LoraMesher::getInstance().getLocalAddress();
+    lastSync = localMillis;
+
+    xSemaphoreGive(timeMutex);
+
+    return true;
+}
+
+void TimeSyncService::sendBeacon() {
+    TimeSyncMessage* message = new TimeSyncMessage();
+
+    message->messageSize = sizeof(TimeSyncMessage) - sizeof(DataMessageGeneric);
+    message->timeSyncCommand = TimeSyncCommand::TimeBeacon;
+    message->appPortDst = appPort::TimeSyncApp;
+    message->appPortSrc = appPort::TimeSyncApp;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = BROADCAST_ADDR;
+    message->messageId = 0;
+
+    // Stamped now, LoRaMeshService drops the beacon instead of deferring it without airtime
+    xSemaphoreTake(timeMutex, portMAX_DELAY);
+    message->stratum = stratum;
+    message->time = getTimeAt(millis());
+    xSemaphoreGive(timeMutex);
+
+    MessageManager::getInstance().sendMessage(messagePort::LoRaMeshPort, (DataMessage*)message,
+                                              DeliveryMode::Unreliable);
+
+    delete message;
+
+    beaconsSent++;
+}
+
+bool TimeSyncService::isFresh(uint32_t now) {
+    return stratum != TIME_SYNC_UNSYNCED && now - lastSync < TIME_SYNC_TIMEOUT;
+}
+
+uint64_t TimeSyncService::getTimeAt(uint32_t localMillis) {
+    uint32_t elapsed = localMillis - referenceMillis;
+    return referenceTime + elapsed - (int64_t)(elapsed * drift / 1000000.0);
+}
+
+void TimeSyncService::createTimeSyncTask() {
+    int res = xTaskCreate(timeSyncLoop, "Time Sync Task", 3072, (void*)1, 1,
+                          &timeSync_TaskHandle);
+    if (res != pdPASS) {
+        ESP_LOGE(TS_TAG, "Time Sync Task creation gave error: %d", res);
+    }
+}
+
+void TimeSyncService::timeSyncLoop(void*) {
+    TimeSyncService& service = TimeSyncService::getInstance();
+
+    for (;;) {
+        // Jitter the beacons so the neighbours do not collide
+        vTaskDelay((TIME_SYNC_BEACON_INTERVAL + random(TIME_SYNC_BEACON_INTERVAL / 10)) /
+                   portTICK_PERIOD_MS);
+
+        service.updateFromNtp();
+
+        // Only the nodes with a recent source beacon, a free running clock is not propagated
+        if (service.isFresh(millis()) && service.stratum < TIME_SYNC_MAX_STRATUM)
+            service.sendBeacon();
+    }
+}
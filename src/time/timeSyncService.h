@@ -0,0 +1,128 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/messageService.h"
+
+#include "message/messageManager.h"
+
+#include "timeSyncCommandService.h"
+
+#include "timeSyncMessage.h"
+
+#include "config.h"
+
+#include "LoraMesher.h"
+
+#define TIME_SYNC_UNSYNCED UINT8_MAX
+
+/**
+ * @brief Distributes the wall clock time from the gateways. A gateway synchronized with NTP
+ * broadcasts beacons with stratum 1. The nodes follow the beacons of the lowest stratum they hear,
+ * estimate the offset and the drift of their clock and, once synchronized, beacon with their own
+ * stratum + 1 so the time reaches the nodes out of range of the gateway.
+ *
+ */
+class TimeSyncService : public MessageService {
+public:
+    static TimeSyncService& getInstance() {
+        static TimeSyncService instance;
+        return instance;
+    }
+
+    ~TimeSyncService() {
+        if (timeSyncCommandService != nullptr) {
+            delete timeSyncCommandService;
+        }
+    }
+
+    TimeSyncCommandService* timeSyncCommandService = nullptr;
+
+    void init();
+
+    /**
+     * @brief The time has been synchronized and is still inside the holdover period
+     *
+     */
+    bool isSynced();
+
+    /**
+     * @brief Get the synchronized time
+     *
+     * @return uint64_t Epoch milliseconds, 0 if the time has never been synchronized
+     */
+    uint64_t getTime();
+
+    /**
+     * @brief Get the synchronized time
+     *
+     * @return uint32_t Epoch seconds, 0 if the time has never been synchronized
+     */
+    uint32_t getEpoch();
+
+    /**
+     * @brief Get the synchronized UTC date and time
+     *
+     * @param result Broken down time
+     * @return true If the time is synchronized
+     */
+    bool getUTCTime(struct tm* result);
+
+    /**
+     * @brief Milliseconds from now until an epoch time, to schedule transmissions
+     *
+     * @param time Epoch milliseconds
+     * @return uint32_t 0 if the time has passed, UINT32_MAX if not synchronized
+     */
+    uint32_t getDelayUntil(uint64_t time);
+
+    String getStatus();
+
+    String getJSON(DataMessage* message);
+
+    DataMessage* getDataMessage(JsonObject data);
+
+    void processReceivedMessage(messagePort port, DataMessage* message);
+
+private:
+    TimeSyncService() : MessageService(TimeSyncApp, "TimeSync") {
+        timeSyncCommandService = new TimeSyncCommandService();
+        commandService = timeSyncCommandService;
+    };
+
+    TaskHandle_t timeSync_TaskHandle = NULL;
+
+    SemaphoreHandle_t timeMutex = NULL;
+
+    // Reference point of the local clock: the time was referenceTime at referenceMillis
+    uint32_t referenceMillis = 0;
+    uint64_t referenceTime = 0;
+
+    // Drift of the local clock against the source in ppm, positive if the local clock runs fast
+    float drift = 0;
+
+    uint8_t stratum = TIME_SYNC_UNSYNCED;
+    uint16_t parent = 0;
+    uint32_t lastSync = 0;
+
+    bool ntpStarted = false;
+
+    int32_t lastError = 0;
+    uint32_t beaconsSent = 0;
+    uint32_t beaconsReceived = 0;
+    uint32_t steps = 0;
+
+    void createTimeSyncTask();
+
+    static void timeSyncLoop(void*);
+
+    bool updateFromNtp();
+
+    void processBeacon(uint16_t src, TimeSyncMessage* message, uint32_t receivedAt);
+
+    void sendBeacon();
+
+    bool isFresh(uint32_t now);
+
+    uint64_t getTimeAt(uint32_t localMillis);
+};
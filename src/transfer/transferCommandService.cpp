@@ -0,0 +1,21 @@
+#include "transferCommandService.h"
+#include "transferService.h"
+
+TransferCommandService::TransferCommandService() {
+    addCommand(Command("/transferStats", "Get the bulk transfers in progress and their statistics",
+                       TransferCommand::GetTransferStats, 1, [this](String args) {
+                           return TransferService::getInstance().getStatus();
+                       }));
+
+    addCommand(Command("/transferTest",
+                       "Send a test blob. Usage: /transferTest <size> <dst in hex, closest gateway "
+                       "if empty>",
+                       TransferCommand::SendTestTransfer, 1, [this](String args) {
+                           int separator = args.indexOf(" ");
+                           uint32_t size = args.substring(0, separator).toInt();
+                           uint16_t dst = 0;
+                           if (separator > 0)
+                               dst = strtol(args.substring(separator + 1).c_str(), NULL, 16);
+                           return TransferService::getInstance().sendTestTransfer(size, dst);
+                       }));
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Arduino.h"
+
+#include "commands/commandService.h"
+
+#include "transferMessage.h"
+
+class TransferCommandService : public CommandService {
+public:
+    TransferCommandService();
+};
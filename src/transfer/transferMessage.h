@@ -0,0 +1,118 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/dataMessage.h"
+
+#pragma pack(1)
+
+enum TransferCommand : uint8_t {
+    TransferInit = 0,
+    TransferChunk = 1,
+    TransferAck = 2,
+    TransferData = 3,
+    GetTransferStats = 4,
+    SendTestTransfer = 5,
+};
+
+enum TransferStatus : uint8_t {
+    TransferInProgress = 0,
+    TransferComplete = 1,
+    TransferCrcError = 2,
+    TransferUnknown = 3,
+    TransferRejected = 4,
+};
+
+/**
+ * @brief Announces a transfer, it is also sent again to probe the receiver when the ACKs stop or to
+ * resume an interrupted transfer. The receiver always answers with an ACK.
+ *
+ */
+class TransferInitMessage {
+public:
+    uint32_t totalSize;
+    uint16_t chunkCount;
+    uint8_t chunkSize;
+    uint32_t crc;
+};
+
+class TransferChunkMessage {
+public:
+    uint16_t chunkIndex;
+    uint8_t data[];
+};
+
+/**
+ * @brief Selective acknowledgement. All the chunks before base have been received, bit i of the
+ * bitmap is set when the chunk base + 1 + i has been received.
+ *
+ */
+class TransferAckMessage {
+public:
+    TransferStatus status;
+    uint16_t base;
+    uint32_t bitmap;
+};
+
+class TransferMessage : public DataMessageGeneric {
+public:
+    TransferCommand transferCommand;
+    uint16_t transferId;
+    uint8_t payload[];
+
+    uint32_t getPayloadSize() {
+        return messageSize - (sizeof(TransferMessage) - sizeof(DataMessageGeneric));
+    }
+
+    /**
+     * @brief Smallest payload of each command, the received messages shorter than it are dropped
+     *
+     */
+    static uint32_t getMinPayloadSize(TransferCommand command) {
+        switch (command) {
+            case TransferCommand::TransferInit:
+                return sizeof(TransferInitMessage);
+            case TransferCommand::TransferChunk:
+                return sizeof(TransferChunkMessage);
+            case TransferCommand::TransferAck:
+                return sizeof(TransferAckMessage);
+            default:
+                return 0;
+        }
+    }
+
+    void serialize(JsonObject& doc) {
+        // Call the base class serialize function
+        ((DataMessageGeneric*)(this))->serialize(doc);
+
+        doc["transferCommand"] = transferCommand;
+        doc["transferId"] = transferId;
+
+        if (getPayloadSize() < getMinPayloadSize(transferCommand))
+            return;
+
+        switch (transferCommand) {
+            case TransferCommand::TransferInit: {
+                TransferInitMessage* init = (TransferInitMessage*)payload;
+                doc["totalSize"] = init->totalSize;
+                doc["chunkCount"] = init->chunkCount;
+                doc["crc"] = init->crc;
+                break;
+            }
+            case TransferCommand::TransferAck: {
+                TransferAckMessage* ack = (TransferAckMessage*)payload;
+                doc["status"] = ack->status;
+                doc["base"] = ack->base;
+                doc["bitmap"] = ack->bitmap;
+                break;
+            }
+            case TransferCommand::TransferData:
+                doc["dataSize"] = getPayloadSize();
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+#pragma pack()
@@ -0,0 +1,673 @@
+#include "transferService.h"
+
+static const char* TRANSFER_TAG = "TransferService";
+
+void TransferService::init() {
+    transferMutex = xSemaphoreCreateMutex();
+
+    createTransferTask();
+}
+
+uint16_t TransferService::send(DataMessage* message, uint16_t dst) {
+    if (transferMutex == NULL) {
+        ESP_LOGE(TRANSFER_TAG, "Transfer service not initialized");
+        return 0;
+    }
+
+    if (dst == 0) {
+        RouteNode* gateway = LoraMesher::getInstance().getClosestGateway();
+        if (gateway == nullptr) {
+            ESP_LOGE(TRANSFER_TAG, "No gateway found");
+            return 0;
+        }
+        dst = gateway->networkNode.address;
+    }
+
+    uint32_t size = message->getDataMessageSize();
+    if (size > TRANSFER_MAX_SIZE) {
+        ESP_LOGE(TRANSFER_TAG, "Message of %d bytes is larger than %d", size, TRANSFER_MAX_SIZE);
+        return 0;
+    }
+
+    uint8_t* data = (uint8_t*)pvPortMalloc(size);
+    if (data == nullptr) {
+        ESP_LOGE(TRANSFER_TAG, "Not enough memory to transfer %d bytes", size);
+        return 0;
+    }
+
+    memcpy(data, message, size);
+
+    uint16_t chunkCount = (size + TRANSFER_CHUNK_SIZE - 1) / TRANSFER_CHUNK_SIZE;
+    uint32_t now = millis();
+
+    OutgoingTransfer* transfer = new OutgoingTransfer();
+    transfer->dst = dst;
+    transfer->data = data;
+    transfer->size = size;
+    transfer->chunkCount = chunkCount;
+    transfer->crc = Helper::crc32(data, size);
+    transfer->base = 0;
+    transfer->chunkState.assign(chunkCount, ChunkNotSent);
+    transfer->sentAt.assign(chunkCount, 0);
+    transfer->startedAt = now;
+    transfer->lastProgress = now;
+    transfer->lastAck = now;
+    transfer->lastProbe = 0;
+    transfer->probes = 0;
+    transfer->needsInit = true;
+    transfer->interrupted = false;
+    transfer->retransmissions = 0;
+
+    xSemaphoreTake(transferMutex, portMAX_DELAY);
+
+    if (outgoing.size() >= TRANSFER_MAX_OUTGOING) {
+        xSemaphoreGive(transferMutex);
+        ESP_LOGW(TRANSFER_TAG, "Too many outgoing transfers");
+        vPortFree(data);
+        delete transfer;
+        return 0;
+    }
+
+    transfer->id = nextTransferId++;
+    if (nextTransferId == 0)
+        nextTransferId = 1;
+
+    outgoing.push_back(transfer);
+    stats.started++;
+
+    xSemaphoreGive(transferMutex);
+
+    ESP_LOGI(TRANSFER_TAG, "Transfer %d to %X: %d bytes in %d chunks", transfer->id, dst, size,
+             chunkCount);
+
+    xTaskNotifyGive(transfer_TaskHandle);
+
+    return transfer->id;
+}
+
+String TransferService::sendTestTransfer(uint32_t size, uint16_t dst) {
+    if (size == 0)
+        return "Usage: /transferTest <size> <dst>";
+
+    uint32_t messageSize = sizeof(TransferMessage) + size;
+
+    TransferMessage* message = (TransferMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr)
+        return "Not enough memory";
+
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::TransferApp;
+    message->messageId = 0;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = dst;
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+    message->transferCommand = TransferCommand::TransferData;
+    message->transferId = 0;
+
+    for (uint32_t i = 0; i < size; i++) {
+        message->payload[i] = i;
+    }
+
+    uint16_t id = send((DataMessage*)message, dst);
+
+    vPortFree(message);
+
+    if (id == 0)
+        return "Transfer not started";
+
+    return "Transfer " + String(id) + " started";
+}
+
+String TransferService::getStatus() {
+    if (transferMutex == NULL)
+        return "Transfer service not initialized";
+
+    uint32_t now = millis();
+    String status = "--- Transfers ---\n";
+
+    xSemaphoreTake(transferMutex, portMAX_DELAY);
+
+    for (auto transfer : outgoing) {
+        uint16_t acked = 0;
+        for (uint16_t i = 0; i < transfer->chunkCount; i++) {
+            if (transfer->chunkState[i] == ChunkAcked)
+                acked++;
+        }
+
+        status += "Out " + String(transfer->id) + " to " + String(transfer->dst, HEX) + ": " +
+                  String(acked) + "/" + String(transfer->chunkCount) + " chunks, " +
+                  String(transfer->retransmissions) + " retransmissions, " +
+                  String((now - transfer->startedAt) / 1000) + " s" +
+                  (transfer->interrupted ? " (interrupted)" : "") + "\n";
+    }
+
+    for (auto transfer : incoming) {
+        status += "In " + String(transfer->id) + " from " + String(transfer->src, HEX) + ": " +
+                  String(transfer->receivedCount) + "/" + String(transfer->chunkCount) +
+                  " chunks" + (transfer->complete ? " (complete)" : "") + "\n";
+    }
+
+    status += "Sent: " + String(stats.started) + " started, " + String(stats.completed) +
+              " completed, " + String(stats.failed) + " failed, " + String(stats.chunksSent) +
+              " chunks, " + String(stats.retransmissions) + " retransmissions, " +
+              String(stats.probes) + " probes, " + String(stats.acksReceived) + " ACKs, " +
+              String(stats.bytesDelivered) + " B delivered, last " +
+              String(stats.lastThroughput) + " B/s\n";
+
+    status += "Received: " + String(stats.received) + " completed, " +
+              String(stats.chunksReceived) + " chunks, " + String(stats.duplicateChunks) +
+              " duplicated, " + String(stats.crcErrors) + " CRC errors, " +
+              String(stats.rejected) + " rejected\n";
+
+    xSemaphoreGive(transferMutex);
+
+    return status;
+}
+
+String TransferService::getJSON(DataMessage* message) {
+    TransferMessage* transferMessage = (TransferMessage*)message;
+
+    StaticJsonDocument<300> doc;
+
+    JsonObject data = doc.createNestedObject("data");
+
+    transferMessage->serialize(data);
+
+    if (transferMessage->transferCommand == TransferCommand::TransferData)
+        data["crc"] = Helper::crc32(transferMessage->payload, data["dataSize"].as<uint32_t>());
+
+    String json;
+    serializeJson(doc, json);
+
+    return json;
+}
+
+void TransferService::processReceivedMessage(messagePort port, DataMessage* message) {
+    uint32_t headerSize = sizeof(TransferMessage) - sizeof(DataMessageGeneric);
+    if (transferMutex == NULL || message->messageSize < headerSize)
+        return;
+
+    TransferMessage* transferMessage = (TransferMessage*)message;
+    uint32_t payloadSize = transferMessage->getPayloadSize();
+
+    if (payloadSize < TransferMessage::getMinPayloadSize(transferMessage->transferCommand)) {
+        ESP_LOGW(TRANSFER_TAG, "Transfer command %d of %d bytes from %X is too short",
+                 transferMessage->transferCommand, payloadSize, message->addrSrc);
+        return;
+    }
+
+    DataMessage* completed = nullptr;
+
+    xSemaphoreTake(transferMutex, portMAX_DELAY);
+
+    switch (transferMessage->transferCommand) {
+        case TransferCommand::TransferInit:
+            processInit(message->addrSrc, transferMessage->transferId,
+                        (TransferInitMessage*)transferMessage->payload);
+            break;
+        case TransferCommand::TransferChunk:
+            completed = processChunk(message->addrSrc, transferMessage->transferId,
+                                     (TransferChunkMessage*)transferMessage->payload,
+                                     payloadSize - sizeof(TransferChunkMessage));
+            break;
+        case TransferCommand::TransferAck:
+            processAck(message->addrSrc, transferMessage->transferId,
+                       (TransferAckMessage*)transferMessage->payload);
+            break;
+        case TransferCommand::TransferData:
+            ESP_LOGI(TRANSFER_TAG, "Test transfer of %d bytes received from %X", payloadSize,
+                     message->addrSrc);
+            break;
+        default:
+            break;
+    }
+
+    xSemaphoreGive(transferMutex);
+
+    // Dispatch the reassembled message outside the lock, the target service can take a while
+    if (completed != nullptr) {
+        MessageManager::getInstance().processReceivedMessage(LoRaMeshPort, completed);
+        vPortFree(completed);
+    }
+}
+
+void TransferService::processInit(uint16_t src, uint16_t transferId, TransferInitMessage* init) {
+    IncomingTransfer* transfer = findIncoming(src, transferId);
+
+    // The same id with another content, the sender has restarted
+    if (transfer != nullptr && (transfer->size != init->totalSize || transfer->crc != init->crc)) {
+        vPortFree(transfer->data);
+        incoming.erase(std::find(incoming.begin(), incoming.end(), transfer));
+        delete transfer;
+        transfer = nullptr;
+    }
+
+    if (transfer != nullptr) {
+        // Resume or probe, answer with the chunks already received
+        transfer->lastActivity = millis();
+        sendAck(transfer, src, transferId,
+                transfer->complete ? TransferComplete : TransferInProgress);
+        return;
+    }
+
+    expireIncoming(millis());
+
+    uint16_t activeTransfers = 0;
+    for (auto other : incoming) {
+        if (!other->complete)
+            activeTransfers++;
+    }
+
+    uint8_t* data = nullptr;
+    if (init->totalSize <= TRANSFER_MAX_SIZE && init->chunkSize > 0 &&
+        init->chunkCount == (init->totalSize + init->chunkSize - 1) / init->chunkSize &&
+        activeTransfers < TRANSFER_MAX_INCOMING)
+        data = (uint8_t*)pvPortMalloc(init->totalSize);
+
+    if (data == nullptr) {
+        ESP_LOGW(TRANSFER_TAG, "Transfer %d from %X of %d bytes rejected", transferId, src,
+                 init->totalSize);
+        stats.rejected++;
+        sendAck(nullptr, src, transferId, TransferRejected);
+        return;
+    }
+
+    transfer = new IncomingTransfer();
+    transfer->id = transferId;
+    transfer->src = src;
+    transfer->data = data;
+    transfer->size = init->totalSize;
+    transfer->chunkCount = init->chunkCount;
+    transfer->chunkSize = init->chunkSize;
+    transfer->crc = init->crc;
+    transfer->received.assign(init->chunkCount, false);
+    transfer->receivedCount = 0;
+    transfer->sinceAck = 0;
+    transfer->lastActivity = millis();
+    transfer->complete = false;
+
+    incoming.push_back(transfer);
+
+    ESP_LOGI(TRANSFER_TAG, "Transfer %d from %X: %d bytes in %d chunks", transferId, src,
+             init->totalSize, init->chunkCount);
+
+    sendAck(transfer, src, transferId, TransferInProgress);
+}
+
+DataMessage* TransferService::processChunk(uint16_t src, uint16_t transferId,
+                                           TransferChunkMessage* chunk, uint32_t chunkSize) {
+    IncomingTransfer* transfer = findIncoming(src, transferId);
+
+    if (transfer == nullptr) {
+        // The Init has been lost or this node has restarted, the sender needs to start again
+        sendAck(nullptr, src, transferId, TransferUnknown);
+        return nullptr;
+    }
+
+    transfer->lastActivity = millis();
+
+    if (transfer->complete) {
+        sendAck(transfer, src, transferId, TransferComplete);
+        return nullptr;
+    }
+
+    if (chunk->chunkIndex >= transfer->chunkCount ||
+        chunkSize != getChunkSize(transfer->size, transfer->chunkSize, chunk->chunkIndex)) {
+        ESP_LOGW(TRANSFER_TAG, "Invalid chunk %d of transfer %d", chunk->chunkIndex, transferId);
+        return nullptr;
+    }
+
+    stats.chunksReceived++;
+
+    if (transfer->received[chunk->chunkIndex]) {
+        stats.duplicateChunks++;
+    } else {
+        memcpy(transfer->data + chunk->chunkIndex * transfer->chunkSize, chunk->data, chunkSize);
+        transfer->received[chunk->chunkIndex] = true;
+        transfer->receivedCount++;
+    }
+
+    transfer->sinceAck++;
+
+    if (transfer->receivedCount < transfer->chunkCount) {
+        if (transfer->sinceAck >= TRANSFER_ACK_EVERY)
+            sendAck(transfer, src, transferId, TransferInProgress);
+        return nullptr;
+    }
+
+    if (Helper::crc32(transfer->data, transfer->size) != transfer->crc) {
+        ESP_LOGE(TRANSFER_TAG, "Transfer %d from %X CRC error", transferId, src);
+        stats.crcErrors++;
+        transfer->received.assign(transfer->chunkCount, false);
+        transfer->receivedCount = 0;
+        sendAck(transfer, src, transferId, TransferCrcError);
+        return nullptr;
+    }
+
+    // Keep the completed transfer without data to answer the duplicates until it expires
+    DataMessage* message = (DataMessage*)transfer->data;
+    transfer->data = nullptr;
+    transfer->complete = true;
+    stats.received++;
+
+    sendAck(transfer, src, transferId, TransferComplete);
+
+    if (transfer->size < sizeof(DataMessageGeneric) ||
+        message->getDataMessageSize() != transfer->size) {
+        ESP_LOGE(TRANSFER_TAG, "Transfer %d from %X is not a valid message", transferId, src);
+        vPortFree(message);
+        return nullptr;
+    }
+
+    message->addrSrc = src;
+    message->addrDst = LoraMesher::getInstance().getLocalAddress();
+
+    ESP_LOGI(TRANSFER_TAG, "Transfer %d from %X completed, %d bytes", transferId, src,
+             transfer->size);
+
+    return message;
+}
+
+void TransferService::processAck(uint16_t src, uint16_t transferId, TransferAckMessage* ack) {
+    OutgoingTransfer* transfer = findOutgoing(src, transferId);
+    if (transfer == nullptr)
+        return;
+
+    uint32_t now = millis();
+
+    stats.acksReceived++;
+    transfer->lastAck = now;
+    transfer->probes = 0;
+    transfer->interrupted = false;
+
+    switch (ack->status) {
+        case TransferComplete:
+            finishOutgoing(transfer, true);
+            return;
+        case TransferRejected:
+            ESP_LOGW(TRANSFER_TAG, "Transfer %d rejected by %X", transferId, src);
+            finishOutgoing(transfer, false);
+            return;
+        case TransferUnknown:
+        case TransferCrcError:
+            // Start again from the first chunk
+            transfer->base = 0;
+            transfer->chunkState.assign(transfer->chunkCount, ChunkNotSent);
+            transfer->needsInit = ack->status == TransferUnknown;
+            break;
+        default: {
+            uint16_t base = ack->base < transfer->chunkCount ? ack->base : transfer->chunkCount;
+            int32_t highest = (int32_t)base - 1;
+
+            // A chunk acknowledged for the first time, by the base or by the bitmap
+            bool progress = false;
+
+            for (uint16_t i = 0; i < base; i++) {
+                progress |= transfer->chunkState[i] != ChunkAcked;
+                transfer->chunkState[i] = ChunkAcked;
+            }
+
+            for (uint8_t bit = 0; bit < 32 && base + 1 + bit < transfer->chunkCount; bit++) {
+                if (ack->bitmap & (1UL << bit)) {
+                    progress |= transfer->chunkState[base + 1 + bit] != ChunkAcked;
+                    transfer->chunkState[base + 1 + bit] = ChunkAcked;
+                    highest = base + 1 + bit;
+                }
+            }
+
+            // Chunks before a received one or older than the timeout are lost
+            for (uint16_t i = base; i < transfer->chunkCount; i++) {
+                if (transfer->chunkState[i] == ChunkSent &&
+                    ((int32_t)i < highest || now - transfer->sentAt[i] >= TRANSFER_ACK_TIMEOUT)) {
+                    transfer->chunkState[i] = ChunkNotSent;
+                    transfer->retransmissions++;
+                    stats.retransmissions++;
+                }
+            }
+
+            if (progress)
+                transfer->lastProgress = now;
+
+            transfer->base = base;
+            transfer->needsInit = false;
+            break;
+        }
+    }
+
+    xTaskNotifyGive(transfer_TaskHandle);
+}
+
+void TransferService::processOutgoing(OutgoingTransfer* transfer, uint32_t now) {
+    if (now - transfer->lastProgress >= TRANSFER_EXPIRE_TIMEOUT) {
+        ESP_LOGE(TRANSFER_TAG, "Transfer %d to %X expired", transfer->id, transfer->dst);
+        finishOutgoing(transfer, false);
+        return;
+    }
+
+    if (transfer->interrupted) {
+        if (now - transfer->lastProbe >= TRANSFER_RESUME_INTERVAL)
+            sendInit(transfer);
+        return;
+    }
+
+    uint32_t lastHeard = transfer->lastAck > transfer->lastProbe ? transfer->lastAck
+                                                                 : transfer->lastProbe;
+    if (now - lastHeard >= TRANSFER_ACK_TIMEOUT) {
+        if (transfer->probes >= TRANSFER_MAX_PROBES) {
+            ESP_LOGW(TRANSFER_TAG, "Transfer %d to %X interrupted", transfer->id, transfer->dst);
+            transfer->interrupted = true;
+            return;
+        }
+
+        transfer->probes++;
+        stats.probes++;
+        sendInit(transfer);
+        return;
+    }
+
+    if (transfer->needsInit) {
+        sendInit(transfer);
+        transfer->needsInit = false;
+    }
+
+    uint16_t windowEnd = transfer->base + TRANSFER_WINDOW;
+    if (windowEnd > transfer->chunkCount)
+        windowEnd = transfer->chunkCount;
+
+    for (uint16_t i = transfer->base; i < windowEnd; i++) {
+        if (transfer->chunkState[i] != ChunkNotSent)
+            continue;
+
+        // Do not fill the LoRaMesher queue, the chunks would wait there instead of in the window
+        if (LoRaMeshService::getInstance().queueWaitingSendPacketsLength() >= TRANSFER_MAX_QUEUED)
+            break;
+
+        sendChunk(transfer, i);
+    }
+}
+
+void TransferService::finishOutgoing(OutgoingTransfer* transfer, bool delivered) {
+    uint32_t duration = millis() - transfer->startedAt;
+
+    if (delivered) {
+        stats.completed++;
+        stats.bytesDelivered += transfer->size;
+        stats.lastThroughput = duration == 0 ? transfer->size : transfer->size * 1000 / duration;
+
+        ESP_LOGI(TRANSFER_TAG, "Transfer %d to %X completed in %d ms, %d B/s, %d retransmissions",
+                 transfer->id, transfer->dst, duration, stats.lastThroughput,
+                 transfer->retransmissions);
+    } else {
+        stats.failed++;
+    }
+
+    vPortFree(transfer->data);
+    outgoing.erase(std::find(outgoing.begin(), outgoing.end(), transfer));
+    delete transfer;
+}
+
+void TransferService::expireIncoming(uint32_t now) {
+    for (auto it = incoming.begin(); it != incoming.end();) {
+        IncomingTransfer* transfer = *it;
+        if (now - transfer->lastActivity >= TRANSFER_EXPIRE_TIMEOUT) {
+            ESP_LOGW(TRANSFER_TAG, "Transfer %d from %X expired", transfer->id, transfer->src);
+            vPortFree(transfer->data);
+            delete transfer;
+            it = incoming.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+TransferService::OutgoingTransfer* TransferService::findOutgoing(uint16_t dst,
+                                                                 uint16_t transferId) {
+    for (auto transfer : outgoing) {
+        if (transfer->dst == dst && transfer->id == transferId)
+            return transfer;
+    }
+    return nullptr;
+}
+
+TransferService::IncomingTransfer* TransferService::findIncoming(uint16_t src,
+                                                                 uint16_t transferId) {
+    for (auto transfer : incoming) {
+        if (transfer->src == src && transfer->id == transferId)
+            return transfer;
+    }
+    return nullptr;
+}
+
+uint32_t TransferService::getChunkSize(uint32_t size, uint8_t chunkSize, uint16_t index) {
+    uint32_t offset = (uint32_t)index * chunkSize;
+    return size - offset < chunkSize ? size - offset : chunkSize;
+}
+
+void TransferService::sendInit(OutgoingTransfer* transfer) {
+    TransferMessage* message = createTransferMessage(TransferCommand::TransferInit, transfer->id,
+                                                     transfer->dst, sizeof(TransferInitMessage));
+    if (message == nullptr)
+        return;
+
+    TransferInitMessage* init = (TransferInitMessage*)message->payload;
+    init->totalSize = transfer->size;
+    init->chunkCount = transfer->chunkCount;
+    init->chunkSize = TRANSFER_CHUNK_SIZE;
+    init->crc = transfer->crc;
+
+    transfer->lastProbe = millis();
+
+    sendTransferMessage(message);
+}
+
+void TransferService::sendChunk(OutgoingTransfer* transfer, uint16_t index) {
+    uint32_t chunkSize = getChunkSize(transfer->size, TRANSFER_CHUNK_SIZE, index);
+
+    TransferMessage* message =
+        createTransferMessage(TransferCommand::TransferChunk, transfer->id, transfer->dst,
+                              sizeof(TransferChunkMessage) + chunkSize);
+    if (message == nullptr)
+        return;
+
+    TransferChunkMessage* chunk = (TransferChunkMessage*)message->payload;
+    chunk->chunkIndex = index;
+    memcpy(chunk->data, transfer->data + index * TRANSFER_CHUNK_SIZE, chunkSize);
+
+    transfer->chunkState[index] = ChunkSent;
+    transfer->sentAt[index] = millis();
+    stats.chunksSent++;
+
+    sendTransferMessage(message);
+}
+
+void TransferService::sendAck(IncomingTransfer* transfer, uint16_t src, uint16_t transferId,
+                              TransferStatus status) {
+    TransferMessage* message = createTransferMessage(TransferCommand::TransferAck, transferId, src,
+                                                     sizeof(TransferAckMessage));
+    if (message == nullptr)
+        return;
+
+    TransferAckMessage* ack = (TransferAckMessage*)message->payload;
+    ack->status = status;
+    ack->base = 0;
+    ack->bitmap = 0;
+
+    if (transfer != nullptr) {
+        if (transfer->complete) {
+            ack->base = transfer->chunkCount;
+        } else {
+            while (ack->base < transfer->chunkCount && transfer->received[ack->base])
+                ack->base++;
+
+            for (uint8_t bit = 0; bit < 32 && ack->base + 1 + bit < transfer->chunkCount; bit++) {
+                if (transfer->received[ack->base + 1 + bit])
+                    ack->bitmap |= 1UL << bit;
+            }
+        }
+
+        transfer->sinceAck = 0;
+    }
+
+    sendTransferMessage(message);
+}
+
+TransferMessage* TransferService::createTransferMessage(TransferCommand command,
+                                                        uint16_t transferId, uint16_t dst,
+                                                        uint32_t payloadSize) {
+    uint32_t messageSize = sizeof(TransferMessage) + payloadSize;
+
+    TransferMessage* message = (TransferMessage*)pvPortMalloc(messageSize);
+    if (message == nullptr) {
+        ESP_LOGE(TRANSFER_TAG, "Not enough memory to create a transfer message");
+        return nullptr;
+    }
+
+    message->appPortDst = appPort::TransferApp;
+    message->appPortSrc = appPort::TransferApp;
+    message->messageId = 0;
+    message->addrSrc = LoraMesher::getInstance().getLocalAddress();
+    message->addrDst = dst;
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+    message->transferCommand = command;
+    message->transferId = transferId;
+
+    return message;
+}
+
+void TransferService::sendTransferMessage(TransferMessage* message) {
+    // The transfer has its own acknowledgements, the frames do not need the LoRaMesher ones
+    MessageManager::getInstance().sendMessage(messagePort::LoRaMeshPort, (DataMessage*)message,
+                                              DeliveryMode::Unreliable);
+
+    vPortFree(message);
+}
+
+void TransferService::createTransferTask() {
+    int res = xTaskCreate(transferLoop, "Transfer Task", 4096, (void*)1, 1,
+                          &transfer_TaskHandle);
+    if (res != pdPASS) {
+        ESP_LOGE(TRANSFER_TAG, "Transfer Task creation gave error: %d", res);
+    }
+}
+
+void TransferService::transferLoop(void*) {
+    TransferService& service = TransferService::getInstance();
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, TRANSFER_TICK / portTICK_PERIOD_MS);
+
+        uint32_t now = millis();
+
+        xSemaphoreTake(service.transferMutex, portMAX_DELAY);
+
+        // Copy, finishing a transfer removes it from the list
+        std::vector<OutgoingTransfer*> transfers = service.outgoing;
+        for (auto transfer : transfers) {
+            service.processOutgoing(transfer, now);
+        }
+
+        service.expireIncoming(now);
+
+        xSemaphoreGive(service.transferMutex);
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "message/messageService.h"
+
+#include "message/messageManager.h"
+
+#include "transferCommandService.h"
+
+#include "transferMessage.h"
+
+#include "helpers/helper.h"
+
+#include "config.h"
+
+#include "LoraMesher.h"
+
+static_assert(TRANSFER_WINDOW <= 32, "The SACK bitmap covers at most 32 chunks");
+
+/**
+ * @brief Moves messages larger than one LoRa frame. The message is split in chunks that are sent
+ * with a sliding window and acknowledged with selective ACK bitmaps. The receiver keeps the partial
+ * transfers so an interrupted transfer resumes from the missing chunks. Once all the chunks are
+ * received and the CRC32 matches, the original DataMessage is dispatched to its appPortDst.
+ *
+ */
+class TransferService : public MessageService {
+public:
+    static TransferService& getInstance() {
+        static TransferService instance;
+        return instance;
+    }
+
+    ~TransferService() {
+        if (transferCommandService != nullptr) {
+            delete transferCommandService;
+        }
+    }
+
+    TransferCommandService* transferCommandService = nullptr;
+
+    void init();
+
+    /**
+     * @brief Start a transfer of the message. The message is copied, it can be deleted after the
+     * call.
+     *
+     * @param message Message to transfer, of any size up to TRANSFER_MAX_SIZE
+     * @param dst Destination address, 0 to use the closest gateway
+     * @return uint16_t Transfer id, 0 if the transfer could not be started
+     */
+    uint16_t send(DataMessage* message, uint16_t dst = 0);
+
+    String sendTestTransfer(uint32_t size, uint16_t dst);
+
+    String getStatus();
+
+    String getJSON(DataMessage* message);
+
+    void processReceivedMessage(messagePort port, DataMessage* message);
+
+private:
+    TransferService() : MessageService(TransferApp, "Transfer") {
+        transferCommandService = new TransferCommandService();
+        commandService = transferCommandService;
+    };
+
+    enum ChunkState : uint8_t {
+        ChunkNotSent = 0,
+        ChunkSent = 1,
+        ChunkAcked = 2,
+    };
+
+    struct OutgoingTransfer {
+        uint16_t id;
+        uint16_t dst;
+        uint8_t* data;
+        uint32_t size;
+        uint16_t chunkCount;
+        uint32_t crc;
+        uint16_t base;  // First chunk not acknowledged
+        std::vector<uint8_t> chunkState;
+        std::vector<uint32_t> sentAt;
+        uint32_t startedAt;
+        uint32_t lastProgress;
+        uint32_t lastAck;
+        uint32_t lastProbe;
+        uint8_t probes;
+        bool needsInit;
+        bool interrupted;
+        uint32_t retransmissions;
+    };
+
+    struct IncomingTransfer {
+        uint16_t id;
+        uint16_t src;
+        uint8_t* data;
+        uint32_t size;
+        uint16_t chunkCount;
+        uint8_t chunkSize;
+        uint32_t crc;
+        std::vector<bool> received;
+        uint16_t receivedCount;
+        uint16_t sinceAck;
+        uint32_t lastActivity;
+        bool complete;
+    };
+
+    struct TransferStats {
+        uint32_t started = 0;
+        uint32_t completed = 0;
+        uint32_t failed = 0;
+        uint32_t chunksSent = 0;
+        uint32_t retransmissions = 0;
+        uint32_t probes = 0;
+        uint32_t acksReceived = 0;
+        uint32_t bytesDelivered = 0;
+        uint32_t lastThroughput = 0;  // B/s of the last completed transfer
+        uint32_t received = 0;
+        uint32_t chunksReceived = 0;
+        uint32_t duplicateChunks = 0;
+        uint32_t crcErrors = 0;
+        uint32_t rejected = 0;
+    };
+
+    std::vector<OutgoingTransfer*> outgoing;
+
+    std::vector<IncomingTransfer*> incoming;
+
+    TransferStats stats;
+
+    uint16_t nextTransferId = 1;
+
+    SemaphoreHandle_t transferMutex = NULL;
+
+    TaskHandle_t transfer_TaskHandle = NULL;
+
+    void createTransferTask();
+
+    static void transferLoop(void*);
+
+    void processOutgoing(OutgoingTransfer* transfer, uint32_t now);
+
+    void processAck(uint16_t src, uint16_t transferId, TransferAckMessage* ack);
+
+    void processInit(uint16_t src, uint16_t transferId, TransferInitMessage* init);
+
+    DataMessage* processChunk(uint16_t src, uint16_t transferId, TransferChunkMessage* chunk,
+                              uint32_t chunkSize);
+
+    void finishOutgoing(OutgoingTransfer* transfer, bool delivered);
+
+    void expireIncoming(uint32_t now);
+
+    OutgoingTransfer* findOutgoing(uint16_t dst, uint16_t transferId);
+
+    IncomingTransfer* findIncoming(uint16_t src, uint16_t transferId);
+
+    uint32_t getChunkSize(uint32_t size, uint8_t chunkSize, uint16_t index);
+
+    void sendInit(OutgoingTransfer* transfer);
+
+    void sendChunk(OutgoingTransfer* transfer, uint16_t index);
+
+    void sendAck(IncomingTransfer* transfer, uint16_t src, uint16_t transferId,
+                 TransferStatus status);
+
+    TransferMessage* createTransferMessage(TransferCommand command, uint16_t transferId,
+                                           uint16_t dst, uint32_t payloadSize);
+
+    void sendTransferMessage(TransferMessage* message);
+};
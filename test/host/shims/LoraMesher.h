@@ -0,0 +1,6 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The LoRaMesher library is not built on the host, the benchmarks only need the firmware message
+// layouts that include it
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <vector>
+
+#include "sensor/generic/sensorMeasurement.h"
+
+/**
+ * @brief Host replacement of the SensorHistory, it keeps the appended points in memory so the tests
+ * can check what the sensors store
+ *
+ */
+class SensorHistory {
+public:
+    static SensorHistory& getInstance() {
+        static SensorHistory instance;
+        return instance;
+    }
+
+    struct Point {
+        MeasurementType type;
+        float value;
+    };
+
+    std::vector<Point> points;
+
+    void append(MeasurementType type, float value) { points.push_back({type, value}); }
+};
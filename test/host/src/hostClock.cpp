@@ -0,0 +1,11 @@
+#include <Arduino.h>
+
+#include "hostClock.h"
+
+uint32_t hostNow = 0;
+
+bool hostVerbose = false;
+
+uint32_t millis() {
+    return hostNow;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Value returned by millis(), the tests move it by hand
+ *
+ */
+extern uint32_t hostNow;
@@ -0,0 +1,150 @@
+#include <Arduino.h>
+
+#include <random>
+#include <vector>
+
+#include "loramesh/dutyCycle.h"
+#include "loramesh/loraMeshMessage.h"
+#include "loramesh/piggyback.h"
+#include "monitor/monServiceMessage.h"
+#include "sensor/generic/compactMeasurement.h"
+#include "sensor/sensorServiceMessage.h"
+
+#include "hostClock.h"
+
+// Frames and airtime that the piggyback saves to a node that sends the compact sensor reports and
+// the Mon delta reports to its gateway, with the firmware Piggyback and message layouts
+
+#define BENCH_DURATION 86400000  // ms of reports per scenario
+#define BENCH_NEIGHBORS 8        // Neighbors in the Mon keyframes
+#define BENCH_GATEWAY 1
+
+struct FrameCount {
+    uint32_t frames = 0;
+    uint64_t airtime = 0;  // us
+
+    void add(DataMessage* message) {
+        frames++;
+        airtime += DutyCycle::getTimeOnAir(sizeof(LoRaMeshMessage) + message->messageSize +
+                                               LORAMESH_PACKET_OVERHEAD,
+                                           125, 7, 7, 8);
+    }
+};
+
+static DataMessage* createSensorReport(uint32_t now) {
+    MeasurementAggregate aggregates[4] = {};
+    MeasurementType types[4] = {MeasurementTemperature, MeasurementHumidity,
+                                MeasurementSoilTemperature, MeasurementSoilMoisture};
+    for (uint8_t i = 0; i < 4; i++) {
+        aggregates[i].type = types[i];
+        aggregates[i].count = SENSOR_SENDING_EVERY / 10000;
+        aggregates[i].mean = aggregates[i].min = aggregates[i].max = aggregates[i].last = 21.5;
+    }
+
+    size_t maxPayload = CompactMeasurement::getMaxSize(4);
+    SensorCompactReportMessage* message =
+        (SensorCompactReportMessage*)pvPortMalloc(sizeof(SensorCompactReportMessage) + maxPayload);
+
+    size_t payloadSize = CompactMeasurement::encode(message->payload, maxPayload, now / 1000,
+                                                    SENSOR_SENDING_EVERY, nullptr, aggregates, 4);
+
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::SensorApp;
+    message->addrSrc = 2;
+    message->addrDst = BENCH_GATEWAY;
+    message->messageId = 0;
+    message->sensorCommand = SensorCommand::CompactReport;
+    message->messageSize = sizeof(SensorCommand) + payloadSize;
+
+    return (DataMessage*)message;
+}
+
+static DataMessage* createMonReport(uint8_t updated, uint8_t removed) {
+    uint32_t messageSize = sizeof(monDeltaMessage) + updated * sizeof(routing_entry) +
+                           removed * sizeof(uint16_t) + sizeof(MonCompactMetrics);
+
+    monDeltaMessage* message = (monDeltaMessage*)pvPortMalloc(messageSize);
+    memset((void*)message, 0, messageSize);
+
+    message->appPortDst = appPort::MQTTApp;
+    message->appPortSrc = appPort::MonApp;
+    message->addrSrc = 2;
+    message->addrDst = BENCH_GATEWAY;
+    message->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+    return (DataMessage*)message;
+}
+
+/**
+ * @brief Send the reports of BENCH_DURATION without and with the piggyback
+ *
+ * @param monInterval ms between the Mon reports
+ */
+static void runScenario(uint32_t monInterval) {
+    std::mt19937 random(monInterval);
+    Piggyback piggyback;
+    FrameCount alone;
+    FrameCount combined;
+    uint32_t monReports = 0;
+    uint32_t sensorReports = 0;
+    uint32_t monBytes = 0;
+
+    for (hostNow = 1000; hostNow <= BENCH_DURATION; hostNow += 1000) {
+        if (hostNow % monInterval == 0) {
+            // A keyframe has the whole table, the deltas the few neighbors that changed
+            bool keyframe = monReports % MON_KEYFRAME_EVERY == 0;
+            DataMessage* report = keyframe ? createMonReport(BENCH_NEIGHBORS, 0)
+                                           : createMonReport(random() % 4, random() % 2);
+            monReports++;
+            monBytes += report->messageSize;
+            alone.add(report);
+
+            if (!Piggyback::canWait(report) || !piggyback.add(report))
+                combined.add(report);
+
+            vPortFree(report);
+        }
+
+        if (hostNow % SENSOR_SENDING_EVERY == 0) {
+            DataMessage* report = createSensorReport(hostNow);
+            sensorReports++;
+            alone.add(report);
+
+            DataMessage* carrier = piggyback.attach(report);
+            combined.add(carrier ? carrier : report);
+
+            if (carrier)
+                vPortFree(carrier);
+            vPortFree(report);
+        }
+
+        DataMessage* expired;
+        while ((expired = piggyback.takeExpired()) != nullptr) {
+            combined.add(expired);
+            vPortFree(expired);
+        }
+    }
+
+    printf("Mon every %3u s, %4u Mon reports of %4.1f B, %4u sensor reports: frames %5u -> %5u "
+           "(%4.1f%% less), airtime %6.1f -> %6.1f s\n",
+           monInterval / 1000, monReports, (float)monBytes / monReports, sensorReports,
+           alone.frames, combined.frames, 100.0 * (alone.frames - combined.frames) / alone.frames,
+           alone.airtime / 1e6, combined.airtime / 1e6);
+}
+
+int main() {
+    DataMessage* sensorReport = createSensorReport(0);
+    printf("Frame payload %d B, compact sensor report %u B, Mon delta %u B + %u B per neighbor, "
+           "piggyback deadline %d s\n",
+           LORAMESH_MAX_FRAME_PAYLOAD, sensorReport->getDataMessageSize(),
+           (uint32_t)(sizeof(monDeltaMessage) + sizeof(MonCompactMetrics)),
+           (uint32_t)sizeof(routing_entry), PIGGYBACK_DEADLINE / 1000);
+    vPortFree(sensorReport);
+
+    runScenario(MON_MIN_INTERVAL);
+    runScenario(MON_SENDING_EVERY);
+    runScenario(MON_SENDING_EVERY * 2);
+    runScenario(MON_MAX_INTERVAL);
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <Arduino.h>
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "sensor/generic/sensor.h"
+#include "sensor/types/SHT4x/SHT4xAirSensorMessage.h"
+
+#include "hostClock.h"
+
+// Micro-benchmarks of the sensor framework, in ns per operation on the host. Only the ratios are
+// meaningful for the ESP32.
+
+#define BENCH_ITERATIONS 2000000
+
+static volatile double sink;
+
+template <typename F>
+static void bench(const char* name, F operation) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        operation(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / BENCH_ITERATIONS;
+    printf("%-44s %8.1f ns/op\n", name, ns);
+}
+
+class BenchSensor : public Sensor<SHT4xAirSensorMessage> {
+public:
+    BenchSensor() : Sensor("bench", 1, 0, 100) {}
+
+    void init() override {}
+
+    SHT4xAirSensorMessage next;
+
+protected:
+    SHT4xAirSensorMessage readSensor() override { return next; }
+};
+
+int main() {
+    std::vector<float> values(4096);
+    std::mt19937 random(3);
+    std::normal_distribution<float> normal(21, 3);
+    for (float& value : values) value = normal(random);
+
+    BenchSensor sensor;
+    sensor.resetSchedule(hostNow);
+    bench("Sensor<T> poll and record a reading", [&](uint32_t i) {
+        sensor.next = SHT4xAirSensorMessage(values[i % values.size()], 50);
+        hostNow++;
+        sink = sensor.poll(hostNow);
+    });
+
+    MetadataSensorMessage metadata;
+    bench("Sensor<T> metadata of a measurement", [&](uint32_t i) {
+        sensor.getMetadata(i % 2, metadata);
+        sink = metadata.variance;
+    });
+
+    MeasurementAggregate aggregates[SHT4xAirSensorMessage::ValueCount];
+    bench("Sensor<T> record a reading and take a window", [&](uint32_t i) {
+        sensor.next = SHT4xAirSensorMessage(values[i % values.size()], 50);
+        hostNow++;
+        sensor.poll(hostNow);
+        sink = sensor.takeWindow(aggregates, SHT4xAirSensorMessage::ValueCount, hostNow);
+
+        // The shim of the history keeps every point
+        if (i % 4096 == 0)
+            SensorHistory::getInstance().points.clear();
+    });
+
+    return 0;
+}
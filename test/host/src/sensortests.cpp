@@ -0,0 +1,308 @@
+#include <Arduino.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "helpers/ringBuffer.h"
+#include "sensor/generic/sensor.h"
+#include "sensor/types/SHT4x/SHT4xAirSensorMessage.h"
+
+#include "hostClock.h"
+
+// Unit tests of the sensor framework, every result is checked against a brute force recompute
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(condition)                                                 \
+    do {                                                                 \
+        checks++;                                                        \
+        if (!(condition)) {                                              \
+            failures++;                                                  \
+            printf("%s:%d: failed %s\n", __FILE__, __LINE__, #condition); \
+        }                                                                \
+    } while (0)
+
+static bool isNear(double value, double expected, double tolerance = 1e-6) {
+    return fabs(value - expected) <= tolerance * std::max(1.0, fabs(expected));
+}
+
+struct BruteStats {
+    uint32_t count = 0;
+    uint32_t missing = 0;
+    double mean = 0;
+    double variance = 0;
+};
+
+static BruteStats computeStats(const std::vector<float>& values) {
+    BruteStats stats;
+    double sum = 0;
+    for (float value : values) {
+        if (value == SENSOR_MISSING_VALUE) {
+            stats.missing++;
+            continue;
+        }
+        stats.count++;
+        sum += value;
+    }
+
+    if (stats.count == 0)
+        return stats;
+
+    stats.mean = sum / stats.count;
+    for (float value : values) {
+        if (value != SENSOR_MISSING_VALUE)
+            stats.variance += (value - stats.mean) * (value - stats.mean);
+    }
+    stats.variance /= stats.count;
+
+    return stats;
+}
+
+static void testRingBuffer() {
+    RingBuffer<int, 7> buffer;
+    std::deque<int> expected;
+
+    CHECK(buffer.isEmpty());
+    CHECK(buffer.capacity() == 7);
+
+    for (int value = 0; value < 100; value++) {
+        int evicted = -1;
+        bool full = buffer.push(value, &evicted);
+
+        CHECK(full == (expected.size() == 7));
+        if (full) {
+            CHECK(evicted == expected.front());
+            expected.pop_front();
+        }
+        expected.push_back(value);
+
+        CHECK(buffer.size() == expected.size());
+        CHECK(buffer.last() == value);
+        for (size_t i = 0; i < expected.size(); i++) {
+            CHECK(buffer[i] == expected[i]);
+        }
+    }
+
+    CHECK(buffer.isFull());
+    buffer.clear();
+    CHECK(buffer.isEmpty());
+}
+
+/**
+ * @brief Sensor that reads the values set by the test, or never finishes the conversion
+ *
+ */
+template <typename T>
+class ScriptedSensor : public Sensor<T> {
+public:
+    ScriptedSensor(uint32_t sampleEvery, float deadband, uint32_t timeout)
+        : Sensor<T>("scripted", sampleEvery, deadband, timeout) {}
+
+    void init() override {}
+
+    T next;
+    bool hang = false;
+
+protected:
+    bool isConversionReady(uint32_t now) override {
+        return !hang && SensorBase::isConversionReady(now);
+    }
+
+    T readSensor() override { return next; }
+};
+
+/**
+ * @brief Poll the sensor until it records a reading, the clock moves to each requested poll
+ *
+ */
+template <typename T>
+static void sample(ScriptedSensor<T>& sensor, const T& reading) {
+    sensor.next = reading;
+
+    uint32_t wait = sensor.poll(hostNow);
+    while (sensor.isConverting()) {
+        hostNow += std::max<uint32_t>(wait, 1);
+        wait = sensor.poll(hostNow);
+    }
+
+    hostNow += wait;
+}
+
+static void testSensorStatistics() {
+    typedef SHT4xAirSensorMessage Reading;
+
+    std::mt19937 random(2);
+    std::normal_distribution<float> temperature(21, 3);
+    std::uniform_real_distribution<float> humidity(30, 90);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    // Only the absolute deadbands of the measurements
+    ScriptedSensor<Reading> sensor(1000, 0, 500);
+    sensor.resetSchedule(hostNow);
+
+    SensorHistory::getInstance().points.clear();
+
+    std::vector<Reading> readings;
+    std::vector<float> window[Reading::ValueCount];
+    uint32_t windows = 0;
+    uint32_t storedPoints = 0;
+    uint32_t suppressed[Reading::ValueCount] = {};
+    float lastReported[Reading::ValueCount] = {};
+    uint32_t lastReportTime[Reading::ValueCount] = {};
+    bool reported[Reading::ValueCount] = {};
+
+    for (int i = 0; i < 2000; i++) {
+        Reading reading(temperature(random), humidity(random));
+        if (percent(random) < 10)
+            reading.temperature = SENSOR_MISSING_VALUE;
+        if (percent(random) < 5)
+            reading.humidity = SENSOR_MISSING_VALUE;
+
+        // Some conversions time out and are recorded as missing
+        sensor.hang = percent(random) < 3;
+        if (sensor.hang)
+            reading = Reading::missing();
+
+        sample(sensor, reading);
+        readings.push_back(reading);
+
+        for (uint8_t value = 0; value < Reading::ValueCount; value++) {
+            if (reading.getValue(value) != SENSOR_MISSING_VALUE)
+                window[value].push_back(reading.getValue(value));
+        }
+
+        // Statistics of the last STORED_SENSOR_DATA readings
+        size_t first = readings.size() > STORED_SENSOR_DATA
+                           ? readings.size() - STORED_SENSOR_DATA
+                           : 0;
+        for (uint8_t value = 0; value < Reading::ValueCount; value++) {
+            std::vector<float> values;
+            for (size_t j = first; j < readings.size(); j++) {
+                values.push_back(readings[j].getValue(value));
+            }
+            BruteStats expected = computeStats(values);
+
+            MetadataSensorMessage metadata;
+            sensor.getMetadata(value, metadata);
+
+            CHECK(metadata.type == Reading::getType(value));
+            CHECK(metadata.sampleSize == expected.count);
+            CHECK(metadata.missingValues == expected.missing);
+            CHECK(isNear(metadata.variance, expected.variance, 1e-4));
+            CHECK(isNear(metadata.stDev, sqrt(expected.variance), 1e-4));
+        }
+
+        // A window every 37 readings
+        if (i % 37 != 36)
+            continue;
+
+        MeasurementAggregate aggregates[Reading::ValueCount];
+        uint8_t count = sensor.takeWindow(aggregates, Reading::ValueCount, hostNow);
+        windows++;
+
+        uint8_t expectedCount = 0;
+        for (uint8_t value = 0; value < Reading::ValueCount; value++) {
+            std::vector<float>& values = window[value];
+            if (values.empty())
+                continue;
+
+            double sum = 0;
+            for (float element : values) sum += element;
+            float mean = sum / values.size();
+
+            // Every mean is stored, only the ones out of the deadband are reported
+            std::vector<SensorHistory::Point>& points = SensorHistory::getInstance().points;
+            CHECK(storedPoints < points.size() &&
+                  points[storedPoints].type == Reading::getType(value) &&
+                  isNear(points[storedPoints].value, mean, 1e-5));
+            storedPoints++;
+
+            float band = getMeasurementDeadband(Reading::getType(value));
+            if (reported[value] && hostNow - lastReportTime[value] < SENSOR_HEARTBEAT &&
+                fabs(mean - lastReported[value]) <= band) {
+                suppressed[value] += values.size();
+                values.clear();
+                continue;
+            }
+
+            MeasurementAggregate& aggregate = aggregates[expectedCount++];
+
+            CHECK(aggregate.type == Reading::getType(value));
+            CHECK(aggregate.count == values.size());
+            CHECK(aggregate.min == *std::min_element(values.begin(), values.end()));
+            CHECK(aggregate.max == *std::max_element(values.begin(), values.end()));
+            CHECK(aggregate.last == values.back());
+            CHECK(isNear(aggregate.mean, mean, 1e-5));
+
+            reported[value] = true;
+            lastReported[value] = aggregate.mean;
+            lastReportTime[value] = hostNow;
+            values.clear();
+        }
+        CHECK(count == expectedCount);
+
+        for (uint8_t value = 0; value < Reading::ValueCount; value++) {
+            MetadataSensorMessage metadata;
+            sensor.getMetadata(value, metadata);
+            CHECK(metadata.suppressedValues == suppressed[value]);
+        }
+    }
+
+    CHECK(windows > 0);
+    CHECK(SensorHistory::getInstance().points.size() == storedPoints);
+}
+
+static void testSensorDeadband() {
+    typedef SHT4xAirSensorMessage Reading;
+
+    // Temperature band: max(TEMPERATURE_DEADBAND, 2% of the last reported value)
+    ScriptedSensor<Reading> sensor(1000, 0.02, 500);
+    sensor.resetSchedule(hostNow);
+
+    MeasurementAggregate aggregates[Reading::ValueCount];
+
+    auto window = [&](float temperature) {
+        for (int i = 0; i < 5; i++) {
+            sample(sensor, Reading(temperature, SENSOR_MISSING_VALUE));
+        }
+        return sensor.takeWindow(aggregates, Reading::ValueCount, hostNow);
+    };
+
+    // The first window is always reported
+    CHECK(window(20) == 1);
+    CHECK(aggregates[0].type == MeasurementTemperature);
+
+    // Inside the band of 0.4 around 20
+    CHECK(window(20.3) == 0);
+
+    MetadataSensorMessage metadata;
+    sensor.getMetadata(0, metadata);
+    CHECK(metadata.suppressedValues == 5);
+
+    // Out of the band
+    CHECK(window(21) == 1);
+    CHECK(isNear(aggregates[0].mean, 21, 1e-6));
+
+    // The heartbeat reports the same value again
+    CHECK(window(21) == 0);
+    hostNow += SENSOR_HEARTBEAT;
+    sensor.resetSchedule(hostNow);
+    CHECK(window(21) == 1);
+
+    // Humidity never had a sample, it is never reported
+    sensor.getMetadata(1, metadata);
+    CHECK(metadata.sampleSize == 0);
+    CHECK(metadata.missingValues == STORED_SENSOR_DATA);
+}
+
+int main() {
+    testRingBuffer();
+    testSensorStatistics();
+    testSensorDeadband();
+
+    printf("%d checks, %d failed\n", checks, failures);
+
+    return failures == 0 ? 0 : 1;
+}
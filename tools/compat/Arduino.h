@@ -0,0 +1,210 @@
+#pragma once
+
+// Host replacement of the parts of the Arduino-ESP32 core used by the firmware sources that the
+// host tools link. Each tool implements millis(), its clock, and hostVerbose. The FreeRTOS
+// primitives are no-ops, the tools run in a single thread.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <type_traits>
+
+#define HEX 16
+#define DEC 10
+
+/**
+ * @brief Milliseconds of the clock of the tool
+ *
+ */
+uint32_t millis();
+
+class String {
+public:
+    String() {}
+
+    String(const char* value) : value(value == nullptr ? "" : value) {}
+
+    String(const std::string& value) : value(value) {}
+
+    String(char character) : value(1, character) {}
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value &&
+                                                      !std::is_same<T, char>::value,
+                                                  int>::type = 0>
+    String(T number, int base = DEC) {
+        char buffer[24];
+        if (base == HEX)
+            snprintf(buffer, sizeof(buffer), "%llx", (unsigned long long)number);
+        else if (std::is_signed<T>::value)
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)number);
+        else
+            snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)number);
+        value = buffer;
+    }
+
+    String(double number, int decimals = 2) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, number);
+        value = buffer;
+    }
+
+    const char* c_str() const { return value.c_str(); }
+
+    unsigned int length() const { return value.size(); }
+
+    char charAt(unsigned int index) const { return index < value.size() ? value[index] : 0; }
+
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    int indexOf(char character, unsigned int from = 0) const {
+        size_t index = value.find(character, from);
+        return index == std::string::npos ? -1 : (int)index;
+    }
+
+    int indexOf(const String& other, unsigned int from = 0) const {
+        size_t index = value.find(other.value, from);
+        return index == std::string::npos ? -1 : (int)index;
+    }
+
+    int lastIndexOf(char character) const {
+        size_t index = value.rfind(character);
+        return index == std::string::npos ? -1 : (int)index;
+    }
+
+    String substring(unsigned int from) const {
+        return from < value.size() ? value.substr(from) : std::string();
+    }
+
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to)
+            std::swap(from, to);
+        return from < value.size() ? value.substr(from, to - from) : std::string();
+    }
+
+    void trim() {
+        size_t start = 0;
+        while (start < value.size() && isspace((unsigned char)value[start]))
+            start++;
+        size_t end = value.size();
+        while (end > start && isspace((unsigned char)value[end - 1]))
+            end--;
+        value = value.substr(start, end - start);
+    }
+
+    long toInt() const { return strtol(value.c_str(), NULL, 10); }
+
+    bool equals(const String& other) const { return value == other.value; }
+
+    bool equalsIgnoreCase(const String& other) const {
+        return value.size() == other.value.size() &&
+               std::equal(value.begin(), value.end(), other.value.begin(), [](char a, char b) {
+                   return tolower((unsigned char)a) == tolower((unsigned char)b);
+               });
+    }
+
+    bool startsWith(const String& prefix) const { return value.rfind(prefix.value, 0) == 0; }
+
+    String& operator+=(const String& other) {
+        value += other.value;
+        return *this;
+    }
+
+    bool operator==(const String& other) const { return value == other.value; }
+
+    bool operator!=(const String& other) const { return value != other.value; }
+
+    friend String operator+(const String& a, const String& b) { return a.value + b.value; }
+
+    friend String operator+(const String& a, const char* b) { return a.value + b; }
+
+    friend String operator+(const char* a, const String& b) { return a + b.value; }
+
+    const std::string& str() const { return value; }
+
+private:
+    std::string value;
+};
+
+inline bool isHexadecimalDigit(char character) {
+    return isxdigit((unsigned char)character);
+}
+
+// GPIO, the tools have no pins
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+// ESP-IDF log macros, printed to stderr when the tool runs with --verbose
+
+extern bool hostVerbose;
+
+#define HOST_LOG(level, tag, format, ...)                                                   \
+    do {                                                                                    \
+        if (hostVerbose)                                                                    \
+            fprintf(stderr, "%c (%u) %s: " format "\n", level, millis(), tag, ##__VA_ARGS__); \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG('E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG('W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG('I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG('D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG('V', tag, format, ##__VA_ARGS__)
+
+// Serial output, printed to stderr with the logs
+
+class HostSerial {
+public:
+    void print(const String& text) {
+        if (hostVerbose)
+            fputs(text.c_str(), stderr);
+    }
+
+    void println(const String& text = "") { print(text + "\n"); }
+};
+
+inline HostSerial Serial;
+
+// FreeRTOS
+
+typedef void* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef QueueHandle_t xQueueHandle;
+
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_PERIOD_MS 1
+
+// The tools move their clock themselves, a task never waits
+inline void vTaskDelay(uint32_t) {}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    static int mutex;
+    return &mutex;
+}
+
+inline int xSemaphoreTake(SemaphoreHandle_t, uint32_t) { return 1; }
+
+inline int xSemaphoreGive(SemaphoreHandle_t) { return 1; }
+
+// Allocations made with pvPortMalloc, a tool that replaces the global new counts them too
+inline uint64_t hostAllocations = 0;
+
+inline void* pvPortMalloc(size_t size) {
+    hostAllocations++;
+    return malloc(size);
+}
+
+inline void vPortFree(void* pointer) { free(pointer); }
@@ -0,0 +1,658 @@
+#pragma once
+
+// Host replacement of the part of ArduinoJson 6 used by the message headers and the
+// MessageManager: documents, objects, arrays and variants with their conversions,
+// serializeJson and deserializeJson. The tree is built with the standard containers, the
+// capacity of the documents is ignored.
+
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+class JsonNode {
+public:
+    enum Type { Null, Bool, Signed, Unsigned, Float, Text, Object, Array };
+
+    Type type = Null;
+    bool boolean = false;
+    int64_t integer = 0;
+    uint64_t natural = 0;
+    double real = 0;
+    std::string text;
+
+    // Members in insertion order, as ArduinoJson serializes them
+    std::vector<std::pair<std::string, std::unique_ptr<JsonNode>>> members;
+    std::vector<std::unique_ptr<JsonNode>> elements;
+
+    JsonNode* find(const char* key) {
+        for (auto& member : members) {
+            if (member.first == key)
+                return member.second.get();
+        }
+        return nullptr;
+    }
+
+    JsonNode* addMember(const char* key) {
+        JsonNode* node = find(key);
+        if (node != nullptr)
+            return node;
+
+        if (type != Object)
+            clear(Object);
+        members.emplace_back(key, std::unique_ptr<JsonNode>(new JsonNode()));
+        return members.back().second.get();
+    }
+
+    JsonNode* addElement() {
+        if (type != Array)
+            clear(Array);
+        elements.emplace_back(new JsonNode());
+        return elements.back().get();
+    }
+
+    void clear(Type newType) {
+        members.clear();
+        elements.clear();
+        text.clear();
+        type = newType;
+    }
+
+    template <typename T>
+    T get() const {
+        switch (type) {
+            case Bool:
+                return (T)boolean;
+            case Signed:
+                return (T)integer;
+            case Unsigned:
+                return (T)natural;
+            case Float:
+                return (T)real;
+            default:
+                return T();
+        }
+    }
+
+    template <typename T>
+    void set(T value) {
+        clear(Null);
+        if (std::is_same<T, bool>::value) {
+            type = Bool;
+            boolean = value;
+        } else if (std::is_floating_point<T>::value) {
+            type = Float;
+            real = value;
+        } else if (std::is_signed<T>::value) {
+            type = Signed;
+            integer = value;
+        } else {
+            type = Unsigned;
+            natural = value;
+        }
+    }
+
+    void setText(const char* value) {
+        clear(value == nullptr ? Null : Text);
+        if (value != nullptr)
+            text = value;
+    }
+};
+
+class JsonArray;
+class JsonObject;
+
+// Enums are stored as their underlying integer type
+template <typename T, bool = std::is_enum<T>::value>
+struct Arithmetic {
+    typedef T type;
+};
+
+template <typename T>
+struct Arithmetic<T, true> {
+    typedef typename std::underlying_type<T>::type type;
+};
+
+/**
+ * @brief Reference to a node, or to the member or element of a node that may not exist yet. The
+ * member is created when it is written, reading a missing one gives the default value.
+ *
+ */
+class JsonVariant {
+public:
+    JsonVariant() {}
+
+    JsonVariant(JsonNode* node) : node(node) {}
+
+    JsonVariant(JsonNode* parent, const char* key) : parent(parent), key(key) {
+        if (parent != nullptr && parent->type == JsonNode::Object)
+            node = parent->find(key);
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                                      int>::type = 0>
+    JsonVariant& operator=(T value) {
+        JsonNode* target = getOrCreate();
+        if (target != nullptr)
+            target->set(static_cast<typename Arithmetic<T>::type>(value));
+        return *this;
+    }
+
+    JsonVariant& operator=(const char* value) {
+        JsonNode* target = getOrCreate();
+        if (target != nullptr)
+            target->setText(value);
+        return *this;
+    }
+
+    JsonVariant& operator=(const String& value) { return *this = value.c_str(); }
+
+    template <typename T>
+    T as() const {
+        return convert<T>();
+    }
+
+    template <typename T,
+              typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                                      int>::type = 0>
+    operator T() const {
+        return convert<T>();
+    }
+
+    operator String() const { return node != nullptr ? String(node->text) : String(); }
+
+    operator JsonObject() const;
+
+    operator JsonArray() const;
+
+    JsonVariant operator[](const char* member) const { return JsonVariant(getOrCreate(), member); }
+
+    JsonVariant operator[](const String& member) const { return (*this)[member.c_str()]; }
+
+    JsonVariant operator[](size_t index) const {
+        if (node == nullptr || node->type != JsonNode::Array || index >= node->elements.size())
+            return JsonVariant();
+        return JsonVariant(node->elements[index].get());
+    }
+
+    JsonVariant operator[](int index) const { return (*this)[(size_t)index]; }
+
+    bool containsKey(const char* member) const {
+        return node != nullptr && node->type == JsonNode::Object && node->find(member) != nullptr;
+    }
+
+    bool isNull() const { return node == nullptr || node->type == JsonNode::Null; }
+
+    size_t size() const {
+        if (node == nullptr)
+            return 0;
+        return node->type == JsonNode::Array ? node->elements.size() : node->members.size();
+    }
+
+    JsonObject createNestedObject(const char* member) const;
+
+    JsonArray createNestedArray(const char* member) const;
+
+    JsonObject createNestedObject() const;
+
+    JsonArray createNestedArray() const;
+
+    template <typename T>
+    bool add(T value) const {
+        JsonNode* target = getOrCreate();
+        if (target == nullptr)
+            return false;
+        JsonVariant(target->addElement()) = value;
+        return true;
+    }
+
+    JsonNode* getNode() const { return node; }
+
+protected:
+    mutable JsonNode* node = nullptr;
+    JsonNode* parent = nullptr;
+    std::string key;
+
+    JsonNode* getOrCreate() const {
+        if (node == nullptr && parent != nullptr)
+            node = parent->addMember(key.c_str());
+        return node;
+    }
+
+    template <typename T>
+    T convert() const {
+        if (node == nullptr)
+            return T();
+        return static_cast<T>(node->get<typename Arithmetic<T>::type>());
+    }
+};
+
+template <>
+inline String JsonVariant::as<String>() const {
+    return node != nullptr ? String(node->text) : String();
+}
+
+template <>
+inline const char* JsonVariant::as<const char*>() const {
+    return node != nullptr && node->type == JsonNode::Text ? node->text.c_str() : nullptr;
+}
+
+template <typename T>
+T operator|(const JsonVariant& variant, const T& defaultValue) {
+    return variant.isNull() ? defaultValue : variant.as<T>();
+}
+
+template <typename T,
+          typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                                  int>::type = 0>
+bool operator==(const JsonVariant& variant, T value) {
+    return variant.as<T>() == value;
+}
+
+template <typename T,
+          typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                                  int>::type = 0>
+bool operator!=(const JsonVariant& variant, T value) {
+    return !(variant == value);
+}
+
+class JsonObject : public JsonVariant {
+public:
+    JsonObject() {}
+
+    JsonObject(JsonNode* node) : JsonVariant(node) {
+        if (node != nullptr && node->type != JsonNode::Object)
+            node->clear(JsonNode::Object);
+    }
+};
+
+class JsonArray : public JsonVariant {
+public:
+    class Iterator {
+    public:
+        Iterator(JsonNode* node, size_t index) : node(node), index(index) {}
+
+        JsonVariant operator*() const { return JsonVariant(node->elements[index].get()); }
+
+        Iterator& operator++() {
+            index++;
+            return *this;
+        }
+
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+    private:
+        JsonNode* node;
+        size_t index;
+    };
+
+    JsonArray() {}
+
+    JsonArray(JsonNode* node) : JsonVariant(node) {
+        if (node != nullptr && node->type != JsonNode::Array)
+            node->clear(JsonNode::Array);
+    }
+
+    Iterator begin() const { return Iterator(node, 0); }
+
+    Iterator end() const {
+        return Iterator(node, node != nullptr && node->type == JsonNode::Array
+                                  ? node->elements.size()
+                                  : 0);
+    }
+};
+
+inline JsonVariant::operator JsonObject() const {
+    return node != nullptr && node->type == JsonNode::Object ? JsonObject(node) : JsonObject();
+}
+
+inline JsonVariant::operator JsonArray() const {
+    return node != nullptr && node->type == JsonNode::Array ? JsonArray(node) : JsonArray();
+}
+
+inline JsonObject JsonVariant::createNestedObject(const char* member) const {
+    JsonNode* target = getOrCreate();
+    if (target == nullptr)
+        return JsonObject();
+    JsonNode* child = target->addMember(member);
+    child->clear(JsonNode::Object);
+    return JsonObject(child);
+}
+
+inline JsonArray JsonVariant::createNestedArray(const char* member) const {
+    JsonNode* target = getOrCreate();
+    if (target == nullptr)
+        return JsonArray();
+    JsonNode* child = target->addMember(member);
+    child->clear(JsonNode::Array);
+    return JsonArray(child);
+}
+
+inline JsonObject JsonVariant::createNestedObject() const {
+    JsonNode* target = getOrCreate();
+    if (target == nullptr)
+        return JsonObject();
+    return JsonObject(target->addElement());
+}
+
+inline JsonArray JsonVariant::createNestedArray() const {
+    JsonNode* target = getOrCreate();
+    if (target == nullptr)
+        return JsonArray();
+    JsonNode* child = target->addElement();
+    child->clear(JsonNode::Array);
+    return JsonArray(child);
+}
+
+class JsonDocument : public JsonVariant {
+public:
+    JsonDocument() : JsonVariant(new JsonNode()), root(node) {}
+
+    JsonDocument(const JsonDocument&) = delete;
+
+    JsonDocument& operator=(const JsonDocument&) = delete;
+
+    template <typename T>
+    T to() {
+        root->clear(std::is_same<T, JsonArray>::value ? JsonNode::Array : JsonNode::Object);
+        return T(root.get());
+    }
+
+    void clear() { root->clear(JsonNode::Null); }
+
+private:
+    std::unique_ptr<JsonNode> root;
+};
+
+template <size_t capacity>
+class StaticJsonDocument : public JsonDocument {};
+
+class DynamicJsonDocument : public JsonDocument {
+public:
+    DynamicJsonDocument(size_t) {}
+};
+
+class DeserializationError {
+public:
+    enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput };
+
+    DeserializationError(Code code = Ok) : code(code) {}
+
+    explicit operator bool() const { return code != Ok; }
+
+    const char* c_str() const {
+        static const char* names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput"};
+        return names[code];
+    }
+
+private:
+    Code code;
+};
+
+namespace compatJson {
+
+inline void writeText(const std::string& text, std::string& output) {
+    output += '"';
+    for (char character : text) {
+        switch (character) {
+            case '"':
+                output += "\\\"";
+                break;
+            case '\\':
+                output += "\\\\";
+                break;
+            case '\n':
+                output += "\\n";
+                break;
+            case '\r':
+                output += "\\r";
+                break;
+            case '\t':
+                output += "\\t";
+                break;
+            default:
+                output += character;
+        }
+    }
+    output += '"';
+}
+
+inline void write(const JsonNode* node, std::string& output) {
+    char buffer[32];
+
+    switch (node->type) {
+        case JsonNode::Null:
+            output += "null";
+            break;
+        case JsonNode::Bool:
+            output += node->boolean ? "true" : "false";
+            break;
+        case JsonNode::Signed:
+            snprintf(buffer, sizeof(buffer), "%lld", (long long)node->integer);
+            output += buffer;
+            break;
+        case JsonNode::Unsigned:
+            snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)node->natural);
+            output += buffer;
+            break;
+        case JsonNode::Float:
+            snprintf(buffer, sizeof(buffer), "%.9g", node->real);
+            output += buffer;
+            break;
+        case JsonNode::Text:
+            writeText(node->text, output);
+            break;
+        case JsonNode::Object: {
+            output += '{';
+            bool first = true;
+            for (auto& member : node->members) {
+                if (!first)
+                    output += ',';
+                first = false;
+                writeText(member.first, output);
+                output += ':';
+                write(member.second.get(), output);
+            }
+            output += '}';
+            break;
+        }
+        case JsonNode::Array: {
+            output += '[';
+            for (size_t i = 0; i < node->elements.size(); i++) {
+                if (i > 0)
+                    output += ',';
+                write(node->elements[i].get(), output);
+            }
+            output += ']';
+            break;
+        }
+    }
+}
+
+class Reader {
+public:
+    Reader(const char* input) : input(input) {}
+
+    DeserializationError::Code parse(JsonNode* node) {
+        skipSpaces();
+        if (*input == '\0')
+            return DeserializationError::IncompleteInput;
+
+        if (*input == '{')
+            return parseObject(node);
+        if (*input == '[')
+            return parseArray(node);
+        if (*input == '"') {
+            node->clear(JsonNode::Text);
+            return parseText(node->text);
+        }
+        if (strncmp(input, "true", 4) == 0 || strncmp(input, "false", 5) == 0) {
+            node->set(*input == 't');
+            input += *input == 't' ? 4 : 5;
+            return DeserializationError::Ok;
+        }
+        if (strncmp(input, "null", 4) == 0) {
+            node->clear(JsonNode::Null);
+            input += 4;
+            return DeserializationError::Ok;
+        }
+        return parseNumber(node);
+    }
+
+private:
+    const char* input;
+
+    void skipSpaces() {
+        while (isspace((unsigned char)*input))
+            input++;
+    }
+
+    DeserializationError::Code parseObject(JsonNode* node) {
+        node->clear(JsonNode::Object);
+        input++;
+        skipSpaces();
+        if (*input == '}') {
+            input++;
+            return DeserializationError::Ok;
+        }
+
+        for (;;) {
+            skipSpaces();
+            std::string key;
+            if (*input != '"')
+                return *input == '\0' ? DeserializationError::IncompleteInput
+                                      : DeserializationError::InvalidInput;
+            DeserializationError::Code code = parseText(key);
+            if (code != DeserializationError::Ok)
+                return code;
+
+            skipSpaces();
+            if (*input != ':')
+                return DeserializationError::InvalidInput;
+            input++;
+
+            code = parse(node->addMember(key.c_str()));
+            if (code != DeserializationError::Ok)
+                return code;
+
+            skipSpaces();
+            if (*input == ',') {
+                input++;
+                continue;
+            }
+            if (*input == '}') {
+                input++;
+                return DeserializationError::Ok;
+            }
+            return *input == '\0' ? DeserializationError::IncompleteInput
+                                  : DeserializationError::InvalidInput;
+        }
+    }
+
+    DeserializationError::Code parseArray(JsonNode* node) {
+        node->clear(JsonNode::Array);
+        input++;
+        skipSpaces();
+        if (*input == ']') {
+            input++;
+            return DeserializationError::Ok;
+        }
+
+        for (;;) {
+            DeserializationError::Code code = parse(node->addElement());
+            if (code != DeserializationError::Ok)
+                return code;
+
+            skipSpaces();
+            if (*input == ',') {
+                input++;
+                continue;
+            }
+            if (*input == ']') {
+                input++;
+                return DeserializationError::Ok;
+            }
+            return *input == '\0' ? DeserializationError::IncompleteInput
+                                  : DeserializationError::InvalidInput;
+        }
+    }
+
+    DeserializationError::Code parseText(std::string& text) {
+        input++;
+        while (*input != '"') {
+            if (*input == '\0')
+                return DeserializationError::IncompleteInput;
+            if (*input == '\\') {
+                input++;
+                switch (*input) {
+                    case 'n':
+                        text += '\n';
+                        break;
+                    case 'r':
+                        text += '\r';
+                        break;
+                    case 't':
+                        text += '\t';
+                        break;
+                    case '\0':
+                        return DeserializationError::IncompleteInput;
+                    default:
+                        text += *input;
+                }
+            } else {
+                text += *input;
+            }
+            input++;
+        }
+        input++;
+        return DeserializationError::Ok;
+    }
+
+    DeserializationError::Code parseNumber(JsonNode* node) {
+        char* end;
+        const char* start = input;
+        bool real = false;
+        for (const char* c = input; *c != '\0' && strchr("+-0123456789.eE", *c) != nullptr; c++) {
+            if (*c == '.' || *c == 'e' || *c == 'E')
+                real = true;
+        }
+
+        if (real)
+            node->set(strtod(start, &end));
+        else if (*start == '-')
+            node->set((int64_t)strtoll(start, &end, 10));
+        else
+            node->set((uint64_t)strtoull(start, &end, 10));
+
+        if (end == start)
+            return DeserializationError::InvalidInput;
+        input = end;
+        return DeserializationError::Ok;
+    }
+};
+
+}  // namespace compatJson
+
+inline size_t serializeJson(const JsonVariant& variant, String& output) {
+    std::string json;
+    if (variant.getNode() != nullptr)
+        compatJson::write(variant.getNode(), json);
+    else
+        json = "null";
+    output = json;
+    return json.size();
+}
+
+inline DeserializationError deserializeJson(JsonDocument& document, const char* input) {
+    if (input == nullptr || *input == '\0')
+        return DeserializationError::EmptyInput;
+
+    document.clear();
+    return compatJson::Reader(input).parse(document.getNode());
+}
+
+inline DeserializationError deserializeJson(JsonDocument& document, const String& input) {
+    return deserializeJson(document, input.c_str());
+}
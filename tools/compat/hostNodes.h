@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Firmware singletons per virtual node, for the host tools that run many nodes in one
+ * process. With HOST_NODES the getInstance of the firmware classes that support it returns the
+ * instance of the selected node, created on first use. The tool selects the node before it calls
+ * the firmware code for an event of that node.
+ *
+ */
+class HostNodes {
+public:
+    static void select(uint16_t node) { selected = node; }
+
+    static uint16_t getSelected() { return selected; }
+
+    template <class T>
+    static T& instance() {
+        static std::vector<std::unique_ptr<T>> instances;
+
+        if (instances.size() <= selected)
+            instances.resize(selected + 1);
+
+        if (!instances[selected])
+            instances[selected].reset(new T());
+
+        return *instances[selected];
+    }
+
+private:
+    static inline uint16_t selected = 0;
+};
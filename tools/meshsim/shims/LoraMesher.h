@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// The types of the LoRaMesher library used by the firmware Sim messages. The simulator models the
+// routing of LoRaMesher itself, see SimNode.
+
+struct LM_PacketHeader {
+    uint8_t type;
+    uint8_t id;
+    uint8_t packetSize;
+    uint16_t src;
+    uint16_t dst;
+    uint16_t via;
+    uint8_t seq_id;
+    uint16_t number;
+};
+
+struct LM_State {
+    uint32_t id;
+    uint8_t type;
+    uint8_t receivedQueueSize;
+    uint8_t sentQueueSize;
+    uint8_t receivedUserQueueSize;
+    uint8_t q_WRPSize;
+    uint8_t q_WSPSize;
+    uint8_t routingTableSize;
+    uint32_t secondsSinceStart;
+    uint32_t freeMemoryAllocation;
+    LM_PacketHeader packetHeader;
+};
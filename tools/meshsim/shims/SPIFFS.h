@@ -0,0 +1,5 @@
+#pragma once
+
+// The simulated nodes have no flash, the firmware headers only declare members of these types
+
+class File {};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hostNodes.h"
+
+#include "message/dataMessage.h"
+
+#include "loramesh/delivery.h"
+
+#define BROADCAST_ADDR 0xFFFF
+
+class SimNode;
+
+/**
+ * @brief Host replacement of the LoRaMesher service, one per virtual node. The MessageManager of
+ * the node sends through it and the SimNode routes the messages over the simulated radio.
+ *
+ */
+class LoRaMeshService {
+public:
+    static LoRaMeshService& getInstance() { return HostNodes::instance<LoRaMeshService>(); }
+
+    void setNode(SimNode* node) { this->node = node; }
+
+    SimNode* getNode() { return node; }
+
+    uint16_t getLocalAddress();
+
+    void send(DataMessage* message, DeliveryMode mode = DefaultDelivery,
+              DeliveryCallback callback = nullptr);
+
+    /**
+     * @brief Send to the closest gateway
+     *
+     * @return false If the node has no route to a gateway
+     */
+    bool sendClosestGateway(DataMessage* message, DeliveryMode mode = DefaultDelivery,
+                            DeliveryCallback callback = nullptr);
+
+private:
+    friend class HostNodes;
+
+    LoRaMeshService() {}
+
+    SimNode* node = nullptr;
+};
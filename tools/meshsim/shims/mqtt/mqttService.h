@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "hostNodes.h"
+
+#include "message/messageService.h"
+
+/**
+ * @brief Host replacement of the MQTT service, one per virtual node. At the gateways it is
+ * connected and registered in the MessageManager as the firmware service: the messages for
+ * MQTTApp are converted to JSON with MessageManager::getJSON and handed to the simulator as
+ * published.
+ *
+ */
+class MqttService : public MessageService {
+public:
+    static MqttService& getInstance() { return HostNodes::instance<MqttService>(); }
+
+    bool isInitialized() { return initialized; }
+
+    void setInitialized(bool value) { initialized = value; }
+
+    bool writeToMqtt(DataMessage* message);
+
+    void processReceivedMessage(messagePort port, DataMessage* message) override {
+        writeToMqtt(message);
+    }
+
+private:
+    friend class HostNodes;
+
+    MqttService() : MessageService(appPort::MQTTApp, String("MQTT")) {
+        commandService = new CommandService();
+    }
+
+    bool initialized = false;
+};
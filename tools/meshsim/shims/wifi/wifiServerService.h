@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Host replacement of the WiFi service of the MessageManager, never connected. The
+ * gateways reach the server with the MqttService.
+ *
+ */
+class WiFiServerService {
+public:
+    static WiFiServerService& getInstance() {
+        static WiFiServerService instance;
+        return instance;
+    }
+
+    bool isConnected() { return false; }
+};
@@ -0,0 +1,132 @@
+#include <chrono>
+
+#include "meshSim.h"
+
+static void printUsage() {
+    printf("Usage: meshsim [options]\n"
+           "  --nodes N            Nodes, the first ones are the gateways (50)\n"
+           "  --gateways N         Gateways (one every 50 nodes)\n"
+           "  --topology T         random, grid or line (random)\n"
+           "  --area M             Side of the square or length of the line in m (2000 for\n"
+           "                       50 nodes, the same density for more)\n"
+           "  --duration S         Simulated seconds, 0 until the traffic ends (0)\n"
+           "  --seed N             Seed of the placement, shadowing and backoffs (1)\n"
+           "  --sf N               Spreading factor (7)\n"
+           "  --tx-power DBM       Transmission power (14)\n"
+           "  --path-loss N        Path loss exponent (3)\n"
+           "  --shadowing DB       Standard deviation of the shadowing (4)\n"
+           "  --hello-interval MS  HELLO period (120000, longer when a node hears more HELLO\n"
+           "                       frames than in the 50 node mesh)\n"
+           "  --route-timeout MS   Route lifetime without HELLOs (5 HELLO periods)\n"
+           "  --warmup MS          Time before the first Sim packet (5 HELLO periods)\n"
+           "  --packets N          Sim packets per sender (PACKET_COUNT)\n"
+           "  --size B             Payload of the Sim packets (PACKET_SIZE)\n"
+           "  --delay MS           Time between Sim packets (PACKET_DELAY)\n"
+           "  --sender I           Only this node index sends, as ONE_SENDER (all)\n"
+           "  --queue N            Frames per send queue (30)\n"
+           "  --backoff MS         Longest random wait before a transmission (1000)\n"
+           "  --no-duty-cycle      Do not limit the airtime\n"
+           "  --json               One line JSON summary, for the regression scripts\n"
+           "  --verbose            Print the logs of the nodes\n");
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = true;
+
+        if (option == "--no-duty-cycle") {
+            options.dutyCycle = false;
+            hasValue = false;
+        } else if (option == "--json") {
+            options.json = true;
+            hasValue = false;
+        } else if (option == "--verbose") {
+            hostVerbose = true;
+            hasValue = false;
+        } else if (option == "--help" || value == nullptr) {
+            printUsage();
+            return option == "--help" ? 0 : 1;
+        } else if (option == "--nodes") {
+            options.nodes = atoi(value);
+        } else if (option == "--gateways") {
+            options.gateways = atoi(value);
+        } else if (option == "--topology") {
+            options.topology = value;
+        } else if (option == "--area") {
+            options.area = atof(value);
+        } else if (option == "--duration") {
+            options.duration = atol(value);
+        } else if (option == "--seed") {
+            options.seed = strtoull(value, nullptr, 10);
+        } else if (option == "--sf") {
+            options.radio.spreadingFactor = atoi(value);
+        } else if (option == "--tx-power") {
+            options.radio.txPower = atof(value);
+        } else if (option == "--path-loss") {
+            options.radio.pathLossExponent = atof(value);
+        } else if (option == "--shadowing") {
+            options.radio.shadowing = atof(value);
+        } else if (option == "--hello-interval") {
+            options.helloInterval = atol(value);
+        } else if (option == "--route-timeout") {
+            options.routeTimeout = atol(value);
+        } else if (option == "--warmup") {
+            options.warmup = atol(value);
+        } else if (option == "--packets") {
+            options.packetCount = atol(value);
+        } else if (option == "--size") {
+            options.packetSize = atol(value);
+        } else if (option == "--delay") {
+            options.packetDelay = atol(value);
+        } else if (option == "--sender") {
+            options.sender = atoi(value);
+        } else if (option == "--queue") {
+            options.queueSize = atol(value);
+        } else if (option == "--backoff") {
+            options.backoff = atol(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option.c_str());
+            printUsage();
+            return 1;
+        }
+
+        if (hasValue)
+            i++;
+    }
+
+    if (options.nodes == 0 || options.gateways > options.nodes) {
+        fprintf(stderr, "Needs at least one node and no more gateways than nodes\n");
+        return 1;
+    }
+
+    // The Sim packets are not split, they fit in one frame with their headers
+    uint32_t maxPacketSize =
+        LORAMESH_MAX_FRAME_PAYLOAD - sizeof(SimMessage) - sizeof(SimPayloadMessage);
+    if (options.packetSize < 1 || options.packetSize > maxPacketSize) {
+        fprintf(stderr, "The Sim packet size must be between 1 and %u bytes\n", maxPacketSize);
+        return 1;
+    }
+
+    if (options.radio.spreadingFactor < 7 || options.radio.spreadingFactor > 12) {
+        fprintf(stderr, "The spreading factor must be between 7 and 12\n");
+        return 1;
+    }
+
+    MeshSim sim(options);
+
+    auto start = std::chrono::steady_clock::now();
+    sim.run();
+    double wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (options.json)
+        sim.printJSON(wallSeconds);
+    else
+        sim.printSummary(wallSeconds);
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "meshSim.h"
+
+#include <math.h>
+
+#include "scheduler.h"
+
+// ms after the last Sim packet for the network to deliver the packets still in flight
+#define DRAIN_TIME 600000
+
+MeshSim::MeshSim(const SimOptions& options) : options(options), generator(options.seed) {
+    setPlacementDefaults();
+
+    radio.init(options.radio, placeNodes(), options.seed);
+
+    setRoutingDefaults();
+
+    radio.setCallbacks(
+        [this](uint16_t node, const Frame& frame, float snr) {
+            nodes[node]->receive(frame, snr);
+        },
+        [this](uint16_t node) { nodes[node]->sent(); });
+
+    for (uint16_t i = 0; i < options.nodes; i++) {
+        nodes.emplace_back(new SimNode(*this, i, i < this->options.gateways));
+    }
+}
+
+void MeshSim::setPlacementDefaults() {
+    float scale = (float)options.nodes / DEFAULT_NODES;
+
+    if (options.gateways == 0)
+        options.gateways = std::max(1, options.nodes / DEFAULT_NODES);
+
+    if (options.area == 0)
+        options.area = DEFAULT_AREA * (options.topology == "line" ? scale : sqrtf(scale));
+}
+
+static uint32_t getHelloFrames(uint32_t nodes) {
+    return (nodes + HELLO_ENTRIES_PER_FRAME - 1) / HELLO_ENTRIES_PER_FRAME;
+}
+
+void MeshSim::setRoutingDefaults() {
+    if (options.helloInterval == 0) {
+        uint64_t heard = 0;
+        for (uint16_t i = 0; i < options.nodes; i++) {
+            heard += radio.getAudible(i);
+        }
+        heard = heard * getHelloFrames(options.nodes) / options.nodes;
+
+        // In the default mesh every node hears the HELLOs of all the others
+        uint64_t defaultHeard = DEFAULT_NODES * getHelloFrames(DEFAULT_NODES);
+
+        options.helloInterval = std::max<uint64_t>(DEFAULT_HELLO_INTERVAL,
+                                                   DEFAULT_HELLO_INTERVAL * heard / defaultHeard);
+    }
+
+    if (options.routeTimeout == 0)
+        options.routeTimeout = options.helloInterval * DEFAULT_ROUTE_PERIODS;
+
+    if (options.warmup == 0)
+        options.warmup = options.helloInterval * DEFAULT_ROUTE_PERIODS;
+}
+
+std::vector<Position> MeshSim::placeNodes() {
+    std::vector<Position> positions;
+    std::uniform_real_distribution<float> coordinate(0, options.area);
+
+    uint16_t columns = ceil(sqrt(options.nodes));
+    float spacing = options.area / std::max(1, columns - 1);
+    float lineSpacing = options.area / std::max(1, options.nodes - 1);
+
+    for (uint16_t i = 0; i < options.nodes; i++) {
+        if (options.topology == "grid")
+            positions.push_back({(i % columns) * spacing, (i / columns) * spacing});
+        else if (options.topology == "line")
+            positions.push_back({i * lineSpacing, 0});
+        else
+            positions.push_back({coordinate(generator), coordinate(generator)});
+    }
+
+    return positions;
+}
+
+uint32_t MeshSim::random(uint32_t max) {
+    if (max == 0)
+        return 0;
+
+    return generator() % max;
+}
+
+SimNode* MeshSim::getNode(uint16_t address) {
+    if (address == 0 || address > nodes.size())
+        return nullptr;
+
+    return nodes[address - 1].get();
+}
+
+uint64_t MeshSim::getEnd() {
+    if (options.duration != 0)
+        return options.duration * 1000000ULL;
+
+    return (options.warmup + (uint64_t)options.packetDelay * (options.packetCount + 1) +
+            DRAIN_TIME) * 1000ULL;
+}
+
+void MeshSim::run() {
+    for (auto& node : nodes) {
+        bool sender = !node->isGateway() &&
+                      (options.sender < 0 || options.sender == node->getAddress() - 1);
+        node->start(sender);
+    }
+
+    Scheduler::getInstance().run(getEnd());
+
+    // The flows measured since the last report
+    for (auto& node : nodes) {
+        if (node->isGateway())
+            node->reportFlows();
+    }
+}
+
+void MeshSim::published(SimNode& gateway, DataMessage* message, uint8_t hops, size_t jsonSize) {
+    stats.published++;
+    stats.jsonBytes += jsonSize;
+
+    SimMessage* simMessage = (SimMessage*)message;
+
+    if (simMessage->simCommand == SimCommand::FlowReport) {
+        SimFlowReport* report = (SimFlowReport*)simMessage->payload;
+        for (uint8_t i = 0; i < report->count; i++) {
+            SimFlowSummary& flow = report->flows[i];
+            evictions[gateway.getAddress()] = flow.evictions;
+
+            // A new measurement of the flow after an eviction, the previous one is closed
+            auto found = flows.find({gateway.getAddress(), flow.src});
+            if (found != flows.end() && (flow.firstSeq != found->second.firstSeq ||
+                                         flow.received < found->second.received))
+                addFlow(closedFlows, found->second);
+
+            flows[{gateway.getAddress(), flow.src}] = flow;
+        }
+        return;
+    }
+
+    SimPayloadMessage* payload = simMessage->getPayloadMessage();
+    if (payload == nullptr)
+        return;
+
+    stats.delivered++;
+    stats.latency.add(millis() - payload->sentAt);
+    stats.hops.add(hops);
+
+    SimNode* source = getNode(message->addrSrc);
+    if (source != nullptr)
+        source->addDelivered();
+}
+
+void MeshSim::addFlow(SimFlowSummary& total, const SimFlowSummary& flow) {
+    total.received += flow.received;
+    total.lost += flow.lost;
+    total.reordered += flow.reordered;
+    total.duplicated += flow.duplicated;
+    total.corrupted += flow.corrupted;
+}
+
+void MeshSim::printSummary(double wallSeconds) {
+    RadioStats& radioStats = radio.getStats();
+    double simulated = getEnd() / 1e6;
+
+    uint32_t withGateway = 0;
+    uint32_t routes = 0;
+    uint32_t starved = 0;
+    for (auto& node : nodes) {
+        routes += node->getRoutingTableSize();
+        if (!node->isGateway() && node->hasGatewayRoute())
+            withGateway++;
+        if (node->getGenerated() > 0 && node->getDelivered() == 0)
+            starved++;
+    }
+
+    uint32_t routers = options.nodes - options.gateways;
+
+    printf("Nodes %d (%d gateways), %s topology of %.0f m, SF%d, HELLO every %u s, seed %llu\n",
+           options.nodes, options.gateways, options.topology.c_str(), options.area,
+           options.radio.spreadingFactor, options.helloInterval / 1000,
+           (unsigned long long)options.seed);
+    printf("Simulated %.0f s in %.2f s (%.0fx), %llu events\n", simulated, wallSeconds,
+           wallSeconds > 0 ? simulated / wallSeconds : 0,
+           (unsigned long long)Scheduler::getInstance().getProcessedEvents());
+    printf("Frames: sent %u, received %u, collisions %u, half-duplex %u, airtime %.1f s\n",
+           radioStats.framesSent, radioStats.receptions, radioStats.collisions,
+           radioStats.halfDuplex, radioStats.airtime / 1e6);
+    printf("Packets: generated %u, delivered %u (%.1f%%), forwarded %u, no route %u\n",
+           stats.generated, stats.delivered,
+           stats.generated > 0 ? 100.0 * stats.delivered / stats.generated : 0, stats.forwarded,
+           stats.noRoute);
+    printf("Queues: full %u, duty cycle waits %u, duty cycle drops %u\n", stats.queueFull,
+           stats.dutyCycleWaits, stats.dutyCycleDrops);
+    printf("Routes: %u of %u nodes reach a gateway, %.1f routes per node, %u senders with nothing "
+           "delivered\n",
+           withGateway, routers, (float)routes / options.nodes, starved);
+    SimFlowSummary total = closedFlows;
+    uint32_t flagged = 0;
+    for (auto& flow : flows) {
+        addFlow(total, flow.second);
+        if (flow.second.flags != 0)
+            flagged++;
+    }
+
+    uint32_t evicted = 0;
+    for (auto& gateway : evictions) evicted += gateway.second;
+
+    printf("MQTT: published %u messages, %.1f kB of JSON\n", stats.published,
+           stats.jsonBytes / 1e3);
+    printf("Flows reported by the gateways: %u, received %u, lost %u, reordered %u, duplicated "
+           "%u, corrupted %u\n",
+           (uint32_t)flows.size(), total.received, total.lost, total.reordered, total.duplicated,
+           total.corrupted);
+    printf("Flows evicted %u (more than %d senders per gateway), %u late or restarted\n",
+           evicted, SIM_FLOW_MAX, flagged);
+    printf("%s", stats.latency.toString("Latency", "ms").c_str());
+    printf("%s", stats.hops.toString("Hops", "").c_str());
+}
+
+void MeshSim::printJSON(double wallSeconds) {
+    RadioStats& radioStats = radio.getStats();
+
+    printf("{\"nodes\":%d,\"gateways\":%d,\"seed\":%llu,\"simulated\":%.0f,\"wall\":%.3f,"
+           "\"framesSent\":%u,\"receptions\":%u,\"collisions\":%u,\"halfDuplex\":%u,"
+           "\"airtime\":%llu,\"generated\":%u,\"delivered\":%u,\"forwarded\":%u,\"noRoute\":%u,"
+           "\"queueFull\":%u,\"dutyCycleWaits\":%u,\"dutyCycleDrops\":%u,\"published\":%u,"
+           "\"jsonBytes\":%llu,"
+           "\"latency\":{\"mean\":%u,\"p50\":%u,\"p95\":%u,\"max\":%u},"
+           "\"hops\":{\"mean\":%u,\"max\":%u}}\n",
+           options.nodes, options.gateways, (unsigned long long)options.seed, getEnd() / 1e6,
+           wallSeconds, radioStats.framesSent, radioStats.receptions, radioStats.collisions,
+           radioStats.halfDuplex, (unsigned long long)(radioStats.airtime / 1000), stats.generated,
+           stats.delivered, stats.forwarded, stats.noRoute, stats.queueFull, stats.dutyCycleWaits,
+           stats.dutyCycleDrops, stats.published, (unsigned long long)stats.jsonBytes,
+           stats.latency.getMean(), stats.latency.getPercentile(50),
+           stats.latency.getPercentile(95), stats.latency.getMax(), stats.hops.getMean(),
+           stats.hops.getMax());
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "helpers/histogram.h"
+#include "radio.h"
+#include "simNode.h"
+
+// The defaults are a mesh of 50 nodes in 2000 m with one gateway and the LoRaMesher HELLO period.
+// The larger meshes keep its density, its nodes per gateway and the HELLO frames a node hears.
+#define DEFAULT_NODES 50
+#define DEFAULT_AREA 2000                // m
+#define DEFAULT_HELLO_INTERVAL 120000    // ms, LoRaMesher HELLO_PACKETS_DELAY
+#define DEFAULT_ROUTE_PERIODS 5          // HELLO periods of the route timeout and the warmup
+
+struct SimOptions {
+    uint16_t nodes = DEFAULT_NODES;
+    uint16_t gateways = 0;            // 0 for one every DEFAULT_NODES nodes
+    std::string topology = "random";  // random, grid or line
+    float area = 0;                   // m, side of the square or length of the line, 0 scaled
+    uint32_t duration = 0;            // s of simulated time, 0 until the traffic ends
+    uint64_t seed = 1;
+    uint32_t helloInterval = 0;       // ms, 0 scaled from DEFAULT_HELLO_INTERVAL
+    uint32_t routeTimeout = 0;        // ms without news before a route expires, 0 scaled
+    uint32_t warmup = 0;              // ms before the first Sim packet, to build the routes
+    uint32_t packetCount = PACKET_COUNT;
+    uint32_t packetSize = PACKET_SIZE;
+    uint32_t packetDelay = PACKET_DELAY;
+    int32_t sender = -1;     // Index of the only sender as ONE_SENDER, -1 all but the gateways
+    uint32_t queueSize = 30; // Frames per send queue
+    uint32_t backoff = 1000; // ms, longest random wait before a transmission
+    bool dutyCycle = true;
+    bool json = false;
+    RadioConfig radio;
+};
+
+struct SimStats {
+    uint32_t generated = 0;
+    uint32_t delivered = 0;
+    uint32_t forwarded = 0;
+    uint32_t noRoute = 0;         // Packets dropped without a route to the destination
+    uint32_t queueFull = 0;       // Frames dropped by a full send queue
+    uint32_t dutyCycleWaits = 0;  // Frames delayed by the duty cycle
+    uint32_t dutyCycleDrops = 0;  // Frames larger than the whole budget
+    uint32_t published = 0;       // Messages published by the MqttService of the gateways
+    uint64_t jsonBytes = 0;       // Length of their JSON
+    Histogram latency;            // ms
+    Histogram hops;
+};
+
+/**
+ * @brief Places the nodes, runs the discrete-event simulation and reports the results
+ *
+ */
+class MeshSim {
+public:
+    MeshSim(const SimOptions& options);
+
+    void run();
+
+    void printSummary(double wallSeconds);
+
+    void printJSON(double wallSeconds);
+
+    SimOptions& getOptions() { return options; }
+
+    SimStats& getStats() { return stats; }
+
+    Radio& getRadio() { return radio; }
+
+    /**
+     * @brief Uniform random value in [0, max)
+     *
+     */
+    uint32_t random(uint32_t max);
+
+    SimNode* getNode(uint16_t address);
+
+    /**
+     * @brief A gateway published a message of the Sim service: a Sim packet that reached it or a
+     * flow report
+     *
+     * @param hops Hops of the Sim packets
+     */
+    void published(SimNode& gateway, DataMessage* message, uint8_t hops, size_t jsonSize);
+
+private:
+    SimOptions options;
+
+    SimStats stats;
+
+    Radio radio;
+
+    std::mt19937_64 generator;
+
+    std::vector<std::unique_ptr<SimNode>> nodes;
+
+    // Last flow report of each sender at each gateway
+    std::map<std::pair<uint16_t, uint16_t>, SimFlowSummary> flows;
+
+    // Counters of the flows that a gateway evicted and measured again
+    SimFlowSummary closedFlows = {};
+    std::map<uint16_t, uint32_t> evictions;  // By gateway
+
+    void addFlow(SimFlowSummary& total, const SimFlowSummary& flow);
+
+    /**
+     * @brief Scale the area and the gateways left at 0 with the nodes, keeping the density and
+     * the nodes per gateway of the default mesh
+     *
+     */
+    void setPlacementDefaults();
+
+    /**
+     * @brief Scale the HELLO period left at 0, and the route timeout and warmup that follow it. A
+     * HELLO carries the whole routing table, one frame per HELLO_ENTRIES_PER_FRAME nodes, so with
+     * the LoRaMesher period the HELLOs of a large mesh fill the channel. The period grows with the
+     * HELLO frames that a node hears, to keep them as in the default mesh.
+     *
+     */
+    void setRoutingDefaults();
+
+    std::vector<Position> placeNodes();
+
+    uint64_t getEnd();
+};
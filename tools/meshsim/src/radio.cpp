@@ -0,0 +1,149 @@
+#include "radio.h"
+
+#include <Arduino.h>
+
+#include <math.h>
+
+#include <random>
+
+#include "config.h"
+#include "loramesh/dutyCycle.h"
+#include "scheduler.h"
+
+void Radio::init(const RadioConfig& config, const std::vector<Position>& positions,
+                 uint64_t seed) {
+    this->config = config;
+    nodes = positions.size();
+    noiseFloor = -174.0 + 10.0 * log10(config.bandwidth * 1000.0) + config.noiseFigure;
+
+    std::mt19937_64 random(seed);
+    std::normal_distribution<float> shadowing(0.0, config.shadowing);
+
+    linkRssi.assign((size_t)nodes * nodes, -INFINITY);
+    for (uint16_t i = 0; i < nodes; i++) {
+        for (uint16_t j = i + 1; j < nodes; j++) {
+            float distance =
+                hypotf(positions[i].x - positions[j].x, positions[i].y - positions[j].y);
+            float pathLoss = config.referenceLoss +
+                             10.0 * config.pathLossExponent * log10f(fmaxf(distance, 1.0)) +
+                             (config.shadowing > 0 ? shadowing(random) : 0);
+
+            linkRssi[i * nodes + j] = linkRssi[j * nodes + i] = config.txPower - pathLoss;
+        }
+    }
+
+    // Far below the demodulation floor a frame does not even interfere
+    float floor = getSNRThreshold() - config.captureThreshold;
+
+    audible.assign(nodes, std::vector<uint16_t>());
+    for (uint16_t i = 0; i < nodes; i++) {
+        for (uint16_t j = 0; j < nodes; j++) {
+            if (i != j && getSNR(i, j) >= floor)
+                audible[i].push_back(j);
+        }
+    }
+
+    transceivers.assign(nodes, Transceiver());
+}
+
+void Radio::setCallbacks(ReceiveCallback onReceive, SentCallback onSent) {
+    this->onReceive = onReceive;
+    this->onSent = onSent;
+}
+
+uint64_t Radio::getAirtime(uint32_t payloadSize) {
+    return DutyCycle::getTimeOnAir(payloadSize + LORAMESH_PACKET_OVERHEAD, config.bandwidth,
+                                   config.spreadingFactor, config.codingRate,
+                                   config.preambleLength);
+}
+
+uint64_t Radio::transmit(uint16_t node, const Frame& frame) {
+    uint32_t id = nextFrame++;
+    Transmission& transmission = inFlight[id];
+    transmission.sender = node;
+    transmission.frame = frame;
+
+    // Half-duplex, everything this node was receiving is lost
+    Transceiver& sender = transceivers[node];
+    sender.transmitting = true;
+    for (Reception& reception : sender.receptions) {
+        if (reception.state == ReceptionOk)
+            reception.state = ReceptionHalfDuplex;
+    }
+
+    float threshold = getSNRThreshold();
+
+    for (uint16_t receiver : audible[node]) {
+        float snr = getSNR(node, receiver);
+        Transceiver& transceiver = transceivers[receiver];
+        Reception reception = {id, linkRssi[node * nodes + receiver],
+                               snr >= threshold ? ReceptionOk : ReceptionWeak};
+
+        if (transceiver.transmitting && reception.state == ReceptionOk)
+            reception.state = ReceptionHalfDuplex;
+
+        for (Reception& other : transceiver.receptions) {
+            collide(reception, other);
+        }
+
+        transceiver.receptions.push_back(reception);
+        transmission.receivers.push_back(receiver);
+    }
+
+    uint64_t airtime = getAirtime(frame.payload.size());
+
+    stats.framesSent++;
+    stats.airtime += airtime;
+
+    Scheduler::getInstance().after(airtime, [this, id]() { finish(id); });
+
+    return airtime;
+}
+
+void Radio::collide(Reception& a, Reception& b) {
+    bool aSurvives = a.rssi >= b.rssi + config.captureThreshold;
+    bool bSurvives = b.rssi >= a.rssi + config.captureThreshold;
+
+    if (!aSurvives && a.state == ReceptionOk)
+        a.state = ReceptionCollision;
+    if (!bSurvives && b.state == ReceptionOk)
+        b.state = ReceptionCollision;
+}
+
+void Radio::finish(uint32_t id) {
+    auto found = inFlight.find(id);
+    Transmission transmission = std::move(found->second);
+    inFlight.erase(found);
+
+    transceivers[transmission.sender].transmitting = false;
+
+    for (uint16_t receiver : transmission.receivers) {
+        std::vector<Reception>& receptions = transceivers[receiver].receptions;
+
+        ReceptionState state = ReceptionWeak;
+        for (auto it = receptions.begin(); it != receptions.end(); ++it) {
+            if (it->frame == id) {
+                state = it->state;
+                receptions.erase(it);
+                break;
+            }
+        }
+
+        switch (state) {
+            case ReceptionOk:
+                stats.receptions++;
+                onReceive(receiver, transmission.frame, getSNR(transmission.sender, receiver));
+                break;
+            case ReceptionCollision:
+                stats.collisions++;
+                break;
+            case ReceptionHalfDuplex:
+                stats.halfDuplex++;
+                break;
+            default:
+                break;
+        }
+    }
+
+    onSent(transmission.sender);
+}
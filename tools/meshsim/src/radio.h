@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct RadioConfig {
+    float frequency = 868.0;     // MHz
+    float bandwidth = 125.0;     // kHz
+    uint8_t spreadingFactor = 7;
+    uint8_t codingRate = 7;      // Denominator, 4/7
+    uint16_t preambleLength = 8;
+    float txPower = 14.0;          // dBm
+    float referenceLoss = 40.0;    // dB at 1 m, with the losses of the antennas
+    float pathLossExponent = 3.0;  // Suburban, about 1.9 km at SF7 and 14 dBm
+    float shadowing = 4.0;         // dB, standard deviation of the log-normal shadowing
+    float noiseFigure = 6.0;       // dB
+    float captureThreshold = 6.0;  // dB the stronger frame needs to survive a collision
+};
+
+struct Position {
+    float x;
+    float y;
+};
+
+enum FrameType : uint8_t {
+    HelloFrame = 0,
+    DataFrame = 1,
+};
+
+/**
+ * @brief A LoRa frame on the air. The payload is what follows the LoRaMesher header, the header is
+ * only accounted in the airtime.
+ *
+ */
+struct Frame {
+    FrameType type;
+    uint16_t src;                  // Transmitter
+    uint16_t via;                  // Next hop, BROADCAST_ADDR for the HELLOs
+    std::vector<uint8_t> payload;
+    uint8_t hops = 0;              // Bookkeeping for the statistics, not on the air
+};
+
+struct RadioStats {
+    uint32_t framesSent = 0;
+    uint32_t receptions = 0;   // Frames received by a node, a broadcast counts once per receiver
+    uint32_t collisions = 0;   // Frames lost by a receiver because another frame overlapped
+    uint32_t halfDuplex = 0;   // Frames lost because the receiver was transmitting
+    uint64_t airtime = 0;      // Microseconds
+};
+
+/**
+ * @brief Shared channel of all the nodes. The link budget is a log-distance path loss with a
+ * symmetric log-normal shadowing per link, fixed for the whole run. A frame is received when its
+ * SNR is above the demodulation floor of the spreading factor, the receiver is not transmitting
+ * and no overlapping frame is within the capture threshold of it.
+ *
+ */
+class Radio {
+public:
+    typedef std::function<void(uint16_t node, const Frame& frame, float snr)> ReceiveCallback;
+    typedef std::function<void(uint16_t node)> SentCallback;
+
+    void init(const RadioConfig& config, const std::vector<Position>& positions, uint64_t seed);
+
+    void setCallbacks(ReceiveCallback onReceive, SentCallback onSent);
+
+    /**
+     * @brief Start the transmission of a frame, the node must not be transmitting
+     *
+     * @param node Index of the transmitter
+     * @return uint64_t Airtime in microseconds
+     */
+    uint64_t transmit(uint16_t node, const Frame& frame);
+
+    bool isTransmitting(uint16_t node) { return transceivers[node].transmitting; }
+
+    /**
+     * @brief Time on air of a frame, with the LoRaMesher header
+     *
+     * @param payloadSize Bytes after the LoRaMesher header
+     * @return uint64_t Microseconds
+     */
+    uint64_t getAirtime(uint32_t payloadSize);
+
+    float getSNR(uint16_t from, uint16_t to) { return linkRssi[from * nodes + to] - noiseFloor; }
+
+    /**
+     * @brief Lowest SNR that the spreading factor demodulates
+     *
+     */
+    float getSNRThreshold() { return -7.5 - 2.5 * (config.spreadingFactor - 7); }
+
+    /**
+     * @brief Nodes that hear the transmissions of a node, over the interference floor
+     *
+     */
+    size_t getAudible(uint16_t node) { return audible[node].size(); }
+
+    RadioStats& getStats() { return stats; }
+
+private:
+    enum ReceptionState : uint8_t {
+        ReceptionOk,
+        ReceptionWeak,
+        ReceptionCollision,
+        ReceptionHalfDuplex,
+    };
+
+    struct Reception {
+        uint32_t frame;
+        float rssi;
+        ReceptionState state;
+    };
+
+    struct Transceiver {
+        bool transmitting = false;
+        std::vector<Reception> receptions;
+    };
+
+    struct Transmission {
+        uint16_t sender;
+        Frame frame;
+        std::vector<uint16_t> receivers;
+    };
+
+    RadioConfig config;
+
+    uint16_t nodes = 0;
+
+    float noiseFloor = 0;
+
+    std::vector<float> linkRssi;
+
+    // Nodes that a transmitter reaches over the interference floor, the rest never notice it
+    std::vector<std::vector<uint16_t>> audible;
+
+    std::vector<Transceiver> transceivers;
+
+    std::unordered_map<uint32_t, Transmission> inFlight;
+
+    uint32_t nextFrame = 0;
+
+    ReceiveCallback onReceive;
+
+    SentCallback onSent;
+
+    RadioStats stats;
+
+    void finish(uint32_t frame);
+
+    void collide(Reception& a, Reception& b);
+};
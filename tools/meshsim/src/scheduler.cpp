@@ -0,0 +1,33 @@
+#include "scheduler.h"
+
+#include <Arduino.h>
+
+bool hostVerbose = false;
+
+uint32_t millis() {
+    return (uint32_t)(Scheduler::getInstance().now() / 1000);
+}
+
+void Scheduler::at(uint64_t time, Callback callback) {
+    if (time < this->time)
+        time = this->time;
+
+    events.push({time, sequence++, callback});
+}
+
+void Scheduler::after(uint64_t delay, Callback callback) {
+    at(time + delay, callback);
+}
+
+void Scheduler::run(uint64_t end) {
+    while (!events.empty() && events.top().time <= end) {
+        Event event = events.top();
+        events.pop();
+
+        time = event.time;
+        processedEvents++;
+        event.callback();
+    }
+
+    time = end;
+}
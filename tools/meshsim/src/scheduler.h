@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+/**
+ * @brief Discrete-event scheduler with a virtual clock in microseconds. The events run in time
+ * order, the events at the same time in the order they were scheduled, so a run is reproducible
+ * from its seed.
+ *
+ */
+class Scheduler {
+public:
+    static Scheduler& getInstance() {
+        static Scheduler instance;
+        return instance;
+    }
+
+    typedef std::function<void()> Callback;
+
+    /**
+     * @brief Run a callback at an absolute time
+     *
+     * @param time Microseconds since the start of the simulation
+     */
+    void at(uint64_t time, Callback callback);
+
+    /**
+     * @brief Run a callback after a delay from now
+     *
+     * @param delay Microseconds
+     */
+    void after(uint64_t delay, Callback callback);
+
+    /**
+     * @brief Run the events until the queue is empty or the clock reaches the end
+     *
+     * @param end Microseconds since the start of the simulation
+     */
+    void run(uint64_t end);
+
+    uint64_t now() { return time; }
+
+    uint64_t getProcessedEvents() { return processedEvents; }
+
+private:
+    Scheduler() {}
+
+    struct Event {
+        uint64_t time;
+        uint64_t sequence;
+        Callback callback;
+    };
+
+    struct Later {
+        bool operator()(const Event& a, const Event& b) const {
+            return a.time > b.time || (a.time == b.time && a.sequence > b.sequence);
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, Later> events;
+
+    uint64_t time = 0;
+    uint64_t sequence = 0;
+    uint64_t processedEvents = 0;
+};
@@ -0,0 +1,277 @@
+#include "simNode.h"
+
+#include "meshSim.h"
+#include "message/messageManager.h"
+#include "scheduler.h"
+
+static const char* NODE_TAG = "SimNode";
+
+// Routes at this metric are unreachable, it stops the count to infinity
+#define MAX_METRIC 32
+
+SimNode::SimNode(MeshSim& sim, uint16_t index, bool gateway)
+    : sim(sim), index(index), gateway(gateway), routes(sim.getOptions().nodes + 1) {
+    RadioConfig& radio = sim.getOptions().radio;
+    dutyCycle.init(radio.frequency, radio.bandwidth, radio.spreadingFactor, radio.codingRate,
+                   radio.preambleLength);
+}
+
+void SimNode::start(bool sender) {
+    SimOptions& options = sim.getOptions();
+    Scheduler& scheduler = Scheduler::getInstance();
+
+    select();
+    LoRaMeshService::getInstance().setNode(this);
+
+    MessageManager& manager = MessageManager::getInstance();
+    manager.addMessageService(&simService);
+
+    if (gateway) {
+        MqttService& mqtt = MqttService::getInstance();
+        mqtt.setInitialized(true);
+        manager.addMessageService(&mqtt);
+
+        scheduler.at(SIM_FLOW_REPORT_INTERVAL * 1000ULL, [this]() { reportFlows(); });
+    }
+
+    scheduler.at(sim.random(options.helloInterval) * 1000ULL, [this]() { sendHello(); });
+
+    if (sender)
+        scheduler.at((options.warmup + sim.random(options.packetDelay)) * 1000ULL,
+                     [this]() { sendPacket(); });
+}
+
+size_t SimNode::getRoutingTableSize() {
+    uint32_t now = millis();
+
+    size_t size = 0;
+    for (Route& route : routes) {
+        if (route.expires > now)
+            size++;
+    }
+    return size;
+}
+
+void SimNode::sendHello() {
+    SimOptions& options = sim.getOptions();
+
+    std::vector<HelloEntry> entries;
+    entries.push_back({getAddress(), 0, gateway});
+
+    uint32_t now = millis();
+    for (uint16_t address = 1; address < routes.size(); address++) {
+        Route& route = routes[address];
+        if (route.expires > now && route.metric < MAX_METRIC)
+            entries.push_back({address, route.metric, route.gateway});
+    }
+
+    // Large routing tables are split in several frames, as LoRaMesher does
+    for (size_t first = 0; first < entries.size(); first += HELLO_ENTRIES_PER_FRAME) {
+        size_t count = std::min(entries.size() - first, (size_t)HELLO_ENTRIES_PER_FRAME);
+
+        Frame frame = {HelloFrame, getAddress(), BROADCAST_ADDR, {}};
+        frame.payload.resize(count * sizeof(HelloEntry));
+        memcpy(frame.payload.data(), &entries[first], frame.payload.size());
+
+        enqueue(frame, true);
+    }
+
+    Scheduler::getInstance().after(options.helloInterval * 1000ULL, [this]() { sendHello(); });
+}
+
+void SimNode::sendPacket() {
+    SimOptions& options = sim.getOptions();
+
+    generated++;
+    sim.getStats().generated++;
+
+    select();
+    simService.sendPacket(1, generated - 1, options.packetSize);
+
+    if (generated < options.packetCount)
+        Scheduler::getInstance().after(options.packetDelay * 1000ULL, [this]() { sendPacket(); });
+}
+
+void SimNode::reportFlows() {
+    select();
+    simService.sendFlowReports();
+
+    Scheduler::getInstance().after(SIM_FLOW_REPORT_INTERVAL * 1000ULL,
+                                   [this]() { reportFlows(); });
+}
+
+bool SimNode::sendMessage(DataMessage* message, uint16_t dst) {
+    Route* route = getRoute(dst);
+    if (route == nullptr) {
+        ESP_LOGW(NODE_TAG, "%X has no route to %X", getAddress(), dst);
+        sim.getStats().noRoute++;
+        return false;
+    }
+
+    Frame frame = {DataFrame, getAddress(), route->via, {}};
+    frame.payload.resize(message->getDataMessageSize());
+    memcpy(frame.payload.data(), message, frame.payload.size());
+
+    // The destination travels in the LoRaMesher header, the receiver sets it in the DataMessage
+    DataMessage* copy = (DataMessage*)frame.payload.data();
+    copy->addrSrc = getAddress();
+    copy->addrDst = dst;
+
+    return enqueue(frame, false);
+}
+
+void SimNode::published(DataMessage* message, size_t jsonSize) {
+    sim.published(*this, message, receivedHops, jsonSize);
+}
+
+bool SimNode::enqueue(const Frame& frame, bool control) {
+    std::deque<Frame>& queue = control ? controlQueue : dataQueue;
+
+    // The control queue always fits the frames of a whole HELLO
+    size_t limit = sim.getOptions().queueSize;
+    if (control)
+        limit = std::max(limit, (routes.size() + HELLO_ENTRIES_PER_FRAME - 1) /
+                                    HELLO_ENTRIES_PER_FRAME);
+
+    if (queue.size() >= limit) {
+        sim.getStats().queueFull++;
+        return false;
+    }
+
+    queue.push_back(frame);
+    transmitNext();
+
+    return true;
+}
+
+void SimNode::transmitNext() {
+    SimOptions& options = sim.getOptions();
+    Scheduler& scheduler = Scheduler::getInstance();
+
+    while (!busy && (!controlQueue.empty() || !dataQueue.empty())) {
+        bool control = !controlQueue.empty();
+        std::deque<Frame>& queue = control ? controlQueue : dataQueue;
+        SendPriority priority = control ? HighPriority : NormalPriority;
+
+        uint32_t airtime = (sim.getRadio().getAirtime(queue.front().payload.size()) + 999) / 1000;
+
+        if (options.dutyCycle && !dutyCycle.tryConsume(airtime, priority)) {
+            uint32_t waitTime = dutyCycle.getWaitTime(airtime, priority);
+            if (waitTime == UINT32_MAX) {
+                sim.getStats().dutyCycleDrops++;
+                queue.pop_front();
+                continue;
+            }
+
+            sim.getStats().dutyCycleWaits++;
+            busy = true;
+            scheduler.after(waitTime * 1000ULL, [this]() {
+                busy = false;
+                transmitNext();
+            });
+            return;
+        }
+
+        Frame frame = std::move(queue.front());
+        queue.pop_front();
+
+        // Random wait before the transmission, it desynchronizes the nodes that received the same
+        // frame
+        busy = true;
+        scheduler.after(sim.random(options.backoff) * 1000ULL,
+                        [this, frame]() { sim.getRadio().transmit(index, frame); });
+    }
+}
+
+void SimNode::sent() {
+    busy = false;
+    transmitNext();
+}
+
+void SimNode::receive(const Frame& frame, float snr) {
+    if (frame.type == HelloFrame)
+        processHello(frame);
+    else if (frame.via == getAddress())
+        processData(frame);
+}
+
+void SimNode::processHello(const Frame& frame) {
+    SimOptions& options = sim.getOptions();
+    uint32_t now = millis();
+    uint32_t expires = now + options.routeTimeout;
+
+    size_t count = frame.payload.size() / sizeof(HelloEntry);
+    for (size_t i = 0; i < count; i++) {
+        HelloEntry entry;
+        memcpy(&entry, frame.payload.data() + i * sizeof(HelloEntry), sizeof(HelloEntry));
+
+        if (entry.address == getAddress() || entry.address >= routes.size())
+            continue;
+
+        uint8_t metric = entry.metric + 1;
+        Route& route = routes[entry.address];
+
+        // A better route, or news from the current next hop, even if it is worse
+        if (route.expires <= now || metric < route.metric || route.via == frame.src)
+            route = {frame.src, metric, entry.gateway != 0, expires};
+    }
+}
+
+void SimNode::processData(const Frame& frame) {
+    DataMessage* message = (DataMessage*)frame.payload.data();
+
+    if (message->addrDst == getAddress()) {
+        // The MessageManager gets its own copy, as LoRaMeshService::createDataMessage
+        std::vector<uint8_t> received(frame.payload);
+        receivedHops = frame.hops + 1;
+
+        select();
+        MessageManager::getInstance().processReceivedMessage(LoRaMeshPort,
+                                                             (DataMessage*)received.data());
+
+        receivedHops = 0;
+        return;
+    }
+
+    Route* route = getRoute(message->addrDst);
+    if (route == nullptr) {
+        sim.getStats().noRoute++;
+        return;
+    }
+
+    Frame forward = frame;
+    forward.src = getAddress();
+    forward.via = route->via;
+    forward.hops++;
+
+    if (enqueue(forward, false))
+        sim.getStats().forwarded++;
+}
+
+SimNode::Route* SimNode::getRoute(uint16_t address) {
+    if (address >= routes.size())
+        return nullptr;
+
+    Route& route = routes[address];
+    if (route.expires <= millis() || route.metric >= MAX_METRIC)
+        return nullptr;
+
+    return &route;
+}
+
+uint16_t SimNode::getClosestGateway() {
+    uint16_t closest = 0;
+    uint8_t closestMetric = MAX_METRIC;
+    uint32_t now = millis();
+
+    for (uint16_t address = 1; address < routes.size(); address++) {
+        Route& route = routes[address];
+        if (!route.gateway || route.expires <= now || route.metric >= closestMetric)
+            continue;
+
+        closest = address;
+        closestMetric = route.metric;
+    }
+
+    return closest;
+}
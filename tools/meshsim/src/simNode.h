@@ -0,0 +1,155 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <deque>
+#include <vector>
+
+#include "loramesh/dutyCycle.h"
+#include "loramesh/loraMeshService.h"
+#include "message/dataMessage.h"
+#include "radio.h"
+#include "simService.h"
+
+class MeshSim;
+
+#pragma pack(1)
+
+/**
+ * @brief Routing table entry announced in the HELLO frames
+ *
+ */
+struct HelloEntry {
+    uint16_t address;
+    uint8_t metric;
+    uint8_t gateway;
+};
+
+#pragma pack()
+
+#define HELLO_ENTRIES_PER_FRAME (LORAMESH_MAX_FRAME_PAYLOAD / sizeof(HelloEntry))
+
+/**
+ * @brief A virtual node: the LoRaMesher distance-vector routing (periodic HELLO with the routing
+ * table, hop count metric, routes to the gateways) and a send queue with the firmware DutyCycle.
+ * Above them the node runs its own firmware MessageManager, selected with HostNodes, with the Sim
+ * traffic of SimService and, at the gateways, the MqttService that publishes to the server.
+ *
+ */
+class SimNode {
+public:
+    SimNode(MeshSim& sim, uint16_t index, bool gateway);
+
+    /**
+     * @brief Register the services in the MessageManager of the node and schedule the HELLOs, the
+     * Sim packets of the senders and the flow reports of the gateways
+     *
+     * @param sender Generates Sim packets
+     */
+    void start(bool sender);
+
+    /**
+     * @brief Route a message of the MessageManager of this node, as LoRaMesher does
+     *
+     * @param dst Destination in the mesh
+     * @return false If there is no route to the destination or the send queue is full
+     */
+    bool sendMessage(DataMessage* message, uint16_t dst);
+
+    /**
+     * @brief The MqttService of this gateway published a message
+     *
+     * @param jsonSize Length of the JSON of the message
+     */
+    void published(DataMessage* message, size_t jsonSize);
+
+    /**
+     * @brief Publish the flow reports of the gateway
+     *
+     */
+    void reportFlows();
+
+    /**
+     * @brief Gateway with the lowest metric, as LoRaMesher getClosestGateway
+     *
+     * @return uint16_t Address of the gateway, 0 if there is no route to any gateway
+     */
+    uint16_t getClosestGateway();
+
+    void receive(const Frame& frame, float snr);
+
+    /**
+     * @brief The radio finished the transmission of a frame of this node
+     *
+     */
+    void sent();
+
+    uint16_t getAddress() { return index + 1; }
+
+    bool isGateway() { return gateway; }
+
+    size_t getRoutingTableSize();
+
+    bool hasGatewayRoute() { return getClosestGateway() != 0; }
+
+    uint32_t getGenerated() { return generated; }
+
+    uint32_t getDelivered() { return delivered; }
+
+    void addDelivered() { delivered++; }
+
+private:
+    struct Route {
+        uint16_t via;
+        uint8_t metric;
+        bool gateway;
+        uint32_t expires;  // ms
+    };
+
+    MeshSim& sim;
+
+    uint16_t index;
+
+    bool gateway;
+
+    // By address, a route that never existed has expired at 0
+    std::vector<Route> routes;
+
+    std::deque<Frame> controlQueue;
+
+    std::deque<Frame> dataQueue;
+
+    // Transmitting, in the backoff or waiting for the duty cycle
+    bool busy = false;
+
+    DutyCycle dutyCycle;
+
+    uint32_t generated = 0;
+
+    uint32_t delivered = 0;
+
+    SimService simService;
+
+    // Hops of the message being dispatched to the MessageManager
+    uint8_t receivedHops = 0;
+
+    /**
+     * @brief Select the firmware instances of this node, before calling the firmware code
+     *
+     */
+    void select() { HostNodes::select(index); }
+
+    void sendHello();
+
+    void sendPacket();
+
+    bool enqueue(const Frame& frame, bool control);
+
+    void transmitNext();
+
+    void processHello(const Frame& frame);
+
+    void processData(const Frame& frame);
+
+    Route* getRoute(uint16_t address);
+};
@@ -0,0 +1,102 @@
+#include "simService.h"
+
+#include "message/messageManager.h"
+
+static const char* SIM_SERVICE_TAG = "SimService";
+
+void SimService::sendPacket(uint8_t run, uint32_t seq, uint32_t packetSize) {
+    uint32_t messageSize = sizeof(SimMessage) + sizeof(SimPayloadMessage) + packetSize;
+
+    SimMessage* simMessage = (SimMessage*)pvPortMalloc(messageSize);
+    if (simMessage == nullptr)
+        return;
+
+    simMessage->simCommand = SimCommand::Payload;
+    simMessage->appPortDst = appPort::MQTTApp;
+    simMessage->appPortSrc = appPort::SimApp;
+    simMessage->addrSrc = LoRaMeshService::getInstance().getLocalAddress();
+    simMessage->addrDst = 0;
+    simMessage->messageId = seq;
+    simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+    SimPayloadMessage* payload = (SimPayloadMessage*)simMessage->payload;
+    payload->packetSize = packetSize;
+    payload->run = run;
+    payload->seq = seq;
+    payload->sentAt = millis();
+
+    for (uint32_t i = 0; i < packetSize; i++) {
+        payload->payload[i] = i;
+    }
+
+    payload->crc = payload->computeCrc();
+
+    MessageManager::getInstance().sendMessage(messagePort::MqttPort, (DataMessage*)simMessage);
+
+    vPortFree(simMessage);
+}
+
+void SimService::sendFlowReports() {
+    SimFlowSummary summaries[SIM_FLOW_MAX];
+    uint8_t count = flowMonitor.takeSummaries(summaries);
+
+    for (uint8_t first = 0; first < count; first += SIM_FLOW_REPORT_BATCH) {
+        uint8_t batch = std::min<uint8_t>(SIM_FLOW_REPORT_BATCH, count - first);
+
+        uint32_t messageSize =
+            sizeof(SimMessage) + sizeof(SimFlowReport) + batch * sizeof(SimFlowSummary);
+        SimMessage* simMessage = (SimMessage*)pvPortMalloc(messageSize);
+        if (simMessage == nullptr)
+            return;
+
+        simMessage->simCommand = SimCommand::FlowReport;
+        simMessage->appPortDst = appPort::MQTTApp;
+        simMessage->appPortSrc = appPort::SimApp;
+        simMessage->addrSrc = LoRaMeshService::getInstance().getLocalAddress();
+        simMessage->addrDst = 0;
+        simMessage->messageId = 0;
+        simMessage->messageSize = messageSize - sizeof(DataMessageGeneric);
+
+        SimFlowReport* report = (SimFlowReport*)simMessage->payload;
+        report->count = batch;
+        memcpy(report->flows, &summaries[first], batch * sizeof(SimFlowSummary));
+
+        MessageManager::getInstance().sendMessage(messagePort::MqttPort,
+                                                  (DataMessage*)simMessage);
+
+        vPortFree(simMessage);
+    }
+}
+
+String SimService::getJSON(DataMessage* message) {
+    SimMessage* simMessage = (SimMessage*)message;
+
+    StaticJsonDocument<2048> doc;
+
+    JsonObject data = doc.createNestedObject("data");
+
+    simMessage->serialize(data);
+
+    String json;
+    serializeJson(doc, json);
+
+    return json;
+}
+
+void SimService::processGatewayMessage(DataMessage* message) {
+    SimMessage* simMessage = (SimMessage*)message;
+    if (simMessage->simCommand != SimCommand::Payload)
+        return;
+
+    SimPayloadMessage* payload = simMessage->getPayloadMessage();
+    if (payload == nullptr) {
+        ESP_LOGW(SIM_SERVICE_TAG, "Invalid Sim packet from %X", simMessage->addrSrc);
+        flowMonitor.observe(simMessage->addrSrc, 0, 0, false, 0, 0);
+        return;
+    }
+
+    bool valid = payload->computeCrc() == payload->crc;
+
+    flowMonitor.observe(simMessage->addrSrc, payload->run, payload->seq, valid, payload->sentAt,
+                        millis());
+}
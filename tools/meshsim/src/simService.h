@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/messageService.h"
+
+#include "simulator/simFlowMonitor.h"
+
+#include "simulator/simMessage.h"
+
+/**
+ * @brief The Sim traffic of a virtual node, host version of the traffic part of the firmware Sim
+ * service. The senders build the same Sim packets, a SimMessage with a SimPayloadMessage and its
+ * CRC, and send them to the server through the MessageManager of their node. The gateways measure
+ * the packets they relay with the firmware SimFlowMonitor and publish its flow reports. The run
+ * control and the upload of the state logs need the devices and are not simulated.
+ *
+ * The simulated clock is the synchronized time of every node.
+ *
+ */
+class SimService : public MessageService {
+public:
+    SimService() : MessageService(SimApp, "Sim") { commandService = new CommandService(); }
+
+    /**
+     * @brief Send a Sim packet of the run to the server
+     *
+     */
+    void sendPacket(uint8_t run, uint32_t seq, uint32_t packetSize);
+
+    /**
+     * @brief Publish the summaries of the flows that changed, as Sim::sendFlowReports
+     *
+     */
+    void sendFlowReports();
+
+    String getJSON(DataMessage* message) override;
+
+    void processGatewayMessage(DataMessage* message) override;
+
+private:
+    SimFlowMonitor flowMonitor;
+};
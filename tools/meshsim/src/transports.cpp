@@ -0,0 +1,36 @@
+#include "simNode.h"
+
+#include "message/messageManager.h"
+
+// Host versions of the transports and of the recorder used by the MessageManager of each node
+
+uint16_t LoRaMeshService::getLocalAddress() {
+    return node->getAddress();
+}
+
+void LoRaMeshService::send(DataMessage* message, DeliveryMode mode, DeliveryCallback callback) {
+    node->sendMessage(message, message->addrDst);
+}
+
+bool LoRaMeshService::sendClosestGateway(DataMessage* message, DeliveryMode mode,
+                                         DeliveryCallback callback) {
+    // Without a gateway there is no route to 0, the simulated nodes do not carry messages forward
+    return node->sendMessage(message, node->getClosestGateway());
+}
+
+bool MqttService::writeToMqtt(DataMessage* message) {
+    String json = MessageManager::getInstance().getJSON(message);
+    LoRaMeshService::getInstance().getNode()->published(message, json.length());
+    return true;
+}
+
+String MessageTraceRecorder::start() {
+    return "The simulated nodes do not record traces";
+}
+
+String MessageTraceRecorder::stop() {
+    return "";
+}
+
+void MessageTraceRecorder::append(MessageTraceEvent event, uint8_t port, DataMessage* message,
+                                  uint8_t mode) {}
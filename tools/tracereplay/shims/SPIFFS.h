@@ -0,0 +1,3 @@
+#pragma once
+
+// The host recorder of tools/tracereplay does not write files
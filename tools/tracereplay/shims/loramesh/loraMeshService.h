@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/dataMessage.h"
+
+#include "loramesh/delivery.h"
+
+#define BROADCAST_ADDR 0xFFFF
+
+/**
+ * @brief Host replacement of the LoRaMesher service of the MessageManager. The messages are
+ * copied into a frame as LoRaMesher does, and the copy is measured as the lora stage.
+ *
+ */
+class LoRaMeshService {
+public:
+    static LoRaMeshService& getInstance() {
+        static LoRaMeshService instance;
+        return instance;
+    }
+
+    uint16_t getLocalAddress() { return localAddress; }
+
+    void setLocalAddress(uint16_t address) { localAddress = address; }
+
+    void send(DataMessage* message, DeliveryMode mode = DefaultDelivery,
+              DeliveryCallback callback = nullptr);
+
+    bool sendClosestGateway(DataMessage* message, DeliveryMode mode = DefaultDelivery,
+                            DeliveryCallback callback = nullptr);
+
+private:
+    LoRaMeshService() {}
+
+    uint16_t localAddress = 0;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "message/dataMessage.h"
+
+/**
+ * @brief Host replacement of the MQTT service of the MessageManager. When the replay runs as a
+ * gateway the messages are converted to JSON with MessageManager::getJSON, as the firmware does
+ * before publishing them, and the conversion is measured as the json stage.
+ *
+ */
+class MqttService {
+public:
+    static MqttService& getInstance() {
+        static MqttService instance;
+        return instance;
+    }
+
+    bool isInitialized() { return initialized; }
+
+    void setInitialized(bool value) { initialized = value; }
+
+    bool writeToMqtt(DataMessage* message);
+
+private:
+    MqttService() {}
+
+    bool initialized = false;
+};
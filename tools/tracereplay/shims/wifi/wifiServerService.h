@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Host replacement of the WiFi service of the MessageManager, never connected
+ *
+ */
+class WiFiServerService {
+public:
+    static WiFiServerService& getInstance() {
+        static WiFiServerService instance;
+        return instance;
+    }
+
+    bool isConnected() { return false; }
+};
@@ -0,0 +1,76 @@
+#include "replay.h"
+
+static void printUsage() {
+    printf("Usage: tracereplay [options] TRACE\n"
+           "  TRACE                trace.bin from SPIFFS or a serial log with /traceDump\n"
+           "  --speed X            1 at the recorded pace, X times faster, 0 without waits (0)\n"
+           "  --repeat N           Replay the trace N times (1)\n"
+           "  --gateway            Connected to MQTT, the uplinks are converted to JSON\n"
+           "  --json               One line JSON summary, for the regression scripts\n"
+           "  --verbose            Print the logs of the firmware\n"
+           "The MessageManager and the message classes are the firmware ones, the services are\n"
+           "stubs that only convert their messages to JSON.\n");
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool hasValue = true;
+
+        if (option == "--gateway") {
+            options.gateway = true;
+            hasValue = false;
+        } else if (option == "--json") {
+            options.json = true;
+            hasValue = false;
+        } else if (option == "--verbose") {
+            hostVerbose = true;
+            hasValue = false;
+        } else if (option == "--help") {
+            printUsage();
+            return 0;
+        } else if (option.rfind("--", 0) != 0 && path.empty()) {
+            path = option;
+            hasValue = false;
+        } else if (value == nullptr) {
+            printUsage();
+            return 1;
+        } else if (option == "--speed") {
+            options.speed = atof(value);
+        } else if (option == "--repeat") {
+            options.repeat = atol(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option.c_str());
+            printUsage();
+            return 1;
+        }
+
+        if (hasValue)
+            i++;
+    }
+
+    if (path.empty() || options.speed < 0) {
+        printUsage();
+        return 1;
+    }
+
+    TraceReader trace;
+    if (!trace.load(path)) {
+        fprintf(stderr, "%s\n", trace.getError().c_str());
+        return 1;
+    }
+
+    Replay& replay = Replay::getInstance();
+    replay.run(trace, options);
+
+    if (options.json)
+        replay.printJSON();
+    else
+        replay.printSummary(path);
+
+    return 0;
+}
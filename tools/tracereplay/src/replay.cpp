@@ -0,0 +1,230 @@
+#include "replay.h"
+
+#include <thread>
+
+#include "message/messageManager.h"
+
+bool hostVerbose = false;
+
+uint32_t millis() {
+    return Replay::getInstance().getMillis();
+}
+
+// Count the allocations of the firmware code, pvPortMalloc counts its own
+void* operator new(size_t size) {
+    hostAllocations++;
+    void* pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+void Replay::run(TraceReader& trace, const ReplayOptions& replayOptions) {
+    options = replayOptions;
+
+    const MessageTraceHeader& header = trace.getHeader();
+    const std::vector<TraceEntry>& entries = trace.getEntries();
+
+    startMillis = header.startMillis;
+    localAddress = header.localAddress;
+    traceRecords = entries.size();
+    traceDuration = entries.empty() ? 0 : entries.back().time;
+
+    LoRaMeshService::getInstance().setLocalAddress(localAddress);
+    MqttService::getInstance().setInitialized(options.gateway);
+
+    addServiceStubs(services);
+
+    MessageTraceRecorder::getInstance().start();
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    for (uint32_t iteration = 0; iteration < options.repeat; iteration++) {
+        auto iterationStart = std::chrono::steady_clock::now();
+        pending.clear();
+
+        for (const TraceEntry& entry : entries) {
+            now = entry.time;
+
+            if (options.speed > 0) {
+                std::this_thread::sleep_until(
+                    iterationStart + std::chrono::microseconds((uint64_t)(now / options.speed)));
+            }
+
+            if (!pending.empty()) {
+                const Produced& next = pending.front();
+                if (next.event == entry.record.event && next.port == entry.record.port &&
+                    next.fullSize == entry.record.fullSize) {
+                    pending.pop_front();
+                    reproduced++;
+                    continue;
+                }
+
+                // The firmware did something else than the real MessageManager does here
+                diverged += pending.size();
+                pending.clear();
+            }
+
+            inject(entry);
+        }
+
+        diverged += pending.size();
+    }
+
+    wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    MessageTraceRecorder::getInstance().stop();
+}
+
+void Replay::inject(const TraceEntry& entry) {
+    const MessageTraceRecord& record = entry.record;
+
+    if (record.fullSize < sizeof(DataMessageGeneric) || record.size > record.fullSize) {
+        diverged++;
+        return;
+    }
+
+    DataMessage* message = nullptr;
+
+    // The truncated part of the messages is replayed as zeros
+    measure(StageDecode, [&]() {
+        message = (DataMessage*)pvPortMalloc(record.fullSize);
+        memcpy(message, entry.message.data(), record.size);
+        memset((uint8_t*)message + record.size, 0, record.fullSize - record.size);
+    });
+
+    if (record.size < record.fullSize)
+        truncated++;
+
+    injecting = true;
+
+    if (record.event == TraceReceived) {
+        measure(StageReceive, [&]() {
+            MessageManager::getInstance().processReceivedMessage((messagePort)record.port,
+                                                                 message);
+        });
+        received++;
+    } else {
+        measure(StageSend, [&]() {
+            MessageManager::getInstance().sendMessage((messagePort)record.port, message,
+                                                      (DeliveryMode)record.mode);
+        });
+        sent++;
+    }
+
+    injecting = false;
+
+    vPortFree(message);
+
+    messages++;
+    bytes += record.fullSize;
+}
+
+void Replay::produced(MessageTraceEvent event, uint8_t port, uint32_t fullSize) {
+    if (injecting) {
+        injecting = false;
+        return;
+    }
+
+    pending.push_back({event, port, fullSize});
+}
+
+const char* Replay::getStageName(ReplayStage stage) {
+    switch (stage) {
+        case StageDecode:
+            return "decode";
+        case StageReceive:
+            return "receive";
+        case StageSend:
+            return "send";
+        case StageJson:
+            return "json";
+        case StageLora:
+            return "lora";
+        default:
+            return "unknown";
+    }
+}
+
+void Replay::printSummary(const std::string& path) {
+    printf("Trace %s: %u records of node %X, %.1f s\n", path.c_str(), traceRecords, localAddress,
+           traceDuration / 1e6);
+
+    printf("Replayed %u times as a %s in %.3f s: %llu received, %llu sent, %u truncated\n",
+           options.repeat, options.gateway ? "gateway" : "node", wallSeconds,
+           (unsigned long long)received, (unsigned long long)sent, truncated);
+
+    printf("Reproduced by the MessageManager %u, diverged %u\n", reproduced, diverged);
+
+    if (wallSeconds > 0) {
+        printf("Throughput %.0f msg/s, %.0f B/s, JSON %.0f B/s\n", messages / wallSeconds,
+               bytes / wallSeconds, jsonBytes / wallSeconds);
+    }
+
+    for (uint8_t i = 0; i < StageCount; i++) {
+        StageStats& stats = stages[i];
+        if (stats.latency.getCount() == 0)
+            continue;
+
+        String line = stats.latency.toString(getStageName((ReplayStage)i), "ns");
+        line.trim();
+
+        printf("%s, allocs/op %.2f\n", line.c_str(),
+               (double)stats.allocations / stats.latency.getCount());
+    }
+
+    for (ServiceStub* service : services) {
+        if (service->delivered == 0 && service->gatewayMessages == 0)
+            continue;
+
+        printf("%s stub: delivered %u, through the gateway %u\n", service->serviceName.c_str(),
+               service->delivered, service->gatewayMessages);
+    }
+}
+
+void Replay::printJSON() {
+    printf("{\"records\":%u,\"repeat\":%u,\"gateway\":%s,\"wallSeconds\":%.6f,\"received\":%u,"
+           "\"sent\":%u,\"truncated\":%u,\"reproduced\":%u,\"diverged\":%u,"
+           "\"msgsPerSecond\":%.1f,\"bytesPerSecond\":%.1f,\"stages\":{",
+           traceRecords, options.repeat, options.gateway ? "true" : "false", wallSeconds,
+           received, sent, truncated, reproduced, diverged,
+           wallSeconds > 0 ? messages / wallSeconds : 0, wallSeconds > 0 ? bytes / wallSeconds : 0);
+
+    bool first = true;
+    for (uint8_t i = 0; i < StageCount; i++) {
+        StageStats& stats = stages[i];
+        uint32_t count = stats.latency.getCount();
+        if (count == 0)
+            continue;
+
+        printf("%s\"%s\":{\"count\":%u,\"meanNs\":%u,\"p50Ns\":%u,\"p99Ns\":%u,\"maxNs\":%u,"
+               "\"allocsPerOp\":%.3f}",
+               first ? "" : ",", getStageName((ReplayStage)i), count, stats.latency.getMean(),
+               stats.latency.getPercentile(50), stats.latency.getPercentile(99),
+               stats.latency.getMax(), (double)stats.allocations / count);
+        first = false;
+    }
+
+    printf("}}\n");
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <string>
+
+#include "helpers/histogram.h"
+
+#include "traceReader.h"
+
+#include "serviceStubs.h"
+
+struct ReplayOptions {
+    double speed = 0;  // 1 at the recorded pace, N times faster, 0 without waiting
+    uint32_t repeat = 1;
+    bool gateway = false;  // MQTT connected, the uplinks are converted to JSON
+    bool json = false;
+};
+
+enum ReplayStage : uint8_t {
+    StageDecode = 0,   // Rebuild the DataMessage from the record
+    StageReceive = 1,  // MessageManager::processReceivedMessage
+    StageSend = 2,     // MessageManager::sendMessage
+    StageJson = 3,     // MessageManager::getJSON before publishing to MQTT, inside send
+    StageLora = 4,     // Copy into a LoRaMesher frame, inside send or receive
+    StageCount
+};
+
+struct StageStats {
+    Histogram latency;  // ns
+    uint64_t totalTime = 0;
+    uint64_t allocations = 0;
+};
+
+/**
+ * @brief Feeds a trace through the real MessageManager on the host. The received records go
+ * through processReceivedMessage and the sent ones through sendMessage, with a virtual millis()
+ * that follows the time of the trace. The services are ServiceStubs, the replay measures the
+ * dispatch, the JSON conversions and the transports, not the logic of the services.
+ *
+ * The records that the MessageManager produces by itself while replaying another one, as the
+ * forwards of the downlinks or the InternalPort sends, are recorded again by the host
+ * MessageTraceRecorder. When the next records of the trace are the same they are counted as
+ * reproduced instead of being injected twice.
+ *
+ */
+class Replay {
+public:
+    static Replay& getInstance() {
+        static Replay instance;
+        return instance;
+    }
+
+    void run(TraceReader& trace, const ReplayOptions& options);
+
+    /**
+     * @brief Run a stage and add its time and allocations
+     *
+     */
+    template <typename F>
+    void measure(ReplayStage stage, F function) {
+        uint64_t allocations = hostAllocations;
+        auto start = std::chrono::steady_clock::now();
+
+        function();
+
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+        StageStats& stats = stages[stage];
+        stats.latency.add(elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed);
+        stats.totalTime += elapsed;
+        stats.allocations += hostAllocations - allocations;
+    }
+
+    /**
+     * @brief Called by the host MessageTraceRecorder for every record of the MessageManager
+     *
+     */
+    void produced(MessageTraceEvent event, uint8_t port, uint32_t fullSize);
+
+    /**
+     * @brief Virtual time of the node, in ms
+     *
+     */
+    uint32_t getMillis() { return startMillis + (uint32_t)(now / 1000); }
+
+    void countJSON(size_t bytes) { jsonBytes += bytes; }
+
+    void printSummary(const std::string& path);
+
+    void printJSON();
+
+private:
+    Replay() {}
+
+    struct Produced {
+        uint8_t event;
+        uint8_t port;
+        uint32_t fullSize;
+    };
+
+    ReplayOptions options;
+
+    std::vector<ServiceStub*> services;
+
+    StageStats stages[StageCount];
+
+    std::deque<Produced> pending;
+
+    // The first record during an injection is the injected message itself
+    bool injecting = false;
+
+    uint32_t startMillis = 0;
+    uint64_t now = 0;
+
+    uint16_t localAddress = 0;
+    uint32_t traceRecords = 0;
+    uint64_t traceDuration = 0;
+
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t jsonBytes = 0;
+    uint32_t received = 0;
+    uint32_t sent = 0;
+    uint32_t truncated = 0;
+    uint32_t reproduced = 0;
+    uint32_t diverged = 0;
+
+    double wallSeconds = 0;
+
+    void inject(const TraceEntry& entry);
+
+    static const char* getStageName(ReplayStage stage);
+};
@@ -0,0 +1,70 @@
+#include "serviceStubs.h"
+
+#include "message/messageManager.h"
+
+#include "led/ledMessage.h"
+
+#include "sensor/sensorServiceMessage.h"
+
+#include "sensor/history/sensorHistoryMessage.h"
+
+#include "time/timeSyncMessage.h"
+
+/**
+ * @brief JSON of the services that nest the message in "data", as Led::getJSON
+ *
+ */
+template <class T>
+static String serializeData(DataMessage* message) {
+    StaticJsonDocument<2048> doc;
+
+    JsonObject data = doc.createNestedObject("data");
+
+    ((T*)message)->serialize(data);
+
+    String json;
+    serializeJson(doc, json);
+
+    return json;
+}
+
+/**
+ * @brief JSON of the services that serialize the message in the root, as SensorService::getJSON
+ *
+ */
+template <class T>
+static String serializeRoot(DataMessage* message) {
+    StaticJsonDocument<2000> doc;
+
+    JsonObject root = doc.to<JsonObject>();
+
+    ((T*)message)->serialize(root);
+
+    String json;
+    serializeJson(doc, json);
+
+    return json;
+}
+
+void addServiceStubs(std::vector<ServiceStub*>& services) {
+    services.push_back(new ServiceStub(LedApp, "Led", serializeData<LedMessage>));
+    services.push_back(
+        new ServiceStub(SensorApp, "Sensor", serializeRoot<SensorCommandMessage>));
+    services.push_back(
+        new ServiceStub(TimeSyncApp, "TimeSync", serializeData<TimeSyncMessage>));
+    services.push_back(
+        new ServiceStub(HistoryApp, "History", serializeData<SensorHistoryMessage>));
+
+    // The other services only get the header, their messages need the hardware headers
+    const appPort headerOnly[] = {LoRaChat, BluetoothApp, WiFiApp, GPSApp, WalletApp,
+                                  CommandApp, LoRaMesherApp, MQTTApp, SimApp, MetadataApp,
+                                  MonApp, DisplayApp, TransferApp};
+
+    for (appPort port : headerOnly) {
+        services.push_back(new ServiceStub(port, "App " + String((uint8_t)port),
+                                             serializeData<DataMessageGeneric>));
+    }
+
+    for (ServiceStub* service : services)
+        MessageManager::getInstance().addMessageService(service);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+
+#include "message/messageService.h"
+
+/**
+ * @brief Stub of a firmware service in the MessageManager of the replay. It counts the messages
+ * dispatched to it and converts them to JSON with the real message classes, as the getJSON of the
+ * service. The logic of the services needs the hardware and FreeRTOS and is not replayed.
+ *
+ */
+class ServiceStub : public MessageService {
+public:
+    typedef std::function<String(DataMessage* message)> Serializer;
+
+    ServiceStub(uint8_t id, String name, Serializer serializer)
+        : MessageService(id, name), serializer(serializer) {
+        commandService = new CommandService();
+    }
+
+    void processReceivedMessage(messagePort port, DataMessage* message) override { delivered++; }
+
+    void processGatewayMessage(DataMessage* message) override { gatewayMessages++; }
+
+    String getJSON(DataMessage* message) override { return serializer(message); }
+
+    uint32_t delivered = 0;
+
+    uint32_t gatewayMessages = 0;
+
+private:
+    Serializer serializer;
+};
+
+/**
+ * @brief Register a ServiceStub for every appPort in the MessageManager
+ *
+ */
+void addServiceStubs(std::vector<ServiceStub*>& services);
@@ -0,0 +1,120 @@
+#include "traceReader.h"
+
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+
+bool TraceReader::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "Could not open " + path;
+        return false;
+    }
+
+    std::stringstream content;
+    content << file.rdbuf();
+    std::string text = content.str();
+
+    std::vector<uint8_t> data(text.begin(), text.end());
+
+    uint32_t magic = 0;
+    if (data.size() >= sizeof(magic))
+        memcpy(&magic, data.data(), sizeof(magic));
+
+    if (magic != MESSAGE_TRACE_MAGIC && !decodeDump(text, data)) {
+        error = "Neither a trace nor a log with a trace dump";
+        return false;
+    }
+
+    return parse(data);
+}
+
+bool TraceReader::parse(const std::vector<uint8_t>& data) {
+    if (data.size() < sizeof(MessageTraceHeader)) {
+        error = "Trace shorter than its header";
+        return false;
+    }
+
+    memcpy(&header, data.data(), sizeof(MessageTraceHeader));
+
+    if (header.magic != MESSAGE_TRACE_MAGIC) {
+        error = "Not a message trace";
+        return false;
+    }
+
+    if (header.version != MESSAGE_TRACE_VERSION) {
+        error = "Unsupported trace version " + std::to_string(header.version);
+        return false;
+    }
+
+    entries.clear();
+
+    size_t offset = sizeof(MessageTraceHeader);
+    uint64_t time = 0;
+
+    while (offset + sizeof(MessageTraceRecord) <= data.size()) {
+        TraceEntry entry;
+        memcpy(&entry.record, data.data() + offset, sizeof(MessageTraceRecord));
+        offset += sizeof(MessageTraceRecord);
+
+        // A dump cut in the middle of a record, keep the complete ones
+        if (offset + entry.record.size > data.size())
+            break;
+
+        time += entry.record.delta;
+        entry.time = time;
+        entry.message.assign(data.begin() + offset, data.begin() + offset + entry.record.size);
+        offset += entry.record.size;
+
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+bool TraceReader::decodeDump(const std::string& log, std::vector<uint8_t>& data) {
+    size_t begin = log.find(MESSAGE_TRACE_DUMP_BEGIN);
+    if (begin == std::string::npos)
+        return false;
+    begin += strlen(MESSAGE_TRACE_DUMP_BEGIN);
+
+    size_t end = log.find(MESSAGE_TRACE_DUMP_END, begin);
+    if (end == std::string::npos)
+        return false;
+
+    static const std::string alphabet =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    data.clear();
+
+    std::istringstream lines(log.substr(begin, end - begin));
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+            line.pop_back();
+
+        // Log lines of other tasks printed in the middle of the dump
+        if (line.empty() || line.size() % 4 != 0 ||
+            line.find_first_not_of(alphabet + "=") != std::string::npos)
+            continue;
+
+        uint32_t bits = 0;
+        int count = 0;
+
+        for (char character : line) {
+            if (character == '=')
+                break;
+
+            bits = (bits << 6) | alphabet.find(character);
+            count += 6;
+            if (count >= 8) {
+                count -= 8;
+                data.push_back((bits >> count) & 0xFF);
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "message/messageTrace.h"
+
+/**
+ * @brief Record of a trace with its message and its time since the start of the recording
+ *
+ */
+struct TraceEntry {
+    uint64_t time;  // us
+    MessageTraceRecord record;
+    std::vector<uint8_t> message;
+};
+
+/**
+ * @brief Reads the traces of MessageTraceRecorder, either the binary file copied from SPIFFS or a
+ * serial log that contains the output of /traceDump
+ *
+ */
+class TraceReader {
+public:
+    /**
+     * @brief Load a trace
+     *
+     * @return true If the trace is valid, otherwise getError describes the problem
+     */
+    bool load(const std::string& path);
+
+    const MessageTraceHeader& getHeader() { return header; }
+
+    const std::vector<TraceEntry>& getEntries() { return entries; }
+
+    const std::string& getError() { return error; }
+
+private:
+    MessageTraceHeader header = {};
+
+    std::vector<TraceEntry> entries;
+
+    std::string error;
+
+    bool parse(const std::vector<uint8_t>& data);
+
+    /**
+     * @brief Decode the base64 lines between MESSAGE_TRACE_DUMP_BEGIN and MESSAGE_TRACE_DUMP_END
+     *
+     * @return true If the markers were found
+     */
+    static bool decodeDump(const std::string& log, std::vector<uint8_t>& data);
+};
@@ -0,0 +1,47 @@
+#include "replay.h"
+
+#include "message/messageManager.h"
+
+// Host versions of the transports and of the recorder used by the MessageManager
+
+static void copyToFrame(DataMessage* message) {
+    Replay::getInstance().measure(StageLora, [&]() {
+        uint32_t size = message->getDataMessageSize();
+        uint8_t* frame = (uint8_t*)pvPortMalloc(size);
+        memcpy(frame, message, size);
+        vPortFree(frame);
+    });
+}
+
+void LoRaMeshService::send(DataMessage* message, DeliveryMode mode, DeliveryCallback callback) {
+    copyToFrame(message);
+}
+
+bool LoRaMeshService::sendClosestGateway(DataMessage* message, DeliveryMode mode,
+                                         DeliveryCallback callback) {
+    copyToFrame(message);
+    return true;
+}
+
+bool MqttService::writeToMqtt(DataMessage* message) {
+    Replay::getInstance().measure(StageJson, [&]() {
+        String json = MessageManager::getInstance().getJSON(message);
+        Replay::getInstance().countJSON(json.length());
+    });
+    return true;
+}
+
+String MessageTraceRecorder::start() {
+    recording = true;
+    return "";
+}
+
+String MessageTraceRecorder::stop() {
+    recording = false;
+    return "";
+}
+
+void MessageTraceRecorder::append(MessageTraceEvent event, uint8_t port, DataMessage* message,
+                                  uint8_t mode) {
+    Replay::getInstance().produced(event, port, message->getDataMessageSize());
+}